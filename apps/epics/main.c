@@ -1596,14 +1596,16 @@ int main(int argc, char *argv[])
                     Read_Property_Multiple_Data.new_data = false;
                     myState = ProcessRPMData(
                         Read_Property_Multiple_Data.rpm_data, myState);
-                    if (tsm_invoke_id_free(Request_Invoke_ID)) {
+                    if (tsm_invoke_id_free_peer(
+                            &Target_Address, Request_Invoke_ID)) {
                         Request_Invoke_ID = 0;
                     } else {
                         assert(false); /* How can this be? */
                         Request_Invoke_ID = 0;
                     }
                     elapsed_seconds = 0;
-                } else if (tsm_invoke_id_free(Request_Invoke_ID)) {
+                } else if (tsm_invoke_id_free_peer(
+                               &Target_Address, Request_Invoke_ID)) {
                     elapsed_seconds = 0;
                     Request_Invoke_ID = 0;
                     if (myState == GET_HEADING_RESPONSE)
@@ -1632,9 +1634,10 @@ int main(int argc, char *argv[])
                         myState = GET_ALL_REQUEST; /* Let's try again */
                     else
                         myState = GET_PROPERTY_REQUEST;
-                } else if (tsm_invoke_id_failed(Request_Invoke_ID)) {
+                } else if (tsm_invoke_id_failed_peer(
+                               &Target_Address, Request_Invoke_ID)) {
                     fprintf(stderr, "\rError: TSM Timeout!\n");
-                    tsm_free_invoke_id(Request_Invoke_ID);
+                    tsm_free_invoke_id_peer(&Target_Address, Request_Invoke_ID);
                     Request_Invoke_ID = 0;
                     elapsed_seconds = 0;
                     if (myState == GET_HEADING_RESPONSE)
@@ -1689,7 +1692,8 @@ int main(int argc, char *argv[])
                         Read_Property_Multiple_Data.rpm_data->object_type,
                         Read_Property_Multiple_Data.rpm_data->object_instance,
                         Read_Property_Multiple_Data.rpm_data->listOfProperties);
-                    if (tsm_invoke_id_free(Request_Invoke_ID)) {
+                    if (tsm_invoke_id_free_peer(
+                            &Target_Address, Request_Invoke_ID)) {
                         Request_Invoke_ID = 0;
                     } else {
                         assert(false); /* How can this be? */
@@ -1708,7 +1712,8 @@ int main(int argc, char *argv[])
                         Property_List_Index++;
                     }
                     myState = GET_PROPERTY_REQUEST; /* Go fetch next Property */
-                } else if (tsm_invoke_id_free(Request_Invoke_ID)) {
+                } else if (tsm_invoke_id_free_peer(
+                               &Target_Address, Request_Invoke_ID)) {
                     Request_Invoke_ID = 0;
                     elapsed_seconds = 0;
                     myState = GET_PROPERTY_REQUEST;
@@ -1745,9 +1750,10 @@ int main(int argc, char *argv[])
                             }
                         }
                     }
-                } else if (tsm_invoke_id_failed(Request_Invoke_ID)) {
+                } else if (tsm_invoke_id_failed_peer(
+                               &Target_Address, Request_Invoke_ID)) {
                     fprintf(stderr, "\rError: TSM Timeout!\n");
-                    tsm_free_invoke_id(Request_Invoke_ID);
+                    tsm_free_invoke_id_peer(&Target_Address, Request_Invoke_ID);
                     elapsed_seconds = 0;
                     Request_Invoke_ID = 0;
                     myState = 3; /* Let's try again, same Property */
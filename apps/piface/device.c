@@ -142,6 +142,19 @@ rr_info_function Device_Objects_RR_Info(BACNET_OBJECT_TYPE object_type)
     return (pObject != NULL ? pObject->Object_RR_Info : NULL);
 }
 
+/** Take the lock of the objects, which this single threaded device
+ * does not need.
+ */
+void Device_Objects_Lock(void)
+{
+}
+
+/** Release the lock of the objects.
+ */
+void Device_Objects_Unlock(void)
+{
+}
+
 /** For a given object type, returns the special property list.
  * This function is used for ReadPropertyMultiple calls which want
  * just Required, just Optional, or All properties.
@@ -612,6 +625,16 @@ void Device_Inc_Database_Revision(void)
     Database_Revision++;
 }
 
+/* there is no Object_List cache to keep up to date */
+void Device_Object_List_Changed(void)
+{
+}
+
+/* there is no object name index to keep up to date */
+void Device_Object_Name_Changed(void)
+{
+}
+
 /** Get the total count of objects supported by this Device Object.
  * @note Since many network clients depend on the object list
  *       for discovery, it must be consistent!
@@ -1402,6 +1425,21 @@ bool Device_COV(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
     return (status);
 }
 
+/** Checks if the objects of a type report their own COV changes
+ * @ingroup ObjHelpers
+ * @param [in] The object type to be looked up.
+ * @return True if the objects call handler_cov_object_changed(),
+ *  and false if their COV flag has to be polled
+ */
+bool Device_COV_Pushed(BACNET_OBJECT_TYPE object_type)
+{
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Objects_Find_Functions(object_type);
+
+    return (pObject != NULL) && pObject->Object_COV_Pushed;
+}
+
 /** Clears the COV flag in the requested Object
  * @ingroup ObjHelpers
  * @param [in] The object type to be looked up.
@@ -361,7 +361,8 @@ int main(int argc, char *argv[])
 
                             break;
                     }
-                } else if (tsm_invoke_id_free(invoke_id)) {
+                } else if (tsm_invoke_id_free_peer(
+                               &Target_Address, invoke_id)) {
                     if (iCount != MY_MAX_BLOCK) {
                         iCount++;
                         invoke_id = 0;
@@ -374,9 +375,10 @@ int main(int argc, char *argv[])
                             break;
                         }
                     }
-                } else if (tsm_invoke_id_failed(invoke_id)) {
+                } else if (tsm_invoke_id_failed_peer(
+                               &Target_Address, invoke_id)) {
                     fprintf(stderr, "\rError: TSM Timeout!\r\n");
-                    tsm_free_invoke_id(invoke_id);
+                    tsm_free_invoke_id_peer(&Target_Address, invoke_id);
                     Error_Detected = true;
                     /* try again or abort? */
                     break;
@@ -45,6 +45,8 @@
 #include "bacnet/basic/tsm/tsm.h"
 #include "bacnet/datalink/datalink.h"
 #include "bacnet/basic/binding/address.h"
+#include "bacnet/basic/binding/bind_schedule.h"
+#include "bacnet/basic/sys/mstimer.h"
 /* include the device object */
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/object/lc.h"
@@ -58,6 +60,11 @@
 #if defined(BAC_UCI)
 #include "bacnet/basic/ucix/ucix.h"
 #endif /* defined(BAC_UCI) */
+#if defined(__linux__)
+#include <pthread.h>
+#include "event_loop.h"
+#include "apdu_workers.h"
+#endif
 
 /** @file server/main.c  Example server application using the BACnet Stack. */
 
@@ -72,6 +79,17 @@ static const char *BACnet_Version = BACNET_VERSION_TEXT;
 /** Buffer used for receiving */
 static uint8_t Rx_Buf[MAX_MPDU] = { 0 };
 
+#ifdef BACNET_ADDRESS_SNAPSHOT
+/** Snapshot of the address bindings, to resume with them after a restart */
+static const char *Address_Snapshot_Filename = "address_cache.bin";
+#endif
+
+/* period of the bind schedule timer, well below the window and the
+   interval in which the bind schedule spaces its Who-Is */
+#ifndef SERVER_BIND_SCHEDULE_MS
+#define SERVER_BIND_SCHEDULE_MS 50
+#endif
+
 /** Initialize the handlers we will utilize.
  * @see Device_Init, apdu_set_unconfirmed_handler, apdu_set_confirmed_handler
  */
@@ -146,6 +164,275 @@ static void Init_Service_Handlers(void)
 #endif
 }
 
+/** Run the timers of the stack and of the objects.
+ * @param elapsed_seconds [in] Seconds elapsed since the previous call.
+ */
+static void Server_Timer_Seconds(uint32_t elapsed_seconds)
+{
+    static uint32_t address_binding_tmr = 0;
+#if defined(INTRINSIC_REPORTING)
+    static uint32_t recipient_scan_tmr = 0;
+#endif
+#if defined(BACNET_TIME_MASTER)
+    BACNET_DATE_TIME bdatetime;
+#endif
+    uint32_t elapsed_milliseconds = 0;
+
+    dcc_timer_seconds(elapsed_seconds);
+    datalink_maintenance_timer(elapsed_seconds);
+    dlenv_maintenance_timer(elapsed_seconds);
+    Load_Control_State_Machine_Handler();
+    elapsed_milliseconds = elapsed_seconds * 1000;
+    handler_cov_timer_seconds(elapsed_seconds);
+    tsm_timer_milliseconds(elapsed_milliseconds);
+    trend_log_timer(elapsed_seconds);
+#if defined(INTRINSIC_REPORTING)
+    Device_local_reporting();
+#endif
+#if defined(BACNET_TIME_MASTER)
+    Device_getCurrentDateTime(&bdatetime);
+    handler_timesync_task(&bdatetime);
+#endif
+    /* scan cache address */
+    address_binding_tmr += elapsed_seconds;
+    if (address_binding_tmr >= 60) {
+        address_cache_timer(address_binding_tmr);
+#ifdef BACNET_ADDRESS_SNAPSHOT
+        address_cache_snapshot_save(Address_Snapshot_Filename);
+#endif
+        address_binding_tmr = 0;
+    }
+#if defined(INTRINSIC_REPORTING)
+    /* try to find addresses of recipients */
+    recipient_scan_tmr += elapsed_seconds;
+    if (recipient_scan_tmr >= NC_RESCAN_RECIPIENTS_SECS) {
+        Notification_Class_find_recipient();
+        recipient_scan_tmr = 0;
+    }
+#endif
+}
+
+#if defined(__linux__)
+/* PDUs handled for each readiness of the datalink, so that the
+   timers are not held off by a flood */
+#define SERVER_RECEIVE_BATCH 64
+/* COV notifications sent for each event */
+#define SERVER_COV_BATCH 32
+/* the lock of the objects and the services, which the worker threads
+   of the datalink and of the confirmed services share */
+#if defined(BACDL_BIP)
+#define Server_Lock() bip_shards_lock()
+#define Server_Unlock() bip_shards_unlock()
+#else
+#define Server_Lock()
+#define Server_Unlock()
+#endif
+
+/** Send the pending COV notifications, a batch at a time. */
+static void Server_COV_Task(void)
+{
+    unsigned count;
+
+    for (count = 0; count < SERVER_COV_BATCH; count++) {
+        if (handler_cov_fsm()) {
+            break;
+        }
+    }
+}
+
+/** Handle the PDUs that are ready on the datalink.
+ * @param fd [in] File descriptor of the datalink.
+ * @param context [in] Not used.
+ */
+static void Server_Receive_Handler(int fd, void *context)
+{
+#if defined(BACDL_BIP)
+    BACNET_PACKET *packet = NULL;
+#else
+    BACNET_ADDRESS src = { 0 };
+    uint16_t pdu_len = 0;
+#endif
+    unsigned count;
+
+    (void)fd;
+    (void)context;
+#if defined(BACDL_BIP)
+    /* the datagrams already taken from the socket are handled, too,
+       since the socket does not report them as ready again */
+    for (count = 0; (count < SERVER_RECEIVE_BATCH) || bip_receive_pending();
+         count++) {
+        /* handled in place, in the buffer that the datalink received */
+        packet = bip_receive_packet(0);
+        if (!packet) {
+            break;
+        }
+        Server_Lock();
+        npdu_handler_packet(packet);
+        Server_Unlock();
+        pktbuf_release(packet);
+    }
+#else
+    for (count = 0; count < SERVER_RECEIVE_BATCH; count++) {
+        pdu_len = datalink_receive(&src, &Rx_Buf[0], MAX_MPDU, 0);
+        if (pdu_len == 0) {
+            break;
+        }
+        Server_Lock();
+        npdu_handler(&src, &Rx_Buf[0], pdu_len);
+        Server_Unlock();
+    }
+#endif
+    Server_Lock();
+    Server_COV_Task();
+    Server_Unlock();
+}
+
+/** Run the timers once a second.
+ * @param milliseconds [in] Time elapsed since the previous expiry.
+ * @param context [in] Not used.
+ */
+static void Server_Timer_Handler(uint32_t milliseconds, void *context)
+{
+    /* the part of a second not yet given to the timers */
+    static uint32_t elapsed_milliseconds = 0;
+    uint32_t elapsed_seconds = 0;
+
+    (void)context;
+    elapsed_milliseconds += milliseconds;
+    elapsed_seconds = elapsed_milliseconds / 1000;
+    elapsed_milliseconds %= 1000;
+    Server_Lock();
+    if (elapsed_seconds) {
+        Server_Timer_Seconds(elapsed_seconds);
+    }
+    Server_COV_Task();
+    Server_Unlock();
+}
+
+/** Run the bind schedule, which works in fractions of a second.
+ * @param milliseconds [in] Time elapsed since the previous expiry.
+ * @param context [in] Not used.
+ */
+static void Server_Bind_Schedule_Handler(uint32_t milliseconds, void *context)
+{
+    (void)context;
+    if (milliseconds > UINT16_MAX) {
+        milliseconds = UINT16_MAX;
+    }
+    Server_Lock();
+    bind_schedule_timer((uint16_t)milliseconds);
+    Server_Unlock();
+}
+
+#if defined(BACDL_BIP)
+/* the users of the received packets, which take no other lock */
+static pthread_mutex_t Server_Packet_Mutex = PTHREAD_MUTEX_INITIALIZER;
+/* true while the worker threads of the sharded receive run */
+static bool Server_Sharded;
+
+/** Take the lock of the users of the received packets. */
+static void Server_Packet_Lock(void)
+{
+    pthread_mutex_lock(&Server_Packet_Mutex);
+}
+
+/** Release the lock of the users of the received packets. */
+static void Server_Packet_Unlock(void)
+{
+    pthread_mutex_unlock(&Server_Packet_Mutex);
+}
+
+/** Have the objects, the TSM and the packets take their locks, for the
+ * handlers that run on more than one thread.
+ * @param enable [in] true to take the locks, false to drop them.
+ */
+static void Server_Thread_Locks(bool enable)
+{
+    if (enable) {
+        /* each property, transmit buffer, segmented response and
+           received packet is taken with the lock held, and the
+           handlers run without it in between */
+        Device_Set_Lock_Functions(bip_shards_lock, bip_shards_unlock);
+        tsm_pdu_set_lock_functions(bip_shards_lock, bip_shards_unlock);
+        pktbuf_set_lock_functions(Server_Packet_Lock, Server_Packet_Unlock);
+    } else {
+        Device_Set_Lock_Functions(NULL, NULL);
+        tsm_pdu_set_lock_functions(NULL, NULL);
+        pktbuf_set_lock_functions(NULL, NULL);
+    }
+}
+
+/** Handle a packet received by a worker thread of the sharded receive.
+ * @param packet [in] The packet, in the buffer of the worker.
+ */
+static void Server_Shard_Handler(BACNET_PACKET *packet)
+{
+    if (packet->header.valid &&
+        apdu_workers_service(packet->header.service_choice)) {
+        /* a read of a unicast confirmed request, whose header the
+           datalink parsed, locks the objects for each property */
+        npdu_handler_packet(packet);
+        return;
+    }
+    /* the other services are not thread safe */
+    Server_Lock();
+    npdu_handler_packet(packet);
+    Server_COV_Task();
+    Server_Unlock();
+}
+#endif
+
+/** Shard the receive of the datalink over worker threads, when the
+ * BACNET_IP_SHARDS environment variable asks for more than one.
+ * @return true if the workers were started.
+ */
+static bool Server_Shards_Start(void)
+{
+#if defined(BACDL_BIP)
+    char *pEnv = NULL;
+    long count = 0;
+
+    pEnv = getenv("BACNET_IP_SHARDS");
+    if (pEnv) {
+        count = strtol(pEnv, NULL, 0);
+    }
+    if (count > 1) {
+        Server_Thread_Locks(true);
+        if (bip_shards_start((unsigned)count, Server_Shard_Handler)) {
+            Server_Sharded = true;
+            return true;
+        }
+        Server_Thread_Locks(false);
+    }
+#endif
+
+    return false;
+}
+
+/** Run the confirmed services that may take long on a pool of worker
+ * threads, when the BACNET_SERVICE_WORKERS environment variable asks
+ * for any. The datalink has to be safe to send from each of them.
+ */
+static void Server_Workers_Start(void)
+{
+#if defined(BACDL_BIP)
+    char *pEnv = NULL;
+    long count = 0;
+
+    pEnv = getenv("BACNET_SERVICE_WORKERS");
+    if (pEnv) {
+        count = strtol(pEnv, NULL, 0);
+    }
+    if (count > 0) {
+        Server_Thread_Locks(true);
+        if (!apdu_workers_init((unsigned)count) && !Server_Sharded) {
+            Server_Thread_Locks(false);
+        }
+    }
+#endif
+}
+#endif
+
 static void print_usage(const char *filename)
 {
     printf("Usage: %s [device-instance [device-name]]\n", filename);
@@ -189,14 +476,7 @@ int main(int argc, char *argv[])
     time_t last_seconds = 0;
     time_t current_seconds = 0;
     uint32_t elapsed_seconds = 0;
-    uint32_t elapsed_milliseconds = 0;
-    uint32_t address_binding_tmr = 0;
-#if defined(INTRINSIC_REPORTING)
-    uint32_t recipient_scan_tmr = 0;
-#endif
-#if defined(BACNET_TIME_MASTER)
-    BACNET_DATE_TIME bdatetime;
-#endif
+    struct mstimer bind_timer;
 #if defined(BAC_UCI)
     int uciId = 0;
     struct uci_context *ctx;
@@ -249,16 +529,43 @@ int main(int argc, char *argv[])
     /* load any static address bindings to show up
        in our device bindings list */
     address_init();
+#ifdef BACNET_ADDRESS_SNAPSHOT
+    /* resume with the bindings from before a restart */
+    address_cache_snapshot_load(Address_Snapshot_Filename);
+#endif
+    /* coalesce the Who-Is of bind requests into ranges */
+    bind_schedule_init(Send_WhoIs_Remote);
     Init_Service_Handlers();
     if (argc > 2) {
         Device_Object_Name_ANSI_Init(argv[2]);
     }
     dlenv_init();
     atexit(datalink_cleanup);
-    /* configure the timeout values */
-    last_seconds = time(NULL);
     /* broadcast an I-Am on startup */
     Send_I_Am(&Handler_Transmit_Buffer[0]);
+#if defined(__linux__)
+    /* wait on the datalink and the timers, where the datalink has a
+       file descriptor, instead of polling; or leave the datalink to
+       the worker threads of a sharded receive */
+    if (event_loop_init() &&
+        (event_loop_timer_add(1000, Server_Timer_Handler, NULL) >= 0) &&
+        (event_loop_timer_add(SERVER_BIND_SCHEDULE_MS,
+             Server_Bind_Schedule_Handler, NULL) >= 0) &&
+        (Server_Shards_Start() ||
+            event_loop_fd_add(
+                datalink_get_fd(), Server_Receive_Handler, NULL))) {
+        Server_Workers_Start();
+        event_loop_run();
+        apdu_workers_cleanup();
+        event_loop_cleanup();
+        return 0;
+    }
+    event_loop_cleanup();
+#endif
+    /* configure the timeout values */
+    last_seconds = time(NULL);
+    mstimer_init();
+    mstimer_set(&bind_timer, SERVER_BIND_SCHEDULE_MS);
     /* loop forever */
     for (;;) {
         /* input */
@@ -275,37 +582,13 @@ int main(int argc, char *argv[])
         elapsed_seconds = (uint32_t)(current_seconds - last_seconds);
         if (elapsed_seconds) {
             last_seconds = current_seconds;
-            dcc_timer_seconds(elapsed_seconds);
-            datalink_maintenance_timer(elapsed_seconds);
-            dlenv_maintenance_timer(elapsed_seconds);
-            Load_Control_State_Machine_Handler();
-            elapsed_milliseconds = elapsed_seconds * 1000;
-            handler_cov_timer_seconds(elapsed_seconds);
-            tsm_timer_milliseconds(elapsed_milliseconds);
-            trend_log_timer(elapsed_seconds);
-#if defined(INTRINSIC_REPORTING)
-            Device_local_reporting();
-#endif
-#if defined(BACNET_TIME_MASTER)
-            Device_getCurrentDateTime(&bdatetime);
-            handler_timesync_task(&bdatetime);
-#endif
+            Server_Timer_Seconds(elapsed_seconds);
         }
-        handler_cov_task();
-        /* scan cache address */
-        address_binding_tmr += elapsed_seconds;
-        if (address_binding_tmr >= 60) {
-            address_cache_timer(address_binding_tmr);
-            address_binding_tmr = 0;
+        if (mstimer_expired(&bind_timer)) {
+            bind_schedule_timer((uint16_t)mstimer_elapsed(&bind_timer));
+            mstimer_restart(&bind_timer);
         }
-#if defined(INTRINSIC_REPORTING)
-        /* try to find addresses of recipients */
-        recipient_scan_tmr += elapsed_seconds;
-        if (recipient_scan_tmr >= NC_RESCAN_RECIPIENTS_SECS) {
-            Notification_Class_find_recipient();
-            recipient_scan_tmr = 0;
-        }
-#endif
+        handler_cov_task();
         /* output */
 
         /* blink LEDs, Turn on or off outputs, etc */
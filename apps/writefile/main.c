@@ -255,7 +255,8 @@ int main(int argc, char *argv[])
             }
             /* has the previous invoke id expired or returned?
                note: invoke ID = 0 is invalid, so it will be idle */
-            if ((invoke_id == 0) || tsm_invoke_id_free(invoke_id)) {
+            if ((invoke_id == 0) ||
+                tsm_invoke_id_free_peer(&Target_Address, invoke_id)) {
                 if (End_Of_File_Detected || Error_Detected) {
                     printf("\r\n");
                     break;
@@ -289,9 +290,9 @@ int main(int argc, char *argv[])
                     Target_Device_Object_Instance, Target_File_Object_Instance,
                     fileStartPosition, &fileData);
                 Current_Invoke_ID = invoke_id;
-            } else if (tsm_invoke_id_failed(invoke_id)) {
+            } else if (tsm_invoke_id_failed_peer(&Target_Address, invoke_id)) {
                 fprintf(stderr, "\rError: TSM Timeout!\r\n");
-                tsm_free_invoke_id(invoke_id);
+                tsm_free_invoke_id_peer(&Target_Address, invoke_id);
                 Error_Detected = true;
                 /* try again or abort? */
                 break;
@@ -1598,6 +1598,21 @@ bool Device_COV(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
     return (status);
 }
 
+/** Checks if the objects of a type report their own COV changes
+ * @ingroup ObjHelpers
+ * @param [in] The object type to be looked up.
+ * @return True if the objects call handler_cov_object_changed(),
+ *  and false if their COV flag has to be polled
+ */
+bool Device_COV_Pushed(BACNET_OBJECT_TYPE object_type)
+{
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Objects_Find_Functions(object_type);
+
+    return (pObject != NULL) && pObject->Object_COV_Pushed;
+}
+
 /** Clears the COV flag in the requested Object
  * @ingroup ObjHelpers
  * @param [in] The object type to be looked up.
@@ -0,0 +1,280 @@
+/**
+ * @file
+ * @brief Pool of worker threads for the confirmed service handlers
+ *
+ * @section DESCRIPTION
+ *
+ * The APDU handler gives the confirmed service requests to
+ * apdu_workers_dispatch(), which copies those of the pooled services
+ * into a fixed queue and runs the rest, and any that do not fit, on the
+ * receiving thread. The handlers run without a lock of their own: the
+ * objects are locked for each property, or each ReadRange read, and the
+ * TSM locks its segmented responses, while each worker encodes into its
+ * own buffers.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "bacnet/config.h"
+#include "bacnet/bacdef.h"
+#include "bacnet/bacaddr.h"
+#include "bacnet/bacenum.h"
+#include "bacnet/apdu.h"
+#include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/pktbuf.h"
+#include "apdu_workers.h"
+
+/* number of worker threads */
+#ifndef APDU_WORKERS_MAX
+#define APDU_WORKERS_MAX 16
+#endif
+/* number of requests that wait for a worker */
+#ifndef APDU_WORKERS_QUEUE_MAX
+#define APDU_WORKERS_QUEUE_MAX 32
+#endif
+
+/* A queued confirmed service request, in place in its received packet,
+   or copied from the receive buffer where the packet is not known */
+struct apdu_workers_request {
+    uint8_t service_choice;
+    confirmed_function handler;
+    BACNET_ADDRESS src;
+    BACNET_CONFIRMED_SERVICE_DATA service_data;
+    /* the retained packet that the service request is in, or NULL */
+    BACNET_PACKET *packet;
+    uint8_t *service_request;
+    uint16_t service_len;
+    uint8_t copy[MAX_APDU];
+};
+
+static struct apdu_workers_request Request_Queue[APDU_WORKERS_QUEUE_MAX];
+static unsigned Request_Head;
+static unsigned Request_Count;
+static pthread_mutex_t Request_Mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Request_Ready = PTHREAD_COND_INITIALIZER;
+
+static pthread_t Worker_Thread[APDU_WORKERS_MAX];
+static unsigned Worker_Count;
+static bool Workers_Running;
+
+/**
+ * @brief Determine if a confirmed service runs on the pool.
+ * Only the reads are pooled, which lock the objects for each property;
+ * the writes need the lock of the server around the whole request.
+ *
+ * @param service_choice - the confirmed service
+ *
+ * @return true if the service runs on the pool
+ */
+bool apdu_workers_service(uint8_t service_choice)
+{
+    bool status = false;
+
+    switch (service_choice) {
+        case SERVICE_CONFIRMED_READ_PROPERTY:
+        case SERVICE_CONFIRMED_READ_PROP_MULTIPLE:
+        case SERVICE_CONFIRMED_READ_RANGE:
+        case SERVICE_CONFIRMED_ATOMIC_READ_FILE:
+            status = true;
+            break;
+        default:
+            break;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Queue a confirmed service request for the workers, or run its
+ * handler now if the service is not pooled or the queue is full.
+ *
+ * @param service_choice - the confirmed service
+ * @param handler - the handler of the service
+ * @param service_request - the service request, in the receive buffer
+ * @param service_len - the number of bytes of the service request
+ * @param src - the source address
+ * @param service_data - the decoded header of the confirmed request
+ */
+static void apdu_workers_dispatch(uint8_t service_choice,
+    confirmed_function handler,
+    uint8_t *service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS *src,
+    BACNET_CONFIRMED_SERVICE_DATA *service_data)
+{
+    struct apdu_workers_request *request;
+    BACNET_PACKET *packet = apdu_packet();
+    bool queued = false;
+
+    if (apdu_workers_service(service_choice) &&
+        (service_len <= MAX_APDU)) {
+        pthread_mutex_lock(&Request_Mutex);
+        if (Workers_Running && (Request_Count < APDU_WORKERS_QUEUE_MAX)) {
+            request = &Request_Queue[(Request_Head + Request_Count) %
+                APDU_WORKERS_QUEUE_MAX];
+            request->service_choice = service_choice;
+            request->handler = handler;
+            bacnet_address_copy(&request->src, src);
+            request->service_data = *service_data;
+            request->service_len = service_len;
+            if (packet && pktbuf_retain(packet)) {
+                request->packet = packet;
+                request->service_request = service_request;
+            } else {
+                request->packet = NULL;
+                request->service_request = request->copy;
+                if (service_len > 0) {
+                    memcpy(request->copy, service_request, service_len);
+                }
+            }
+            Request_Count++;
+            pthread_cond_signal(&Request_Ready);
+            queued = true;
+        }
+        pthread_mutex_unlock(&Request_Mutex);
+    }
+    if (!queued) {
+        handler(service_request, service_len, src, service_data);
+    }
+}
+
+/**
+ * @brief Take the oldest of the queued requests, with the lock of the
+ * queue held. The copy of a request that is not in its packet is taken
+ * along, since the slot of the queue may be reused.
+ *
+ * @param request - returns the request
+ */
+static void apdu_workers_take(struct apdu_workers_request *request)
+{
+    struct apdu_workers_request *queued = &Request_Queue[Request_Head];
+
+    request->service_choice = queued->service_choice;
+    request->handler = queued->handler;
+    bacnet_address_copy(&request->src, &queued->src);
+    request->service_data = queued->service_data;
+    request->packet = queued->packet;
+    request->service_len = queued->service_len;
+    if (queued->packet) {
+        request->service_request = queued->service_request;
+    } else {
+        request->service_request = request->copy;
+        if (queued->service_len > 0) {
+            memcpy(request->copy, queued->copy, queued->service_len);
+        }
+    }
+    Request_Head = (Request_Head + 1) % APDU_WORKERS_QUEUE_MAX;
+    Request_Count--;
+}
+
+/**
+ * @brief Worker thread: run the handlers of the queued requests.
+ *
+ * @param arg - not used
+ *
+ * @return NULL
+ */
+static void *apdu_workers_thread(void *arg)
+{
+    struct apdu_workers_request request;
+
+    (void)arg;
+    pthread_mutex_lock(&Request_Mutex);
+    for (;;) {
+        while (Workers_Running && (Request_Count == 0)) {
+            pthread_cond_wait(&Request_Ready, &Request_Mutex);
+        }
+        if (!Workers_Running) {
+            break;
+        }
+        apdu_workers_take(&request);
+        pthread_mutex_unlock(&Request_Mutex);
+        request.handler(request.service_request, request.service_len,
+            &request.src, &request.service_data);
+        pktbuf_release(request.packet);
+        pthread_mutex_lock(&Request_Mutex);
+    }
+    pthread_mutex_unlock(&Request_Mutex);
+
+    return NULL;
+}
+
+/**
+ * @brief Start the worker threads, and have the APDU handler queue the
+ * pooled confirmed services for them. The datalink shall be safe to
+ * send from more than one thread, and the lock functions of the objects
+ * (Device_Set_Lock_Functions()), of the TSM (tsm_pdu_set_lock_functions())
+ * and of the packets (pktbuf_set_lock_functions()) shall be set.
+ *
+ * @param count - number of worker threads
+ *
+ * @return true if the workers were started
+ */
+bool apdu_workers_init(unsigned count)
+{
+    if ((Worker_Count > 0) || (count == 0) || (count > APDU_WORKERS_MAX)) {
+        return false;
+    }
+    Request_Head = 0;
+    Request_Count = 0;
+    Workers_Running = true;
+    while (Worker_Count < count) {
+        if (pthread_create(&Worker_Thread[Worker_Count], NULL,
+                apdu_workers_thread, NULL) != 0) {
+            apdu_workers_cleanup();
+            return false;
+        }
+        Worker_Count++;
+    }
+    apdu_set_confirmed_dispatch(apdu_workers_dispatch);
+
+    return true;
+}
+
+/**
+ * @brief Stop the worker threads, and drop the requests that still wait
+ * for one, which their clients will retry.
+ */
+void apdu_workers_cleanup(void)
+{
+    unsigned i;
+
+    apdu_set_confirmed_dispatch(NULL);
+    pthread_mutex_lock(&Request_Mutex);
+    Workers_Running = false;
+    pthread_cond_broadcast(&Request_Ready);
+    pthread_mutex_unlock(&Request_Mutex);
+    for (i = 0; i < Worker_Count; i++) {
+        pthread_join(Worker_Thread[i], NULL);
+    }
+    Worker_Count = 0;
+    /* nothing is queued once the workers have stopped, so the packets
+       are released without the lock of the queue */
+    while (Request_Count > 0) {
+        pktbuf_release(Request_Queue[Request_Head].packet);
+        Request_Head = (Request_Head + 1) % APDU_WORKERS_QUEUE_MAX;
+        Request_Count--;
+    }
+}
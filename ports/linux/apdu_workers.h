@@ -0,0 +1,57 @@
+/**
+ * @file
+ * @brief Pool of worker threads for the confirmed service handlers
+ *
+ * @section DESCRIPTION
+ *
+ * The confirmed services that may take long, such as ReadPropertyMultiple
+ * of many properties or AtomicReadFile, are queued by the APDU handler
+ * and run on a pool of worker threads, so that one slow request does not
+ * hold off the requests of the other clients. A request of a packet
+ * given to apdu_handler_packet() is queued in place, with the packet
+ * retained, and is otherwise copied. Each reply is encoded into a
+ * buffer of the transmit pool of the TSM, and each thread has its own
+ * scratch buffers, where BACNET_THREAD_LOCAL is defined.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef APDU_WORKERS_H
+#define APDU_WORKERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    bool apdu_workers_init(
+        unsigned count);
+    bool apdu_workers_service(
+        uint8_t service_choice);
+    void apdu_workers_cleanup(
+        void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
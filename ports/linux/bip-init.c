@@ -31,6 +31,10 @@
  License.
  -------------------------------------------
 ####COPYRIGHTEND####*/
+/* recvmmsg() and sendmmsg() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 /* linux Ethernet/IP specific */
 #include <asm/types.h>
 #include <netinet/ether.h>
@@ -42,6 +46,8 @@
 #include <linux/rtnetlink.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
 /* standard C */
 #include <stdint.h> /* for standard integer types uint8_t etc. */
 #include <stdbool.h> /* for the standard bool type. */
@@ -51,6 +57,7 @@
 #include <stdio.h>
 /* BACnet specific */
 #include "bacnet/bacdcode.h"
+#include "bacnet/bacaddr.h"
 #include "bacnet/bacint.h"
 #include "bacnet/datalink/bip.h"
 #include "bacnet/basic/sys/debug.h"
@@ -59,9 +66,6 @@
 
 /** @file linux/bip-init.c  Initializes BACnet/IP interface (Linux). */
 
-/* unix socket */
-static int BIP_Socket = -1;
-
 /* NOTE: we store address and port in network byte order
    since BACnet/IP uses network byte order for all address byte arrays
 */
@@ -75,6 +79,70 @@ static struct in_addr BIP_Broadcast_Addr;
 /* enable debugging */
 static bool BIP_Debug = false;
 
+/* datagrams that are received with one system call */
+#ifndef BIP_RECEIVE_BATCH
+#define BIP_RECEIVE_BATCH 16
+#endif
+/* datagrams that are sent with one system call */
+#ifndef BIP_SEND_BATCH
+#define BIP_SEND_BATCH 16
+#endif
+/* destinations of one datagram that are sent with one system call */
+#ifndef BIP_FANOUT_BATCH
+#define BIP_FANOUT_BATCH 64
+#endif
+/* sockets, each with a worker thread, of the sharded receive */
+#ifndef BIP_SHARDS_MAX
+#define BIP_SHARDS_MAX 16
+#endif
+/* milliseconds that a worker waits before it checks for a stop */
+#ifndef BIP_SHARD_POLL_MS
+#define BIP_SHARD_POLL_MS 250
+#endif
+
+/* A received or queued datagram */
+struct bip_packet {
+    struct sockaddr_in sin;
+    /* sent to a broadcast address, known when IP_PKTINFO is enabled */
+    bool broadcast;
+    uint16_t length;
+    uint8_t buffer[BIP_MPDU_MAX];
+    /* the descriptor of a received datagram, which the handlers share */
+    BACNET_PACKET descriptor;
+};
+
+/* A socket, and the batches of the thread that uses it */
+struct bip_shard {
+    int socket;
+    pthread_t thread;
+    /* datagrams received by the last recvmmsg() that are not yet handled */
+    struct bip_packet receive_packet[BIP_RECEIVE_BATCH];
+    /* the packets, in the order received, that the datagrams are in */
+    unsigned receive_slot[BIP_RECEIVE_BATCH];
+    unsigned receive_head;
+    unsigned receive_count;
+    /* datagrams queued for sendmmsg() while a batch is open */
+    struct bip_packet send_packet[BIP_SEND_BATCH];
+    unsigned send_count;
+    bool send_batch;
+};
+
+/* unix socket, and the batches of the application thread */
+static struct bip_shard BIP_Main = { .socket = -1 };
+/* the worker threads of the sharded receive; the first one shares the
+   socket of the application and is the only one to handle broadcasts */
+static struct bip_shard *BIP_Shard;
+static unsigned BIP_Shard_Count;
+static volatile bool BIP_Shard_Running;
+static bip_shard_handler BIP_Shard_Handler;
+/* serializes the BVLC handler of the packets other than a unicast
+   confirmed request, the broadcasts, and the batches of the application
+   thread, with the users of the stack on other threads */
+static pthread_mutex_t BIP_Shard_Mutex =
+    PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+/* the shard of a worker thread, or NULL for the application thread */
+static BACNET_THREAD_LOCAL struct bip_shard *BIP_Shard_Self;
+
 /**
  * @brief Print the IPv4 address with debug info
  * @param str - debug info string
@@ -253,6 +321,92 @@ uint8_t bip_get_subnet_prefix(void)
     return prefix;
 }
 
+/**
+ * @brief The shard of the calling thread.
+ *
+ * @return Pointer to the shard of a worker thread, or to the shard of
+ *  the application thread
+ */
+static struct bip_shard *bip_shard_self(void)
+{
+    return BIP_Shard_Self ? BIP_Shard_Self : &BIP_Main;
+}
+
+/**
+ * @brief Send the datagrams that were queued while a batch was open,
+ * with as few sendmmsg() calls as the kernel allows.
+ *
+ * @param shard - the shard of the calling thread
+ *
+ * @return 0 if all were sent, or -1 with errno set if one failed
+ */
+static int bip_send_flush(struct bip_shard *shard)
+{
+    struct mmsghdr msgs[BIP_SEND_BATCH];
+    struct iovec iov[BIP_SEND_BATCH];
+    unsigned sent = 0;
+    unsigned i;
+    int status = 0;
+    int rv;
+
+    if (shard->send_count == 0) {
+        return 0;
+    }
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < shard->send_count; i++) {
+        iov[i].iov_base = shard->send_packet[i].buffer;
+        iov[i].iov_len = shard->send_packet[i].length;
+        msgs[i].msg_hdr.msg_name = &shard->send_packet[i].sin;
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (sent < shard->send_count) {
+        rv = sendmmsg(
+            shard->socket, &msgs[sent], shard->send_count - sent, 0);
+        if (rv > 0) {
+            sent += (unsigned)rv;
+        } else if ((rv < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            /* the datagram that failed is dropped, and the rest tried */
+            if (BIP_Debug) {
+                fprintf(stderr, "BIP: sendmmsg failed: %s\n", strerror(errno));
+                fflush(stderr);
+            }
+            status = -1;
+            sent++;
+        }
+    }
+    shard->send_count = 0;
+
+    return status;
+}
+
+/**
+ * @brief Queue the datagrams of bip_send_mpdu() until bip_send_end(),
+ * such as the forwarding of a BBMD to each of its peers and foreign
+ * devices.
+ */
+static void bip_send_begin(void)
+{
+    bip_shard_self()->send_batch = true;
+}
+
+/**
+ * @brief Send the datagrams queued since bip_send_begin().
+ *
+ * @return 0 if all were sent, or -1 with errno set if one failed
+ */
+static int bip_send_end(void)
+{
+    struct bip_shard *shard = bip_shard_self();
+
+    shard->send_batch = false;
+
+    return bip_send_flush(shard);
+}
+
 /**
  * The send function for BACnet/IP driver layer
  *
@@ -267,14 +421,17 @@ uint8_t bip_get_subnet_prefix(void)
 int bip_send_mpdu(BACNET_IP_ADDRESS *dest, uint8_t *mtu, uint16_t mtu_len)
 {
     struct sockaddr_in bip_dest = { 0 };
+    struct bip_shard *shard = bip_shard_self();
+    struct bip_packet *packet;
+    int bytes_sent;
 
     /* assumes that the driver has already been initialized */
-    if (BIP_Socket < 0) {
+    if (shard->socket < 0) {
         if (BIP_Debug) {
             fprintf(stderr, "BIP: driver not initialized!\n");
             fflush(stderr);
         }
-        return BIP_Socket;
+        return shard->socket;
     }
     /* load destination IP address */
     bip_dest.sin_family = AF_INET;
@@ -283,101 +440,400 @@ int bip_send_mpdu(BACNET_IP_ADDRESS *dest, uint8_t *mtu, uint16_t mtu_len)
     /* Send the packet */
     debug_print_ipv4(
         "Sending MPDU->", &bip_dest.sin_addr, bip_dest.sin_port, mtu_len);
-    return sendto(BIP_Socket, (char *)mtu, mtu_len, 0,
-        (struct sockaddr *)&bip_dest, sizeof(struct sockaddr));
+    if (shard == &BIP_Main) {
+        pthread_mutex_lock(&BIP_Shard_Mutex);
+    }
+    if (shard->send_batch && (mtu_len <= BIP_MPDU_MAX)) {
+        if (shard->send_count >= BIP_SEND_BATCH) {
+            bip_send_flush(shard);
+        }
+        packet = &shard->send_packet[shard->send_count++];
+        packet->sin = bip_dest;
+        packet->length = mtu_len;
+        memcpy(packet->buffer, mtu, mtu_len);
+        bytes_sent = mtu_len;
+    } else {
+        bytes_sent = sendto(shard->socket, (char *)mtu, mtu_len, 0,
+            (struct sockaddr *)&bip_dest, sizeof(struct sockaddr));
+    }
+    if (shard == &BIP_Main) {
+        pthread_mutex_unlock(&BIP_Shard_Mutex);
+    }
+
+    return bytes_sent;
 }
 
 /**
- * BACnet/IP Datalink Receive handler.
+ * The send function for BACnet/IP driver layer, of one datagram to each
+ * of a list of destinations, such as the forwarding of a BBMD to its
+ * peers and foreign devices. The datagram is not copied, and is sent
+ * to as many destinations with each sendmmsg() call as it allows.
  *
- * @param src - returns the source address
- * @param npdu - returns the NPDU buffer
- * @param max_npdu -maximum size of the NPDU buffer
- * @param timeout - number of milliseconds to wait for a packet
+ * @param dest - Points to an array of BACNET_IP_ADDRESS structures
+ *  containing the destination addresses.
+ * @param dest_count - number of destination addresses
+ * @param mtu - the bytes of data to send
+ * @param mtu_len - the number of bytes of data to send
  *
- * @return Number of bytes received, or 0 if none or timeout.
+ * @return Upon successful completion, returns the number of datagrams
+ *  sent. Otherwise, -1 shall be returned and errno set to indicate the
+ *  error.
  */
-uint16_t bip_receive(
-    BACNET_ADDRESS *src, uint8_t *npdu, uint16_t max_npdu, unsigned timeout)
+int bip_send_mpdu_list(BACNET_IP_ADDRESS *dest,
+    unsigned dest_count,
+    uint8_t *mtu,
+    uint16_t mtu_len)
 {
-    uint16_t npdu_len = 0; /* return value */
-    fd_set read_fds;
-    int max = 0;
-    struct timeval select_timeout;
-    struct sockaddr_in sin = { 0 };
-    BACNET_IP_ADDRESS addr = { { 0 } };
-    socklen_t sin_len = sizeof(sin);
-    int received_bytes = 0;
-    int offset = 0;
-    uint16_t i = 0;
+    struct mmsghdr msgs[BIP_FANOUT_BATCH];
+    struct sockaddr_in bip_dest[BIP_FANOUT_BATCH];
+    struct iovec iov;
+    struct bip_shard *shard = bip_shard_self();
+    unsigned count;
+    unsigned sent = 0;
+    unsigned i;
+    int status = 0;
+    int rv;
 
-    /* Make sure the socket is open */
-    if (BIP_Socket < 0) {
-        return 0;
+    /* assumes that the driver has already been initialized */
+    if (shard->socket < 0) {
+        if (BIP_Debug) {
+            fprintf(stderr, "BIP: driver not initialized!\n");
+            fflush(stderr);
+        }
+        return shard->socket;
     }
-    /* we could just use a non-blocking socket, but that consumes all
-       the CPU time.  We can use a timeout; it is only supported as
-       a select. */
-    if (timeout >= 1000) {
-        select_timeout.tv_sec = timeout / 1000;
-        select_timeout.tv_usec =
-            1000 * (timeout - select_timeout.tv_sec * 1000);
-    } else {
-        select_timeout.tv_sec = 0;
-        select_timeout.tv_usec = 1000 * timeout;
-    }
-    FD_ZERO(&read_fds);
-    FD_SET(BIP_Socket, &read_fds);
-    max = BIP_Socket;
-    /* see if there is a packet for us */
-    if (select(max + 1, &read_fds, NULL, NULL, &select_timeout) > 0) {
-        received_bytes = recvfrom(max, (char *)&npdu[0], max_npdu, 0,
-            (struct sockaddr *)&sin, &sin_len);
-    } else {
+    iov.iov_base = mtu;
+    iov.iov_len = mtu_len;
+    if (shard == &BIP_Main) {
+        pthread_mutex_lock(&BIP_Shard_Mutex);
+    }
+    /* the datagrams queued before these go first */
+    bip_send_flush(shard);
+    while (sent < dest_count) {
+        count = dest_count - sent;
+        if (count > BIP_FANOUT_BATCH) {
+            count = BIP_FANOUT_BATCH;
+        }
+        memset(msgs, 0, sizeof(msgs[0]) * count);
+        for (i = 0; i < count; i++) {
+            memset(&bip_dest[i], 0, sizeof(bip_dest[i]));
+            bip_dest[i].sin_family = AF_INET;
+            memcpy(&bip_dest[i].sin_addr.s_addr, &dest[sent + i].address[0],
+                4);
+            bip_dest[i].sin_port = htons(dest[sent + i].port);
+            msgs[i].msg_hdr.msg_name = &bip_dest[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            msgs[i].msg_hdr.msg_iov = &iov;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        i = 0;
+        while (i < count) {
+            rv = sendmmsg(shard->socket, &msgs[i], count - i, 0);
+            if (rv > 0) {
+                i += (unsigned)rv;
+            } else if ((rv < 0) && (errno == EINTR)) {
+                continue;
+            } else {
+                /* the destination that failed is skipped, and the rest
+                   tried */
+                if (BIP_Debug) {
+                    fprintf(stderr, "BIP: sendmmsg failed: %s\n",
+                        strerror(errno));
+                    fflush(stderr);
+                }
+                status = -1;
+                i++;
+            }
+        }
+        sent += count;
+    }
+    if (shard == &BIP_Main) {
+        pthread_mutex_unlock(&BIP_Shard_Mutex);
+    }
+    if (BIP_Debug) {
+        fprintf(stderr, "BIP: Sent MPDU to %u destinations (%u bytes)\n",
+            dest_count, (unsigned)mtu_len);
+        fflush(stderr);
+    }
+
+    return (status == 0) ? (int)sent : status;
+}
+
+/**
+ * @brief Receive the datagrams that are waiting on the socket, as many
+ * as fit in the batch, with one recvmmsg() call. A packet that is still
+ * held by a handler that deferred it is not received into.
+ *
+ * @param shard - the shard of the calling thread
+ *
+ * @return Number of datagrams received
+ */
+static unsigned bip_receive_batch(struct bip_shard *shard)
+{
+    struct mmsghdr msgs[BIP_RECEIVE_BATCH];
+    struct iovec iov[BIP_RECEIVE_BATCH];
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(struct in_pktinfo))];
+    } control[BIP_RECEIVE_BATCH];
+    struct bip_packet *packet;
+    struct cmsghdr *cmsg;
+    struct in_pktinfo *pktinfo;
+    unsigned count = 0;
+    unsigned i;
+    int rv;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < BIP_RECEIVE_BATCH; i++) {
+        packet = &shard->receive_packet[i];
+        if (!packet->descriptor.buffer) {
+            pktbuf_init(
+                &packet->descriptor, packet->buffer, sizeof(packet->buffer));
+        }
+        if (pktbuf_busy(&packet->descriptor)) {
+            continue;
+        }
+        shard->receive_slot[count] = i;
+        iov[count].iov_base = packet->buffer;
+        iov[count].iov_len = sizeof(packet->buffer);
+        msgs[count].msg_hdr.msg_name = &packet->sin;
+        msgs[count].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[count].msg_hdr.msg_iov = &iov[count];
+        msgs[count].msg_hdr.msg_iovlen = 1;
+        msgs[count].msg_hdr.msg_control = control[count].buffer;
+        msgs[count].msg_hdr.msg_controllen = sizeof(control[count].buffer);
+        count++;
+    }
+    if (count == 0) {
+        /* each packet is held; give the handlers time to release one */
+        poll(NULL, 0, 1);
         return 0;
     }
-    /* See if there is a problem */
-    if (received_bytes < 0) {
+    rv = recvmmsg(shard->socket, msgs, count, MSG_DONTWAIT, NULL);
+    if (rv <= 0) {
         return 0;
     }
+    for (i = 0; i < (unsigned)rv; i++) {
+        packet = &shard->receive_packet[shard->receive_slot[i]];
+        packet->length = (uint16_t)msgs[i].msg_len;
+        packet->broadcast = false;
+        for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg;
+             cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+            if ((cmsg->cmsg_level == IPPROTO_IP) &&
+                (cmsg->cmsg_type == IP_PKTINFO)) {
+                pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
+                packet->broadcast =
+                    (pktinfo->ipi_addr.s_addr == BIP_Broadcast_Addr.s_addr) ||
+                    (pktinfo->ipi_addr.s_addr == htonl(INADDR_BROADCAST));
+            }
+        }
+    }
+    shard->receive_head = 0;
+    shard->receive_count = (unsigned)rv;
+
+    return shard->receive_count;
+}
+
+/**
+ * @brief Take the next of the datagrams of the last batch.
+ *
+ * @param shard - the shard of the calling thread, with a datagram left
+ *
+ * @return Pointer to the datagram
+ */
+static struct bip_packet *bip_receive_take(struct bip_shard *shard)
+{
+    unsigned slot = shard->receive_slot[shard->receive_head];
+
+    shard->receive_head++;
+    shard->receive_count--;
+
+    return &shard->receive_packet[slot];
+}
+
+/**
+ * @brief Handle a received datagram in place: check it, pass it into
+ * the BBMD handler, and start its descriptor if it has an NPDU. The
+ * caller releases the descriptor after handling the NPDU.
+ *
+ * @param packet - the received datagram
+ *
+ * @return true if the descriptor holds an NPDU for the handlers
+ */
+static bool bip_receive_datagram(struct bip_packet *packet)
+{
+    BACNET_PACKET *descriptor = &packet->descriptor;
+    BACNET_IP_ADDRESS addr = { { 0 } };
+    uint16_t received_bytes = packet->length;
+    int offset = 0;
+    int max = 0;
+
     /* no problem, just no bytes */
     if (received_bytes == 0) {
-        return 0;
+        return false;
     }
     /* the signature of a BACnet/IPv packet */
-    if (npdu[0] != BVLL_TYPE_BACNET_IP) {
-        return 0;
+    if (packet->buffer[0] != BVLL_TYPE_BACNET_IP) {
+        return false;
     }
     /* Erase up to 16 bytes after the received bytes as safety margin to
      * ensure that the decoding functions will run into a 'safe field'
      * of zero, if for any reason they would overrun, when parsing the
      * message. */
-    max = (int)max_npdu - received_bytes;
+    max = (int)sizeof(packet->buffer) - received_bytes;
     if (max > 0) {
         if (max > 16) {
             max = 16;
         }
-        memset(&npdu[received_bytes], 0, max);
+        memset(&packet->buffer[received_bytes], 0, max);
+    }
+    if (!pktbuf_receive(descriptor, received_bytes)) {
+        return false;
     }
     /* Data link layer addressing between B/IPv4 nodes consists of a 32-bit
        IPv4 address followed by a two-octet UDP port number (both of which
        shall be transmitted with the most significant octet first). This
        address shall be referred to as a B/IPv4 address.
     */
-    memcpy(&addr.address[0], &sin.sin_addr.s_addr, 4);
-    addr.port = ntohs(sin.sin_port);
-    debug_print_ipv4(
-        "Received MPDU->", &sin.sin_addr, sin.sin_port, received_bytes);
-    /* pass the packet into the BBMD handler */
-    offset = bvlc_handler(&addr, src, npdu, received_bytes);
-    if (offset > 0) {
-        npdu_len = received_bytes - offset;
-        debug_print_ipv4(
-            "Received NPDU->", &sin.sin_addr, sin.sin_port, npdu_len);
+    memcpy(&addr.address[0], &packet->sin.sin_addr.s_addr, 4);
+    addr.port = ntohs(packet->sin.sin_port);
+    debug_print_ipv4("Received MPDU->", &packet->sin.sin_addr,
+        packet->sin.sin_port, received_bytes);
+    /* pass the packet into the BBMD handler, which parses the headers
+       of a unicast confirmed request in one pass.  That parse needs no
+       lock, so it is done first, and only the other packets, which may
+       use the tables of the BBMD, are handled with the lock held. */
+    if (bvlc_decode_packet_header(descriptor)) {
+        offset = bvlc_handler_packet(&addr, descriptor);
+    } else {
+        pthread_mutex_lock(&BIP_Shard_Mutex);
+        offset = bvlc_handler_packet(&addr, descriptor);
+        pthread_mutex_unlock(&BIP_Shard_Mutex);
+    }
+    if ((offset > 0) && (offset < received_bytes)) {
+        descriptor->npdu_offset = (uint16_t)offset;
+        debug_print_ipv4("Received NPDU->", &packet->sin.sin_addr,
+            packet->sin.sin_port, pktbuf_npdu_len(descriptor));
+        return true;
+    }
+    pktbuf_release(descriptor);
+
+    return false;
+}
+
+/**
+ * @brief Wait for datagrams on the socket of the application thread,
+ * and receive a batch of them, unless some are waiting to be handled.
+ *
+ * @param timeout - number of milliseconds to wait for a packet
+ *
+ * @return true if datagrams are waiting to be handled
+ */
+static bool bip_receive_wait(unsigned timeout)
+{
+    fd_set read_fds;
+    int max = 0;
+    struct timeval select_timeout;
+
+    /* Make sure the socket is open */
+    if (BIP_Main.socket < 0) {
+        return false;
+    }
+    if (BIP_Main.receive_count == 0) {
+        /* we could just use a non-blocking socket, but that consumes all
+           the CPU time.  We can use a timeout; it is only supported as
+           a select. */
+        if (timeout >= 1000) {
+            select_timeout.tv_sec = timeout / 1000;
+            select_timeout.tv_usec =
+                1000 * (timeout - select_timeout.tv_sec * 1000);
+        } else {
+            select_timeout.tv_sec = 0;
+            select_timeout.tv_usec = 1000 * timeout;
+        }
+        if (BIP_Shard_Count > 0) {
+            select(0, NULL, NULL, NULL, &select_timeout);
+            return false;
+        }
+        FD_ZERO(&read_fds);
+        FD_SET(BIP_Main.socket, &read_fds);
+        max = BIP_Main.socket;
+        /* see if there is a packet for us */
+        if (select(max + 1, &read_fds, NULL, NULL, &select_timeout) <= 0) {
+            return false;
+        }
+        if (bip_receive_batch(&BIP_Main) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Take the next of the waiting datagrams of the application
+ * thread that has an NPDU, handling the others, which are only for
+ * the BBMD, on the way.
+ *
+ * @return Pointer to the datagram, or NULL if none is left
+ */
+static struct bip_packet *bip_receive_next(void)
+{
+    struct bip_packet *packet = NULL;
+    bool received = false;
+
+    pthread_mutex_lock(&BIP_Shard_Mutex);
+    bip_send_begin();
+    while (!received && (BIP_Main.receive_count > 0)) {
+        packet = bip_receive_take(&BIP_Main);
+        received = bip_receive_datagram(packet);
+    }
+    bip_send_end();
+    pthread_mutex_unlock(&BIP_Shard_Mutex);
+
+    return received ? packet : NULL;
+}
+
+/**
+ * BACnet/IP Datalink Receive handler.
+ *
+ * The datagrams waiting on the socket are drained with one recvmmsg()
+ * call, and handled one at a time by the following calls, so that a
+ * storm of datagrams costs one system call per batch. Datagrams that
+ * are only for the BBMD are handled without returning, and what the
+ * BBMD forwards is sent with one sendmmsg() call. While the receive is
+ * sharded, the worker threads handle the datagrams, and this only waits.
+ *
+ * @param src - returns the source address
+ * @param npdu - returns the NPDU buffer
+ * @param max_npdu -maximum size of the NPDU buffer
+ * @param timeout - number of milliseconds to wait for a packet
+ *
+ * @return Number of bytes received, or 0 if none or timeout.
+ */
+uint16_t bip_receive(
+    BACNET_ADDRESS *src, uint8_t *npdu, uint16_t max_npdu, unsigned timeout)
+{
+    uint16_t npdu_len = 0; /* return value */
+    struct bip_packet *packet;
+    int max = 0;
+
+    if (!bip_receive_wait(timeout)) {
+        return 0;
+    }
+    packet = bip_receive_next();
+    if (packet) {
+        npdu_len = pktbuf_npdu_len(&packet->descriptor);
         if (npdu_len <= max_npdu) {
-            /* shift the buffer to return a valid NPDU */
-            for (i = 0; i < npdu_len; i++) {
-                npdu[i] = npdu[offset + i];
+            memcpy(npdu, pktbuf_npdu(&packet->descriptor), npdu_len);
+            bacnet_address_copy(src, &packet->descriptor.src);
+            /* the same safety margin as in the buffer of the datagram */
+            max = (int)max_npdu - npdu_len;
+            if (max > 0) {
+                if (max > 16) {
+                    max = 16;
+                }
+                memset(&npdu[npdu_len], 0, max);
             }
         } else {
             if (BIP_Debug) {
@@ -386,11 +842,46 @@ uint16_t bip_receive(
             }
             npdu_len = 0;
         }
+        pktbuf_release(&packet->descriptor);
     }
 
     return npdu_len;
 }
 
+/**
+ * BACnet/IP Datalink Receive handler, without a copy: the NPDU is
+ * handled in place in the buffer that the datagram was received into.
+ *
+ * @param timeout - number of milliseconds to wait for a packet
+ *
+ * @return Descriptor of the packet, with its source address and NPDU
+ *  offset set, which the caller shall release with pktbuf_release(),
+ *  or NULL if none or timeout.
+ */
+BACNET_PACKET *bip_receive_packet(unsigned timeout)
+{
+    struct bip_packet *packet;
+
+    if (!bip_receive_wait(timeout)) {
+        return NULL;
+    }
+    packet = bip_receive_next();
+
+    return packet ? &packet->descriptor : NULL;
+}
+
+/**
+ * Check for datagrams of the application thread that were already
+ * received from the socket, but not yet handled.  The socket does not
+ * report them as ready to read.
+ *
+ * @return true if bip_receive_packet() has more of them to hand out
+ */
+bool bip_receive_pending(void)
+{
+    return (BIP_Main.receive_count > 0);
+}
+
 /**
  * The common send function for BACnet/IP application layer
  *
@@ -408,7 +899,26 @@ int bip_send_pdu(BACNET_ADDRESS *dest,
     uint8_t *pdu,
     unsigned pdu_len)
 {
-    return bvlc_send_pdu(dest, npdu_data, pdu, pdu_len);
+    int bytes_sent;
+
+    if ((dest->net != BACNET_BROADCAST_NETWORK) && (dest->mac_len != 0)) {
+        /* a unicast, or a broadcast on one network, uses no table of
+           the BBMD, and bip_send_mpdu() locks the batch of the
+           application thread */
+        return bvlc_send_pdu(dest, npdu_data, pdu, pdu_len);
+    }
+    /* the BBMD tables, and the batch of the application thread, may be
+       used by other threads */
+    pthread_mutex_lock(&BIP_Shard_Mutex);
+    /* a broadcast of a BBMD goes to each of its peers */
+    bip_send_begin();
+    bytes_sent = bvlc_send_pdu(dest, npdu_data, pdu, pdu_len);
+    if (bip_send_end() < 0) {
+        bytes_sent = -1;
+    }
+    pthread_mutex_unlock(&BIP_Shard_Mutex);
+
+    return bytes_sent;
 }
 
 /**
@@ -745,6 +1255,63 @@ void bip_set_interface(char *ifname)
     }
 }
 
+/**
+ * @brief Open a UDP socket, configured for sending and receiving and for
+ * broadcasts, and bound to the BACnet/IP port.
+ *
+ * @param reuse_port - true to join a group of sockets on the port,
+ *  among which the kernel spreads the datagrams by their source address
+ *
+ * @return the socket, or -1 if the socket functions fail
+ */
+static int bip_socket_open(bool reuse_port)
+{
+    int status = 0; /* return from socket lib calls */
+    struct sockaddr_in sin;
+    int sockopt = 0;
+    int sock_fd = -1;
+
+    sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock_fd < 0) {
+        return -1;
+    }
+    /* Allow us to use the same socket for sending and receiving */
+    /* This makes sure that the src port is correct when sending */
+    sockopt = 1;
+    status = setsockopt(
+        sock_fd, SOL_SOCKET, SO_REUSEADDR, &sockopt, sizeof(sockopt));
+    if (status == 0) {
+        /* allow us to send a broadcast */
+        status = setsockopt(
+            sock_fd, SOL_SOCKET, SO_BROADCAST, &sockopt, sizeof(sockopt));
+    }
+    if ((status == 0) && reuse_port) {
+        status = setsockopt(
+            sock_fd, SOL_SOCKET, SO_REUSEPORT, &sockopt, sizeof(sockopt));
+        if (status == 0) {
+            /* each socket of the group gets a copy of a broadcast, so
+               tell which datagrams were sent to a broadcast address */
+            status = setsockopt(
+                sock_fd, IPPROTO_IP, IP_PKTINFO, &sockopt, sizeof(sockopt));
+        }
+    }
+    if (status == 0) {
+        /* bind the socket to the local port number and IP address */
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = htonl(INADDR_ANY);
+        sin.sin_port = BIP_Port;
+        memset(&(sin.sin_zero), '\0', sizeof(sin.sin_zero));
+        status = bind(
+            sock_fd, (const struct sockaddr *)&sin, sizeof(struct sockaddr));
+    }
+    if (status < 0) {
+        close(sock_fd);
+        return -1;
+    }
+
+    return sock_fd;
+}
+
 /** Initialize the BACnet/IP services at the given interface.
  * @ingroup DLBIP
  * -# Gets the local IP address and local broadcast address from the system,
@@ -764,11 +1331,6 @@ void bip_set_interface(char *ifname)
  */
 bool bip_init(char *ifname)
 {
-    int status = 0; /* return from socket lib calls */
-    struct sockaddr_in sin;
-    int sockopt = 0;
-    int sock_fd = -1;
-
     if (ifname) {
         bip_set_interface(ifname);
     } else {
@@ -780,54 +1342,193 @@ bool bip_init(char *ifname)
         fflush(stderr);
         return false;
     }
-    /* assumes that the driver has already been initialized */
-    sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    BIP_Socket = sock_fd;
-    if (sock_fd < 0) {
+    BIP_Main.socket = bip_socket_open(false);
+    if (BIP_Main.socket < 0) {
         return false;
     }
-    /* Allow us to use the same socket for sending and receiving */
-    /* This makes sure that the src port is correct when sending */
-    sockopt = 1;
-    status = setsockopt(
-        sock_fd, SOL_SOCKET, SO_REUSEADDR, &sockopt, sizeof(sockopt));
-    if (status < 0) {
-        close(sock_fd);
-        BIP_Socket = -1;
-        return status;
+    bvlc_init();
+
+    return true;
+}
+
+/**
+ * @brief Worker thread of the sharded receive. It receives the datagrams
+ * of its socket, passes them into the BBMD handler, and passes their
+ * NPDU to the handler of the application.
+ *
+ * @param arg - the shard of the worker
+ *
+ * @return NULL
+ */
+static void *bip_shard_thread(void *arg)
+{
+    struct bip_shard *shard = (struct bip_shard *)arg;
+    /* the first worker shares the socket of the application thread */
+    bool broadcasts = (shard == &BIP_Shard[0]);
+    struct pollfd pfd;
+    struct bip_packet *packet;
+    bool received;
+
+    BIP_Shard_Self = shard;
+    pfd.fd = shard->socket;
+    pfd.events = POLLIN;
+    while (BIP_Shard_Running) {
+        pfd.revents = 0;
+        if (poll(&pfd, 1, BIP_SHARD_POLL_MS) <= 0) {
+            continue;
+        }
+        bip_receive_batch(shard);
+        while (shard->receive_count > 0) {
+            packet = bip_receive_take(shard);
+            if (packet->broadcast && !broadcasts) {
+                /* another copy is handled by the first worker */
+                continue;
+            }
+            bip_send_begin();
+            received = bip_receive_datagram(packet);
+            bip_send_end();
+            if (received) {
+                BIP_Shard_Handler(&packet->descriptor);
+                pktbuf_release(&packet->descriptor);
+            }
+        }
     }
-    /* allow us to send a broadcast */
-    status = setsockopt(
-        sock_fd, SOL_SOCKET, SO_BROADCAST, &sockopt, sizeof(sockopt));
-    if (status < 0) {
-        close(sock_fd);
-        BIP_Socket = -1;
+
+    return NULL;
+}
+
+/**
+ * @brief Shard the receive of BACnet/IP over a group of sockets on the
+ * port, each with a worker thread. The kernel picks the socket of a
+ * unicast datagram by a hash of its source address, so the requests
+ * of a peer are handled in order by one worker. Each socket gets a copy
+ * of a broadcast, which only the first worker handles. The headers of a
+ * unicast confirmed request are parsed by each worker without a lock.
+ *
+ * The handler is called by the workers without any lock held, so one
+ * that uses the stack shall hold bip_shards_lock(), as shall the
+ * application thread while it uses the stack, such as for its timers,
+ * except around the handlers that lock the objects and the TSM for
+ * each access of their own.
+ *
+ * @param count - number of sockets and worker threads
+ * @param handler - function that handles a received NPDU
+ *
+ * @return true if the workers were started
+ */
+bool bip_shards_start(unsigned count, bip_shard_handler handler)
+{
+    unsigned i;
+
+    if ((BIP_Main.socket < 0) || BIP_Shard || !handler || (count == 0) ||
+        (count > BIP_SHARDS_MAX)) {
         return false;
     }
-    /* bind the socket to the local port number and IP address */
-    sin.sin_family = AF_INET;
-    sin.sin_addr.s_addr = htonl(INADDR_ANY);
-    sin.sin_port = BIP_Port;
-    memset(&(sin.sin_zero), '\0', sizeof(sin.sin_zero));
-    status =
-        bind(sock_fd, (const struct sockaddr *)&sin, sizeof(struct sockaddr));
-    if (status < 0) {
-        close(sock_fd);
-        BIP_Socket = -1;
+    BIP_Shard = calloc(count, sizeof(struct bip_shard));
+    if (!BIP_Shard) {
+        return false;
+    }
+    for (i = 0; i < count; i++) {
+        BIP_Shard[i].socket = bip_socket_open(true);
+        if (BIP_Shard[i].socket < 0) {
+            while (i > 0) {
+                i--;
+                close(BIP_Shard[i].socket);
+            }
+            free(BIP_Shard);
+            BIP_Shard = NULL;
+            return false;
+        }
+    }
+    /* the group replaces the socket of the application thread */
+    close(BIP_Main.socket);
+    BIP_Main.socket = BIP_Shard[0].socket;
+    BIP_Main.receive_count = 0;
+    BIP_Shard_Handler = handler;
+    BIP_Shard_Count = count;
+    BIP_Shard_Running = true;
+    for (i = 0; i < count; i++) {
+        if (pthread_create(&BIP_Shard[i].thread, NULL, bip_shard_thread,
+                &BIP_Shard[i]) != 0) {
+            break;
+        }
+    }
+    if (i < count) {
+        /* without all of its workers, part of the group would be deaf */
+        for (; i < count; i++) {
+            if (i > 0) {
+                close(BIP_Shard[i].socket);
+            }
+            BIP_Shard[i].socket = -1;
+        }
+        bip_shards_stop();
         return false;
     }
-    bvlc_init();
 
     return true;
 }
 
+/**
+ * @brief Stop the workers of the sharded receive, and go back to
+ * receiving with bip_receive() on the first socket of the group.
+ */
+void bip_shards_stop(void)
+{
+    unsigned i;
+
+    if (!BIP_Shard) {
+        return;
+    }
+    BIP_Shard_Running = false;
+    for (i = 0; i < BIP_Shard_Count; i++) {
+        /* a worker was started for each socket that is still open */
+        if (BIP_Shard[i].socket >= 0) {
+            pthread_join(BIP_Shard[i].thread, NULL);
+            if (i > 0) {
+                close(BIP_Shard[i].socket);
+            }
+        }
+    }
+    free(BIP_Shard);
+    BIP_Shard = NULL;
+    BIP_Shard_Count = 0;
+}
+
+/**
+ * @brief Take the lock that serializes the users of the stack with the
+ * BBMD handler and the sends of BACnet/IP. It may be taken again by the
+ * thread that holds it.
+ */
+void bip_shards_lock(void)
+{
+    pthread_mutex_lock(&BIP_Shard_Mutex);
+}
+
+/**
+ * @brief Release the lock taken by bip_shards_lock().
+ */
+void bip_shards_unlock(void)
+{
+    pthread_mutex_unlock(&BIP_Shard_Mutex);
+}
+
 /**
  * @brief Determine if this BACnet/IP datalink is valid
  * @return true if the BACnet/IP datalink is valid
  */
 bool bip_valid(void)
 {
-    return (BIP_Socket != -1);
+    return (BIP_Main.socket != -1);
+}
+
+/**
+ * @brief Get the socket of the BACnet/IP datalink, to wait on it
+ * @return the socket, or -1 if the datalink is not initialized or its
+ *  receive is sharded over worker threads
+ */
+int bip_get_fd(void)
+{
+    return (BIP_Shard_Count > 0) ? -1 : BIP_Main.socket;
 }
 
 /** Cleanup and close out the BACnet/IP services by closing the socket.
@@ -835,10 +1536,14 @@ bool bip_valid(void)
  */
 void bip_cleanup(void)
 {
-    if (BIP_Socket != -1) {
-        close(BIP_Socket);
+    bip_shards_stop();
+    if (BIP_Main.socket != -1) {
+        close(BIP_Main.socket);
     }
-    BIP_Socket = -1;
+    BIP_Main.socket = -1;
+    BIP_Main.receive_count = 0;
+    BIP_Main.send_count = 0;
+    BIP_Main.send_batch = false;
 
     return;
 }
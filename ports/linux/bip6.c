@@ -358,6 +358,15 @@ void bip6_cleanup(void)
     return;
 }
 
+/** Get the socket of the BACnet/IPv6 datalink, to wait on it.
+ * @ingroup DLBIP6
+ * @return the socket, or -1 if the datalink is not initialized
+ */
+int bip6_get_fd(void)
+{
+    return BIP6_Socket;
+}
+
 /** Initialize the BACnet/IP services at the given interface.
  * @ingroup DLBIP6
  * -# Gets the local IP address and local broadcast address from the system,
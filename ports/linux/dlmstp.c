@@ -30,6 +30,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <sys/time.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include "bacnet/bacdef.h"
 #include "bacnet/bacaddr.h"
 #include "bacnet/datalink/mstp.h"
@@ -57,6 +59,8 @@ static RT_MUTEX Receive_Packet_Mutex;
 */
 static pthread_cond_t Receive_Packet_Flag;
 static pthread_mutex_t Receive_Packet_Mutex;
+/* readable while a packet is ready, for an event loop to wait on */
+static int Receive_Packet_Event = -1;
 /* mechanism to wait for a frame in state machine */
 /*
 static RT_COND Received_Frame_Flag;
@@ -190,6 +194,16 @@ void dlmstp_cleanup(void)
     pthread_mutex_destroy(&Received_Frame_Mutex);
     pthread_mutex_destroy(&Receive_Packet_Mutex);
     pthread_mutex_destroy(&Master_Done_Mutex);
+    if (Receive_Packet_Event >= 0) {
+        close(Receive_Packet_Event);
+        Receive_Packet_Event = -1;
+    }
+}
+
+/* file descriptor that is readable while a packet is ready, or -1 */
+int dlmstp_get_fd(void)
+{
+    return Receive_Packet_Event;
 }
 
 /* returns number of bytes sent on success, zero on failure */
@@ -230,6 +244,7 @@ uint16_t dlmstp_receive(BACNET_ADDRESS *src, /* source address */
 { /* milliseconds to wait for a packet */
     uint16_t pdu_len = 0;
     struct timespec abstime;
+    uint64_t event_count = 0;
 
     (void)max_pdu;
     /* see if there is a packet available, and a place
@@ -251,6 +266,13 @@ uint16_t dlmstp_receive(BACNET_ADDRESS *src, /* source address */
             pdu_len = Receive_Packet.pdu_len;
         }
         Receive_Packet.ready = false;
+        if (Receive_Packet_Event >= 0) {
+            /* reading clears the event */
+            if (read(Receive_Packet_Event, &event_count,
+                    sizeof(event_count)) < 0) {
+                event_count = 0;
+            }
+        }
     }
     pthread_mutex_unlock(&Receive_Packet_Mutex);
 
@@ -332,6 +354,7 @@ void dlmstp_fill_bacnet_address(BACNET_ADDRESS *src, uint8_t mstp_address)
 uint16_t MSTP_Put_Receive(volatile struct mstp_port_struct_t *mstp_port)
 {
     uint16_t pdu_len = 0;
+    uint64_t event_count = 1;
 
     pthread_mutex_lock(&Receive_Packet_Mutex);
     if (Receive_Packet.ready) {
@@ -352,6 +375,12 @@ uint16_t MSTP_Put_Receive(volatile struct mstp_port_struct_t *mstp_port)
         Receive_Packet.pdu_len = mstp_port->DataLength;
         Receive_Packet.ready = true;
         pthread_cond_signal(&Receive_Packet_Flag);
+        if (Receive_Packet_Event >= 0) {
+            if (write(Receive_Packet_Event, &event_count,
+                    sizeof(event_count)) < 0) {
+                debug_printf("MS/TP: Receive event failed!\n");
+            }
+        }
     }
     pthread_mutex_unlock(&Receive_Packet_Mutex);
 
@@ -713,6 +742,9 @@ bool dlmstp_init(char *ifname)
     /* initialize packet queue */
     Receive_Packet.ready = false;
     Receive_Packet.pdu_len = 0;
+    if (Receive_Packet_Event < 0) {
+        Receive_Packet_Event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
     rv = pthread_cond_init(&Receive_Packet_Flag, &attr);
     if (rv != 0) {
         fprintf(stderr,
@@ -0,0 +1,292 @@
+/**
+ * @file
+ * @brief Event loop of file descriptor readiness and periodic timers
+ *
+ * @section DESCRIPTION
+ *
+ * Each source, a file descriptor or a timerfd, is a slot in a fixed
+ * table, and the epoll event of the source points to its slot. The
+ * handler of a timer is given the time of all the expiries since it
+ * last ran, so that a late timer does not lose time.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "event_loop.h"
+
+/* number of file descriptors and timers */
+#ifndef EVENT_LOOP_SOURCES_MAX
+#define EVENT_LOOP_SOURCES_MAX 16
+#endif
+
+static struct event_loop_source {
+    int fd;
+    bool timer;
+    uint32_t milliseconds;
+    event_loop_fd_handler fd_handler;
+    event_loop_timer_handler timer_handler;
+    void *context;
+} Event_Loop_Source[EVENT_LOOP_SOURCES_MAX];
+
+static int Event_Loop_Fd = -1;
+static volatile bool Event_Loop_Running;
+
+/**
+ * @brief Add a file descriptor to the epoll set, in a free slot.
+ *
+ * @param fd  File descriptor
+ *
+ * @return Pointer to the slot, or NULL if none is free or epoll failed
+ */
+static struct event_loop_source *event_loop_source_add(int fd)
+{
+    struct event_loop_source *source = NULL;
+    struct epoll_event event = { 0 };
+    unsigned i;
+
+    if ((Event_Loop_Fd < 0) || (fd < 0)) {
+        return NULL;
+    }
+    for (i = 0; i < EVENT_LOOP_SOURCES_MAX; i++) {
+        if (Event_Loop_Source[i].fd < 0) {
+            source = &Event_Loop_Source[i];
+            break;
+        }
+    }
+    if (source) {
+        event.events = EPOLLIN;
+        event.data.ptr = source;
+        if (epoll_ctl(Event_Loop_Fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            return NULL;
+        }
+        memset(source, 0, sizeof(*source));
+        source->fd = fd;
+    }
+
+    return source;
+}
+
+/**
+ * @brief Create the epoll set of the event loop.
+ *
+ * @return true if the event loop is ready
+ */
+bool event_loop_init(void)
+{
+    unsigned i;
+
+    if (Event_Loop_Fd >= 0) {
+        return true;
+    }
+    for (i = 0; i < EVENT_LOOP_SOURCES_MAX; i++) {
+        Event_Loop_Source[i].fd = -1;
+    }
+    Event_Loop_Fd = epoll_create1(EPOLL_CLOEXEC);
+
+    return (Event_Loop_Fd >= 0);
+}
+
+/**
+ * @brief Call a handler whenever a file descriptor is ready to read.
+ * The handler is called again while data remains queued in the kernel,
+ * so it may read a bounded amount at a time from there.  Data that the
+ * handler already took into user space is not reported again; it has to
+ * handle all of that before it returns.
+ *
+ * @param fd  File descriptor, such as the socket of a datalink
+ * @param handler  Function to call
+ * @param context  Passed to the handler
+ *
+ * @return true if added
+ */
+bool event_loop_fd_add(int fd, event_loop_fd_handler handler, void *context)
+{
+    struct event_loop_source *source;
+
+    if (!handler) {
+        return false;
+    }
+    source = event_loop_source_add(fd);
+    if (!source) {
+        return false;
+    }
+    source->fd_handler = handler;
+    source->context = context;
+
+    return true;
+}
+
+/**
+ * @brief Call a handler periodically, driven by a timerfd.
+ *
+ * @param milliseconds  Period of the timer
+ * @param handler  Function to call
+ * @param context  Passed to the handler
+ *
+ * @return File descriptor of the timer, to remove it, or -1 on failure
+ */
+int event_loop_timer_add(
+    uint32_t milliseconds, event_loop_timer_handler handler, void *context)
+{
+    struct event_loop_source *source;
+    struct itimerspec period;
+    int fd;
+
+    if (!handler || (milliseconds == 0)) {
+        return -1;
+    }
+    memset(&period, 0, sizeof(period));
+    fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    period.it_interval.tv_sec = milliseconds / 1000;
+    period.it_interval.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+    period.it_value = period.it_interval;
+    if (timerfd_settime(fd, 0, &period, NULL) < 0) {
+        close(fd);
+        return -1;
+    }
+    source = event_loop_source_add(fd);
+    if (!source) {
+        close(fd);
+        return -1;
+    }
+    source->timer = true;
+    source->milliseconds = milliseconds;
+    source->timer_handler = handler;
+    source->context = context;
+
+    return fd;
+}
+
+/**
+ * @brief Stop calling the handler of a file descriptor or timer.
+ * The file descriptor of a timer is closed; others are left open.
+ *
+ * @param fd  File descriptor given to event_loop_fd_add(), or returned
+ *  by event_loop_timer_add()
+ */
+void event_loop_remove(int fd)
+{
+    struct event_loop_source *source;
+    unsigned i;
+
+    for (i = 0; i < EVENT_LOOP_SOURCES_MAX; i++) {
+        source = &Event_Loop_Source[i];
+        if ((fd >= 0) && (source->fd == fd)) {
+            epoll_ctl(Event_Loop_Fd, EPOLL_CTL_DEL, fd, NULL);
+            if (source->timer) {
+                close(fd);
+            }
+            source->fd = -1;
+        }
+    }
+}
+
+/**
+ * @brief Wait for events, and call their handlers.
+ *
+ * @param timeout  Milliseconds to wait, or -1 to wait for an event
+ *
+ * @return Number of events handled, or -1 on failure
+ */
+int event_loop_run_once(int timeout)
+{
+    struct epoll_event events[EVENT_LOOP_SOURCES_MAX];
+    struct event_loop_source *source;
+    uint64_t expirations;
+    int count;
+    int i;
+
+    if (Event_Loop_Fd < 0) {
+        return -1;
+    }
+    count = epoll_wait(Event_Loop_Fd, events, EVENT_LOOP_SOURCES_MAX, timeout);
+    if (count < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    for (i = 0; i < count; i++) {
+        source = events[i].data.ptr;
+        if (source->fd < 0) {
+            /* removed by an earlier handler */
+            continue;
+        }
+        if (source->timer) {
+            if (read(source->fd, &expirations, sizeof(expirations)) ==
+                sizeof(expirations)) {
+                source->timer_handler(
+                    (uint32_t)(expirations * source->milliseconds),
+                    source->context);
+            }
+        } else {
+            source->fd_handler(source->fd, source->context);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Handle events until event_loop_stop() is called.
+ */
+void event_loop_run(void)
+{
+    Event_Loop_Running = true;
+    while (Event_Loop_Running) {
+        if (event_loop_run_once(-1) < 0) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Return from event_loop_run() after the current events.
+ * It may be called from a handler or a signal handler.
+ */
+void event_loop_stop(void)
+{
+    Event_Loop_Running = false;
+}
+
+/**
+ * @brief Remove all the sources, and close the epoll set.
+ */
+void event_loop_cleanup(void)
+{
+    unsigned i;
+
+    if (Event_Loop_Fd < 0) {
+        return;
+    }
+    for (i = 0; i < EVENT_LOOP_SOURCES_MAX; i++) {
+        event_loop_remove(Event_Loop_Source[i].fd);
+    }
+    close(Event_Loop_Fd);
+    Event_Loop_Fd = -1;
+}
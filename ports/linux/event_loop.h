@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @brief Event loop of file descriptor readiness and periodic timers
+ *
+ * @section DESCRIPTION
+ *
+ * The event loop waits in epoll until a registered file descriptor,
+ * such as the socket of a datalink, is ready to read, or a periodic
+ * timer backed by a timerfd expires, and calls its handler. It replaces
+ * main loops that poll the datalink with a short timeout.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Handle a file descriptor that is ready to read.
+ * @param fd - the file descriptor
+ * @param context - the context given when it was added
+ */
+typedef void (*event_loop_fd_handler)(int fd, void *context);
+
+/** Handle the expiry of a periodic timer.
+ * @param milliseconds - time elapsed since the previous expiry
+ * @param context - the context given when it was added
+ */
+typedef void (*event_loop_timer_handler)(
+    uint32_t milliseconds, void *context);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    bool event_loop_init(
+        void);
+    bool event_loop_fd_add(
+        int fd,
+        event_loop_fd_handler handler,
+        void *context);
+    int event_loop_timer_add(
+        uint32_t milliseconds,
+        event_loop_timer_handler handler,
+        void *context);
+    void event_loop_remove(
+        int fd);
+    int event_loop_run_once(
+        int timeout);
+    void event_loop_run(
+        void);
+    void event_loop_stop(
+        void);
+    void event_loop_cleanup(
+        void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
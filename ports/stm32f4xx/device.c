@@ -469,6 +469,16 @@ void Device_Inc_Database_Revision(void)
     Database_Revision++;
 }
 
+/* there is no object name index to keep up to date */
+void Device_Object_Name_Changed(void)
+{
+}
+
+/* there is no Object_List cache to keep up to date */
+void Device_Object_List_Changed(void)
+{
+}
+
 /* Since many network clients depend on the object list */
 /* for discovery, it must be consistent! */
 unsigned Device_Object_List_Count(void)
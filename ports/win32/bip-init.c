@@ -440,6 +440,38 @@ int bip_send_mpdu(BACNET_IP_ADDRESS *dest, uint8_t *mtu, uint16_t mtu_len)
     return rv;
 }
 
+/**
+ * The send function for BACnet/IP driver layer, of one datagram to each
+ * of a list of destinations, such as the forwarding of a BBMD to its
+ * peers and foreign devices.
+ *
+ * @param dest - Points to an array of BACNET_IP_ADDRESS structures
+ *  containing the destination addresses.
+ * @param dest_count - number of destination addresses
+ * @param mtu - the bytes of data to send
+ * @param mtu_len - the number of bytes of data to send
+ *
+ * @return Upon successful completion, returns the number of datagrams
+ *  sent. Otherwise, -1 shall be returned and errno set to indicate the
+ *  error.
+ */
+int bip_send_mpdu_list(BACNET_IP_ADDRESS *dest,
+    unsigned dest_count,
+    uint8_t *mtu,
+    uint16_t mtu_len)
+{
+    unsigned i;
+    int status = 0;
+
+    for (i = 0; i < dest_count; i++) {
+        if (bip_send_mpdu(&dest[i], mtu, mtu_len) < 0) {
+            status = -1;
+        }
+    }
+
+    return (status == 0) ? (int)dest_count : status;
+}
+
 /**
  * BACnet/IP Datalink Receive handler.
  *
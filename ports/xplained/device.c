@@ -419,6 +419,14 @@ bool Device_COV(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
     return (status);
 }
 
+/* none of the objects report their own COV changes */
+bool Device_COV_Pushed(BACNET_OBJECT_TYPE object_type)
+{
+    (void)object_type;
+
+    return false;
+}
+
 void Device_COV_Clear(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
 {
     struct my_object_functions *pObject = NULL;
@@ -99,3 +99,44 @@ bool bacnet_address_same(BACNET_ADDRESS *dest, BACNET_ADDRESS *src)
     }
     return true;
 }
+
+/**
+ * Computes a hash of the parts of a BACnet address that are compared
+ * by bacnet_address_same(), so that the same addresses hash the same.
+ *
+ * @param address - BACnet address to hash
+ *
+ * @return 32-bit FNV-1a hash of the address
+ */
+uint32_t bacnet_address_hash(BACNET_ADDRESS *address)
+{
+    uint32_t hash = 2166136261UL;
+    uint8_t i = 0;
+    uint8_t max_len = 0;
+
+    if (!address) {
+        return hash;
+    }
+    hash = (hash ^ (address->net & 0xFF)) * 16777619UL;
+    hash = (hash ^ (address->net >> 8)) * 16777619UL;
+    hash = (hash ^ address->len) * 16777619UL;
+    max_len = address->len;
+    if (max_len > MAX_MAC_LEN) {
+        max_len = MAX_MAC_LEN;
+    }
+    for (i = 0; i < max_len; i++) {
+        hash = (hash ^ address->adr[i]) * 16777619UL;
+    }
+    if (address->net == 0) {
+        hash = (hash ^ address->mac_len) * 16777619UL;
+        max_len = address->mac_len;
+        if (max_len > MAX_MAC_LEN) {
+            max_len = MAX_MAC_LEN;
+        }
+        for (i = 0; i < max_len; i++) {
+            hash = (hash ^ address->mac[i]) * 16777619UL;
+        }
+    }
+
+    return hash;
+}
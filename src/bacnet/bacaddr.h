@@ -42,6 +42,9 @@ extern "C" {
     bool bacnet_address_same(
         BACNET_ADDRESS * dest,
         BACNET_ADDRESS * src);
+    BACNET_STACK_EXPORT
+    uint32_t bacnet_address_hash(
+        BACNET_ADDRESS * address);
 
 #ifdef __cplusplus
 }
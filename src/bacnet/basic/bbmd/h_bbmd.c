@@ -35,11 +35,15 @@
 #include <stdio.h> /* for standard i/o, like printing */
 #include <stdint.h> /* for standard integer types uint8_t etc. */
 #include <stdbool.h> /* for the standard bool type. */
+#include <stdlib.h> /* for calloc, realloc and free */
 #include <string.h> /* for memcpy */
 #include "bacnet/bacdcode.h"
 #include "bacnet/datalink/bip.h"
 #include "bacnet/datalink/bvlc.h"
 #include "bacnet/basic/sys/debug.h"
+#include "bacnet/basic/sys/dupcache.h"
+#include "bacnet/basic/sys/keyhash.h"
+#include "bacnet/basic/sys/mstimer.h"
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/bbmd/h_bbmd.h"
 
@@ -66,14 +70,32 @@
 static bool BVLC_Debug = false;
 /** result from a client request */
 static uint16_t BVLC_Result_Code = BVLC_RESULT_SUCCESSFUL_COMPLETION;
-/** incoming function */
-static uint8_t BVLC_Function_Code = BVLC_RESULT;
+/** incoming function, of the packet that this thread is handling */
+static BACNET_THREAD_LOCAL uint8_t BVLC_Function_Code = BVLC_RESULT;
 /** Global IP address for NAT handling */
 static BACNET_IP_ADDRESS BVLC_Global_Address;
 /** Flag to indicate if NAT handling is enabled/disabled */
 static bool BVLC_NAT_Handling = false;
 /** if we are a foreign device, store the remote BBMD address/port here */
 static BACNET_IP_ADDRESS Remote_BBMD;
+/* The broadcasts received recently, by origin and NPDU, so that one that
+   comes again by another path, or around a loop of forwards, is dropped
+   before it is forwarded again or handled. */
+#ifndef BVLC_BROADCAST_CACHE_SIZE
+#define BVLC_BROADCAST_CACHE_SIZE 256
+#endif
+#ifndef BVLC_BROADCAST_CACHE_LIFETIME
+#define BVLC_BROADCAST_CACHE_LIFETIME 1000 /* milliseconds */
+#endif
+/* A node that is not a BBMD hands up every broadcast, since a device may
+   repeat one on purpose, unless it opts in, such as a foreign device
+   that hears from more than one BBMD. */
+#ifndef BVLC_BROADCAST_CACHE_NON_BBMD
+#define BVLC_BROADCAST_CACHE_NON_BBMD 0
+#endif
+static DUPCACHE_ENTRY BVLC_Broadcast_Entries[BVLC_BROADCAST_CACHE_SIZE];
+static DUPCACHE BVLC_Broadcast_Cache = { BVLC_Broadcast_Entries,
+    BVLC_BROADCAST_CACHE_SIZE, BVLC_BROADCAST_CACHE_LIFETIME, 0, 0 };
 #if BBMD_ENABLED
 /* local buffer & length for sending */
 static uint8_t BVLC_Buffer[MAX_MPDU];
@@ -84,11 +106,42 @@ static uint16_t BVLC_Buffer_Len;
 #endif
 static BACNET_IP_BROADCAST_DISTRIBUTION_TABLE_ENTRY
     BBMD_Table[MAX_BBMD_ENTRIES];
-/* Foreign Device Table */
+/* Foreign Device Table: an entry is allocated when a foreign device
+   registers, and found by its B/IP address in a keyed hash list.  It is
+   also linked into the bucket of a timing wheel of one second ticks, for
+   the second in which its Time-to-Live plus the grace period runs out,
+   so that the timer only has to look at the buckets of the seconds that
+   passed.  Unless it is zero, MAX_FD_ENTRIES limits the registrations. */
 #ifndef MAX_FD_ENTRIES
-#define MAX_FD_ENTRIES 128
+#define MAX_FD_ENTRIES 0
+#endif
+#ifndef BBMD_FDT_WHEEL_SIZE
+#define BBMD_FDT_WHEEL_SIZE 256 /* buckets - power of two */
 #endif
-static BACNET_IP_FOREIGN_DEVICE_TABLE_ENTRY FD_Table[MAX_FD_ENTRIES];
+struct bbmd_fdt_node {
+    BACNET_IP_FOREIGN_DEVICE_TABLE_ENTRY entry;
+    /* FDT time, in seconds, at which the entry expires */
+    uint32_t expires;
+    struct bbmd_fdt_node *timer_next;
+    struct bbmd_fdt_node *timer_prev;
+};
+static OS_Keyhash FD_List;
+static struct bbmd_fdt_node *FD_Timer_Wheel[BBMD_FDT_WHEEL_SIZE];
+/* seconds elapsed, as given to the maintenance timer */
+static uint32_t FD_Time;
+/* The destinations of a Forwarded-NPDU, the foreign devices followed by
+   the peer BBMDs, without our own address or the global address of the
+   NAT router. It is built again when a table, or either address, has
+   changed since, before the next forward. */
+static struct bbmd_fanout {
+    BACNET_IP_ADDRESS *dest;
+    unsigned dest_size;
+    unsigned fdt_count;
+    unsigned bdt_count;
+    /* our address when built */
+    BACNET_IP_ADDRESS self;
+    bool valid;
+} BBMD_Fanout;
 #endif
 
 /**
@@ -157,6 +210,47 @@ static void debug_print_string(const char *str)
 #endif
 }
 
+#if BBMD_ENABLED || BVLC_BROADCAST_CACHE_NON_BBMD
+/** Hash a B/IP address into a key.
+ *
+ * @param addr - IP address and UDP port
+ * @return the key
+ */
+static KEY bbmd_address_key(BACNET_IP_ADDRESS *addr)
+{
+    KEY key = KEYHASH_SEED;
+    uint8_t port[2];
+
+    key = Keyhash_Hash(key, addr->address, IP_ADDRESS_MAX);
+    port[0] = (uint8_t)(addr->port >> 8);
+    port[1] = (uint8_t)(addr->port & 0xFF);
+
+    return Keyhash_Hash(key, port, sizeof(port));
+}
+
+/** Determine if a broadcast is a repeat of one received recently from
+ * the same origin, and remember it if not.
+ *
+ * @param origin - IP address and UDP port of the origin
+ * @param npdu - the NPDU of the broadcast
+ * @param npdu_len - the number of bytes of the NPDU
+ * @return true if the broadcast is a repeat, to be dropped
+ */
+static bool bbmd_broadcast_repeated(
+    BACNET_IP_ADDRESS *origin, uint8_t *npdu, uint16_t npdu_len)
+{
+    KEY key;
+
+    key = Keyhash_Hash(bbmd_address_key(origin), npdu, npdu_len);
+    if (dupcache_seen(&BVLC_Broadcast_Cache, key, mstimer_now())) {
+        debug_print_bip("Dropped repeated broadcast from", origin);
+        return true;
+    }
+
+    return false;
+}
+#endif
+
 #if BBMD_ENABLED
 /* Define BBMD_BACKUP_FILE if the contents of the BDT
  * (broadcast distribution table) are to be stored in
@@ -223,6 +317,7 @@ void bvlc_bdt_restore_local(void)
             memcpy(BBMD_Table, BBMD_Table_tmp,
                 sizeof(BACNET_IP_BROADCAST_DISTRIBUTION_TABLE_ENTRY) *
                     MAX_BBMD_ENTRIES);
+            BBMD_Fanout.valid = false;
         }
     }
 }
@@ -234,6 +329,200 @@ void bvlc_bdt_restore_local(void)
 {
 }
 #endif
+
+/** Match an FDT entry to a B/IP address.
+ *
+ * @param data - the FDT entry
+ * @param context - the B/IP address
+ * @return true if the entry is of the address
+ */
+static bool bbmd_fdt_match_address(void *data, const void *context)
+{
+    struct bbmd_fdt_node *node = data;
+
+    return !bvlc_address_different(
+        &node->entry.dest_address, (BACNET_IP_ADDRESS *)context);
+}
+
+/** Match an FDT entry to itself.
+ *
+ * @param data - the FDT entry
+ * @param context - the FDT entry looked for
+ * @return true if it is the same entry
+ */
+static bool bbmd_fdt_match_node(void *data, const void *context)
+{
+    return (data == context);
+}
+
+/** Remove an FDT entry from the timing wheel.
+ *
+ * @param node - the FDT entry
+ */
+static void bbmd_fdt_timer_stop(struct bbmd_fdt_node *node)
+{
+    if (node->timer_prev) {
+        node->timer_prev->timer_next = node->timer_next;
+    } else {
+        FD_Timer_Wheel[node->expires & (BBMD_FDT_WHEEL_SIZE - 1)] =
+            node->timer_next;
+    }
+    if (node->timer_next) {
+        node->timer_next->timer_prev = node->timer_prev;
+    }
+    node->timer_next = NULL;
+    node->timer_prev = NULL;
+}
+
+/** Start the timer of an FDT entry with the Time-to-Live of the entry
+ * plus the fixed grace period of 30 seconds, and link it into the
+ * bucket of the timing wheel of the second in which it expires.
+ *
+ * @param node - the FDT entry, not on the wheel
+ */
+static void bbmd_fdt_timer_start(struct bbmd_fdt_node *node)
+{
+    struct bbmd_fdt_node **bucket;
+    uint16_t ttl_seconds = node->entry.ttl_seconds;
+
+    if (ttl_seconds < (UINT16_MAX - 30)) {
+        node->expires = FD_Time + ttl_seconds + 30;
+    } else {
+        node->expires = FD_Time + UINT16_MAX;
+    }
+    bucket = &FD_Timer_Wheel[node->expires & (BBMD_FDT_WHEEL_SIZE - 1)];
+    node->timer_prev = NULL;
+    node->timer_next = *bucket;
+    if (node->timer_next) {
+        node->timer_next->timer_prev = node;
+    }
+    *bucket = node;
+}
+
+/** Remove an entry from the FDT and free it.
+ *
+ * @param node - the FDT entry
+ */
+static void bbmd_fdt_remove(struct bbmd_fdt_node *node)
+{
+    bbmd_fdt_timer_stop(node);
+    Keyhash_Data_Delete_Match(FD_List,
+        bbmd_address_key(&node->entry.dest_address), bbmd_fdt_match_node, node);
+    free(node);
+    BBMD_Fanout.valid = false;
+}
+
+/** Add a foreign device to the FDT, or restart the timer of one that
+ * is registered already.
+ *
+ * @param addr - IP address and UDP port of the foreign device
+ * @param ttl_seconds - Time-to-Live T, in seconds
+ * @return true if the foreign device was added or already registered
+ */
+static bool bbmd_fdt_add(BACNET_IP_ADDRESS *addr, uint16_t ttl_seconds)
+{
+    struct bbmd_fdt_node *node;
+    KEY key;
+
+    if (!FD_List) {
+        FD_List = Keyhash_Create();
+        if (!FD_List) {
+            return false;
+        }
+    }
+    key = bbmd_address_key(addr);
+    node = Keyhash_Data_Match(FD_List, key, bbmd_fdt_match_address, addr);
+    if (node) {
+        /* am I here already?  If so, update my time to live... */
+        bbmd_fdt_timer_stop(node);
+        node->entry.ttl_seconds = ttl_seconds;
+        bbmd_fdt_timer_start(node);
+        return true;
+    }
+    if ((MAX_FD_ENTRIES > 0) && (Keyhash_Count(FD_List) >= MAX_FD_ENTRIES)) {
+        return false;
+    }
+    node = calloc(1, sizeof(struct bbmd_fdt_node));
+    if (!node) {
+        return false;
+    }
+    if (Keyhash_Data_Add(FD_List, key, node) < 0) {
+        free(node);
+        return false;
+    }
+    node->entry.valid = true;
+    bvlc_address_copy(&node->entry.dest_address, addr);
+    node->entry.ttl_seconds = ttl_seconds;
+    bbmd_fdt_timer_start(node);
+    BBMD_Fanout.valid = false;
+
+    return true;
+}
+
+/** Delete a foreign device from the FDT.
+ *
+ * @param addr - IP address and UDP port of the foreign device
+ * @return true if the foreign device was found and deleted
+ */
+static bool bbmd_fdt_delete(BACNET_IP_ADDRESS *addr)
+{
+    struct bbmd_fdt_node *node;
+
+    node = Keyhash_Data_Match(
+        FD_List, bbmd_address_key(addr), bbmd_fdt_match_address, addr);
+    if (node) {
+        bbmd_fdt_remove(node);
+    }
+
+    return (node != NULL);
+}
+
+/** Delete all the foreign devices from the FDT.
+ */
+static void bbmd_fdt_clear(void)
+{
+    struct bbmd_fdt_node *node;
+
+    while (Keyhash_Count(FD_List) > 0) {
+        node = Keyhash_Data_Index(FD_List, 0);
+        bbmd_fdt_remove(node);
+    }
+    FD_Time = 0;
+}
+
+/** Encode the FDT into a Read-Foreign-Device-Table-Ack, with the seconds
+ * that remain of each entry, including the grace period.
+ *
+ * @param pdu - buffer to store the encoding
+ * @param pdu_size - size of the buffer to store encoding
+ * @return number of bytes encoded, or 0 if the FDT does not fit
+ */
+static int bbmd_fdt_encode_ack(uint8_t *pdu, uint16_t pdu_size)
+{
+    BACNET_IP_FOREIGN_DEVICE_TABLE_ENTRY entry = { 0 };
+    struct bbmd_fdt_node *node;
+    uint32_t length;
+    uint16_t offset = 4;
+    int count;
+    int i;
+
+    count = Keyhash_Count(FD_List);
+    length = 4 + ((uint32_t)count * BACNET_IP_FDT_ENTRY_SIZE);
+    if ((length > pdu_size) ||
+        (bvlc_encode_header(pdu, pdu_size, BVLC_READ_FOREIGN_DEVICE_TABLE_ACK,
+             (uint16_t)length) != 4)) {
+        return 0;
+    }
+    for (i = 0; i < count; i++) {
+        node = Keyhash_Data_Index(FD_List, i);
+        entry = node->entry;
+        entry.ttl_seconds_remaining = (uint16_t)(node->expires - FD_Time);
+        offset += (uint16_t)bvlc_encode_foreign_device_table_entry(
+            &pdu[offset], pdu_size - offset, &entry);
+    }
+
+    return (int)length;
+}
 #endif
 
 /** A timer function that is called about once a second.
@@ -243,7 +532,29 @@ void bvlc_bdt_restore_local(void)
 void bvlc_maintenance_timer(uint16_t seconds)
 {
 #if BBMD_ENABLED
-    bvlc_foreign_device_table_maintenance_timer(&FD_Table[0], seconds);
+    struct bbmd_fdt_node *node;
+    struct bbmd_fdt_node *next;
+    unsigned ticks = seconds;
+
+    if (ticks > BBMD_FDT_WHEEL_SIZE) {
+        /* every bucket is looked at once */
+        FD_Time += ticks - BBMD_FDT_WHEEL_SIZE;
+        ticks = BBMD_FDT_WHEEL_SIZE;
+    }
+    while (ticks) {
+        ticks--;
+        FD_Time++;
+        node = FD_Timer_Wheel[FD_Time & (BBMD_FDT_WHEEL_SIZE - 1)];
+        while (node) {
+            next = node->timer_next;
+            /* the bucket also holds the entries of later turns */
+            if ((int32_t)(node->expires - FD_Time) <= 0) {
+                debug_print_bip("FDT entry expired", &node->entry.dest_address);
+                bbmd_fdt_remove(node);
+            }
+            node = next;
+        }
+    }
 #endif
 }
 
@@ -316,7 +627,7 @@ static uint16_t bbmd_forward_npdu(
     BACNET_IP_ADDRESS *bip_src, uint8_t *npdu, uint16_t npdu_length)
 {
     BACNET_IP_ADDRESS broadcast_address = { 0 };
-    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint8_t mtu[MAX_MPDU];
     uint16_t mtu_len = 0;
 
     mtu_len = (uint16_t)bvlc_encode_forwarded_npdu(
@@ -330,92 +641,133 @@ static uint16_t bbmd_forward_npdu(
     return mtu_len;
 }
 
-/** Sends all Broadcast Devices a Forwarded NPDU
+/** Determine if a destination of a Forwarded-NPDU is left out of the
+ * fan-out: our own address, and the global address of the NAT router.
  *
- * @param bip_src - source IP address and UDP port
- * @param npdu - returns the NPDU
- * @param max_npdu - amount of space available in the NPDU
- * @param npdu_length - reported length of the NPDU
- * @param original - was the message an original (not forwarded)
- * @return number of bytes encoded in the Forwarded NPDU
+ * @param dest - destination IP address and UDP port
+ * @param my_addr - our IP address and UDP port
+ * @return true if the destination is left out
  */
-static uint16_t bbmd_bdt_forward_npdu(BACNET_IP_ADDRESS *bip_src,
-    uint8_t *npdu,
-    uint16_t npdu_length,
-    bool original)
+static bool bbmd_fanout_excluded(
+    BACNET_IP_ADDRESS *dest, BACNET_IP_ADDRESS *my_addr)
+{
+    if (!bvlc_address_different(dest, my_addr)) {
+        /* don't forward to our selves */
+        return true;
+    }
+    if (BVLC_NAT_Handling &&
+        !bvlc_address_different(dest, &BVLC_Global_Address)) {
+        /* NAT router port forwards BACnet packets from global IP.
+           Packets sent to that global IP by us would end up back,
+           creating a loop. */
+        return true;
+    }
+
+    return false;
+}
+
+/** Build the destinations of a Forwarded-NPDU from the FDT and BDT,
+ * unless they are built and nothing has changed since.
+ */
+static void bbmd_fanout_update(void)
 {
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
-    unsigned i = 0; /* loop counter */
-    BACNET_IP_ADDRESS bip_dest = { 0 };
     BACNET_IP_ADDRESS my_addr = { 0 };
+    BACNET_IP_ADDRESS *dest = NULL;
+    struct bbmd_fdt_node *node = NULL;
+    unsigned size = 0;
+    unsigned count = 0;
+    unsigned i = 0;
 
     bip_get_addr(&my_addr);
-    /* If we are forwarding an original broadcast message and the NAT
-     * handling is enabled, change the source address to NAT routers
-     * global IP address so the recipient can reply (local IP address
-     * is not accesible from internet side.
-     *
-     * If we are forwarding a message from peer BBMD or foreign device
-     * or the NAT handling is disabled, leave the source address as is.
-     */
-    if (BVLC_NAT_Handling && original) {
-        mtu_len = (uint16_t)bvlc_encode_forwarded_npdu(&mtu[0],
-            (uint16_t)sizeof(mtu), &BVLC_Global_Address, npdu, npdu_length);
-    } else {
-        mtu_len = (uint16_t)bvlc_encode_forwarded_npdu(
-            &mtu[0], (uint16_t)sizeof(mtu), bip_src, npdu, npdu_length);
+    if (BBMD_Fanout.valid &&
+        !bvlc_address_different(&BBMD_Fanout.self, &my_addr)) {
+        return;
+    }
+    size = (unsigned)Keyhash_Count(FD_List) + MAX_BBMD_ENTRIES;
+    if (size > BBMD_Fanout.dest_size) {
+        dest = realloc(BBMD_Fanout.dest, size * sizeof(BACNET_IP_ADDRESS));
+        if (!dest) {
+            BBMD_Fanout.fdt_count = 0;
+            BBMD_Fanout.bdt_count = 0;
+            return;
+        }
+        BBMD_Fanout.dest = dest;
+        BBMD_Fanout.dest_size = size;
+    }
+    for (i = 0; i < (unsigned)Keyhash_Count(FD_List); i++) {
+        node = Keyhash_Data_Index(FD_List, (int)i);
+        dest = &BBMD_Fanout.dest[count];
+        bvlc_address_copy(dest, &node->entry.dest_address);
+        if (!bbmd_fanout_excluded(dest, &my_addr)) {
+            count++;
+        }
     }
-    /* loop through the BDT and send one to each entry */
+    BBMD_Fanout.fdt_count = count;
     for (i = 0; i < MAX_BBMD_ENTRIES; i++) {
         if (BBMD_Table[i].valid) {
+            dest = &BBMD_Fanout.dest[count];
             bvlc_broadcast_distribution_table_entry_forward_address(
-                &bip_dest, &BBMD_Table[i]);
-            if (!bvlc_address_different(&bip_dest, &my_addr)) {
-                /* don't forward to our selves */
-                continue;
+                dest, &BBMD_Table[i]);
+            if (!bbmd_fanout_excluded(dest, &my_addr)) {
+                count++;
             }
-            if (!bvlc_address_different(&bip_dest, bip_src)) {
-                /* don't forward back to origin */
-                continue;
-            }
-            if (BVLC_NAT_Handling) {
-                if (bvlc_address_different(&bip_dest, &BVLC_Global_Address)) {
-                    /* NAT router port forwards BACnet packets from global IP.
-                       Packets sent to that global IP by us would end up back,
-                       creating a loop. */
-                    continue;
-                }
-            }
-            bip_send_mpdu(&bip_dest, mtu, mtu_len);
-            debug_print_bip("BDT Send Forwarded-NPDU", &bip_dest);
         }
     }
+    BBMD_Fanout.bdt_count = count - BBMD_Fanout.fdt_count;
+    bvlc_address_copy(&BBMD_Fanout.self, &my_addr);
+    BBMD_Fanout.valid = true;
+}
 
-    return mtu_len;
+/** Send a Forwarded-NPDU to each of a list of destinations, except
+ * back to its origin, with as few sends as the datalink allows.
+ *
+ * @param dest - the destinations
+ * @param dest_count - the number of destinations
+ * @param bip_src - origin IP address and UDP port
+ * @param mtu - the Forwarded-NPDU
+ * @param mtu_len - the number of bytes of the Forwarded-NPDU
+ */
+static void bbmd_fanout_send(BACNET_IP_ADDRESS *dest,
+    unsigned dest_count,
+    BACNET_IP_ADDRESS *bip_src,
+    uint8_t *mtu,
+    uint16_t mtu_len)
+{
+    unsigned start = 0;
+    unsigned i = 0;
+
+    for (i = 0; i <= dest_count; i++) {
+        if ((i == dest_count) || !bvlc_address_different(&dest[i], bip_src)) {
+            /* don't forward back to origin */
+            if (i > start) {
+                bip_send_mpdu_list(&dest[start], i - start, mtu, mtu_len);
+            }
+            start = i + 1;
+        }
+    }
+    debug_print_unsigned("Sent Forwarded-NPDU to each of", dest_count);
 }
 
-/** Sends all Foreign Devices a Forwarded NPDU
+/** Sends all Foreign Devices, and all Broadcast Devices if asked, a
+ * Forwarded NPDU
  *
  * @param bip_src - source IP address and UDP port
- * @param npdu - returns the NPDU
- * @param max_npdu - amount of space available in the NPDU
+ * @param npdu - the NPDU
  * @param npdu_length - reported length of the NPDU
  * @param original - was the message an original (not forwarded)
+ * @param bdt - forward to the Broadcast Devices as well
  * @return number of bytes encoded in the Forwarded NPDU
  */
-static uint16_t bbmd_fdt_forward_npdu(BACNET_IP_ADDRESS *bip_src,
+static uint16_t bbmd_fanout_forward_npdu(BACNET_IP_ADDRESS *bip_src,
     uint8_t *npdu,
     uint16_t npdu_length,
-    bool original)
+    bool original,
+    bool bdt)
 {
-    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint8_t mtu[MAX_MPDU];
     uint16_t mtu_len = 0;
-    unsigned i = 0; /* loop counter */
-    BACNET_IP_ADDRESS bip_dest = { 0 };
-    BACNET_IP_ADDRESS my_addr = { 0 };
+    unsigned count = 0;
 
-    bip_get_addr(&my_addr);
     /* If we are forwarding an original broadcast message and the NAT
      * handling is enabled, change the source address to NAT routers
      * global IP address so the recipient can reply (local IP address
@@ -427,34 +779,19 @@ static uint16_t bbmd_fdt_forward_npdu(BACNET_IP_ADDRESS *bip_src,
     if (BVLC_NAT_Handling && original) {
         mtu_len = (uint16_t)bvlc_encode_forwarded_npdu(&mtu[0],
             (uint16_t)sizeof(mtu), &BVLC_Global_Address, npdu, npdu_length);
+        /* drop it, should it come back from the global IP */
+        (void)bbmd_broadcast_repeated(&BVLC_Global_Address, npdu, npdu_length);
     } else {
         mtu_len = (uint16_t)bvlc_encode_forwarded_npdu(
             &mtu[0], (uint16_t)sizeof(mtu), bip_src, npdu, npdu_length);
     }
-
-    /* loop through the FDT and send one to each entry */
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid && FD_Table[i].ttl_seconds_remaining) {
-            bvlc_address_copy(&bip_dest, &FD_Table[i].dest_address);
-            if (!bvlc_address_different(&bip_dest, &my_addr)) {
-                /* don't forward to our selves */
-                continue;
-            }
-            if (!bvlc_address_different(&bip_dest, bip_src)) {
-                /* don't forward back to origin */
-                continue;
-            }
-            if (BVLC_NAT_Handling) {
-                if (bvlc_address_different(&bip_dest, &BVLC_Global_Address)) {
-                    /* NAT router port forwards BACnet packets from global IP.
-                       Packets sent to that global IP by us would end up back,
-                       creating a loop. */
-                    continue;
-                }
-            }
-            bip_send_mpdu(&bip_dest, mtu, mtu_len);
-            debug_print_bip("FDT Send Forwarded-NPDU", &bip_dest);
+    if (mtu_len > 0) {
+        bbmd_fanout_update();
+        count = BBMD_Fanout.fdt_count;
+        if (bdt) {
+            count += BBMD_Fanout.bdt_count;
         }
+        bbmd_fanout_send(&BBMD_Fanout.dest[0], count, bip_src, mtu, mtu_len);
     }
 
     return mtu_len;
@@ -591,8 +928,7 @@ int bvlc_send_pdu(BACNET_ADDRESS *dest,
 #if BBMD_ENABLED
             if (mtu_len > 0) {
                 bip_get_addr(&bip_src);
-                bbmd_fdt_forward_npdu(&bip_src, pdu, pdu_len, true);
-                bbmd_bdt_forward_npdu(&bip_src, pdu, pdu_len, true);
+                bbmd_fanout_forward_npdu(&bip_src, pdu, pdu_len, true, true);
             }
 #endif
         }
@@ -706,8 +1042,15 @@ int bvlc_bbmd_disabled_handler(BACNET_IP_ADDRESS *addr,
                         debug_print_string("Forwarded-NPDU is me!");
                         break;
                     }
-                    bvlc_ip_address_to_bacnet_local(src, &fwd_address);
                     offset = header_len + function_len - npdu_len;
+#if BVLC_BROADCAST_CACHE_NON_BBMD
+                    if (bbmd_broadcast_repeated(
+                            &fwd_address, &mtu[offset], npdu_len)) {
+                        offset = 0;
+                        break;
+                    }
+#endif
+                    bvlc_ip_address_to_bacnet_local(src, &fwd_address);
                     debug_print_npdu("Forwarded-NPDU", offset, npdu_len);
                 } else {
                     debug_print_string("Forwarded-NPDU: Unable to decode!");
@@ -763,8 +1106,14 @@ int bvlc_bbmd_disabled_handler(BACNET_IP_ADDRESS *addr,
                 function_len = bvlc_decode_original_broadcast(
                     pdu, pdu_len, NULL, 0, &npdu_len);
                 if (function_len) {
-                    bvlc_ip_address_to_bacnet_local(src, addr);
                     offset = header_len + function_len - npdu_len;
+#if BVLC_BROADCAST_CACHE_NON_BBMD
+                    if (bbmd_broadcast_repeated(addr, &mtu[offset], npdu_len)) {
+                        offset = 0;
+                        break;
+                    }
+#endif
+                    bvlc_ip_address_to_bacnet_local(src, addr);
                     debug_print_npdu(
                         "Original-Broadcast-NPDU", offset, npdu_len);
                 } else {
@@ -840,6 +1189,7 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
             function_len = bvlc_decode_write_broadcast_distribution_table(
                 pdu, pdu_len, &BBMD_Table[0]);
             if (function_len > 0) {
+                BBMD_Fanout.valid = false;
                 /* BDT changed! Save backup to file */
                 bvlc_bdt_backup_local();
                 result_code = BVLC_RESULT_SUCCESSFUL_COMPLETION;
@@ -902,6 +1252,12 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
                     debug_print_string("Forwarded-NPDU is me!");
                     break;
                 }
+                offset = header_len + function_len - npdu_len;
+                if (bbmd_broadcast_repeated(
+                        &fwd_address, &mtu[offset], npdu_len)) {
+                    offset = 0;
+                    break;
+                }
                 if (bbmd_bdt_member_mask_is_unicast(addr)) {
                     /*  Upon receipt of a BVLL Forwarded-NPDU message
                         from a BBMD which is in the receiving BBMD's BDT,
@@ -913,11 +1269,12 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
                 }
                 /*  In addition, the constructed BVLL Forwarded-NPDU
                     message shall be unicast to each foreign device in
-                    the BBMD's FDT. */
-                bbmd_fdt_forward_npdu(&fwd_address, mtu, mtu_len, false);
+                    the BBMD's FDT. It is the received one, as is. */
+                bbmd_fanout_update();
+                bbmd_fanout_send(&BBMD_Fanout.dest[0],
+                    BBMD_Fanout.fdt_count, &fwd_address, mtu, mtu_len);
                 /* prepare the message for me! */
                 bvlc_ip_address_to_bacnet_local(src, &fwd_address);
-                offset = header_len + function_len - npdu_len;
                 debug_print_npdu("Forwarded-NPDU", offset, npdu_len);
             }
             break;
@@ -935,8 +1292,7 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
             function_len =
                 bvlc_decode_register_foreign_device(pdu, pdu_len, &ttl_seconds);
             if (function_len) {
-                if (bvlc_foreign_device_table_entry_add(
-                        &FD_Table[0], addr, ttl_seconds)) {
+                if (bbmd_fdt_add(addr, ttl_seconds)) {
                     result_code = BVLC_RESULT_SUCCESSFUL_COMPLETION;
                     send_result = true;
                 } else {
@@ -956,8 +1312,8 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
                it shall return a BVLC-Result message to the originating device
                with a result code of X'0040' indicating that the read attempt
                has failed. */
-            BVLC_Buffer_Len = bvlc_encode_read_foreign_device_table_ack(
-                BVLC_Buffer, sizeof(BVLC_Buffer), &FD_Table[0]);
+            BVLC_Buffer_Len = (uint16_t)bbmd_fdt_encode_ack(
+                BVLC_Buffer, sizeof(BVLC_Buffer));
             if (BVLC_Buffer_Len > 0) {
                 bip_send_mpdu(addr, BVLC_Buffer, BVLC_Buffer_Len);
             } else {
@@ -986,8 +1342,7 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
             function_len =
                 bvlc_decode_delete_foreign_device(pdu, pdu_len, &fwd_address);
             if (function_len > 0) {
-                if (bvlc_foreign_device_table_entry_delete(
-                        &FD_Table[0], &fwd_address)) {
+                if (bbmd_fdt_delete(&fwd_address)) {
                     result_code = BVLC_RESULT_SUCCESSFUL_COMPLETION;
                     send_result = true;
                 } else {
@@ -1016,10 +1371,13 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
                it shall return a BVLC-Result message to the foreign device
                with a result code of X'0060' indicating that the forwarding
                attempt was unsuccessful */
+            if (bbmd_broadcast_repeated(addr, pdu, pdu_len)) {
+                /* forwarded already */
+                break;
+            }
             npdu_len = bbmd_forward_npdu(addr, pdu, pdu_len);
             if (npdu_len > 0) {
-                bbmd_fdt_forward_npdu(addr, pdu, pdu_len, false);
-                bbmd_bdt_forward_npdu(addr, pdu, pdu_len, false);
+                bbmd_fanout_forward_npdu(addr, pdu, pdu_len, false, true);
             } else {
                 result_code = BVLC_RESULT_DISTRIBUTE_BROADCAST_TO_NETWORK_NAK;
                 send_result = true;
@@ -1058,9 +1416,13 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
             function_len = bvlc_decode_original_broadcast(
                 pdu, pdu_len, NULL, 0, &npdu_len);
             if (function_len) {
+                offset = header_len + function_len - npdu_len;
+                if (bbmd_broadcast_repeated(addr, &mtu[offset], npdu_len)) {
+                    offset = 0;
+                    break;
+                }
                 /* prepare the message for me! */
                 bvlc_ip_address_to_bacnet_local(src, addr);
-                offset = header_len + function_len - npdu_len;
                 /* Upon receipt of a BVLL Original-Broadcast-NPDU message,
                    a BBMD shall construct a BVLL Forwarded-NPDU message and
                    send it to each IP subnet in its BDT with the exception
@@ -1075,8 +1437,7 @@ int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
                    shall be sent directly to each foreign device currently in
                    the BBMD's FDT also using the BVLL Forwarded-NPDU message. */
                 npdu = &mtu[offset];
-                bbmd_fdt_forward_npdu(addr, npdu, npdu_len, true);
-                bbmd_bdt_forward_npdu(addr, npdu, npdu_len, true);
+                bbmd_fanout_forward_npdu(addr, npdu, npdu_len, true, true);
                 debug_print_npdu("Original-Broadcast-NPDU", offset, npdu_len);
             } else {
                 debug_print_string(
@@ -1123,6 +1484,50 @@ int bvlc_handler(BACNET_IP_ADDRESS *addr,
 #endif
 }
 
+/**
+ * Use this handler for a BACnet/IPv4 packet received in place. An
+ * Original-Unicast-NPDU that carries a confirmed request is parsed in
+ * one pass by bvlc_decode_packet_header(), and its compact header is
+ * left in the packet for the network and application layers. Any
+ * other packet is given to bvlc_handler(). A header that the caller
+ * parsed already, such as without its lock, is not parsed again.
+ *
+ * @param addr [in] IPv4 address to send any NAK back to.
+ * @param packet [in,out] The received packet, whose source address
+ *  is set, and whose header is valid if it took the fast path.
+ *
+ * @return number of bytes offset into the packet for the NPDU, or 0 if
+ *  handled
+ */
+int bvlc_handler_packet(BACNET_IP_ADDRESS *addr, BACNET_PACKET *packet)
+{
+    int offset = 0;
+
+    if (!packet) {
+        return 0;
+    }
+    if (packet->header.valid || bvlc_decode_packet_header(packet)) {
+        debug_print_bip("Received Original-Unicast-NPDU", addr);
+        if (bbmd_address_match_self(addr)) {
+            /* ignore messages from my IPv4 address */
+            packet->header.valid = false;
+        } else {
+            BVLC_Function_Code = BVLC_ORIGINAL_UNICAST_NPDU;
+            bvlc_ip_address_to_bacnet_local(&packet->src, addr);
+            offset = packet->npdu_offset;
+        }
+    } else {
+        offset = bvlc_handler(addr, &packet->src,
+            &packet->buffer[packet->bvlc_offset],
+            (uint16_t)(packet->length - packet->bvlc_offset));
+        if (offset > 0) {
+            offset += packet->bvlc_offset;
+        }
+    }
+
+    return offset;
+}
+
 #if BBMD_CLIENT_ENABLED
 /** Register as a foreign device with the indicated BBMD.
  * @param bbmd_addr - IPv4 address of BBMD with which to register
@@ -1198,13 +1603,36 @@ uint8_t bvlc_get_function_code(void)
     return BVLC_Function_Code;
 }
 
+/**
+ * @brief Get the number of broadcasts that were dropped as repeats of one
+ * received recently from the same origin.
+ * @return number of hits of the cache of broadcasts
+ */
+unsigned long bvlc_broadcast_cache_hits(void)
+{
+    return dupcache_hits(&BVLC_Broadcast_Cache);
+}
+
+/**
+ * @brief Get the number of broadcasts that were not repeats.
+ * @return number of misses of the cache of broadcasts
+ */
+unsigned long bvlc_broadcast_cache_misses(void)
+{
+    return dupcache_misses(&BVLC_Broadcast_Cache);
+}
+
 #if BBMD_ENABLED
 /**
  * @brief Get handle to broadcast distribution table (BDT).
+ * The destinations of the next forward are built from the table again,
+ * so call this again after changing it.
  * @return pointer to first entry of broadcast distribution table
  */
 BACNET_IP_BROADCAST_DISTRIBUTION_TABLE_ENTRY *bvlc_bdt_list(void)
 {
+    BBMD_Fanout.valid = false;
+
     return &BBMD_Table[0];
 }
 
@@ -1214,6 +1642,7 @@ BACNET_IP_BROADCAST_DISTRIBUTION_TABLE_ENTRY *bvlc_bdt_list(void)
 void bvlc_bdt_list_clear(void)
 {
     bvlc_broadcast_distribution_table_valid_clear(&BBMD_Table[0]);
+    BBMD_Fanout.valid = false;
     /* BDT changed! Save backup to file */
     bvlc_bdt_backup_local();
 }
@@ -1238,6 +1667,9 @@ void bvlc_set_global_address_for_nat(const BACNET_IP_ADDRESS *addr)
 {
     bvlc_address_copy(&BVLC_Global_Address, addr);
     BVLC_NAT_Handling = true;
+#if BBMD_ENABLED
+    BBMD_Fanout.valid = false;
+#endif
     debug_print_bip("NAT Address enabled", addr);
 }
 
@@ -1247,16 +1679,21 @@ void bvlc_set_global_address_for_nat(const BACNET_IP_ADDRESS *addr)
 void bvlc_disable_nat(void)
 {
     BVLC_NAT_Handling = false;
+#if BBMD_ENABLED
+    BBMD_Fanout.valid = false;
+#endif
     debug_print_string("NAT Address disabled");
 }
 
 void bvlc_init(void)
 {
+    dupcache_clear(&BVLC_Broadcast_Cache);
 #if BBMD_ENABLED
     debug_print_string("Initializing (BBMD Enabled).");
     bvlc_broadcast_distribution_table_link_array(
         &BBMD_Table[0], MAX_BBMD_ENTRIES);
-    bvlc_foreign_device_table_link_array(&FD_Table[0], MAX_FD_ENTRIES);
+    bbmd_fdt_clear();
+    BBMD_Fanout.valid = false;
 #else
     debug_print_string("Initializing (BBMD Disabled).");
 #endif
@@ -47,6 +47,9 @@ int bvlc_handler(BACNET_IP_ADDRESS *addr,
     uint8_t *npdu,
     uint16_t npdu_len);
 
+BACNET_STACK_EXPORT
+int bvlc_handler_packet(BACNET_IP_ADDRESS *addr, BACNET_PACKET *packet);
+
 BACNET_STACK_EXPORT
 int bvlc_bbmd_enabled_handler(BACNET_IP_ADDRESS *addr,
     BACNET_ADDRESS *src,
@@ -72,6 +75,12 @@ uint16_t bvlc_get_last_result(void);
 BACNET_STACK_EXPORT
 uint8_t bvlc_get_function_code(void);
 
+/* broadcasts dropped as repeats, and broadcasts seen first */
+BACNET_STACK_EXPORT
+unsigned long bvlc_broadcast_cache_hits(void);
+BACNET_STACK_EXPORT
+unsigned long bvlc_broadcast_cache_misses(void);
+
 BACNET_STACK_EXPORT
 void bvlc_maintenance_timer(uint16_t seconds);
 
@@ -40,6 +40,9 @@
 #include "bacnet/datalink/bip6.h"
 #include "bacnet/datalink/bvlc6.h"
 #include "bacnet/basic/sys/debug.h"
+#include "bacnet/basic/sys/dupcache.h"
+#include "bacnet/basic/sys/keyhash.h"
+#include "bacnet/basic/sys/mstimer.h"
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/bbmd6/vmac.h"
 #include "bacnet/basic/bbmd6/h_bbmd6.h"
@@ -51,6 +54,24 @@ static uint8_t BVLC6_Function_Code = BVLC6_RESULT;
 
 /** if we are a foreign device, store the remote BBMD address/port here */
 static BACNET_IP6_ADDRESS Remote_BBMD;
+/* The broadcasts received recently, by origin VMAC and NPDU, so that one
+   that comes again by another path is dropped before it is forwarded
+   again or handled. */
+#ifndef BVLC6_BROADCAST_CACHE_SIZE
+#define BVLC6_BROADCAST_CACHE_SIZE 256
+#endif
+#ifndef BVLC6_BROADCAST_CACHE_LIFETIME
+#define BVLC6_BROADCAST_CACHE_LIFETIME 1000 /* milliseconds */
+#endif
+/* A node that is not a BBMD hands up every broadcast, since a device may
+   repeat one on purpose, unless it opts in, such as a foreign device
+   that hears from more than one BBMD. */
+#ifndef BVLC6_BROADCAST_CACHE_NON_BBMD
+#define BVLC6_BROADCAST_CACHE_NON_BBMD 0
+#endif
+static DUPCACHE_ENTRY BVLC6_Broadcast_Entries[BVLC6_BROADCAST_CACHE_SIZE];
+static DUPCACHE BVLC6_Broadcast_Cache = { BVLC6_Broadcast_Entries,
+    BVLC6_BROADCAST_CACHE_SIZE, BVLC6_BROADCAST_CACHE_LIFETIME, 0, 0 };
 #if defined(BACDL_BIP6) && BBMD6_ENABLED
 /* local buffer & length for sending */
 static uint8_t BVLC6_Buffer[MAX_MPDU];
@@ -94,6 +115,36 @@ void bvlc6_maintenance_timer(uint16_t seconds)
 #endif
 }
 
+#if (defined(BACDL_BIP6) && BBMD6_ENABLED) || \
+    BVLC6_BROADCAST_CACHE_NON_BBMD
+/**
+ * Determine if a broadcast is a repeat of one received recently from
+ * the same origin, and remember it if not.
+ *
+ * @param vmac_src - Source-Virtual-Address of the origin
+ * @param npdu - the NPDU of the broadcast
+ * @param npdu_len - the number of bytes of the NPDU
+ * @return true if the broadcast is a repeat, to be dropped
+ */
+static bool bbmd6_broadcast_repeated(
+    uint32_t vmac_src, uint8_t *npdu, uint16_t npdu_len)
+{
+    uint8_t vmac[4];
+    KEY key;
+
+    encode_unsigned32(vmac, vmac_src);
+    key = Keyhash_Hash(KEYHASH_SEED, vmac, sizeof(vmac));
+    key = Keyhash_Hash(key, npdu, npdu_len);
+    if (dupcache_seen(&BVLC6_Broadcast_Cache, key, mstimer_now())) {
+        debug_printf("BIP6: Dropped repeated broadcast from %lu.\n",
+            (unsigned long)vmac_src);
+        return true;
+    }
+
+    return false;
+}
+#endif
+
 /**
  * Sets the IPv6 source address from a VMAC address structure
  *
@@ -146,7 +197,10 @@ static bool bbmd6_address_to_vmac(
 }
 
 /**
- * Adds an IPv6 source address and Device ID key to a VMAC address cache
+ * Adds an IPv6 source address and Device ID key to a VMAC address cache,
+ * or updates the entry of a device whose address has changed.  The entry
+ * of another device that had the address before is removed, so that
+ * each address resolves to one device.
  *
  * @param device_id - device ID used as the key-pair
  * @param addr - IPv6 source address
@@ -158,16 +212,26 @@ static bool bbmd6_add_vmac(uint32_t device_id, BACNET_IP6_ADDRESS *addr)
     bool status = false;
     struct vmac_data *vmac;
     struct vmac_data new_vmac;
+    uint32_t old_device_id = 0;
 
-    if (addr) {
+    if (addr && bbmd6_address_to_vmac(&new_vmac, addr)) {
         vmac = VMAC_Find_By_Key(device_id);
         if (vmac) {
-            /* already exists - replace? */
-        } else if (bbmd6_address_to_vmac(&new_vmac, addr)) {
-            /* new entry - add it! */
-            status = VMAC_Add(device_id, &new_vmac);
-            debug_printf("BVLC6: Adding VMAC %lu.\n", (unsigned long)device_id);
+            if (!VMAC_Different(vmac, &new_vmac)) {
+                /* already exists */
+                return false;
+            }
+            debug_printf("BVLC6: Moving VMAC %lu.\n", (unsigned long)device_id);
+            VMAC_Delete(device_id);
+        }
+        if (VMAC_Find_By_Data(&new_vmac, &old_device_id)) {
+            debug_printf("BVLC6: Replacing VMAC %lu.\n",
+                (unsigned long)old_device_id);
+            VMAC_Delete(old_device_id);
         }
+        /* new entry - add it! */
+        status = VMAC_Add(device_id, &new_vmac);
+        debug_printf("BVLC6: Adding VMAC %lu.\n", (unsigned long)device_id);
     }
 
     return status;
@@ -690,12 +754,19 @@ int bvlc6_bbmd_disabled_handler(BACNET_IP6_ADDRESS *addr,
                     function_len = bvlc6_decode_original_broadcast(
                         pdu, pdu_len, &vmac_src, NULL, 0, &npdu_len);
                     if (function_len) {
+                        offset = header_len + (function_len - npdu_len);
+#if BVLC6_BROADCAST_CACHE_NON_BBMD
+                        if (bbmd6_broadcast_repeated(
+                                vmac_src, &mtu[offset], npdu_len)) {
+                            offset = 0;
+                            break;
+                        }
+#endif
                         /* The Virtual MAC address table shall be updated
                            using the respective parameter values of the
                            incoming messages. */
                         bbmd6_add_vmac(vmac_src, addr);
                         bvlc6_vmac_address_set(src, vmac_src);
-                        offset = header_len + (function_len - npdu_len);
                     } else {
                         debug_printf("BIP6: Original-Broadcast-NPDU: Unable to "
                                      "decode!\n");
@@ -711,12 +782,19 @@ int bvlc6_bbmd_disabled_handler(BACNET_IP6_ADDRESS *addr,
                     function_len = bvlc6_decode_forwarded_npdu(pdu, pdu_len,
                         &vmac_src, &fwd_address, NULL, 0, &npdu_len);
                     if (function_len) {
+                        offset = header_len + (function_len - npdu_len);
+#if BVLC6_BROADCAST_CACHE_NON_BBMD
+                        if (bbmd6_broadcast_repeated(
+                                vmac_src, &mtu[offset], npdu_len)) {
+                            offset = 0;
+                            break;
+                        }
+#endif
                         /* The Virtual MAC address table shall be updated
                            using the respective parameter values of the
                            incoming messages. */
                         bbmd6_add_vmac(vmac_src, &fwd_address);
                         bvlc6_vmac_address_set(src, vmac_src);
-                        offset = header_len + (function_len - npdu_len);
                     } else {
                         debug_printf(
                             "BIP6: Forwarded-NPDU: Unable to decode!\n");
@@ -853,6 +931,10 @@ int bvlc6_bbmd_enabled_handler(BACNET_IP6_ADDRESS *addr,
                 if (function_len) {
                     offset = header_len + (function_len - npdu_len);
                     npdu = &mtu[offset];
+                    if (bbmd6_broadcast_repeated(vmac_src, npdu, npdu_len)) {
+                        offset = 0;
+                        break;
+                    }
                     /*  Upon receipt of a BVLL Original-Broadcast-NPDU
                         message from the local multicast domain, a BBMD
                         shall construct a BVLL Forwarded-NPDU message and
@@ -881,6 +963,10 @@ int bvlc6_bbmd_enabled_handler(BACNET_IP6_ADDRESS *addr,
                 if (function_len) {
                     offset = header_len + (function_len - npdu_len);
                     npdu = &mtu[offset];
+                    if (bbmd6_broadcast_repeated(vmac_src, npdu, npdu_len)) {
+                        offset = 0;
+                        break;
+                    }
                     /*  Upon receipt of a BVLL Forwarded-NPDU message
                         from a BBMD which is in the receiving BBMD's BDT,
                         a BBMD shall construct a BVLL Forwarded-NPDU and
@@ -1011,6 +1097,27 @@ uint8_t bvlc6_get_function_code(void)
     return BVLC6_Function_Code;
 }
 
+/**
+ * Get the number of broadcasts that were dropped as repeats of one
+ * received recently from the same origin.
+ *
+ * @return number of hits of the cache of broadcasts
+ */
+unsigned long bvlc6_broadcast_cache_hits(void)
+{
+    return dupcache_hits(&BVLC6_Broadcast_Cache);
+}
+
+/**
+ * Get the number of broadcasts that were not repeats.
+ *
+ * @return number of misses of the cache of broadcasts
+ */
+unsigned long bvlc6_broadcast_cache_misses(void)
+{
+    return dupcache_misses(&BVLC6_Broadcast_Cache);
+}
+
 /**
  * Cleanup any memory usage
  */
@@ -1027,6 +1134,7 @@ void bvlc6_init(void)
     VMAC_Init();
     BVLC6_Result_Code = BVLC6_RESULT_SUCCESSFUL_COMPLETION;
     BVLC6_Function_Code = BVLC6_RESULT;
+    dupcache_clear(&BVLC6_Broadcast_Cache);
     bvlc6_address_set(
         &Remote_BBMD, 0, 0, 0, 0, 0, 0, 0, BIP6_MULTICAST_GROUP_ID);
 #if defined(BACDL_BIP6) && BBMD6_ENABLED
@@ -80,6 +80,14 @@ extern "C" {
     uint8_t bvlc6_get_function_code(
         void);
 
+    /* broadcasts dropped as repeats, and broadcasts seen first */
+    BACNET_STACK_EXPORT
+    unsigned long bvlc6_broadcast_cache_hits(
+        void);
+    BACNET_STACK_EXPORT
+    unsigned long bvlc6_broadcast_cache_misses(
+        void);
+
     BACNET_STACK_EXPORT
     void bvlc6_maintenance_timer(
         uint16_t seconds);
@@ -38,7 +38,7 @@
 #include <stdlib.h>
 #include "bacnet/config.h"
 #include "bacnet/bacdef.h"
-#include "bacnet/basic/sys/keylist.h"
+#include "bacnet/basic/sys/keyhash.h"
 /* me! */
 #include "bacnet/basic/bbmd6/vmac.h"
 
@@ -48,15 +48,69 @@
 /* This module is used to handle the virtual MAC address binding that */
 /* occurs in BACnet for ZigBee or IPv6. */
 
-/* Key List for storing the object data sorted by instance number  */
-static OS_Keylist VMAC_List;
+/* The VMAC entries are kept in two keyed hash lists, one by Device ID
+   and one by a hash of the VMAC address, so that the entry of a device
+   is found in constant time either way. */
+struct vmac_entry {
+    /* first, so that the entry is its VMAC data */
+    struct vmac_data vmac;
+    uint32_t device_id;
+};
+static OS_Keyhash VMAC_List;
+static OS_Keyhash VMAC_Data_List;
+
+/**
+ * Hash a VMAC address into a key of the list by VMAC address
+ *
+ * @param vmac - VMAC address
+ *
+ * @return the key
+ */
+static KEY VMAC_Data_Key(struct vmac_data *vmac)
+{
+    size_t mac_len = vmac->mac_len;
+
+    if (mac_len > VMAC_MAC_MAX) {
+        mac_len = VMAC_MAC_MAX;
+    }
+
+    return Keyhash_Hash(KEYHASH_SEED, vmac->mac, mac_len);
+}
+
+/**
+ * Match an entry of the list by VMAC address to a VMAC address
+ *
+ * @param data - the VMAC entry
+ * @param context - the VMAC address sought
+ *
+ * @return true if the entry has the VMAC address
+ */
+static bool VMAC_Data_Match(void *data, const void *context)
+{
+    struct vmac_entry *entry = data;
+
+    return VMAC_Match((struct vmac_data *)context, &entry->vmac);
+}
+
+/**
+ * Match an entry of the list by VMAC address to itself
+ *
+ * @param data - the VMAC entry
+ * @param context - the VMAC entry sought
+ *
+ * @return true if it is the same entry
+ */
+static bool VMAC_Entry_Match(void *data, const void *context)
+{
+    return (data == context);
+}
 
 /**
  * Returns the number of VMAC in the list
  */
 unsigned int VMAC_Count(void)
 {
-    return (unsigned int)Keylist_Count(VMAC_List);
+    return (unsigned int)Keyhash_Count(VMAC_List);
 }
 
 /**
@@ -70,25 +124,32 @@ unsigned int VMAC_Count(void)
 bool VMAC_Add(uint32_t device_id, struct vmac_data *src)
 {
     bool status = false;
-    struct vmac_data *pVMAC = NULL;
-    int index = 0;
+    struct vmac_entry *entry = NULL;
     size_t i = 0;
 
-    pVMAC = Keylist_Data(VMAC_List, device_id);
-    if (!pVMAC) {
-        pVMAC = calloc(1, sizeof(struct vmac_data));
-        if (pVMAC) {
+    if (!VMAC_List || !VMAC_Data_List || !src) {
+        return false;
+    }
+    if (!Keyhash_Data(VMAC_List, device_id)) {
+        entry = calloc(1, sizeof(struct vmac_entry));
+        if (entry) {
             /* copy the MAC into the data store */
-            for (i = 0; i < sizeof(pVMAC->mac); i++) {
+            for (i = 0; i < sizeof(entry->vmac.mac); i++) {
                 if (i < src->mac_len) {
-                    pVMAC->mac[i] = src->mac[i];
+                    entry->vmac.mac[i] = src->mac[i];
                 } else {
                     break;
                 }
             }
-            pVMAC->mac_len = src->mac_len;
-            index = Keylist_Data_Add(VMAC_List, device_id, pVMAC);
-            if (index >= 0) {
+            entry->vmac.mac_len = src->mac_len;
+            entry->device_id = device_id;
+            if (Keyhash_Data_Add(VMAC_List, device_id, entry) < 0) {
+                free(entry);
+            } else if (Keyhash_Data_Add(VMAC_Data_List,
+                           VMAC_Data_Key(&entry->vmac), entry) < 0) {
+                Keyhash_Data_Delete(VMAC_List, device_id);
+                free(entry);
+            } else {
                 status = true;
                 printf("VMAC %u added.\n", (unsigned int)device_id);
             }
@@ -103,16 +164,18 @@ bool VMAC_Add(uint32_t device_id, struct vmac_data *src)
  *
  * @param device_id - BACnet device object instance number
  *
- * @return pointer to the VMAC data from the list - be sure to free() it!
+ * @return true if the VMAC was found and deleted
  */
 bool VMAC_Delete(uint32_t device_id)
 {
     bool status = false;
-    struct vmac_data *pVMAC;
+    struct vmac_entry *entry;
 
-    pVMAC = Keylist_Data_Delete(VMAC_List, device_id);
-    if (pVMAC) {
-        free(pVMAC);
+    entry = Keyhash_Data_Delete(VMAC_List, device_id);
+    if (entry) {
+        Keyhash_Data_Delete_Match(VMAC_Data_List,
+            VMAC_Data_Key(&entry->vmac), VMAC_Entry_Match, entry);
+        free(entry);
         status = true;
     }
 
@@ -128,7 +191,14 @@ bool VMAC_Delete(uint32_t device_id)
  */
 struct vmac_data *VMAC_Find_By_Key(uint32_t device_id)
 {
-    return Keylist_Data(VMAC_List, device_id);
+    struct vmac_entry *entry;
+
+    entry = Keyhash_Data(VMAC_List, device_id);
+    if (entry) {
+        return &entry->vmac;
+    }
+
+    return NULL;
 }
 
 /** Compare the VMAC address
@@ -204,28 +274,17 @@ bool VMAC_Match(struct vmac_data *vmac1, struct vmac_data *vmac2)
  */
 bool VMAC_Find_By_Data(struct vmac_data *vmac, uint32_t *device_id)
 {
-    bool status = false;
-    struct vmac_data *list_vmac;
-    int count = 0;
-    int index = 0;
-
-    count = Keylist_Count(VMAC_List);
-    while (count) {
-        index = count - 1;
-        list_vmac = Keylist_Data_Index(VMAC_List, index);
-        if (list_vmac) {
-            if (VMAC_Match(vmac, list_vmac)) {
-                if (device_id) {
-                    *device_id = Keylist_Key(VMAC_List, index);
-                }
-                status = true;
-                break;
-            }
-        }
-        count--;
+    struct vmac_entry *entry = NULL;
+
+    if (vmac) {
+        entry = Keyhash_Data_Match(
+            VMAC_Data_List, VMAC_Data_Key(vmac), VMAC_Data_Match, vmac);
+    }
+    if (entry && device_id) {
+        *device_id = entry->device_id;
     }
 
-    return status;
+    return (entry != NULL);
 }
 
 /**
@@ -233,18 +292,18 @@ bool VMAC_Find_By_Data(struct vmac_data *vmac, uint32_t *device_id)
  */
 void VMAC_Cleanup(void)
 {
-    struct vmac_data *pVMAC;
+    struct vmac_entry *entry;
 
     if (VMAC_List) {
-        do {
-            pVMAC = Keylist_Data_Pop(VMAC_List);
-            if (pVMAC) {
-                free(pVMAC);
-            }
-        } while (pVMAC);
-        Keylist_Delete(VMAC_List);
+        while (Keyhash_Count(VMAC_List) > 0) {
+            entry = Keyhash_Data_Delete_By_Index(VMAC_List, 0);
+            free(entry);
+        }
+        Keyhash_Delete(VMAC_List);
         VMAC_List = NULL;
     }
+    Keyhash_Delete(VMAC_Data_List);
+    VMAC_Data_List = NULL;
 }
 
 /**
@@ -252,8 +311,9 @@ void VMAC_Cleanup(void)
  */
 void VMAC_Init(void)
 {
-    VMAC_List = Keylist_Create();
-    if (VMAC_List) {
+    VMAC_List = Keyhash_Create();
+    VMAC_Data_List = Keyhash_Create();
+    if (VMAC_List && VMAC_Data_List) {
         atexit(VMAC_Cleanup);
         printf("VMAC List initialized.\n");
     }
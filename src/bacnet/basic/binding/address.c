@@ -36,6 +36,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "bacnet/config.h"
 #include "bacnet/bacaddr.h"
 #include "bacnet/bacdef.h"
@@ -43,11 +44,18 @@
 #include "bacnet/readrange.h"
 #include "bacnet/basic/binding/address.h"
 
-/* we are likely compiling the demo command line tools if print enabled */
-#if !defined(BACNET_ADDRESS_CACHE_FILE)
-#if PRINT_ENABLED
-#define BACNET_ADDRESS_CACHE_FILE
+#ifdef BACNET_ADDRESS_SNAPSHOT
+#include <time.h>
 #endif
+
+/* the snapshot of the cache is mapped into memory where available */
+#if defined(BACNET_ADDRESS_SNAPSHOT) && \
+    (defined(__unix__) || defined(__APPLE__))
+#define BACNET_ADDRESS_SNAPSHOT_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 /** @file address.c  Handle address binding */
@@ -59,13 +67,37 @@
 static uint32_t Top_Protected_Entry;
 static uint32_t Own_Device_ID = 0xFFFFFFFF;
 
+/* The cache is a table on the heap that grows by doubling, up to the
+   memory limit. Entries keep their index when it grows, so the
+   protected entries stay protected. */
 static struct Address_Cache_Entry {
     uint8_t Flags;
+    /* the lists and indexes that hold the entry */
+    uint8_t Links;
     uint32_t device_id;
     unsigned max_apdu;
     BACNET_ADDRESS address;
     uint32_t TimeToLive;
-} Address_Cache[MAX_ADDRESS_CACHE];
+    /* chain of the device ID index */
+    uint32_t device_next;
+    /* hash of the address, and chain of the address index */
+    uint32_t address_hash;
+    uint32_t address_next;
+    /* list from the most to the least recently used entry,
+       or the list of free entries */
+    uint32_t prev;
+    uint32_t next;
+} *Address_Cache;
+/* number of entries in the table */
+static uint32_t Address_Cache_Size;
+/* octets of memory for each entry, in the table and its indexes */
+#define ADDRESS_CACHE_ENTRY_OCTETS \
+    (sizeof(struct Address_Cache_Entry) + (2 * sizeof(uint32_t)))
+/* number of entries that the table may grow to, which leaves room to
+   double the size, and the index that ends a list, in 32 bits */
+#define ADDRESS_CACHE_ENTRIES_MAX 0x7FFFFFFFUL
+static uint32_t Address_Cache_Limit =
+    (uint32_t)(ADDRESS_CACHE_MEMORY_LIMIT / ADDRESS_CACHE_ENTRY_OCTETS);
 
 /* State flags for cache entries */
 
@@ -84,6 +116,387 @@ static struct Address_Cache_Entry {
 #define BAC_ADDR_SHORT_TIME BAC_ADDR_SECS_1HOUR
 #define BAC_ADDR_FOREVER 0xFFFFFFFF /* Permenant entry */
 
+/* Links of cache entries */
+#define ADDRESS_LINK_DEVICE 1 /* in the device ID index */
+#define ADDRESS_LINK_ADDRESS 2 /* in the address index - bound entries */
+#define ADDRESS_LINK_USED 4 /* in the list of used entries */
+#define ADDRESS_LINK_FREE 8 /* in the list of free entries */
+
+#ifndef ADDRESS_CACHE_INITIAL_SIZE
+#define ADDRESS_CACHE_INITIAL_SIZE 16
+#endif
+/* end of a chain or list */
+#define ADDRESS_CACHE_NONE 0xFFFFFFFFUL
+
+/* Two hash indexes of the cache: entries in use by device ID, and bound
+   entries by address. Each bucket is a chain of cache indexes. The
+   number of buckets is the power of two at or below the table size. */
+static uint32_t *Address_Device_Hash;
+static uint32_t *Address_Address_Hash;
+static uint32_t Address_Hash_Size;
+static uint32_t Address_Used_Head = ADDRESS_CACHE_NONE;
+static uint32_t Address_Used_Tail = ADDRESS_CACHE_NONE;
+static uint32_t Address_Free_Head = ADDRESS_CACHE_NONE;
+static uint32_t Address_Bound_Count;
+
+/**
+ * @brief Hash a device ID.
+ *
+ * @param device_id  Device ID
+ *
+ * @return 32-bit hash of the device ID
+ */
+static uint32_t address_device_hash(uint32_t device_id)
+{
+    /* Fibonacci hashing spreads the sequential device IDs of a site */
+    device_id *= 2654435761UL;
+
+    return device_id ^ (device_id >> 16);
+}
+
+/**
+ * @brief Remove an entry from a hash chain.
+ *
+ * @param link  Head of the chain
+ * @param index  Cache index of the entry
+ * @param device  true for the device ID chain, false for the address chain
+ */
+static void address_chain_unlink(uint32_t *link, uint32_t index, bool device)
+{
+    while (*link != index) {
+        if (device) {
+            link = &Address_Cache[*link].device_next;
+        } else {
+            link = &Address_Cache[*link].address_next;
+        }
+    }
+    if (device) {
+        *link = Address_Cache[index].device_next;
+    } else {
+        *link = Address_Cache[index].address_next;
+    }
+}
+
+/**
+ * @brief Add an entry to the hash chains of the indexes that it is in.
+ *
+ * @param index  Cache index of the entry
+ */
+static void address_chain_link(uint32_t index)
+{
+    struct Address_Cache_Entry *pMatch = &Address_Cache[index];
+    uint32_t bucket;
+
+    if (pMatch->Links & ADDRESS_LINK_DEVICE) {
+        bucket =
+            address_device_hash(pMatch->device_id) & (Address_Hash_Size - 1);
+        pMatch->device_next = Address_Device_Hash[bucket];
+        Address_Device_Hash[bucket] = index;
+    }
+    if (pMatch->Links & ADDRESS_LINK_ADDRESS) {
+        bucket = pMatch->address_hash & (Address_Hash_Size - 1);
+        pMatch->address_next = Address_Address_Hash[bucket];
+        Address_Address_Hash[bucket] = index;
+    }
+}
+
+/**
+ * @brief Add an entry to the head of the list of used entries,
+ * as the most recently used one.
+ *
+ * @param index  Cache index of the entry
+ */
+static void address_used_link(uint32_t index)
+{
+    struct Address_Cache_Entry *pMatch = &Address_Cache[index];
+
+    pMatch->Links |= ADDRESS_LINK_USED;
+    pMatch->prev = ADDRESS_CACHE_NONE;
+    pMatch->next = Address_Used_Head;
+    if (Address_Used_Head != ADDRESS_CACHE_NONE) {
+        Address_Cache[Address_Used_Head].prev = index;
+    } else {
+        Address_Used_Tail = index;
+    }
+    Address_Used_Head = index;
+}
+
+/**
+ * @brief Remove an entry from the list of used entries.
+ *
+ * @param index  Cache index of the entry
+ */
+static void address_used_unlink(uint32_t index)
+{
+    struct Address_Cache_Entry *pMatch = &Address_Cache[index];
+
+    if (pMatch->prev != ADDRESS_CACHE_NONE) {
+        Address_Cache[pMatch->prev].next = pMatch->next;
+    } else {
+        Address_Used_Head = pMatch->next;
+    }
+    if (pMatch->next != ADDRESS_CACHE_NONE) {
+        Address_Cache[pMatch->next].prev = pMatch->prev;
+    } else {
+        Address_Used_Tail = pMatch->prev;
+    }
+    pMatch->Links &= ~ADDRESS_LINK_USED;
+}
+
+/**
+ * @brief Mark an entry as the most recently used one.
+ *
+ * @param pMatch  Pointer to the cache entry
+ */
+static void address_used_touch(struct Address_Cache_Entry *pMatch)
+{
+    uint32_t index = (uint32_t)(pMatch - Address_Cache);
+
+    if ((pMatch->Links & ADDRESS_LINK_USED) && (Address_Used_Head != index)) {
+        address_used_unlink(index);
+        address_used_link(index);
+    }
+}
+
+/**
+ * @brief Bring the indexes and lists of a cache entry up to date after its
+ * flags, device ID or address changed. A changed entry is the most
+ * recently used one.
+ *
+ * @param pMatch  Pointer to the cache entry
+ */
+static void address_index_update(struct Address_Cache_Entry *pMatch)
+{
+    uint32_t index = (uint32_t)(pMatch - Address_Cache);
+    uint32_t bucket;
+
+    if (pMatch->Links & ADDRESS_LINK_DEVICE) {
+        bucket =
+            address_device_hash(pMatch->device_id) & (Address_Hash_Size - 1);
+        address_chain_unlink(&Address_Device_Hash[bucket], index, true);
+    }
+    if (pMatch->Links & ADDRESS_LINK_ADDRESS) {
+        bucket = pMatch->address_hash & (Address_Hash_Size - 1);
+        address_chain_unlink(&Address_Address_Hash[bucket], index, false);
+        Address_Bound_Count--;
+    }
+    pMatch->Links &= ~(ADDRESS_LINK_DEVICE | ADDRESS_LINK_ADDRESS);
+    if (pMatch->Links & ADDRESS_LINK_USED) {
+        address_used_unlink(index);
+    }
+    if (pMatch->Flags == 0) {
+        if ((pMatch->Links & ADDRESS_LINK_FREE) == 0) {
+            pMatch->Links |= ADDRESS_LINK_FREE;
+            pMatch->next = Address_Free_Head;
+            Address_Free_Head = index;
+        }
+        return;
+    }
+    address_used_link(index);
+    if (pMatch->Flags & BAC_ADDR_IN_USE) {
+        pMatch->Links |= ADDRESS_LINK_DEVICE;
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {
+            pMatch->Links |= ADDRESS_LINK_ADDRESS;
+            pMatch->address_hash = bacnet_address_hash(&pMatch->address);
+            Address_Bound_Count++;
+        }
+        address_chain_link(index);
+    }
+}
+
+/**
+ * @brief Rebuild the indexes and lists from the flags of the entries,
+ * after the cache was cleared down. The free entries are handed out
+ * from the lowest index.
+ */
+static void address_index_rebuild(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < Address_Hash_Size; i++) {
+        Address_Device_Hash[i] = ADDRESS_CACHE_NONE;
+        Address_Address_Hash[i] = ADDRESS_CACHE_NONE;
+    }
+    Address_Used_Head = ADDRESS_CACHE_NONE;
+    Address_Used_Tail = ADDRESS_CACHE_NONE;
+    Address_Free_Head = ADDRESS_CACHE_NONE;
+    Address_Bound_Count = 0;
+    for (i = Address_Cache_Size; i > 0; i--) {
+        Address_Cache[i - 1].Links = 0;
+        address_index_update(&Address_Cache[i - 1]);
+    }
+}
+
+/**
+ * @brief Double the table, and the hash buckets with it.
+ *
+ * @return true if the table grew
+ */
+static bool address_cache_grow(void)
+{
+    struct Address_Cache_Entry *cache;
+    uint32_t *device_hash;
+    uint32_t *address_hash;
+    uint32_t size;
+    uint32_t hash_size;
+    uint32_t i;
+
+    if (Address_Cache_Size == 0) {
+        size = ADDRESS_CACHE_INITIAL_SIZE;
+    } else if (Address_Cache_Size > (Address_Cache_Limit / 2)) {
+        size = Address_Cache_Limit;
+    } else {
+        size = Address_Cache_Size * 2;
+    }
+    if (size > Address_Cache_Limit) {
+        size = Address_Cache_Limit;
+    }
+    if (size <= Address_Cache_Size) {
+        return false;
+    }
+    cache = realloc(Address_Cache, size * sizeof(*cache));
+    if (!cache) {
+        return false;
+    }
+    Address_Cache = cache;
+    hash_size = 1;
+    while ((hash_size * 2) <= size) {
+        hash_size *= 2;
+    }
+    if (hash_size != Address_Hash_Size) {
+        device_hash =
+            realloc(Address_Device_Hash, hash_size * sizeof(*device_hash));
+        if (device_hash) {
+            Address_Device_Hash = device_hash;
+        }
+        address_hash =
+            realloc(Address_Address_Hash, hash_size * sizeof(*address_hash));
+        if (address_hash) {
+            Address_Address_Hash = address_hash;
+        }
+        if (!device_hash || !address_hash) {
+            /* the table grew, but the buckets stay as they are */
+            hash_size = Address_Hash_Size;
+        }
+    }
+    if (hash_size != Address_Hash_Size) {
+        /* rehash the entries in the indexes */
+        Address_Hash_Size = hash_size;
+        for (i = 0; i < hash_size; i++) {
+            Address_Device_Hash[i] = ADDRESS_CACHE_NONE;
+            Address_Address_Hash[i] = ADDRESS_CACHE_NONE;
+        }
+        for (i = 0; i < Address_Cache_Size; i++) {
+            address_chain_link(i);
+        }
+    }
+    /* the new entries are free */
+    for (i = size; i > Address_Cache_Size; i--) {
+        memset(&Address_Cache[i - 1], 0, sizeof(*cache));
+        Address_Cache[i - 1].Links = ADDRESS_LINK_FREE;
+        Address_Cache[i - 1].next = Address_Free_Head;
+        Address_Free_Head = i - 1;
+    }
+    Address_Cache_Size = size;
+
+    return true;
+}
+
+/**
+ * @brief Take a free entry, and grow the table if there is none.
+ *
+ * @return Pointer to the entry, or NULL if the cache is full
+ */
+static struct Address_Cache_Entry *address_entry_alloc(void)
+{
+    struct Address_Cache_Entry *pMatch;
+
+    if (Address_Free_Head == ADDRESS_CACHE_NONE) {
+        if (!address_cache_grow()) {
+            return NULL;
+        }
+    }
+    pMatch = &Address_Cache[Address_Free_Head];
+    Address_Free_Head = pMatch->next;
+    pMatch->Links &= ~ADDRESS_LINK_FREE;
+
+    return pMatch;
+}
+
+/**
+ * @brief Find the cache entry of a device, bound or with a bind request.
+ *
+ * @param device_id  Device ID
+ *
+ * @return Pointer to the cache entry, or NULL if not found
+ */
+static struct Address_Cache_Entry *address_find_device(uint32_t device_id)
+{
+    uint32_t index;
+
+    if (Address_Hash_Size == 0) {
+        return NULL;
+    }
+    index = Address_Device_Hash[address_device_hash(device_id) &
+        (Address_Hash_Size - 1)];
+    while (index != ADDRESS_CACHE_NONE) {
+        if (Address_Cache[index].device_id == device_id) {
+            return &Address_Cache[index];
+        }
+        index = Address_Cache[index].device_next;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Find the bound cache entry of an address.
+ *
+ * @param src  BACnet address
+ *
+ * @return Pointer to the cache entry, or NULL if not found
+ */
+static struct Address_Cache_Entry *address_find_bound(BACNET_ADDRESS *src)
+{
+    uint32_t hash;
+    uint32_t index;
+
+    if (Address_Hash_Size == 0) {
+        return NULL;
+    }
+    hash = bacnet_address_hash(src);
+    index = Address_Address_Hash[hash & (Address_Hash_Size - 1)];
+    while (index != ADDRESS_CACHE_NONE) {
+        if ((Address_Cache[index].address_hash == hash) &&
+            bacnet_address_same(&Address_Cache[index].address, src)) {
+            return &Address_Cache[index];
+        }
+        index = Address_Cache[index].address_next;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Find the first bound entry at or after an index of the table.
+ *
+ * @param index  Table index to start from
+ *
+ * @return Table index of the entry, or the table size if there is none
+ */
+static uint32_t address_bound_next(uint32_t index)
+{
+    while (index < Address_Cache_Size) {
+        if ((Address_Cache[index].Flags &
+                (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) == BAC_ADDR_IN_USE) {
+            break;
+        }
+        index++;
+    }
+
+    return index;
+}
+
 /**
  * @brief Set the index of the first (top) address being protected.
  *
@@ -91,7 +504,7 @@ static struct Address_Cache_Entry {
  */
 void address_protected_entry_index_set(uint32_t top_protected_entry_index)
 {
-    if (top_protected_entry_index <= (MAX_ADDRESS_CACHE - 1)) {
+    if (top_protected_entry_index < Address_Cache_Limit) {
         Top_Protected_Entry = top_protected_entry_index;
     }
 }
@@ -106,6 +519,66 @@ void address_own_device_id_set(uint32_t own_id)
     Own_Device_ID = own_id;
 }
 
+/**
+ * @brief Limit the memory that the cache may grow to. The table does not
+ * shrink when the limit is below its size, but it stops growing.
+ *
+ * @param octets  Memory limit in octets, for the table and its indexes
+ */
+void address_cache_memory_limit_set(size_t octets)
+{
+    size_t entries;
+
+    entries = octets / ADDRESS_CACHE_ENTRY_OCTETS;
+    if (entries > ADDRESS_CACHE_ENTRIES_MAX) {
+        entries = ADDRESS_CACHE_ENTRIES_MAX;
+    }
+    Address_Cache_Limit = (uint32_t)entries;
+}
+
+/**
+ * @brief Return the memory that the cache uses.
+ *
+ * @return Octets of memory used by the table and its indexes
+ */
+size_t address_cache_memory_size(void)
+{
+    return (Address_Cache_Size * sizeof(struct Address_Cache_Entry)) +
+        (Address_Hash_Size * 2 * sizeof(uint32_t));
+}
+
+/**
+ * @brief Return the number of entries that the table holds,
+ * free or in use.
+ *
+ * @return Number of entries
+ */
+unsigned address_cache_size(void)
+{
+    return Address_Cache_Size;
+}
+
+/**
+ * @brief Free the memory of the cache. The cache grows again
+ * when devices are added.
+ */
+void address_cache_cleanup(void)
+{
+    free(Address_Cache);
+    free(Address_Device_Hash);
+    free(Address_Address_Hash);
+    Address_Cache = NULL;
+    Address_Device_Hash = NULL;
+    Address_Address_Hash = NULL;
+    Address_Cache_Size = 0;
+    Address_Hash_Size = 0;
+    Address_Used_Head = ADDRESS_CACHE_NONE;
+    Address_Used_Tail = ADDRESS_CACHE_NONE;
+    Address_Free_Head = ADDRESS_CACHE_NONE;
+    Address_Bound_Count = 0;
+    Top_Protected_Entry = 0;
+}
+
 /**
  * @brief Check if the given source and destination address can be matched
  *        by checking the length, net and MAC address.
@@ -170,83 +643,79 @@ void address_remove_device(uint32_t device_id)
     struct Address_Cache_Entry *pMatch;
     uint32_t index = 0;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            pMatch->Flags = 0;
-            if (index < Top_Protected_Entry) {
-                Top_Protected_Entry--;
-            }
-            break;
+    pMatch = address_find_device(device_id);
+    if (pMatch) {
+        index = (uint32_t)(pMatch - Address_Cache);
+        pMatch->Flags = 0;
+        address_index_update(pMatch);
+        if (index < Top_Protected_Entry) {
+            Top_Protected_Entry--;
         }
-        pMatch++;
-        index++;
     }
 
     return;
 }
 
 /**
- * @brief Search the cache for the entry nearest expiry and delete it. Mark the
- * entry as reserved with a 1 hour TTL and return a pointer to the reserved
- * entry. Will not delete a static entry and returns NULL pointer if no
- * entry available to free up. Does not check for free entries as it is
- * assumed we are calling this due to the lack of those.
+ * @brief Find the least recently used entry with the given flags,
+ * outside of the protected entries.
+ *
+ * @param mask  Flags to compare
+ * @param flags  Value of the flags to compare
+ *
+ * @return Pointer to the entry, or NULL if not found
+ */
+static struct Address_Cache_Entry *address_least_recently_used(
+    uint8_t mask, uint8_t flags)
+{
+    uint32_t index;
+
+    index = Address_Used_Tail;
+    while (index != ADDRESS_CACHE_NONE) {
+        if ((index >= Top_Protected_Entry) &&
+            ((Address_Cache[index].Flags & mask) == flags)) {
+            return &Address_Cache[index];
+        }
+        index = Address_Cache[index].prev;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Delete the least recently used entry of the cache, and mark it
+ * as reserved with a 1 hour TTL. Opportunistic entries with a short TTL
+ * go first, then bound entries, and bind requests last. Will not delete
+ * a static entry and returns NULL pointer if no entry available to free
+ * up. Does not check for free entries as it is assumed we are calling
+ * this due to the lack of those.
  *
  * @return Pointer to the entry that has been removed or NULL.
  */
 static struct Address_Cache_Entry *address_remove_oldest(void)
 {
-    struct Address_Cache_Entry *pMatch;
     struct Address_Cache_Entry *pCandidate;
-    uint32_t ulTime;
+    const uint8_t mask = BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ |
+        BAC_ADDR_STATIC | BAC_ADDR_SHORT_TTL;
 
-    pCandidate = NULL;
-    if (Top_Protected_Entry > (MAX_ADDRESS_CACHE - 1)) {
-        return pCandidate;
+    if (Top_Protected_Entry >= address_cache_size()) {
+        return NULL;
     }
-    ulTime =
-        BAC_ADDR_FOREVER - 1; /* Longest possible non static time to live */
-
-    /* First pass - try only in use and bound entries */
-
-    pMatch = &Address_Cache[Top_Protected_Entry];
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->Flags &
-                (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ | BAC_ADDR_STATIC)) ==
-            BAC_ADDR_IN_USE) {
-            if (pMatch->TimeToLive <= ulTime) { /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
-                pCandidate = pMatch;
-            }
-        }
-        pMatch++;
+    pCandidate = address_least_recently_used(
+        mask, (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_SHORT_TTL));
+    if (pCandidate == NULL) {
+        pCandidate = address_least_recently_used(
+            BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ | BAC_ADDR_STATIC,
+            BAC_ADDR_IN_USE);
     }
-
-    if (pCandidate != NULL) { /* Found something to free up */
-        pCandidate->Flags = BAC_ADDR_RESERVED;
-        pCandidate->TimeToLive =
-            BAC_ADDR_SHORT_TIME; /* only reserve it for a short while */
-        return (pCandidate);
-    }
-
-    /* Second pass - try in use and un bound as last resort */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->Flags &
-                (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ | BAC_ADDR_STATIC)) ==
-            ((uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ))) {
-            if (pMatch->TimeToLive <= ulTime) { /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
-                pCandidate = pMatch;
-            }
-        }
-        pMatch++;
+    if (pCandidate == NULL) {
+        pCandidate = address_least_recently_used(
+            BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ | BAC_ADDR_STATIC,
+            (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ));
     }
-
     if (pCandidate != NULL) { /* Found something to free up */
         pCandidate->Flags = BAC_ADDR_RESERVED;
+        address_index_update(pCandidate);
         pCandidate->TimeToLive =
             BAC_ADDR_SHORT_TIME; /* only reserve it for a short while */
     }
@@ -394,21 +863,308 @@ static void address_file_init(const char *pFilename)
 }
 #endif
 
+#ifdef BACNET_ADDRESS_SNAPSHOT
+/* Snapshot file format, in host byte order for a restart on the same host:
+   a header followed by the bound entries, from the least to the most
+   recently used. */
+#define ADDRESS_SNAPSHOT_MAGIC 0x42414331UL /* "BAC1" */
+#define ADDRESS_SNAPSHOT_VERSION 2
+
+struct Address_Snapshot_Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+    /* FNV-1a hash of the records */
+    uint32_t checksum;
+    /* wall clock seconds when saved, to age the TimeToLive on load */
+    uint32_t save_time;
+};
+
+struct Address_Snapshot_Record {
+    uint32_t device_id;
+    uint32_t max_apdu;
+    uint32_t TimeToLive;
+    uint16_t net;
+    uint8_t Flags;
+    uint8_t mac_len;
+    uint8_t len;
+    uint8_t mac[MAX_MAC_LEN];
+    uint8_t adr[MAX_MAC_LEN];
+};
+
+/**
+ * @brief Continue a 32-bit FNV-1a hash over a buffer.
+ *
+ * @param hash  Hash of the preceding data
+ * @param data  Pointer to the data
+ * @param length  Number of octets of data
+ *
+ * @return Hash including the data
+ */
+static uint32_t address_snapshot_hash(
+    uint32_t hash, const uint8_t *data, size_t length)
+{
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Write a snapshot of the bound entries of the cache. The snapshot
+ * is written to a temporary file that then replaces the file, so that a
+ * reader sees either the old or the new snapshot.
+ *
+ * @param pFilename  Name of the snapshot file
+ *
+ * @return true if the snapshot was written
+ */
+bool address_cache_snapshot_save(const char *pFilename)
+{
+    struct Address_Snapshot_Header header = { 0 };
+    struct Address_Snapshot_Record record;
+    struct Address_Cache_Entry *pMatch;
+    FILE *pFile = NULL;
+    char *pTempname = NULL;
+    uint32_t index;
+    bool status = true;
+
+    if (!pFilename) {
+        return false;
+    }
+    pTempname = malloc(strlen(pFilename) + 5);
+    if (!pTempname) {
+        return false;
+    }
+    sprintf(pTempname, "%s.tmp", pFilename);
+    pFile = fopen(pTempname, "wb");
+    if (!pFile) {
+        free(pTempname);
+        return false;
+    }
+    header.magic = ADDRESS_SNAPSHOT_MAGIC;
+    header.version = ADDRESS_SNAPSHOT_VERSION;
+    header.record_size = (uint16_t)sizeof(record);
+    header.checksum = 2166136261UL;
+    header.save_time = (uint32_t)time(NULL);
+    /* the header is written again once the records are counted */
+    if (fwrite(&header, sizeof(header), 1, pFile) != 1) {
+        status = false;
+    }
+    for (index = Address_Used_Tail; status && (index != ADDRESS_CACHE_NONE);
+         index = Address_Cache[index].prev) {
+        pMatch = &Address_Cache[index];
+        if ((pMatch->Links & ADDRESS_LINK_ADDRESS) == 0) {
+            continue;
+        }
+        /* cleared so that the padding does not change the checksum */
+        memset(&record, 0, sizeof(record));
+        record.device_id = pMatch->device_id;
+        record.max_apdu = (uint32_t)pMatch->max_apdu;
+        record.TimeToLive = pMatch->TimeToLive;
+        record.net = pMatch->address.net;
+        record.Flags = pMatch->Flags & (BAC_ADDR_STATIC | BAC_ADDR_SHORT_TTL);
+        record.mac_len = pMatch->address.mac_len;
+        record.len = pMatch->address.len;
+        memcpy(record.mac, pMatch->address.mac, MAX_MAC_LEN);
+        memcpy(record.adr, pMatch->address.adr, MAX_MAC_LEN);
+        header.checksum = address_snapshot_hash(
+            header.checksum, (const uint8_t *)&record, sizeof(record));
+        header.count++;
+        if (fwrite(&record, sizeof(record), 1, pFile) != 1) {
+            status = false;
+        }
+    }
+    if (status) {
+        if ((fseek(pFile, 0L, SEEK_SET) != 0) ||
+            (fwrite(&header, sizeof(header), 1, pFile) != 1) ||
+            (fflush(pFile) != 0)) {
+            status = false;
+        }
+    }
+#ifdef BACNET_ADDRESS_SNAPSHOT_MMAP
+    /* the data must be on disk before the rename makes it the snapshot */
+    if (status && (fsync(fileno(pFile)) != 0)) {
+        status = false;
+    }
+#endif
+    if (fclose(pFile) != 0) {
+        status = false;
+    }
+    if (status) {
+#if defined(_WIN32)
+        /* rename does not replace an existing file on Windows */
+        remove(pFilename);
+#endif
+        if (rename(pTempname, pFilename) != 0) {
+            status = false;
+        }
+    }
+    if (!status) {
+        remove(pTempname);
+    }
+    free(pTempname);
+
+    return status;
+}
+
+/**
+ * @brief Add the bindings of a snapshot to the cache. Devices that are
+ * already in the cache, such as static bindings, are kept as they are.
+ * The time since the snapshot was saved is taken from the TimeToLive
+ * of the dynamic bindings, and the ones that expired are skipped.
+ *
+ * @param data  Pointer to the snapshot
+ * @param length  Number of octets of the snapshot
+ *
+ * @return true if the snapshot is valid
+ */
+static bool address_snapshot_restore(const uint8_t *data, size_t length)
+{
+    struct Address_Snapshot_Header header;
+    struct Address_Snapshot_Record record;
+    struct Address_Cache_Entry *pMatch;
+    const uint8_t *records;
+    uint32_t elapsed_seconds;
+    uint32_t i;
+
+    if (length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if ((header.magic != ADDRESS_SNAPSHOT_MAGIC) ||
+        (header.version != ADDRESS_SNAPSHOT_VERSION) ||
+        (header.record_size != sizeof(record)) ||
+        (header.count > ((length - sizeof(header)) / sizeof(record))) ||
+        (length != (sizeof(header) + (header.count * sizeof(record))))) {
+        return false;
+    }
+    records = &data[sizeof(header)];
+    if (address_snapshot_hash(2166136261UL, records,
+            header.count * sizeof(record)) != header.checksum) {
+        return false;
+    }
+    elapsed_seconds = (uint32_t)time(NULL) - header.save_time;
+    if (elapsed_seconds > 0x7FFFFFFFUL) {
+        /* the clock was set back since the save */
+        elapsed_seconds = 0;
+    }
+    for (i = 0; i < header.count; i++) {
+        memcpy(&record, &records[i * sizeof(record)], sizeof(record));
+        if ((record.device_id == Own_Device_ID) ||
+            (record.mac_len > MAX_MAC_LEN) || (record.len > MAX_MAC_LEN) ||
+            address_find_device(record.device_id)) {
+            continue;
+        }
+        if ((record.Flags & BAC_ADDR_STATIC) == 0) {
+            if (record.TimeToLive <= elapsed_seconds) {
+                continue;
+            }
+            record.TimeToLive -= elapsed_seconds;
+        }
+        pMatch = address_entry_alloc();
+        if (!pMatch) {
+            break;
+        }
+        pMatch->Flags = (uint8_t)(BAC_ADDR_IN_USE |
+            (record.Flags & (BAC_ADDR_STATIC | BAC_ADDR_SHORT_TTL)));
+        pMatch->device_id = record.device_id;
+        pMatch->max_apdu = record.max_apdu;
+        pMatch->TimeToLive = record.TimeToLive;
+        pMatch->address.net = record.net;
+        pMatch->address.mac_len = record.mac_len;
+        pMatch->address.len = record.len;
+        memcpy(pMatch->address.mac, record.mac, MAX_MAC_LEN);
+        memcpy(pMatch->address.adr, record.adr, MAX_MAC_LEN);
+        address_index_update(pMatch);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Load the bindings of a snapshot written by
+ * address_cache_snapshot_save(). The file is mapped into memory where
+ * the platform supports it, and read otherwise.
+ *
+ * @param pFilename  Name of the snapshot file
+ *
+ * @return true if a valid snapshot was loaded
+ */
+bool address_cache_snapshot_load(const char *pFilename)
+{
+    bool status = false;
+#ifdef BACNET_ADDRESS_SNAPSHOT_MMAP
+    struct stat file_stat;
+    void *data;
+    int fd;
+
+    if (!pFilename) {
+        return false;
+    }
+    fd = open(pFilename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if ((fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0)) {
+        data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE,
+            fd, 0);
+        if (data != MAP_FAILED) {
+            status = address_snapshot_restore(
+                (const uint8_t *)data, (size_t)file_stat.st_size);
+            munmap(data, (size_t)file_stat.st_size);
+        }
+    }
+    close(fd);
+#else
+    FILE *pFile = NULL;
+    uint8_t *data = NULL;
+    long length;
+
+    if (!pFilename) {
+        return false;
+    }
+    pFile = fopen(pFilename, "rb");
+    if (!pFile) {
+        return false;
+    }
+    if ((fseek(pFile, 0L, SEEK_END) == 0) && ((length = ftell(pFile)) > 0) &&
+        (fseek(pFile, 0L, SEEK_SET) == 0)) {
+        data = malloc((size_t)length);
+        if (data) {
+            if (fread(data, (size_t)length, 1, pFile) == 1) {
+                status = address_snapshot_restore(data, (size_t)length);
+            }
+            free(data);
+        }
+    }
+    fclose(pFile);
+#endif
+
+    return status;
+}
+#endif
+
 /**
  * Clear down the cache and make sure the full complement of entries are
- * available. Assume no persistance of memory.
+ * available. Assume no persistance of memory. The memory of the table
+ * is kept for the entries that are added again.
  */
 void address_init(void)
 {
-    struct Address_Cache_Entry *pMatch;
+    uint32_t i;
 
     Top_Protected_Entry = 0;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        pMatch->Flags = 0;
-        pMatch++;
+    for (i = 0; i < Address_Cache_Size; i++) {
+        Address_Cache[i].Flags = 0;
     }
+    address_index_rebuild();
 #ifdef BACNET_ADDRESS_CACHE_FILE
     address_file_init(Address_Cache_Filename);
 #endif
@@ -425,9 +1181,10 @@ void address_init(void)
 void address_init_partial(void)
 {
     struct Address_Cache_Entry *pMatch;
+    uint32_t i;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+    for (i = 0; i < Address_Cache_Size; i++) {
+        pMatch = &Address_Cache[i];
         if ((pMatch->Flags & BAC_ADDR_IN_USE) !=
             0) { /* It's in use so let's check further */
             if (((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0) ||
@@ -440,9 +1197,9 @@ void address_init_partial(void)
             0) { /* Reserved entries should be cleared */
             pMatch->Flags = 0;
         }
-
-        pMatch++;
     }
+    /* the indexes are rebuilt from the entries that were kept */
+    address_index_rebuild();
 #ifdef BACNET_ADDRESS_CACHE_FILE
     address_file_init(Address_Cache_Filename);
 #endif
@@ -465,26 +1222,22 @@ void address_set_device_TTL(
 {
     struct Address_Cache_Entry *pMatch;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) ==
-                0) { /* If bound then we have either static or normaal */
-                if (StaticFlag) {
-                    pMatch->Flags |= BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = BAC_ADDR_FOREVER;
-                } else {
-                    pMatch->Flags &= ~BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = TimeOut;
-                }
+    pMatch = address_find_device(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) ==
+            0) { /* If bound then we have either static or normaal */
+            pMatch->Flags &= ~BAC_ADDR_SHORT_TTL;
+            if (StaticFlag) {
+                pMatch->Flags |= BAC_ADDR_STATIC;
+                pMatch->TimeToLive = BAC_ADDR_FOREVER;
             } else {
-                pMatch->TimeToLive = TimeOut; /* For unbound we can only set the
-                                                 time to live */
+                pMatch->Flags &= ~BAC_ADDR_STATIC;
+                pMatch->TimeToLive = TimeOut;
             }
-            break; /* Exit now if found at all - bound or unbound */
+        } else {
+            pMatch->TimeToLive = TimeOut; /* For unbound we can only set the
+                                             time to live */
         }
-        pMatch++;
     }
 }
 
@@ -501,19 +1254,15 @@ bool address_get_by_device(
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) ==
-                0) { /* If bound then fetch data */
-                bacnet_address_copy(src, &pMatch->address);
-                *max_apdu = pMatch->max_apdu;
-                found = true; /* Prove we found it */
-            }
-            break; /* Exit now if found at all - bound or unbound */
+    pMatch = address_find_device(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) ==
+            0) { /* If bound then fetch data */
+            bacnet_address_copy(src, &pMatch->address);
+            *max_apdu = pMatch->max_apdu;
+            address_used_touch(pMatch);
+            found = true; /* Prove we found it */
         }
-        pMatch++;
     }
 
     return found;
@@ -532,19 +1281,14 @@ bool address_get_device_id(BACNET_ADDRESS *src, uint32_t *device_id)
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE) { /* If bound */
-            if (bacnet_address_same(&pMatch->address, src)) {
-                if (device_id) {
-                    *device_id = pMatch->device_id;
-                }
-                found = true;
-                break;
-            }
+    /* only bound entries are indexed by address */
+    pMatch = address_find_bound(src);
+    if (pMatch) {
+        if (device_id) {
+            *device_id = pMatch->device_id;
         }
-        pMatch++;
+        address_used_touch(pMatch);
+        found = true;
     }
 
     return found;
@@ -573,54 +1317,47 @@ void address_add(uint32_t device_id, unsigned max_apdu, BACNET_ADDRESS *src)
        bind request if it exists */
 
     /* existing device or bind request outstanding - update address */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+    pMatch = address_find_device(device_id);
+    if (pMatch) {
         /* Device already in the list, then update the values. */
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            bacnet_address_copy(&pMatch->address, src);
-            pMatch->max_apdu = max_apdu;
-
-            /* Pick the right time to live */
-
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) !=
-                0) { /* Bind requested so long time */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-            } else if ((pMatch->Flags & BAC_ADDR_STATIC) !=
-                0) { /* Static already so make sure it never expires */
-                pMatch->TimeToLive = BAC_ADDR_FOREVER;
-            } else if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) !=
-                0) { /* Opportunistic entry so leave on short fuse */
-                pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
-            } else {
-                pMatch->TimeToLive =
-                    BAC_ADDR_LONG_TIME; /* Renewing existing entry */
-            }
-
-            pMatch->Flags &= ~BAC_ADDR_BIND_REQ; /* Clear bind request flag just
-                                                    in case */
-            found = true;
-            break;
+        bacnet_address_copy(&pMatch->address, src);
+        pMatch->max_apdu = max_apdu;
+
+        /* Pick the right time to live */
+
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) !=
+            0) { /* Bind requested so long time */
+            pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
+        } else if ((pMatch->Flags & BAC_ADDR_STATIC) !=
+            0) { /* Static already so make sure it never expires */
+            pMatch->TimeToLive = BAC_ADDR_FOREVER;
+        } else if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) !=
+            0) { /* Opportunistic entry so leave on short fuse */
+            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+        } else {
+            pMatch->TimeToLive =
+                BAC_ADDR_LONG_TIME; /* Renewing existing entry */
         }
-        pMatch++;
+
+        pMatch->Flags &= ~BAC_ADDR_BIND_REQ; /* Clear bind request flag just
+                                                in case */
+        address_index_update(pMatch);
+        found = true;
     }
 
     /* New device - add to cache if there is room. */
     if (!found) {
-        pMatch = Address_Cache;
-        while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-            if ((pMatch->Flags & BAC_ADDR_IN_USE) == 0) {
-                pMatch->Flags = BAC_ADDR_IN_USE;
-                pMatch->device_id = device_id;
-                pMatch->max_apdu = max_apdu;
-                bacnet_address_copy(&pMatch->address, src);
-                pMatch->TimeToLive =
-                    BAC_ADDR_SHORT_TIME; /* Opportunistic entry so leave on
-                                            short fuse */
-                found = true;
-                break;
-            }
-            pMatch++;
+        pMatch = address_entry_alloc();
+        if (pMatch != NULL) {
+            pMatch->Flags = (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_SHORT_TTL);
+            pMatch->device_id = device_id;
+            pMatch->max_apdu = max_apdu;
+            bacnet_address_copy(&pMatch->address, src);
+            pMatch->TimeToLive =
+                BAC_ADDR_SHORT_TIME; /* Opportunistic entry so leave on
+                                        short fuse */
+            address_index_update(pMatch);
+            found = true;
         }
     }
 
@@ -629,12 +1366,13 @@ void address_add(uint32_t device_id, unsigned max_apdu, BACNET_ADDRESS *src)
     if (!found) {
         pMatch = address_remove_oldest();
         if (pMatch != NULL) {
-            pMatch->Flags = BAC_ADDR_IN_USE;
+            pMatch->Flags = (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_SHORT_TTL);
             pMatch->device_id = device_id;
             pMatch->max_apdu = max_apdu;
             bacnet_address_copy(&pMatch->address, src);
             pMatch->TimeToLive = BAC_ADDR_SHORT_TIME; /* Opportunistic entry so
                                                          leave on short fuse */
+            address_index_update(pMatch);
         }
     }
     return;
@@ -662,50 +1400,43 @@ bool address_device_bind_request(uint32_t device_id,
     struct Address_Cache_Entry *pMatch;
 
     /* existing device - update address info if currently bound */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) { /* Already bound */
-                found = true;
-                if (src) {
-                    bacnet_address_copy(src, &pMatch->address);
-                }
-                if (max_apdu) {
-                    *max_apdu = pMatch->max_apdu;
-                }
-                if (device_ttl) {
-                    *device_ttl = pMatch->TimeToLive;
-                }
-                if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) !=
-                    0) { /* Was picked up opportunistacilly */
-                    pMatch->Flags &=
-                        ~BAC_ADDR_SHORT_TTL; /* Convert to normal entry  */
-                    pMatch->TimeToLive =
-                        BAC_ADDR_LONG_TIME; /* And give it a decent time to
-                                             * live
-                                             */
-                }
+    pMatch = address_find_device(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) { /* Already bound */
+            found = true;
+            if (src) {
+                bacnet_address_copy(src, &pMatch->address);
+            }
+            if (max_apdu) {
+                *max_apdu = pMatch->max_apdu;
+            }
+            if (device_ttl) {
+                *device_ttl = pMatch->TimeToLive;
+            }
+            if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) !=
+                0) { /* Was picked up opportunistacilly */
+                pMatch->Flags &=
+                    ~BAC_ADDR_SHORT_TTL; /* Convert to normal entry  */
+                pMatch->TimeToLive =
+                    BAC_ADDR_LONG_TIME; /* And give it a decent time to
+                                         * live
+                                         */
             }
-            return (
-                found); /* True if bound, false if bind request outstanding */
         }
-        pMatch++;
+        return (found); /* True if bound, false if bind request outstanding */
     }
 
     /* Not there already so look for a free entry to put it in */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_RESERVED)) == 0) {
-            /* In use and awaiting binding */
-            pMatch->Flags = (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
-            pMatch->device_id = device_id;
-            /* No point in leaving bind requests in for long haul */
-            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
-            /* now would be a good time to do a Who-Is request */
-            return (false);
-        }
-        pMatch++;
+    pMatch = address_entry_alloc();
+    if (pMatch != NULL) {
+        /* In use and awaiting binding */
+        pMatch->Flags = (uint8_t)(BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
+        pMatch->device_id = device_id;
+        /* No point in leaving bind requests in for long haul */
+        pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+        address_index_update(pMatch);
+        /* now would be a good time to do a Who-Is request */
+        return (false);
     }
 
     /* No free entries, See if we can squeeze it in by dropping an existing one
@@ -716,6 +1447,7 @@ bool address_device_bind_request(uint32_t device_id,
         pMatch->device_id = device_id;
         /* No point in leaving bind requests in for long haul */
         pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+        address_index_update(pMatch);
     }
     return (false);
 }
@@ -751,22 +1483,18 @@ void address_add_binding(
     struct Address_Cache_Entry *pMatch;
 
     /* existing device or bind request - update address */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            bacnet_address_copy(&pMatch->address, src);
-            pMatch->max_apdu = max_apdu;
-            /* Clear bind request flag in case it was set */
-            pMatch->Flags &= ~BAC_ADDR_BIND_REQ;
-            /* Only update TTL if not static */
-            if ((pMatch->Flags & BAC_ADDR_STATIC) == 0) {
-                /* and set it on a long fuse */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-            }
-            break;
+    pMatch = address_find_device(device_id);
+    if (pMatch) {
+        bacnet_address_copy(&pMatch->address, src);
+        pMatch->max_apdu = max_apdu;
+        /* Clear bind request flag in case it was set */
+        pMatch->Flags &= ~BAC_ADDR_BIND_REQ;
+        /* Only update TTL if not static */
+        if ((pMatch->Flags & BAC_ADDR_STATIC) == 0) {
+            /* and set it on a long fuse */
+            pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
         }
-        pMatch++;
+        address_index_update(pMatch);
     }
     return;
 }
@@ -774,7 +1502,7 @@ void address_add_binding(
 /**
  * Return the device information from the given index in the table.
  *
- * @param index  Table index [0..MAX_ADDRESS_CACHE-1]
+ * @param index  Table index [0..address_cache_size()-1]
  * @param device_id  Pointer to the variable taking the device id.
  * @param device_ttl  Pointer to the variable taking the Time To Life for the
  * device.
@@ -793,7 +1521,7 @@ bool address_device_get_by_index(unsigned index,
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
-    if (index < MAX_ADDRESS_CACHE) {
+    if (index < Address_Cache_Size) {
         pMatch = &Address_Cache[index];
         if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
             BAC_ADDR_IN_USE) {
@@ -819,7 +1547,7 @@ bool address_device_get_by_index(unsigned index,
 /**
  * Return the device information from the given index in the table.
  *
- * @param index  Table index [0..MAX_ADDRESS_CACHE-1]
+ * @param index  Table index [0..address_cache_size()-1]
  * @param device_id  Pointer to the variable taking the device id.
  * @param max_apdu  Pointer to the variable taking the max APDU size of the
  * device.
@@ -838,25 +1566,12 @@ bool address_get_by_index(unsigned index,
 /**
  * Return the count of cached addresses.
  *
- * @return A value between zero and MAX_ADDRESS_CACHE.
+ * @return A value between zero and address_cache_size().
  */
 unsigned address_count(void)
 {
-    struct Address_Cache_Entry *pMatch;
-    unsigned count = 0; /* return value */
-
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        /* Only count bound entries */
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE) {
-            count++;
-        }
-
-        pMatch++;
-    }
-
-    return count;
+    /* Only count bound entries - they are the ones in the address index */
+    return Address_Bound_Count;
 }
 
 /**
@@ -873,10 +1588,11 @@ int address_list_encode(uint8_t *apdu, unsigned apdu_len)
     int iLen = 0;
     struct Address_Cache_Entry *pMatch;
     BACNET_OCTET_STRING MAC_Address;
+    uint32_t i;
 
     /* Look for matching address. */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+    for (i = 0; i < Address_Cache_Size; i++) {
+        pMatch = &Address_Cache[i];
         if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
             BAC_ADDR_IN_USE) {
             iLen += encode_application_object_id(
@@ -913,7 +1629,6 @@ int address_list_encode(uint8_t *apdu, unsigned apdu_len)
                 break;
             }
         }
-        pMatch++;
     }
 
     return (iLen);
@@ -956,6 +1671,7 @@ int rr_address_list_encode(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     BACNET_OCTET_STRING MAC_Address;
     uint32_t uiTotal = 0; /* Number of bound entries in the cache */
     uint32_t uiIndex = 0; /* Current entry number */
+    uint32_t uiEntry = 0; /* Table index of the current entry */
     uint32_t uiFirst = 0; /* Entry number we started encoding from */
     uint32_t uiLast = 0; /* Entry number we finished encoding on */
     uint32_t uiTarget = 0; /* Last entry we are required to encode */
@@ -971,7 +1687,7 @@ int rr_address_list_encode(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_LAST_ITEM, false);
     bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_MORE_ITEMS, false);
     /* See how much space we have */
-    uiRemaining = (uint32_t)(MAX_APDU - pRequest->Overhead);
+    uiRemaining = (uint32_t)(pRequest->MaxAPDU - pRequest->Overhead);
 
     pRequest->ItemCount = 0; /* Start out with nothing */
     uiTotal = address_count(); /* What do we have to work with here ? */
@@ -1030,31 +1746,18 @@ int rr_address_list_encode(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
         uiTarget = uiTotal;
     }
 
-    pMatch = Address_Cache;
+    /* Find first bound entry, and seek to start position */
+    uiEntry = address_bound_next(0);
     uiIndex = 1;
-    while ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) !=
-        BAC_ADDR_IN_USE) { /* Find first bound entry */
-        pMatch++;
-        /* Shall not happen as the count has been checked first. */
-        if (pMatch > &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-            return (0); /* Issue with the table. */
-        }
-    }
-
-    /* Seek to start position */
     while (uiIndex != pRequest->Range.RefIndex) {
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE) { /* Only count bound entries */
-            pMatch++;
-            uiIndex++;
-        } else {
-            pMatch++;
-        }
-        /* Shall not happen as the count has been checked first. */
-        if (pMatch > &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-            return (0); /* Issue with the table. */
-        }
+        uiEntry = address_bound_next(uiEntry + 1);
+        uiIndex++;
     }
+    /* Shall not happen as the count has been checked first. */
+    if (uiEntry >= Address_Cache_Size) {
+        return (0); /* Issue with the table. */
+    }
+    pMatch = &Address_Cache[uiEntry];
 
     uiFirst = uiIndex; /* Record where we started from */
     while (uiIndex <= uiTarget) {
@@ -1092,16 +1795,16 @@ int rr_address_list_encode(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
 
         uiLast = uiIndex; /* Record the last entry encoded */
         uiIndex++; /* and get ready for next one */
-        pMatch++;
         pRequest->ItemCount++; /* Chalk up another one for the response count */
 
-        while ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) !=
-            BAC_ADDR_IN_USE) { /* Find next bound entry */
-            pMatch++;
+        if (uiIndex <= uiTarget) {
+            /* Find next bound entry */
+            uiEntry = address_bound_next(uiEntry + 1);
             /* Can normally not happen. */
-            if (pMatch > &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+            if (uiEntry >= Address_Cache_Size) {
                 return (0); /* Issue with the table. */
             }
+            pMatch = &Address_Cache[uiEntry];
         }
     }
 
@@ -1129,9 +1832,10 @@ int rr_address_list_encode(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
 void address_cache_timer(uint16_t uSeconds)
 {
     struct Address_Cache_Entry *pMatch;
+    uint32_t i;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+    for (i = 0; i < Address_Cache_Size; i++) {
+        pMatch = &Address_Cache[i];
         if (((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_RESERVED)) != 0) &&
             ((pMatch->Flags & BAC_ADDR_STATIC) ==
                 0)) { /* Check all entries holding a slot except statics
@@ -1140,10 +1844,9 @@ void address_cache_timer(uint16_t uSeconds)
                 pMatch->TimeToLive -= uSeconds;
             } else {
                 pMatch->Flags = 0;
+                address_index_update(pMatch);
             }
         }
-
-        pMatch++;
     }
 }
 
@@ -1157,14 +1860,17 @@ static void set_address(unsigned index, BACNET_ADDRESS *dest)
     unsigned i;
 
     for (i = 0; i < MAX_MAC_LEN; i++) {
-        dest->mac[i] = index;
+        dest->mac[i] = (uint8_t)index;
     }
+    /* more than 255 devices differ in the second octet */
+    dest->mac[1] = (uint8_t)(index >> 8);
     dest->mac_len = MAX_MAC_LEN;
     dest->net = 7;
     dest->len = MAX_MAC_LEN;
     for (i = 0; i < MAX_MAC_LEN; i++) {
-        dest->adr[i] = index;
+        dest->adr[i] = (uint8_t)index;
     }
+    dest->adr[1] = (uint8_t)(index >> 8);
 }
 
 static void set_file_address(const char *pFilename,
@@ -1248,6 +1954,9 @@ void testAddressFile(Test *pTest)
 }
 #endif
 
+/* more devices than the 255 that the cache used to be limited to */
+#define ADDRESS_TEST_DEVICES 1000
+
 void testAddress(Test *pTest)
 {
     unsigned i, count;
@@ -1259,7 +1968,7 @@ void testAddress(Test *pTest)
     unsigned test_max_apdu = 0;
 
     /* create a fake address database */
-    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+    for (i = 0; i < ADDRESS_TEST_DEVICES; i++) {
         set_address(i, &src);
         device_id = i * 255;
         address_add(device_id, max_apdu, &src);
@@ -1267,7 +1976,7 @@ void testAddress(Test *pTest)
         ct_test(pTest, count == (i + 1));
     }
 
-    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+    for (i = 0; i < ADDRESS_TEST_DEVICES; i++) {
         device_id = i * 255;
         set_address(i, &src);
         /* test the lookup by device id */
@@ -1281,19 +1990,19 @@ void testAddress(Test *pTest)
         ct_test(pTest, test_device_id == device_id);
         ct_test(pTest, test_max_apdu == max_apdu);
         ct_test(pTest, bacnet_address_same(&test_address, &src));
-        ct_test(pTest, address_count() == MAX_ADDRESS_CACHE);
+        ct_test(pTest, address_count() == ADDRESS_TEST_DEVICES);
         /* test the lookup by MAC */
         ct_test(pTest, address_get_device_id(&src, &test_device_id));
         ct_test(pTest, test_device_id == device_id);
     }
 
-    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+    for (i = 0; i < ADDRESS_TEST_DEVICES; i++) {
         device_id = i * 255;
         address_remove_device(device_id);
         ct_test(pTest,
             !address_get_by_device(device_id, &test_max_apdu, &test_address));
         count = address_count();
-        ct_test(pTest, count == (MAX_ADDRESS_CACHE - i - 1));
+        ct_test(pTest, count == (ADDRESS_TEST_DEVICES - i - 1));
     }
 }
 
@@ -31,6 +31,20 @@
 #include "bacnet/bacdef.h"
 #include "bacnet/readrange.h"
 
+/* we are likely compiling the demo command line tools if print enabled */
+#if !defined(BACNET_ADDRESS_CACHE_FILE)
+#if PRINT_ENABLED
+#define BACNET_ADDRESS_CACHE_FILE
+#endif
+#endif
+
+/* binary snapshots of the cache go along with the address cache file */
+#if !defined(BACNET_ADDRESS_SNAPSHOT)
+#ifdef BACNET_ADDRESS_CACHE_FILE
+#define BACNET_ADDRESS_SNAPSHOT
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -143,6 +157,28 @@ extern "C" {
     BACNET_STACK_EXPORT
     void address_own_device_id_set(uint32_t own_id);
 
+    BACNET_STACK_EXPORT
+    void address_cache_memory_limit_set(
+        size_t octets);
+    BACNET_STACK_EXPORT
+    size_t address_cache_memory_size(
+        void);
+    BACNET_STACK_EXPORT
+    unsigned address_cache_size(
+        void);
+    BACNET_STACK_EXPORT
+    void address_cache_cleanup(
+        void);
+
+#ifdef BACNET_ADDRESS_SNAPSHOT
+    BACNET_STACK_EXPORT
+    bool address_cache_snapshot_save(
+        const char *pFilename);
+    BACNET_STACK_EXPORT
+    bool address_cache_snapshot_load(
+        const char *pFilename);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
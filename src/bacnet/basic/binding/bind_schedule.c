@@ -0,0 +1,328 @@
+/**
+ * @file
+ * @brief Scheduler that coalesces the Who-Is of address bind requests
+ *
+ * @section DESCRIPTION
+ *
+ * Each network with pending bind requests keeps a sorted list of device
+ * instance ranges. A request next to or within BIND_SCHEDULE_GAP_MAX of
+ * a range joins it. The first request of a network opens a window of
+ * BIND_SCHEDULE_WINDOW_MS for others to join before any Who-Is is sent,
+ * and then the ranges are sent lowest first, at most BIND_SCHEDULE_BURST
+ * at once and one more per BIND_SCHEDULE_INTERVAL_MS after that.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bacnet/bacaddr.h"
+#include "bacnet/bacdef.h"
+#include "bacnet/basic/binding/bind_schedule.h"
+
+/* number of networks with pending bind requests */
+#ifndef BIND_SCHEDULE_NETWORKS_MAX
+#define BIND_SCHEDULE_NETWORKS_MAX 8
+#endif
+/* number of pending ranges per network */
+#ifndef BIND_SCHEDULE_RANGES_MAX
+#define BIND_SCHEDULE_RANGES_MAX 32
+#endif
+/* device instances between two requests that still share one Who-Is */
+#ifndef BIND_SCHEDULE_GAP_MAX
+#define BIND_SCHEDULE_GAP_MAX 32
+#endif
+/* time that the requests of a network are gathered before a Who-Is */
+#ifndef BIND_SCHEDULE_WINDOW_MS
+#define BIND_SCHEDULE_WINDOW_MS 500
+#endif
+/* Who-Is requests that a network may be sent at once */
+#ifndef BIND_SCHEDULE_BURST
+#define BIND_SCHEDULE_BURST 4
+#endif
+/* time until a network may be sent one more Who-Is */
+#ifndef BIND_SCHEDULE_INTERVAL_MS
+#define BIND_SCHEDULE_INTERVAL_MS 250
+#endif
+
+struct Bind_Schedule_Range {
+    uint32_t low;
+    uint32_t high;
+};
+
+static struct Bind_Schedule_Network {
+    bool in_use;
+    /* global broadcast, otherwise to the target address */
+    bool global;
+    BACNET_ADDRESS target;
+    /* milliseconds until the first Who-Is of the ranges */
+    uint32_t window;
+    /* Who-Is that may be sent now, and milliseconds towards one more */
+    unsigned tokens;
+    uint32_t refill;
+    unsigned count;
+    struct Bind_Schedule_Range range[BIND_SCHEDULE_RANGES_MAX];
+} Bind_Schedule_Network[BIND_SCHEDULE_NETWORKS_MAX];
+
+static bind_schedule_send_function Bind_Schedule_Send;
+
+/**
+ * @brief Find the network of a target, or start one.
+ *
+ * @param target_address  Network to send to, or NULL for a global broadcast
+ *
+ * @return Pointer to the network, or NULL if all are in use
+ */
+static struct Bind_Schedule_Network *bind_schedule_network(
+    BACNET_ADDRESS *target_address)
+{
+    struct Bind_Schedule_Network *network;
+    struct Bind_Schedule_Network *unused = NULL;
+    unsigned i;
+
+    for (i = 0; i < BIND_SCHEDULE_NETWORKS_MAX; i++) {
+        network = &Bind_Schedule_Network[i];
+        if (!network->in_use) {
+            if (!unused) {
+                unused = network;
+            }
+        } else if (target_address == NULL) {
+            if (network->global) {
+                return network;
+            }
+        } else if (!network->global &&
+            bacnet_address_same(&network->target, target_address)) {
+            return network;
+        }
+    }
+    if (unused) {
+        memset(unused, 0, sizeof(*unused));
+        unused->in_use = true;
+        if (target_address) {
+            bacnet_address_copy(&unused->target, target_address);
+        } else {
+            unused->global = true;
+        }
+        unused->tokens = BIND_SCHEDULE_BURST;
+    }
+
+    return unused;
+}
+
+/**
+ * @brief Remove a range from the ranges of a network.
+ *
+ * @param network  Pointer to the network
+ * @param index  Index of the range
+ */
+static void bind_schedule_range_remove(
+    struct Bind_Schedule_Network *network, unsigned index)
+{
+    network->count--;
+    memmove(&network->range[index], &network->range[index + 1],
+        (network->count - index) * sizeof(network->range[0]));
+}
+
+/**
+ * @brief Make room for one more range when the ranges of a network are
+ * full, by merging the two ranges with the smallest gap between them.
+ *
+ * @param network  Pointer to the network
+ */
+static void bind_schedule_range_merge(struct Bind_Schedule_Network *network)
+{
+    uint32_t gap;
+    uint32_t smallest_gap = UINT32_MAX;
+    unsigned smallest = 0;
+    unsigned i;
+
+    for (i = 0; (i + 1) < network->count; i++) {
+        gap = network->range[i + 1].low - network->range[i].high;
+        if (gap < smallest_gap) {
+            smallest_gap = gap;
+            smallest = i;
+        }
+    }
+    network->range[smallest].high = network->range[smallest + 1].high;
+    bind_schedule_range_remove(network, smallest + 1);
+}
+
+/**
+ * @brief Add a device instance to the ranges of a network, which are
+ * kept sorted and apart by more than BIND_SCHEDULE_GAP_MAX.
+ *
+ * @param network  Pointer to the network
+ * @param device_id  Device instance
+ */
+static void bind_schedule_range_add(
+    struct Bind_Schedule_Network *network, uint32_t device_id)
+{
+    struct Bind_Schedule_Range *range;
+    unsigned low = 0;
+    unsigned high = network->count;
+    unsigned mid;
+
+    /* the first range that starts above the device */
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (network->range[mid].low > device_id) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    if ((low > 0) &&
+        (device_id <= (network->range[low - 1].high + BIND_SCHEDULE_GAP_MAX))) {
+        range = &network->range[low - 1];
+        if (device_id > range->high) {
+            range->high = device_id;
+        }
+        /* the range may now reach the next one */
+        if ((low < network->count) &&
+            (network->range[low].low <= (range->high + BIND_SCHEDULE_GAP_MAX))) {
+            range->high = network->range[low].high;
+            bind_schedule_range_remove(network, low);
+        }
+    } else if ((low < network->count) &&
+        (network->range[low].low <= (device_id + BIND_SCHEDULE_GAP_MAX))) {
+        network->range[low].low = device_id;
+    } else {
+        if (network->count >= BIND_SCHEDULE_RANGES_MAX) {
+            bind_schedule_range_merge(network);
+            bind_schedule_range_add(network, device_id);
+            return;
+        }
+        memmove(&network->range[low + 1], &network->range[low],
+            (network->count - low) * sizeof(network->range[0]));
+        network->range[low].low = device_id;
+        network->range[low].high = device_id;
+        network->count++;
+    }
+}
+
+/**
+ * @brief Clear the pending bind requests, and set the function that sends
+ * the Who-Is requests, such as Send_WhoIs_Remote().
+ *
+ * @param send_function  Function that sends a Who-Is, or NULL to stop
+ *  scheduling
+ */
+void bind_schedule_init(bind_schedule_send_function send_function)
+{
+    memset(Bind_Schedule_Network, 0, sizeof(Bind_Schedule_Network));
+    Bind_Schedule_Send = send_function;
+}
+
+/**
+ * @brief Schedule a Who-Is for a device that has a bind request, such as
+ * from address_bind_request().
+ *
+ * @param device_id  Device instance to bind
+ * @param target_address  Network to send to, or NULL for a global broadcast
+ *
+ * @return true if scheduled, or false if the caller needs to send the
+ *  Who-Is itself
+ */
+bool bind_schedule_device(uint32_t device_id, BACNET_ADDRESS *target_address)
+{
+    struct Bind_Schedule_Network *network;
+
+    if (!Bind_Schedule_Send || (device_id >= BACNET_MAX_INSTANCE)) {
+        return false;
+    }
+    network = bind_schedule_network(target_address);
+    if (!network) {
+        return false;
+    }
+    if (network->count == 0) {
+        network->window = BIND_SCHEDULE_WINDOW_MS;
+    }
+    bind_schedule_range_add(network, device_id);
+
+    return true;
+}
+
+/**
+ * @brief Send the Who-Is of the networks whose window has passed, as
+ * their rate allows. Call this periodically.
+ *
+ * @param milliseconds  Time elapsed since the previous call
+ */
+void bind_schedule_timer(uint16_t milliseconds)
+{
+    struct Bind_Schedule_Network *network;
+    BACNET_ADDRESS *target_address;
+    unsigned i;
+
+    for (i = 0; i < BIND_SCHEDULE_NETWORKS_MAX; i++) {
+        network = &Bind_Schedule_Network[i];
+        if (!network->in_use) {
+            continue;
+        }
+        network->refill += milliseconds;
+        while ((network->tokens < BIND_SCHEDULE_BURST) &&
+            (network->refill >= BIND_SCHEDULE_INTERVAL_MS)) {
+            network->tokens++;
+            network->refill -= BIND_SCHEDULE_INTERVAL_MS;
+        }
+        if (network->tokens >= BIND_SCHEDULE_BURST) {
+            network->refill = 0;
+        }
+        if (network->window > milliseconds) {
+            network->window -= milliseconds;
+            continue;
+        }
+        network->window = 0;
+        target_address = network->global ? NULL : &network->target;
+        while ((network->count > 0) && (network->tokens > 0)) {
+            Bind_Schedule_Send(target_address,
+                (int32_t)network->range[0].low,
+                (int32_t)network->range[0].high);
+            network->tokens--;
+            bind_schedule_range_remove(network, 0);
+        }
+        /* done with the network once it may send a full burst again */
+        if ((network->count == 0) &&
+            (network->tokens >= BIND_SCHEDULE_BURST)) {
+            network->in_use = false;
+        }
+    }
+}
+
+/**
+ * @brief Number of Who-Is requests that are waiting to be sent.
+ *
+ * @return Number of pending device instance ranges of all networks
+ */
+unsigned bind_schedule_pending(void)
+{
+    unsigned count = 0;
+    unsigned i;
+
+    for (i = 0; i < BIND_SCHEDULE_NETWORKS_MAX; i++) {
+        if (Bind_Schedule_Network[i].in_use) {
+            count += Bind_Schedule_Network[i].count;
+        }
+    }
+
+    return count;
+}
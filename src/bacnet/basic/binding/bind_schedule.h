@@ -0,0 +1,71 @@
+/**
+ * @file
+ * @brief Scheduler that coalesces the Who-Is of address bind requests
+ *
+ * @section DESCRIPTION
+ *
+ * Bind requests are gathered per network for a short window, merged
+ * into low/high limit ranges of device instances, and sent as a few
+ * Who-Is requests at a limited rate per network instead of one
+ * Who-Is broadcast per unbound device.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BIND_SCHEDULE_H
+#define BIND_SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacnet/bacnet_stack_exports.h"
+#include "bacnet/bacdef.h"
+
+/** Send a Who-Is request for a range of device instances.
+ * @param target_address - network to send to, or NULL for a global
+ *  broadcast
+ * @param low_limit - Device Instance Low Range
+ * @param high_limit - Device Instance High Range
+ */
+typedef void (*bind_schedule_send_function)(
+    BACNET_ADDRESS *target_address, int32_t low_limit, int32_t high_limit);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    BACNET_STACK_EXPORT
+    void bind_schedule_init(
+        bind_schedule_send_function send_function);
+    BACNET_STACK_EXPORT
+    bool bind_schedule_device(
+        uint32_t device_id,
+        BACNET_ADDRESS *target_address);
+    BACNET_STACK_EXPORT
+    void bind_schedule_timer(
+        uint16_t milliseconds);
+    BACNET_STACK_EXPORT
+    unsigned bind_schedule_pending(
+        void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
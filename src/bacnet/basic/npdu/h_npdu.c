@@ -39,33 +39,18 @@
 
 /** @file h_npdu.c  Handles messages at the NPDU level of the BACnet stack. */
 
-/** Handler for the NPDU portion of a received packet.
- *  Aside from error-checking, if the NPDU doesn't contain routing info,
- *  this handler doesn't do much besides stepping over the NPDU header
- *  and passing the remaining bytes to the apdu_handler.
- *  @note The routing (except src) and NCPI information, including
- *  npdu_data->data_expecting_reply, are discarded.
- * @see routing_npdu_handler
- *
- * @ingroup MISCHNDLR
+/** Handle an NPDU, and pass its APDU to the APDU handler, in place.
  *
- * @param src  [out] Returned with routing source information if the NPDU
- *                   has any and if this points to non-null storage for it.
- *                   If src->net and src->len are 0 on return, there is no
- *                   routing source information.
- *                   This src describes the original source of the message when
- *                   it had to be routed to reach this BACnet Device, and this
- *                   is passed down into the apdu_handler; however, I don't
- *                   think this project's code has any use for the src info
- *                   on return from this handler, since the response has
- *                   already been sent via the apdu_handler.
- *  @param pdu [in]  Buffer containing the NPDU and APDU of the received packet.
- *  @param pdu_len [in] The size of the received message in the pdu[] buffer.
+ * @param src  [in,out] The source address, see npdu_handler()
+ * @param pdu [in]  Buffer containing the NPDU and APDU.
+ * @param pdu_len [in] The size of the NPDU and APDU in the pdu[] buffer.
+ * @param packet [in] The received packet that the NPDU is in, or NULL
  */
-void npdu_handler(BACNET_ADDRESS *src, /* source address */
-    uint8_t *pdu, /* PDU data */
-    uint16_t pdu_len)
-{ /* length PDU  */
+static void npdu_handler_pdu(BACNET_ADDRESS *src,
+    uint8_t *pdu,
+    uint16_t pdu_len,
+    BACNET_PACKET *packet)
+{
     int apdu_offset = 0;
     BACNET_ADDRESS dest = { 0 };
     BACNET_NPDU_DATA npdu_data = { 0 };
@@ -94,6 +79,10 @@ void npdu_handler(BACNET_ADDRESS *src, /* source address */
                     /* hack for 5.4.5.1 - IDLE */
                     /* ConfirmedBroadcastReceived */
                     /* then enter IDLE - ignore the PDU */
+                } else if (packet) {
+                    packet->apdu_offset =
+                        (uint16_t)(packet->npdu_offset + apdu_offset);
+                    apdu_handler_packet(packet);
                 } else {
                     apdu_handler(src, &pdu[apdu_offset],
                         (uint16_t)(pdu_len - apdu_offset));
@@ -113,3 +102,56 @@ void npdu_handler(BACNET_ADDRESS *src, /* source address */
 
     return;
 }
+
+/** Handler for the NPDU portion of a received packet.
+ *  Aside from error-checking, if the NPDU doesn't contain routing info,
+ *  this handler doesn't do much besides stepping over the NPDU header
+ *  and passing the remaining bytes to the apdu_handler.
+ *  @note The routing (except src) and NCPI information, including
+ *  npdu_data->data_expecting_reply, are discarded.
+ * @see routing_npdu_handler
+ *
+ * @ingroup MISCHNDLR
+ *
+ * @param src  [out] Returned with routing source information if the NPDU
+ *                   has any and if this points to non-null storage for it.
+ *                   If src->net and src->len are 0 on return, there is no
+ *                   routing source information.
+ *                   This src describes the original source of the message when
+ *                   it had to be routed to reach this BACnet Device, and this
+ *                   is passed down into the apdu_handler; however, I don't
+ *                   think this project's code has any use for the src info
+ *                   on return from this handler, since the response has
+ *                   already been sent via the apdu_handler.
+ *  @param pdu [in]  Buffer containing the NPDU and APDU of the received packet.
+ *  @param pdu_len [in] The size of the received message in the pdu[] buffer.
+ */
+void npdu_handler(BACNET_ADDRESS *src, /* source address */
+    uint8_t *pdu, /* PDU data */
+    uint16_t pdu_len)
+{ /* length PDU  */
+    npdu_handler_pdu(src, pdu, pdu_len, NULL);
+}
+
+/** Handler for the NPDU of a received packet, in place in the buffer
+ *  of the datalink. The APDU is passed to apdu_handler_packet(), so a
+ *  handler that defers its service can retain the packet instead of
+ *  copying the request. If the datalink parsed the header of the
+ *  packet, the NPDU is known to be local and is not decoded again.
+ *
+ * @ingroup MISCHNDLR
+ *
+ * @param packet [in] The received packet, with its NPDU offset set.
+ */
+void npdu_handler_packet(BACNET_PACKET *packet)
+{
+    if (!packet || (packet->npdu_offset >= packet->length)) {
+        return;
+    }
+    if (packet->header.valid) {
+        apdu_handler_packet(packet);
+        return;
+    }
+    npdu_handler_pdu(&packet->src, &packet->buffer[packet->npdu_offset],
+        (uint16_t)(packet->length - packet->npdu_offset), packet);
+}
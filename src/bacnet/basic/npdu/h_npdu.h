@@ -37,6 +37,7 @@
 #include "bacnet/bacenum.h"
 #include "bacnet/apdu.h"
 #include "bacnet/npdu.h"
+#include "bacnet/basic/sys/pktbuf.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +49,9 @@ extern "C" {
         uint8_t * pdu,
         uint16_t pdu_len);
     BACNET_STACK_EXPORT
+    void npdu_handler_packet(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
     void npdu_handler_cleanup(void);
     BACNET_STACK_EXPORT
     void npdu_handler_init(
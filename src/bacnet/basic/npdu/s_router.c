@@ -105,10 +105,15 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     bool data_expecting_reply = false;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS bcastDest;
+    uint8_t *pdu = NULL;
 
     if (iArgs == NULL) {
         return 0; /* Can't do anything here */
     }
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return 0;
+    }
 
     /* If dst was NULL, get our (local net) broadcast MAC address. */
     if (dst == NULL) {
@@ -125,15 +130,13 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     /* We don't need src information, since a message can't originate from
      * our downstream BACnet network.
      */
-    pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dst, NULL, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], dst, NULL, &npdu_data);
 
     /* Now encode the optional payload bytes, per message type */
     switch (network_message_type) {
         case NETWORK_MESSAGE_WHO_IS_ROUTER_TO_NETWORK:
             if (*pVal >= 0) {
-                len = encode_unsigned16(
-                    &Handler_Transmit_Buffer[pdu_len], (uint16_t)*pVal);
+                len = encode_unsigned16(&pdu[pdu_len], (uint16_t)*pVal);
                 pdu_len += len;
             }
             /* else, don't encode a DNET */
@@ -143,8 +146,7 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
         case NETWORK_MESSAGE_ROUTER_BUSY_TO_NETWORK:
         case NETWORK_MESSAGE_ROUTER_AVAILABLE_TO_NETWORK:
             while (*pVal >= 0) {
-                len = encode_unsigned16(
-                    &Handler_Transmit_Buffer[pdu_len], (uint16_t)*pVal);
+                len = encode_unsigned16(&pdu[pdu_len], (uint16_t)*pVal);
                 pdu_len += len;
                 pVal++;
             }
@@ -152,10 +154,9 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
 
         case NETWORK_MESSAGE_REJECT_MESSAGE_TO_NETWORK:
             /* Encode the Reason byte, then the DNET */
-            Handler_Transmit_Buffer[pdu_len++] = (uint8_t)*pVal;
+            pdu[pdu_len++] = (uint8_t)*pVal;
             pVal++;
-            len = encode_unsigned16(
-                &Handler_Transmit_Buffer[pdu_len], (uint16_t)*pVal);
+            len = encode_unsigned16(&pdu[pdu_len], (uint16_t)*pVal);
             pdu_len += len;
             break;
 
@@ -167,7 +168,7 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
                 len++;
                 pVal++;
             }
-            Handler_Transmit_Buffer[pdu_len++] = (uint8_t)len;
+            pdu[pdu_len++] = (uint8_t)len;
 
             if (len > 0) {
                 uint8_t portID = 1;
@@ -177,11 +178,10 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
                  * and have no PortInfo.
                  */
                 while (*pVal >= 0) {
-                    len = encode_unsigned16(
-                        &Handler_Transmit_Buffer[pdu_len], (uint16_t)*pVal);
+                    len = encode_unsigned16(&pdu[pdu_len], (uint16_t)*pVal);
                     pdu_len += len;
-                    Handler_Transmit_Buffer[pdu_len++] = portID++;
-                    Handler_Transmit_Buffer[pdu_len++] = 0;
+                    pdu[pdu_len++] = portID++;
+                    pdu[pdu_len++] = 0;
                     debug_printf(
                         "  Sending Routing Table entry for %u \n", *pVal);
                     pVal++;
@@ -192,6 +192,7 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
         default:
             debug_printf("Not sent: %s message unsupported \n",
                 bactext_network_layer_msg_name(network_message_type));
+            tsm_pdu_release(pdu);
             return 0;
     }
 
@@ -204,8 +205,7 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     }
 
     /* Now send the message */
-    bytes_sent = datalink_send_pdu(
-        dst, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(dst, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
         int wasErrno = errno; /* preserve the errno */
@@ -214,6 +214,7 @@ int Send_Network_Layer_Message(BACNET_NETWORK_MESSAGE_TYPE network_message_type,
             strerror(wasErrno));
     }
 #endif
+    tsm_pdu_release(pdu);
     return bytes_sent;
 }
 
@@ -29,6 +29,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
@@ -37,15 +38,20 @@
 #include "bacnet/config.h" /* the custom stuff */
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/keyhash.h"
 #include "bacnet/proplist.h"
 #include "bacnet/timestamp.h"
 #include "bacnet/basic/object/ai.h"
 
+/* number of objects created by Analog_Input_Init() */
 #ifndef MAX_ANALOG_INPUTS
 #define MAX_ANALOG_INPUTS 4
 #endif
 
-static ANALOG_INPUT_DESCR AI_Descr[MAX_ANALOG_INPUTS];
+/* the objects, keyed by object instance */
+static OS_Keyhash Object_List;
+/* we need to have our objects created before answering any calls */
+static bool Analog_Input_Initialized = false;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Properties_Required[] = { PROP_OBJECT_IDENTIFIER,
@@ -79,130 +85,254 @@ void Analog_Input_Property_Lists(
     return;
 }
 
-void Analog_Input_Init(void)
+/**
+ * Allocates and initializes an Analog Input object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  the new object, or NULL if out of memory
+ */
+static ANALOG_INPUT_DESCR *Analog_Input_Object_Create(uint32_t object_instance)
 {
-    unsigned i;
+    ANALOG_INPUT_DESCR *pObject = NULL;
 #if defined(INTRINSIC_REPORTING)
     unsigned j;
 #endif
 
-    for (i = 0; i < MAX_ANALOG_INPUTS; i++) {
-        AI_Descr[i].Present_Value = 0.0f;
-        AI_Descr[i].Out_Of_Service = false;
-        AI_Descr[i].Units = UNITS_PERCENT;
-        AI_Descr[i].Reliability = RELIABILITY_NO_FAULT_DETECTED;
-        AI_Descr[i].Prior_Value = 0.0f;
-        AI_Descr[i].COV_Increment = 1.0f;
-        AI_Descr[i].Changed = false;
+    if (!Object_List) {
+        Object_List = Keyhash_Create();
+    }
+    pObject = calloc(1, sizeof(ANALOG_INPUT_DESCR));
+    if (!pObject) {
+        return NULL;
+    }
+    pObject->Present_Value = 0.0f;
+    pObject->Out_Of_Service = false;
+    pObject->Units = UNITS_PERCENT;
+    pObject->Reliability = RELIABILITY_NO_FAULT_DETECTED;
+    pObject->Prior_Value = 0.0f;
+    pObject->COV_Increment = 1.0f;
+    pObject->Changed = false;
 #if defined(INTRINSIC_REPORTING)
-        AI_Descr[i].Event_State = EVENT_STATE_NORMAL;
-        /* notification class not connected */
-        AI_Descr[i].Notification_Class = BACNET_MAX_INSTANCE;
-        /* initialize Event time stamps using wildcards
-           and set Acked_transitions */
-        for (j = 0; j < MAX_BACNET_EVENT_TRANSITION; j++) {
-            datetime_wildcard_set(&AI_Descr[i].Event_Time_Stamps[j]);
-            AI_Descr[i].Acked_Transitions[j].bIsAcked = true;
-        }
-
-        /* Set handler for GetEventInformation function */
-        handler_get_event_information_set(
-            OBJECT_ANALOG_INPUT, Analog_Input_Event_Information);
-        /* Set handler for AcknowledgeAlarm function */
-        handler_alarm_ack_set(OBJECT_ANALOG_INPUT, Analog_Input_Alarm_Ack);
-        /* Set handler for GetAlarmSummary Service */
-        handler_get_alarm_summary_set(
-            OBJECT_ANALOG_INPUT, Analog_Input_Alarm_Summary);
+    pObject->Event_State = EVENT_STATE_NORMAL;
+    /* notification class not connected */
+    pObject->Notification_Class = BACNET_MAX_INSTANCE;
+    /* initialize Event time stamps using wildcards
+       and set Acked_transitions */
+    for (j = 0; j < MAX_BACNET_EVENT_TRANSITION; j++) {
+        datetime_wildcard_set(&pObject->Event_Time_Stamps[j]);
+        pObject->Acked_Transitions[j].bIsAcked = true;
+    }
 #endif
+    if (Keyhash_Data_Add(Object_List, object_instance, pObject) < 0) {
+        free(pObject);
+        return NULL;
     }
+
+    return pObject;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need validate that the */
-/* given instance exists */
-bool Analog_Input_Valid_Instance(uint32_t object_instance)
+/**
+ * Creates an Analog Input object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object exists or was created
+ */
+bool Analog_Input_Create(uint32_t object_instance)
 {
-    unsigned int index;
+    if (object_instance >= BACNET_MAX_INSTANCE) {
+        return false;
+    }
+    if (Keyhash_Data(Object_List, object_instance)) {
+        return true;
+    }
+    if (!Analog_Input_Object_Create(object_instance)) {
+        return false;
+    }
+    Device_Object_List_Changed();
+    Device_Inc_Database_Revision();
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
+    return true;
+}
+
+/**
+ * Deletes an Analog Input object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object was deleted
+ */
+bool Analog_Input_Delete(uint32_t object_instance)
+{
+    ANALOG_INPUT_DESCR *pObject = NULL;
+
+    pObject = Keyhash_Data_Delete(Object_List, object_instance);
+    if (pObject) {
+        free(pObject);
+        Device_Object_List_Changed();
+        Device_Inc_Database_Revision();
         return true;
     }
 
     return false;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then count how many you have */
+/**
+ * Deletes all the Analog Input objects
+ */
+void Analog_Input_Cleanup(void)
+{
+    ANALOG_INPUT_DESCR *pObject = NULL;
+
+    if (Object_List) {
+        while (Keyhash_Count(Object_List) > 0) {
+            pObject = Keyhash_Data_Delete_By_Index(Object_List, 0);
+            free(pObject);
+        }
+        Keyhash_Delete(Object_List);
+        Object_List = NULL;
+        Device_Object_List_Changed();
+    }
+    Analog_Input_Initialized = false;
+}
+
+/**
+ * Initializes the Analog Input objects, creating MAX_ANALOG_INPUTS
+ * objects with instances 0 to MAX_ANALOG_INPUTS-1.
+ */
+void Analog_Input_Init(void)
+{
+    unsigned i;
+
+    if (!Analog_Input_Initialized) {
+        Analog_Input_Initialized = true;
+        if (!Object_List) {
+            Object_List = Keyhash_Create();
+        }
+        for (i = 0; i < MAX_ANALOG_INPUTS; i++) {
+            if (!Keyhash_Data(Object_List, i)) {
+                (void)Analog_Input_Object_Create(i);
+            }
+        }
+    }
+#if defined(INTRINSIC_REPORTING)
+    /* Set handler for GetEventInformation function */
+    handler_get_event_information_set(
+        OBJECT_ANALOG_INPUT, Analog_Input_Event_Information);
+    /* Set handler for AcknowledgeAlarm function */
+    handler_alarm_ack_set(OBJECT_ANALOG_INPUT, Analog_Input_Alarm_Ack);
+    /* Set handler for GetAlarmSummary Service */
+    handler_get_alarm_summary_set(
+        OBJECT_ANALOG_INPUT, Analog_Input_Alarm_Summary);
+#endif
+}
+
+/**
+ * Determines if a given Analog Input instance is valid
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the instance is valid, and false if not
+ */
+bool Analog_Input_Valid_Instance(uint32_t object_instance)
+{
+    return (Keyhash_Data(Object_List, object_instance) != NULL);
+}
+
+/**
+ * Determines the number of Analog Input objects
+ *
+ * @return  Number of Analog Input objects
+ */
 unsigned Analog_Input_Count(void)
 {
-    return MAX_ANALOG_INPUTS;
+    return (unsigned)Keyhash_Count(Object_List);
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the instance */
-/* that correlates to the correct index */
+/**
+ * Determines the object instance-number for a given 0..N index
+ * of Analog Input objects where N is Analog_Input_Count().
+ *
+ * @param  index - 0..N where N is Analog_Input_Count()
+ *
+ * @return  object instance-number for the given index,
+ *          or BACNET_MAX_INSTANCE if the index is not valid
+ */
 uint32_t Analog_Input_Index_To_Instance(unsigned index)
 {
-    return index;
+    if (index < Analog_Input_Count()) {
+        return Keyhash_Key(Object_List, (int)index);
+    }
+
+    return BACNET_MAX_INSTANCE;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the index */
-/* that correlates to the correct instance number */
+/**
+ * For a given object instance-number, determines a 0..N index
+ * of Analog Input objects where N is Analog_Input_Count().
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  index for the given instance-number, or Analog_Input_Count()
+ *          if the instance is not valid.
+ */
 unsigned Analog_Input_Instance_To_Index(uint32_t object_instance)
 {
-    unsigned index = MAX_ANALOG_INPUTS;
+    int index;
 
-    if (object_instance < MAX_ANALOG_INPUTS) {
-        index = object_instance;
+    index = Keyhash_Index(Object_List, object_instance);
+    if (index < 0) {
+        return Analog_Input_Count();
     }
 
-    return index;
+    return (unsigned)index;
 }
 
 float Analog_Input_Present_Value(uint32_t object_instance)
 {
     float value = 0.0;
-    unsigned int index;
+    ANALOG_INPUT_DESCR *pObject = NULL;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        value = AI_Descr[index].Present_Value;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Present_Value;
     }
 
     return value;
 }
 
-static void Analog_Input_COV_Detect(unsigned int index, float value)
+static void Analog_Input_COV_Detect(
+    ANALOG_INPUT_DESCR *pObject, uint32_t object_instance, float value)
 {
     float prior_value = 0.0;
     float cov_increment = 0.0;
     float cov_delta = 0.0;
 
-    if (index < MAX_ANALOG_INPUTS) {
-        prior_value = AI_Descr[index].Prior_Value;
-        cov_increment = AI_Descr[index].COV_Increment;
+    if (pObject) {
+        prior_value = pObject->Prior_Value;
+        cov_increment = pObject->COV_Increment;
         if (prior_value > value) {
             cov_delta = prior_value - value;
         } else {
             cov_delta = value - prior_value;
         }
         if (cov_delta >= cov_increment) {
-            AI_Descr[index].Changed = true;
-            AI_Descr[index].Prior_Value = value;
+            pObject->Changed = true;
+            pObject->Prior_Value = value;
+            handler_cov_object_changed(OBJECT_ANALOG_INPUT, object_instance);
         }
     }
 }
 
 void Analog_Input_Present_Value_Set(uint32_t object_instance, float value)
 {
-    unsigned int index = 0;
+    ANALOG_INPUT_DESCR *pObject = NULL;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        Analog_Input_COV_Detect(index, value);
-        AI_Descr[index].Present_Value = value;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        Analog_Input_COV_Detect(pObject, object_instance, value);
+        pObject->Present_Value = value;
     }
 }
 
@@ -210,12 +340,11 @@ bool Analog_Input_Object_Name(
     uint32_t object_instance, BACNET_CHARACTER_STRING *object_name)
 {
     static char text_string[32] = ""; /* okay for single thread */
-    unsigned int index;
     bool status = false;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        sprintf(text_string, "ANALOG INPUT %lu", (unsigned long)index);
+    if (Analog_Input_Valid_Instance(object_instance)) {
+        sprintf(text_string, "ANALOG INPUT %lu",
+            (unsigned long)object_instance);
         status = characterstring_init_ansi(object_name, text_string);
     }
 
@@ -224,12 +353,12 @@ bool Analog_Input_Object_Name(
 
 bool Analog_Input_Change_Of_Value(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_INPUT_DESCR *pObject = NULL;
     bool changed = false;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        changed = AI_Descr[index].Changed;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        changed = pObject->Changed;
     }
 
     return changed;
@@ -237,11 +366,11 @@ bool Analog_Input_Change_Of_Value(uint32_t object_instance)
 
 void Analog_Input_Change_Of_Value_Clear(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_INPUT_DESCR *pObject = NULL;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        AI_Descr[index].Changed = false;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pObject->Changed = false;
     }
 }
 
@@ -299,12 +428,12 @@ bool Analog_Input_Encode_Value_List(
 
 float Analog_Input_COV_Increment(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_INPUT_DESCR *pObject = NULL;
     float value = 0;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        value = AI_Descr[index].COV_Increment;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->COV_Increment;
     }
 
     return value;
@@ -312,23 +441,24 @@ float Analog_Input_COV_Increment(uint32_t object_instance)
 
 void Analog_Input_COV_Increment_Set(uint32_t object_instance, float value)
 {
-    unsigned index = 0;
+    ANALOG_INPUT_DESCR *pObject = NULL;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        AI_Descr[index].COV_Increment = value;
-        Analog_Input_COV_Detect(index, AI_Descr[index].Present_Value);
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pObject->COV_Increment = value;
+        Analog_Input_COV_Detect(
+            pObject, object_instance, pObject->Present_Value);
     }
 }
 
 bool Analog_Input_Out_Of_Service(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_INPUT_DESCR *pObject = NULL;
     bool value = false;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
-        value = AI_Descr[index].Out_Of_Service;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Out_Of_Service;
     }
 
     return value;
@@ -336,10 +466,10 @@ bool Analog_Input_Out_Of_Service(uint32_t object_instance)
 
 void Analog_Input_Out_Of_Service_Set(uint32_t object_instance, bool value)
 {
-    unsigned index = 0;
+    ANALOG_INPUT_DESCR *pObject = NULL;
 
-    index = Analog_Input_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_INPUTS) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         /* 	BACnet Testing Observed Incident oi00104
                 The Changed flag was not being set when a client wrote to the
         Out-of-Service bit. Revealed by BACnet Test Client v1.8.16 (
@@ -348,10 +478,11 @@ void Analog_Input_Out_Of_Service_Set(uint32_t object_instance, bool value)
         Please feel free to remove this comment when my changes accepted after
         suitable time for review by all interested parties. Say 6 months ->
         September 2016 */
-        if (AI_Descr[index].Out_Of_Service != value) {
-            AI_Descr[index].Changed = true;
+        if (pObject->Out_Of_Service != value) {
+            pObject->Changed = true;
+            handler_cov_object_changed(OBJECT_ANALOG_INPUT, object_instance);
         }
-        AI_Descr[index].Out_Of_Service = value;
+        pObject->Out_Of_Service = value;
     }
 }
 
@@ -363,7 +494,6 @@ int Analog_Input_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
     BACNET_BIT_STRING bit_string;
     BACNET_CHARACTER_STRING char_string;
     ANALOG_INPUT_DESCR *CurrentAI;
-    unsigned object_index = 0;
 #if defined(INTRINSIC_REPORTING)
     unsigned i = 0;
     int len = 0;
@@ -375,10 +505,8 @@ int Analog_Input_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
         return 0;
     }
 
-    object_index = Analog_Input_Instance_To_Index(rpdata->object_instance);
-    if (object_index < MAX_ANALOG_INPUTS) {
-        CurrentAI = &AI_Descr[object_index];
-    } else {
+    CurrentAI = Keyhash_Data(Object_List, rpdata->object_instance);
+    if (!CurrentAI) {
         return BACNET_STATUS_ERROR;
     }
 
@@ -599,7 +727,6 @@ int Analog_Input_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
 bool Analog_Input_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
 {
     bool status = false; /* return value */
-    unsigned int object_index = 0;
     int len = 0;
     BACNET_APPLICATION_DATA_VALUE value;
     ANALOG_INPUT_DESCR *CurrentAI;
@@ -621,10 +748,8 @@ bool Analog_Input_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
         wp_data->error_code = ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY;
         return false;
     }
-    object_index = Analog_Input_Instance_To_Index(wp_data->object_instance);
-    if (object_index < MAX_ANALOG_INPUTS) {
-        CurrentAI = &AI_Descr[object_index];
-    } else {
+    CurrentAI = Keyhash_Data(Object_List, wp_data->object_instance);
+    if (!CurrentAI) {
         return false;
     }
 
@@ -813,17 +938,14 @@ void Analog_Input_Intrinsic_Reporting(uint32_t object_instance)
     BACNET_EVENT_NOTIFICATION_DATA event_data;
     BACNET_CHARACTER_STRING msgText;
     ANALOG_INPUT_DESCR *CurrentAI;
-    unsigned int object_index;
     uint8_t FromState = 0;
     uint8_t ToState;
     float ExceededLimit = 0.0f;
     float PresentVal = 0.0f;
     bool SendNotify = false;
 
-    object_index = Analog_Input_Instance_To_Index(object_instance);
-    if (object_index < MAX_ANALOG_INPUTS)
-        CurrentAI = &AI_Descr[object_index];
-    else
+    CurrentAI = Keyhash_Data(Object_List, object_instance);
+    if (!CurrentAI)
         return;
 
     /* check limits */
@@ -1121,21 +1243,22 @@ int Analog_Input_Event_Information(
     bool IsNotAckedTransitions;
     bool IsActiveEvent;
     int i;
+    ANALOG_INPUT_DESCR *pObject = NULL;
 
     /* check index */
-    if (index < MAX_ANALOG_INPUTS) {
+    pObject = Keyhash_Data_Index(Object_List, (int)index);
+    if (pObject) {
         /* Event_State not equal to NORMAL */
-        IsActiveEvent = (AI_Descr[index].Event_State != EVENT_STATE_NORMAL);
+        IsActiveEvent = (pObject->Event_State != EVENT_STATE_NORMAL);
 
         /* Acked_Transitions property, which has at least one of the bits
            (TO-OFFNORMAL, TO-FAULT, TONORMAL) set to FALSE. */
         IsNotAckedTransitions =
-            (AI_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_OFFNORMAL]
-                    .bIsAcked == false) |
-            (AI_Descr[index].Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked ==
+            (pObject->Acked_Transitions[TRANSITION_TO_OFFNORMAL].bIsAcked ==
                 false) |
-            (AI_Descr[index].Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked ==
+            (pObject->Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked ==
+                false) |
+            (pObject->Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked ==
                 false);
     } else
         return -1; /* end of list  */
@@ -1146,42 +1269,37 @@ int Analog_Input_Event_Information(
         getevent_data->objectIdentifier.instance =
             Analog_Input_Index_To_Instance(index);
         /* Event State */
-        getevent_data->eventState = AI_Descr[index].Event_State;
+        getevent_data->eventState = pObject->Event_State;
         /* Acknowledged Transitions */
         bitstring_init(&getevent_data->acknowledgedTransitions);
         bitstring_set_bit(&getevent_data->acknowledgedTransitions,
             TRANSITION_TO_OFFNORMAL,
-            AI_Descr[index]
-                .Acked_Transitions[TRANSITION_TO_OFFNORMAL]
-                .bIsAcked);
+            pObject->Acked_Transitions[TRANSITION_TO_OFFNORMAL].bIsAcked);
         bitstring_set_bit(&getevent_data->acknowledgedTransitions,
             TRANSITION_TO_FAULT,
-            AI_Descr[index].Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked);
+            pObject->Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked);
         bitstring_set_bit(&getevent_data->acknowledgedTransitions,
             TRANSITION_TO_NORMAL,
-            AI_Descr[index].Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked);
+            pObject->Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked);
         /* Event Time Stamps */
         for (i = 0; i < 3; i++) {
             getevent_data->eventTimeStamps[i].tag = TIME_STAMP_DATETIME;
             getevent_data->eventTimeStamps[i].value.dateTime =
-                AI_Descr[index].Event_Time_Stamps[i];
+                pObject->Event_Time_Stamps[i];
         }
         /* Notify Type */
-        getevent_data->notifyType = AI_Descr[index].Notify_Type;
+        getevent_data->notifyType = pObject->Notify_Type;
         /* Event Enable */
         bitstring_init(&getevent_data->eventEnable);
         bitstring_set_bit(&getevent_data->eventEnable, TRANSITION_TO_OFFNORMAL,
-            (AI_Descr[index].Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ? true
-                                                                       : false);
+            (pObject->Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ? true : false);
         bitstring_set_bit(&getevent_data->eventEnable, TRANSITION_TO_FAULT,
-            (AI_Descr[index].Event_Enable & EVENT_ENABLE_TO_FAULT) ? true
-                                                                   : false);
+            (pObject->Event_Enable & EVENT_ENABLE_TO_FAULT) ? true : false);
         bitstring_set_bit(&getevent_data->eventEnable, TRANSITION_TO_NORMAL,
-            (AI_Descr[index].Event_Enable & EVENT_ENABLE_TO_NORMAL) ? true
-                                                                    : false);
+            (pObject->Event_Enable & EVENT_ENABLE_TO_NORMAL) ? true : false);
         /* Event Priorities */
         Notification_Class_Get_Priorities(
-            AI_Descr[index].Notification_Class, getevent_data->eventPriorities);
+            pObject->Notification_Class, getevent_data->eventPriorities);
 
         return 1; /* active event */
     } else
@@ -1192,14 +1310,10 @@ int Analog_Input_Alarm_Ack(
     BACNET_ALARM_ACK_DATA *alarmack_data, BACNET_ERROR_CODE *error_code)
 {
     ANALOG_INPUT_DESCR *CurrentAI;
-    unsigned int object_index;
 
-    object_index = Analog_Input_Instance_To_Index(
-        alarmack_data->eventObjectIdentifier.instance);
-
-    if (object_index < MAX_ANALOG_INPUTS)
-        CurrentAI = &AI_Descr[object_index];
-    else {
+    CurrentAI = Keyhash_Data(
+        Object_List, alarmack_data->eventObjectIdentifier.instance);
+    if (!CurrentAI) {
         *error_code = ERROR_CODE_UNKNOWN_OBJECT;
         return -1;
     }
@@ -1291,35 +1405,32 @@ int Analog_Input_Alarm_Ack(
 int Analog_Input_Alarm_Summary(
     unsigned index, BACNET_GET_ALARM_SUMMARY_DATA *getalarm_data)
 {
+    ANALOG_INPUT_DESCR *pObject = NULL;
+
     /* check index */
-    if (index < MAX_ANALOG_INPUTS) {
+    pObject = Keyhash_Data_Index(Object_List, (int)index);
+    if (pObject) {
         /* Event_State is not equal to NORMAL  and
            Notify_Type property value is ALARM */
-        if ((AI_Descr[index].Event_State != EVENT_STATE_NORMAL) &&
-            (AI_Descr[index].Notify_Type == NOTIFY_ALARM)) {
+        if ((pObject->Event_State != EVENT_STATE_NORMAL) &&
+            (pObject->Notify_Type == NOTIFY_ALARM)) {
             /* Object Identifier */
             getalarm_data->objectIdentifier.type = OBJECT_ANALOG_INPUT;
             getalarm_data->objectIdentifier.instance =
                 Analog_Input_Index_To_Instance(index);
             /* Alarm State */
-            getalarm_data->alarmState = AI_Descr[index].Event_State;
+            getalarm_data->alarmState = pObject->Event_State;
             /* Acknowledged Transitions */
             bitstring_init(&getalarm_data->acknowledgedTransitions);
             bitstring_set_bit(&getalarm_data->acknowledgedTransitions,
                 TRANSITION_TO_OFFNORMAL,
-                AI_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_OFFNORMAL]
-                    .bIsAcked);
+                pObject->Acked_Transitions[TRANSITION_TO_OFFNORMAL].bIsAcked);
             bitstring_set_bit(&getalarm_data->acknowledgedTransitions,
                 TRANSITION_TO_FAULT,
-                AI_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_FAULT]
-                    .bIsAcked);
+                pObject->Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked);
             bitstring_set_bit(&getalarm_data->acknowledgedTransitions,
                 TRANSITION_TO_NORMAL,
-                AI_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_NORMAL]
-                    .bIsAcked);
+                pObject->Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked);
 
             return 1; /* active alarm */
         } else
@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacenum.h"
@@ -35,8 +36,11 @@
 #include "bacnet/config.h" /* the custom stuff */
 #include "bacnet/wp.h"
 #include "bacnet/basic/object/ao.h"
+#include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/keyhash.h"
 
+/* number of objects created by Analog_Output_Init() */
 #ifndef MAX_ANALOG_OUTPUTS
 #define MAX_ANALOG_OUTPUTS 4
 #endif
@@ -48,13 +52,17 @@
 /* When all the priorities are level null, the present value returns */
 /* the Relinquish Default value */
 #define AO_RELINQUISH_DEFAULT 0
-/* Here is our Priority Array.  They are supposed to be Real, but */
-/* we don't have that kind of memory, so we will use a single byte */
-/* and load a Real for returning the value when asked. */
-static uint8_t Analog_Output_Level[MAX_ANALOG_OUTPUTS][BACNET_MAX_PRIORITY];
-/* Writable out-of-service allows others to play with our Present Value */
-/* without changing the physical output */
-static bool Out_Of_Service[MAX_ANALOG_OUTPUTS];
+struct analog_output_descr {
+    /* Here is our Priority Array.  They are supposed to be Real, but */
+    /* we don't have that kind of memory, so we will use a single byte */
+    /* and load a Real for returning the value when asked. */
+    uint8_t Level[BACNET_MAX_PRIORITY];
+    /* Writable out-of-service allows others to play with our Present Value */
+    /* without changing the physical output */
+    bool Out_Of_Service;
+};
+/* the objects, keyed by object instance */
+static OS_Keyhash Object_List;
 
 /* we need to have our arrays initialized before answering any calls */
 static bool Analog_Output_Initialized = false;
@@ -85,17 +93,120 @@ void Analog_Output_Property_Lists(
     return;
 }
 
+/**
+ * Allocates and initializes an Analog Output object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  the new object, or NULL if out of memory
+ */
+static struct analog_output_descr *Analog_Output_Object_Create(
+    uint32_t object_instance)
+{
+    struct analog_output_descr *pObject = NULL;
+    unsigned j;
+
+    if (!Object_List) {
+        Object_List = Keyhash_Create();
+    }
+    pObject = calloc(1, sizeof(struct analog_output_descr));
+    if (!pObject) {
+        return NULL;
+    }
+    /* initialize the priority array to NULL */
+    for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
+        pObject->Level[j] = AO_LEVEL_NULL;
+    }
+    pObject->Out_Of_Service = false;
+    if (Keyhash_Data_Add(Object_List, object_instance, pObject) < 0) {
+        free(pObject);
+        return NULL;
+    }
+
+    return pObject;
+}
+
+/**
+ * Creates an Analog Output object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object exists or was created
+ */
+bool Analog_Output_Create(uint32_t object_instance)
+{
+    if (object_instance >= BACNET_MAX_INSTANCE) {
+        return false;
+    }
+    if (Keyhash_Data(Object_List, object_instance)) {
+        return true;
+    }
+    if (!Analog_Output_Object_Create(object_instance)) {
+        return false;
+    }
+    Device_Object_List_Changed();
+    Device_Inc_Database_Revision();
+
+    return true;
+}
+
+/**
+ * Deletes an Analog Output object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object was deleted
+ */
+bool Analog_Output_Delete(uint32_t object_instance)
+{
+    struct analog_output_descr *pObject = NULL;
+
+    pObject = Keyhash_Data_Delete(Object_List, object_instance);
+    if (pObject) {
+        free(pObject);
+        Device_Object_List_Changed();
+        Device_Inc_Database_Revision();
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Deletes all the Analog Output objects
+ */
+void Analog_Output_Cleanup(void)
+{
+    struct analog_output_descr *pObject = NULL;
+
+    if (Object_List) {
+        while (Keyhash_Count(Object_List) > 0) {
+            pObject = Keyhash_Data_Delete_By_Index(Object_List, 0);
+            free(pObject);
+        }
+        Keyhash_Delete(Object_List);
+        Object_List = NULL;
+        Device_Object_List_Changed();
+    }
+    Analog_Output_Initialized = false;
+}
+
+/**
+ * Initializes the Analog Output objects, creating MAX_ANALOG_OUTPUTS
+ * objects with instances 0 to MAX_ANALOG_OUTPUTS-1.
+ */
 void Analog_Output_Init(void)
 {
-    unsigned i, j;
+    unsigned i;
 
     if (!Analog_Output_Initialized) {
         Analog_Output_Initialized = true;
-
-        /* initialize all the analog output priority arrays to NULL */
+        if (!Object_List) {
+            Object_List = Keyhash_Create();
+        }
         for (i = 0; i < MAX_ANALOG_OUTPUTS; i++) {
-            for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
-                Analog_Output_Level[i][j] = AO_LEVEL_NULL;
+            if (!Keyhash_Data(Object_List, i)) {
+                (void)Analog_Output_Object_Create(i);
             }
         }
     }
@@ -103,58 +214,78 @@ void Analog_Output_Init(void)
     return;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need validate that the */
-/* given instance exists */
+/**
+ * Determines if a given Analog Output instance is valid
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the instance is valid, and false if not
+ */
 bool Analog_Output_Valid_Instance(uint32_t object_instance)
 {
-    if (object_instance < MAX_ANALOG_OUTPUTS) {
-        return true;
-    }
-
-    return false;
+    return (Keyhash_Data(Object_List, object_instance) != NULL);
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then count how many you have */
+/**
+ * Determines the number of Analog Output objects
+ *
+ * @return  Number of Analog Output objects
+ */
 unsigned Analog_Output_Count(void)
 {
-    return MAX_ANALOG_OUTPUTS;
+    return (unsigned)Keyhash_Count(Object_List);
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the instance */
-/* that correlates to the correct index */
+/**
+ * Determines the object instance-number for a given 0..N index
+ * of Analog Output objects where N is Analog_Output_Count().
+ *
+ * @param  index - 0..N where N is Analog_Output_Count()
+ *
+ * @return  object instance-number for the given index,
+ *          or BACNET_MAX_INSTANCE if the index is not valid
+ */
 uint32_t Analog_Output_Index_To_Instance(unsigned index)
 {
-    return index;
+    if (index < Analog_Output_Count()) {
+        return Keyhash_Key(Object_List, (int)index);
+    }
+
+    return BACNET_MAX_INSTANCE;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the index */
-/* that correlates to the correct instance number */
+/**
+ * For a given object instance-number, determines a 0..N index
+ * of Analog Output objects where N is Analog_Output_Count().
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  index for the given instance-number, or Analog_Output_Count()
+ *          if the instance is not valid.
+ */
 unsigned Analog_Output_Instance_To_Index(uint32_t object_instance)
 {
-    unsigned index = MAX_ANALOG_OUTPUTS;
+    int index;
 
-    if (object_instance < MAX_ANALOG_OUTPUTS) {
-        index = object_instance;
+    index = Keyhash_Index(Object_List, object_instance);
+    if (index < 0) {
+        return Analog_Output_Count();
     }
 
-    return index;
+    return (unsigned)index;
 }
 
 float Analog_Output_Present_Value(uint32_t object_instance)
 {
     float value = AO_RELINQUISH_DEFAULT;
-    unsigned index = 0;
+    struct analog_output_descr *pObject = NULL;
     unsigned i = 0;
 
-    index = Analog_Output_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_OUTPUTS) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
-            if (Analog_Output_Level[index][i] != AO_LEVEL_NULL) {
-                value = Analog_Output_Level[index][i];
+            if (pObject->Level[i] != AO_LEVEL_NULL) {
+                value = pObject->Level[i];
                 break;
             }
         }
@@ -165,14 +296,14 @@ float Analog_Output_Present_Value(uint32_t object_instance)
 
 unsigned Analog_Output_Present_Value_Priority(uint32_t object_instance)
 {
-    unsigned index = 0; /* instance to index conversion */
+    struct analog_output_descr *pObject = NULL;
     unsigned i = 0; /* loop counter */
     unsigned priority = 0; /* return value */
 
-    index = Analog_Output_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_OUTPUTS) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
-            if (Analog_Output_Level[index][i] != AO_LEVEL_NULL) {
+            if (pObject->Level[i] != AO_LEVEL_NULL) {
                 priority = i + 1;
                 break;
             }
@@ -185,15 +316,15 @@ unsigned Analog_Output_Present_Value_Priority(uint32_t object_instance)
 bool Analog_Output_Present_Value_Set(
     uint32_t object_instance, float value, unsigned priority)
 {
-    unsigned index = 0;
+    struct analog_output_descr *pObject = NULL;
     bool status = false;
 
-    index = Analog_Output_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_OUTPUTS) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         if (priority && (priority <= BACNET_MAX_PRIORITY) &&
             (priority != 6 /* reserved */) && (value >= 0.0) &&
             (value <= 100.0)) {
-            Analog_Output_Level[index][priority - 1] = (uint8_t)value;
+            pObject->Level[priority - 1] = (uint8_t)value;
             /* Note: you could set the physical output here to the next
                highest priority, or to the relinquish default if no
                priorities are set.
@@ -210,14 +341,14 @@ bool Analog_Output_Present_Value_Set(
 bool Analog_Output_Present_Value_Relinquish(
     uint32_t object_instance, unsigned priority)
 {
-    unsigned index = 0;
+    struct analog_output_descr *pObject = NULL;
     bool status = false;
 
-    index = Analog_Output_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_OUTPUTS) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         if (priority && (priority <= BACNET_MAX_PRIORITY) &&
             (priority != 6 /* reserved */)) {
-            Analog_Output_Level[index][priority - 1] = AO_LEVEL_NULL;
+            pObject->Level[priority - 1] = AO_LEVEL_NULL;
             /* Note: you could set the physical output here to the next
                highest priority, or to the relinquish default if no
                priorities are set.
@@ -238,7 +369,7 @@ bool Analog_Output_Object_Name(
     static char text_string[32] = ""; /* okay for single thread */
     bool status = false;
 
-    if (object_instance < MAX_ANALOG_OUTPUTS) {
+    if (Analog_Output_Valid_Instance(object_instance)) {
         sprintf(
             text_string, "ANALOG OUTPUT %lu", (unsigned long)object_instance);
         status = characterstring_init_ansi(object_name, text_string);
@@ -249,12 +380,12 @@ bool Analog_Output_Object_Name(
 
 bool Analog_Output_Out_Of_Service(uint32_t instance)
 {
-    unsigned index = 0;
+    struct analog_output_descr *pObject = NULL;
     bool oos_flag = false;
 
-    index = Analog_Output_Instance_To_Index(instance);
-    if (index < MAX_ANALOG_OUTPUTS) {
-        oos_flag = Out_Of_Service[index];
+    pObject = Keyhash_Data(Object_List, instance);
+    if (pObject) {
+        oos_flag = pObject->Out_Of_Service;
     }
 
     return oos_flag;
@@ -262,11 +393,11 @@ bool Analog_Output_Out_Of_Service(uint32_t instance)
 
 void Analog_Output_Out_Of_Service_Set(uint32_t instance, bool oos_flag)
 {
-    unsigned index = 0;
+    struct analog_output_descr *pObject = NULL;
 
-    index = Analog_Output_Instance_To_Index(instance);
-    if (index < MAX_ANALOG_OUTPUTS) {
-        Out_Of_Service[index] = oos_flag;
+    pObject = Keyhash_Data(Object_List, instance);
+    if (pObject) {
+        pObject->Out_Of_Service = oos_flag;
     }
 }
 
@@ -278,7 +409,7 @@ int Analog_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
     BACNET_BIT_STRING bit_string;
     BACNET_CHARACTER_STRING char_string;
     float real_value = (float)1.414;
-    unsigned object_index = 0;
+    struct analog_output_descr *pObject = NULL;
     unsigned i = 0;
     bool state = false;
     uint8_t *apdu = NULL;
@@ -287,6 +418,12 @@ int Analog_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
         (rpdata->application_data_len == 0)) {
         return 0;
     }
+    pObject = Keyhash_Data(Object_List, rpdata->object_instance);
+    if (!pObject) {
+        rpdata->error_class = ERROR_CLASS_OBJECT;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return BACNET_STATUS_ERROR;
+    }
     apdu = rpdata->application_data;
     switch (rpdata->object_property) {
         case PROP_OBJECT_IDENTIFIER:
@@ -335,14 +472,12 @@ int Analog_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                  */
                 /* into one packet. */
             } else if (rpdata->array_index == BACNET_ARRAY_ALL) {
-                object_index =
-                    Analog_Output_Instance_To_Index(rpdata->object_instance);
                 for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
                     /* FIXME: check if we have room before adding it to APDU */
-                    if (Analog_Output_Level[object_index][i] == AO_LEVEL_NULL) {
+                    if (pObject->Level[i] == AO_LEVEL_NULL) {
                         len = encode_application_null(&apdu[apdu_len]);
                     } else {
-                        real_value = Analog_Output_Level[object_index][i];
+                        real_value = pObject->Level[i];
                         len = encode_application_real(
                             &apdu[apdu_len], real_value);
                     }
@@ -357,16 +492,12 @@ int Analog_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                     }
                 }
             } else {
-                object_index =
-                    Analog_Output_Instance_To_Index(rpdata->object_instance);
                 if (rpdata->array_index <= BACNET_MAX_PRIORITY) {
-                    if (Analog_Output_Level[object_index][rpdata->array_index -
-                            1] == AO_LEVEL_NULL) {
+                    if (pObject->Level[rpdata->array_index - 1] ==
+                        AO_LEVEL_NULL) {
                         apdu_len = encode_application_null(&apdu[0]);
                     } else {
-                        real_value =
-                            Analog_Output_Level[object_index]
-                                               [rpdata->array_index - 1];
+                        real_value = pObject->Level[rpdata->array_index - 1];
                         apdu_len =
                             encode_application_real(&apdu[0], real_value);
                     }
@@ -29,6 +29,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "bacnet/bacdef.h"
@@ -39,13 +40,18 @@
 #include "bacnet/config.h" /* the custom stuff */
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/keyhash.h"
 #include "bacnet/basic/object/av.h"
 
+/* number of objects created by Analog_Value_Init() */
 #ifndef MAX_ANALOG_VALUES
 #define MAX_ANALOG_VALUES 4
 #endif
 
-static ANALOG_VALUE_DESCR AV_Descr[MAX_ANALOG_VALUES];
+/* the objects, keyed by object instance */
+static OS_Keyhash Object_List;
+/* we need to have our objects created before answering any calls */
+static bool Analog_Value_Initialized = false;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Analog_Value_Properties_Required[] = { PROP_OBJECT_IDENTIFIER,
@@ -88,63 +94,158 @@ void Analog_Value_Property_Lists(
 }
 
 /**
- * Initialize the analog values.
+ * Allocate and initialize an analog value.
+ *
+ * @param object_instance Object instance
+ *
+ * @return The new object, or NULL if out of memory.
  */
-void Analog_Value_Init(void)
+static ANALOG_VALUE_DESCR *Analog_Value_Object_Create(uint32_t object_instance)
 {
-    unsigned i;
+    ANALOG_VALUE_DESCR *pObject = NULL;
 #if defined(INTRINSIC_REPORTING)
     unsigned j;
 #endif
 
-    for (i = 0; i < MAX_ANALOG_VALUES; i++) {
-        memset(&AV_Descr[i], 0x00, sizeof(ANALOG_VALUE_DESCR));
-        AV_Descr[i].Present_Value = 0.0;
-        AV_Descr[i].Units = UNITS_NO_UNITS;
-        AV_Descr[i].Prior_Value = 0.0f;
-        AV_Descr[i].COV_Increment = 1.0f;
-        AV_Descr[i].Changed = false;
+    if (!Object_List) {
+        Object_List = Keyhash_Create();
+    }
+    pObject = calloc(1, sizeof(ANALOG_VALUE_DESCR));
+    if (!pObject) {
+        return NULL;
+    }
+    pObject->Present_Value = 0.0;
+    pObject->Units = UNITS_NO_UNITS;
+    pObject->Prior_Value = 0.0f;
+    pObject->COV_Increment = 1.0f;
+    pObject->Changed = false;
 #if defined(INTRINSIC_REPORTING)
-        AV_Descr[i].Event_State = EVENT_STATE_NORMAL;
-        /* notification class not connected */
-        AV_Descr[i].Notification_Class = BACNET_MAX_INSTANCE;
-        /* initialize Event time stamps using wildcards
-           and set Acked_transitions */
-        for (j = 0; j < MAX_BACNET_EVENT_TRANSITION; j++) {
-            datetime_wildcard_set(&AV_Descr[i].Event_Time_Stamps[j]);
-            AV_Descr[i].Acked_Transitions[j].bIsAcked = true;
-        }
-
-        /* Set handler for GetEventInformation function */
-        handler_get_event_information_set(
-            OBJECT_ANALOG_VALUE, Analog_Value_Event_Information);
-        /* Set handler for AcknowledgeAlarm function */
-        handler_alarm_ack_set(OBJECT_ANALOG_VALUE, Analog_Value_Alarm_Ack);
-        /* Set handler for GetAlarmSummary Service */
-        handler_get_alarm_summary_set(
-            OBJECT_ANALOG_VALUE, Analog_Value_Alarm_Summary);
+    pObject->Event_State = EVENT_STATE_NORMAL;
+    /* notification class not connected */
+    pObject->Notification_Class = BACNET_MAX_INSTANCE;
+    /* initialize Event time stamps using wildcards
+       and set Acked_transitions */
+    for (j = 0; j < MAX_BACNET_EVENT_TRANSITION; j++) {
+        datetime_wildcard_set(&pObject->Event_Time_Stamps[j]);
+        pObject->Acked_Transitions[j].bIsAcked = true;
+    }
 #endif
+    if (Keyhash_Data_Add(Object_List, object_instance, pObject) < 0) {
+        free(pObject);
+        return NULL;
     }
+
+    return pObject;
 }
 
 /**
- * We simply have 0-n object instances. Yours might be
- * more complex, and then you need validate that the
- * given instance exists.
+ * Create an analog value at runtime.
  *
  * @param object_instance Object instance
  *
- * @return true/false
+ * @return true if the object exists or was created.
  */
-bool Analog_Value_Valid_Instance(uint32_t object_instance)
+bool Analog_Value_Create(uint32_t object_instance)
 {
-    if (object_instance < MAX_ANALOG_VALUES) {
+    if (object_instance >= BACNET_MAX_INSTANCE) {
+        return false;
+    }
+    if (Keyhash_Data(Object_List, object_instance)) {
+        return true;
+    }
+    if (!Analog_Value_Object_Create(object_instance)) {
+        return false;
+    }
+    Device_Object_List_Changed();
+    Device_Inc_Database_Revision();
+
+    return true;
+}
+
+/**
+ * Delete an analog value at runtime.
+ *
+ * @param object_instance Object instance
+ *
+ * @return true if the object was deleted.
+ */
+bool Analog_Value_Delete(uint32_t object_instance)
+{
+    ANALOG_VALUE_DESCR *pObject = NULL;
+
+    pObject = Keyhash_Data_Delete(Object_List, object_instance);
+    if (pObject) {
+        free(pObject);
+        Device_Object_List_Changed();
+        Device_Inc_Database_Revision();
         return true;
     }
 
     return false;
 }
 
+/**
+ * Delete all the analog values.
+ */
+void Analog_Value_Cleanup(void)
+{
+    ANALOG_VALUE_DESCR *pObject = NULL;
+
+    if (Object_List) {
+        while (Keyhash_Count(Object_List) > 0) {
+            pObject = Keyhash_Data_Delete_By_Index(Object_List, 0);
+            free(pObject);
+        }
+        Keyhash_Delete(Object_List);
+        Object_List = NULL;
+        Device_Object_List_Changed();
+    }
+    Analog_Value_Initialized = false;
+}
+
+/**
+ * Initialize the analog values, creating MAX_ANALOG_VALUES
+ * objects with instances 0 to MAX_ANALOG_VALUES-1.
+ */
+void Analog_Value_Init(void)
+{
+    unsigned i;
+
+    if (!Analog_Value_Initialized) {
+        Analog_Value_Initialized = true;
+        if (!Object_List) {
+            Object_List = Keyhash_Create();
+        }
+        for (i = 0; i < MAX_ANALOG_VALUES; i++) {
+            if (!Keyhash_Data(Object_List, i)) {
+                (void)Analog_Value_Object_Create(i);
+            }
+        }
+    }
+#if defined(INTRINSIC_REPORTING)
+    /* Set handler for GetEventInformation function */
+    handler_get_event_information_set(
+        OBJECT_ANALOG_VALUE, Analog_Value_Event_Information);
+    /* Set handler for AcknowledgeAlarm function */
+    handler_alarm_ack_set(OBJECT_ANALOG_VALUE, Analog_Value_Alarm_Ack);
+    /* Set handler for GetAlarmSummary Service */
+    handler_get_alarm_summary_set(
+        OBJECT_ANALOG_VALUE, Analog_Value_Alarm_Summary);
+#endif
+}
+
+/**
+ * Determine if a given analog value instance exists.
+ *
+ * @param object_instance Object instance
+ *
+ * @return true/false
+ */
+bool Analog_Value_Valid_Instance(uint32_t object_instance)
+{
+    return (Keyhash_Data(Object_List, object_instance) != NULL);
+}
+
 /**
  * Return the count of analog values.
  *
@@ -152,41 +253,43 @@ bool Analog_Value_Valid_Instance(uint32_t object_instance)
  */
 unsigned Analog_Value_Count(void)
 {
-    return MAX_ANALOG_VALUES;
+    return (unsigned)Keyhash_Count(Object_List);
 }
 
 /**
- * We simply have 0-n object instances.  Yours might be
- * more complex, and then you need to return the instance
- * that correlates to the correct index.
+ * Return the instance that correlates to the given index.
  *
- * @param index Index
+ * @param index Index 0..Analog_Value_Count()-1
  *
- * @return Object instance
+ * @return Object instance, or BACNET_MAX_INSTANCE if the index is not valid.
  */
 uint32_t Analog_Value_Index_To_Instance(unsigned index)
 {
-    return index;
+    if (index < Analog_Value_Count()) {
+        return Keyhash_Key(Object_List, (int)index);
+    }
+
+    return BACNET_MAX_INSTANCE;
 }
 
 /**
- * We simply have 0-n object instances.  Yours might be
- * more complex, and then you need to return the index
- * that correlates to the correct instance number
+ * Return the index that correlates to the given instance number.
  *
  * @param object_instance Object instance
  *
- * @return Index in the object table.
+ * @return Index in the object table, or Analog_Value_Count()
+ *         if the instance does not exist.
  */
 unsigned Analog_Value_Instance_To_Index(uint32_t object_instance)
 {
-    unsigned index = MAX_ANALOG_VALUES;
+    int index;
 
-    if (object_instance < MAX_ANALOG_VALUES) {
-        index = object_instance;
+    index = Keyhash_Index(Object_List, object_instance);
+    if (index < 0) {
+        return Analog_Value_Count();
     }
 
-    return index;
+    return (unsigned)index;
 }
 
 /**
@@ -196,26 +299,29 @@ unsigned Analog_Value_Instance_To_Index(uint32_t object_instance)
  *
  * This method will update the COV-changed attribute.
  *
- * @param index  Object index
+ * @param pObject  Object data
+ * @param object_instance  Object instance
  * @param value  Given present value.
  */
-static void Analog_Value_COV_Detect(unsigned int index, float value)
+static void Analog_Value_COV_Detect(
+    ANALOG_VALUE_DESCR *pObject, uint32_t object_instance, float value)
 {
     float prior_value = 0.0;
     float cov_increment = 0.0;
     float cov_delta = 0.0;
 
-    if (index < MAX_ANALOG_VALUES) {
-        prior_value = AV_Descr[index].Prior_Value;
-        cov_increment = AV_Descr[index].COV_Increment;
+    if (pObject) {
+        prior_value = pObject->Prior_Value;
+        cov_increment = pObject->COV_Increment;
         if (prior_value > value) {
             cov_delta = prior_value - value;
         } else {
             cov_delta = value - prior_value;
         }
         if (cov_delta >= cov_increment) {
-            AV_Descr[index].Changed = true;
-            AV_Descr[index].Prior_Value = value;
+            pObject->Changed = true;
+            pObject->Prior_Value = value;
+            handler_cov_object_changed(OBJECT_ANALOG_VALUE, object_instance);
         }
     }
 }
@@ -233,13 +339,13 @@ static void Analog_Value_COV_Detect(unsigned int index, float value)
 bool Analog_Value_Present_Value_Set(
     uint32_t object_instance, float value, uint8_t priority)
 {
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
     bool status = false;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        Analog_Value_COV_Detect(index, value);
-        AV_Descr[index].Present_Value = value;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        Analog_Value_COV_Detect(pObject, object_instance, value);
+        pObject->Present_Value = value;
         status = true;
     }
     return status;
@@ -255,11 +361,11 @@ bool Analog_Value_Present_Value_Set(
 float Analog_Value_Present_Value(uint32_t object_instance)
 {
     float value = 0;
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        value = AV_Descr[index].Present_Value;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Present_Value;
     }
 
     return value;
@@ -281,7 +387,7 @@ bool Analog_Value_Object_Name(
     static char text_string[32] = ""; /* okay for single thread */
     bool status = false;
 
-    if (object_instance < MAX_ANALOG_VALUES) {
+    if (Analog_Value_Valid_Instance(object_instance)) {
         sprintf(
             text_string, "ANALOG VALUE %lu", (unsigned long)object_instance);
         status = characterstring_init_ansi(object_name, text_string);
@@ -300,12 +406,12 @@ bool Analog_Value_Object_Name(
  */
 bool Analog_Value_Change_Of_Value(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
     bool changed = false;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        changed = AV_Descr[index].Changed;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        changed = pObject->Changed;
     }
 
     return changed;
@@ -318,11 +424,11 @@ bool Analog_Value_Change_Of_Value(uint32_t object_instance)
  */
 void Analog_Value_Change_Of_Value_Clear(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        AV_Descr[index].Changed = false;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pObject->Changed = false;
     }
 }
 
@@ -380,12 +486,12 @@ bool Analog_Value_Encode_Value_List(
 
 float Analog_Value_COV_Increment(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
     float value = 0;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        value = AV_Descr[index].COV_Increment;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->COV_Increment;
     }
 
     return value;
@@ -393,23 +499,24 @@ float Analog_Value_COV_Increment(uint32_t object_instance)
 
 void Analog_Value_COV_Increment_Set(uint32_t object_instance, float value)
 {
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        AV_Descr[index].COV_Increment = value;
-        Analog_Value_COV_Detect(index, AV_Descr[index].Present_Value);
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pObject->COV_Increment = value;
+        Analog_Value_COV_Detect(
+            pObject, object_instance, pObject->Present_Value);
     }
 }
 
 bool Analog_Value_Out_Of_Service(uint32_t object_instance)
 {
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
     bool value = false;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        value = AV_Descr[index].Out_Of_Service;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Out_Of_Service;
     }
 
     return value;
@@ -417,14 +524,15 @@ bool Analog_Value_Out_Of_Service(uint32_t object_instance)
 
 void Analog_Value_Out_Of_Service_Set(uint32_t object_instance, bool value)
 {
-    unsigned index = 0;
+    ANALOG_VALUE_DESCR *pObject = NULL;
 
-    index = Analog_Value_Instance_To_Index(object_instance);
-    if (index < MAX_ANALOG_VALUES) {
-        if (AV_Descr[index].Out_Of_Service != value) {
-            AV_Descr[index].Changed = true;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        if (pObject->Out_Of_Service != value) {
+            pObject->Changed = true;
+            handler_cov_object_changed(OBJECT_ANALOG_VALUE, object_instance);
         }
-        AV_Descr[index].Out_Of_Service = value;
+        pObject->Out_Of_Service = value;
     }
 }
 
@@ -441,7 +549,6 @@ int Analog_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
     BACNET_BIT_STRING bit_string;
     BACNET_CHARACTER_STRING char_string;
     float real_value = (float)1.414;
-    unsigned object_index = 0;
     bool state = false;
     uint8_t *apdu = NULL;
     ANALOG_VALUE_DESCR *CurrentAV;
@@ -461,15 +568,13 @@ int Analog_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
 
     apdu = rpdata->application_data;
 
-    object_index = Analog_Value_Instance_To_Index(rpdata->object_instance);
-    if (object_index >= MAX_ANALOG_VALUES) {
+    CurrentAV = Keyhash_Data(Object_List, rpdata->object_instance);
+    if (!CurrentAV) {
         rpdata->error_class = ERROR_CLASS_OBJECT;
         rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
         return BACNET_STATUS_ERROR;
     }
 
-    CurrentAV = &AV_Descr[object_index];
-
     switch (rpdata->object_property) {
         case PROP_OBJECT_IDENTIFIER:
             apdu_len = encode_application_object_id(
@@ -677,7 +782,6 @@ int Analog_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
 bool Analog_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
 {
     bool status = false; /* return value */
-    unsigned int object_index = 0;
     int len = 0;
     BACNET_APPLICATION_DATA_VALUE value;
     ANALOG_VALUE_DESCR *CurrentAV;
@@ -710,15 +814,13 @@ bool Analog_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
     }
 
     /* Valid object? */
-    object_index = Analog_Value_Instance_To_Index(wp_data->object_instance);
-    if (object_index >= MAX_ANALOG_VALUES) {
+    CurrentAV = Keyhash_Data(Object_List, wp_data->object_instance);
+    if (!CurrentAV) {
         wp_data->error_class = ERROR_CLASS_OBJECT;
         wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
         return false;
     }
 
-    CurrentAV = &AV_Descr[object_index];
-
     switch (wp_data->object_property) {
         case PROP_PRESENT_VALUE:
             if (value.tag == BACNET_APPLICATION_TAG_REAL) {
@@ -910,17 +1012,14 @@ void Analog_Value_Intrinsic_Reporting(uint32_t object_instance)
     BACNET_EVENT_NOTIFICATION_DATA event_data;
     BACNET_CHARACTER_STRING msgText;
     ANALOG_VALUE_DESCR *CurrentAV;
-    unsigned int object_index;
     uint8_t FromState = 0;
     uint8_t ToState;
     float ExceededLimit = 0.0f;
     float PresentVal = 0.0f;
     bool SendNotify = false;
 
-    object_index = Analog_Value_Instance_To_Index(object_instance);
-    if (object_index < MAX_ANALOG_VALUES)
-        CurrentAV = &AV_Descr[object_index];
-    else
+    CurrentAV = Keyhash_Data(Object_List, object_instance);
+    if (!CurrentAV)
         return;
 
     /* check limits */
@@ -1218,21 +1317,22 @@ int Analog_Value_Event_Information(
     bool IsNotAckedTransitions;
     bool IsActiveEvent;
     int i;
+    ANALOG_VALUE_DESCR *pObject = NULL;
 
     /* check index */
-    if (index < MAX_ANALOG_VALUES) {
+    pObject = Keyhash_Data_Index(Object_List, (int)index);
+    if (pObject) {
         /* Event_State not equal to NORMAL */
-        IsActiveEvent = (AV_Descr[index].Event_State != EVENT_STATE_NORMAL);
+        IsActiveEvent = (pObject->Event_State != EVENT_STATE_NORMAL);
 
         /* Acked_Transitions property, which has at least one of the bits
            (TO-OFFNORMAL, TO-FAULT, TONORMAL) set to FALSE. */
         IsNotAckedTransitions =
-            (AV_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_OFFNORMAL]
-                    .bIsAcked == false) |
-            (AV_Descr[index].Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked ==
+            (pObject->Acked_Transitions[TRANSITION_TO_OFFNORMAL].bIsAcked ==
+                false) |
+            (pObject->Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked ==
                 false) |
-            (AV_Descr[index].Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked ==
+            (pObject->Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked ==
                 false);
     } else
         return -1; /* end of list  */
@@ -1243,42 +1343,37 @@ int Analog_Value_Event_Information(
         getevent_data->objectIdentifier.instance =
             Analog_Value_Index_To_Instance(index);
         /* Event State */
-        getevent_data->eventState = AV_Descr[index].Event_State;
+        getevent_data->eventState = pObject->Event_State;
         /* Acknowledged Transitions */
         bitstring_init(&getevent_data->acknowledgedTransitions);
         bitstring_set_bit(&getevent_data->acknowledgedTransitions,
             TRANSITION_TO_OFFNORMAL,
-            AV_Descr[index]
-                .Acked_Transitions[TRANSITION_TO_OFFNORMAL]
-                .bIsAcked);
+            pObject->Acked_Transitions[TRANSITION_TO_OFFNORMAL].bIsAcked);
         bitstring_set_bit(&getevent_data->acknowledgedTransitions,
             TRANSITION_TO_FAULT,
-            AV_Descr[index].Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked);
+            pObject->Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked);
         bitstring_set_bit(&getevent_data->acknowledgedTransitions,
             TRANSITION_TO_NORMAL,
-            AV_Descr[index].Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked);
+            pObject->Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked);
         /* Event Time Stamps */
         for (i = 0; i < 3; i++) {
             getevent_data->eventTimeStamps[i].tag = TIME_STAMP_DATETIME;
             getevent_data->eventTimeStamps[i].value.dateTime =
-                AV_Descr[index].Event_Time_Stamps[i];
+                pObject->Event_Time_Stamps[i];
         }
         /* Notify Type */
-        getevent_data->notifyType = AV_Descr[index].Notify_Type;
+        getevent_data->notifyType = pObject->Notify_Type;
         /* Event Enable */
         bitstring_init(&getevent_data->eventEnable);
         bitstring_set_bit(&getevent_data->eventEnable, TRANSITION_TO_OFFNORMAL,
-            (AV_Descr[index].Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ? true
-                                                                       : false);
+            (pObject->Event_Enable & EVENT_ENABLE_TO_OFFNORMAL) ? true : false);
         bitstring_set_bit(&getevent_data->eventEnable, TRANSITION_TO_FAULT,
-            (AV_Descr[index].Event_Enable & EVENT_ENABLE_TO_FAULT) ? true
-                                                                   : false);
+            (pObject->Event_Enable & EVENT_ENABLE_TO_FAULT) ? true : false);
         bitstring_set_bit(&getevent_data->eventEnable, TRANSITION_TO_NORMAL,
-            (AV_Descr[index].Event_Enable & EVENT_ENABLE_TO_NORMAL) ? true
-                                                                    : false);
+            (pObject->Event_Enable & EVENT_ENABLE_TO_NORMAL) ? true : false);
         /* Event Priorities */
         Notification_Class_Get_Priorities(
-            AV_Descr[index].Notification_Class, getevent_data->eventPriorities);
+            pObject->Notification_Class, getevent_data->eventPriorities);
 
         return 1; /* active event */
     } else
@@ -1289,14 +1384,10 @@ int Analog_Value_Alarm_Ack(
     BACNET_ALARM_ACK_DATA *alarmack_data, BACNET_ERROR_CODE *error_code)
 {
     ANALOG_VALUE_DESCR *CurrentAV;
-    unsigned int object_index;
 
-    object_index = Analog_Value_Instance_To_Index(
-        alarmack_data->eventObjectIdentifier.instance);
-
-    if (object_index < MAX_ANALOG_VALUES)
-        CurrentAV = &AV_Descr[object_index];
-    else {
+    CurrentAV = Keyhash_Data(
+        Object_List, alarmack_data->eventObjectIdentifier.instance);
+    if (!CurrentAV) {
         *error_code = ERROR_CODE_UNKNOWN_OBJECT;
         return -1;
     }
@@ -1391,35 +1482,32 @@ int Analog_Value_Alarm_Ack(
 int Analog_Value_Alarm_Summary(
     unsigned index, BACNET_GET_ALARM_SUMMARY_DATA *getalarm_data)
 {
+    ANALOG_VALUE_DESCR *pObject = NULL;
+
     /* check index */
-    if (index < MAX_ANALOG_VALUES) {
+    pObject = Keyhash_Data_Index(Object_List, (int)index);
+    if (pObject) {
         /* Event_State is not equal to NORMAL  and
            Notify_Type property value is ALARM */
-        if ((AV_Descr[index].Event_State != EVENT_STATE_NORMAL) &&
-            (AV_Descr[index].Notify_Type == NOTIFY_ALARM)) {
+        if ((pObject->Event_State != EVENT_STATE_NORMAL) &&
+            (pObject->Notify_Type == NOTIFY_ALARM)) {
             /* Object Identifier */
             getalarm_data->objectIdentifier.type = OBJECT_ANALOG_VALUE;
             getalarm_data->objectIdentifier.instance =
                 Analog_Value_Index_To_Instance(index);
             /* Alarm State */
-            getalarm_data->alarmState = AV_Descr[index].Event_State;
+            getalarm_data->alarmState = pObject->Event_State;
             /* Acknowledged Transitions */
             bitstring_init(&getalarm_data->acknowledgedTransitions);
             bitstring_set_bit(&getalarm_data->acknowledgedTransitions,
                 TRANSITION_TO_OFFNORMAL,
-                AV_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_OFFNORMAL]
-                    .bIsAcked);
+                pObject->Acked_Transitions[TRANSITION_TO_OFFNORMAL].bIsAcked);
             bitstring_set_bit(&getalarm_data->acknowledgedTransitions,
                 TRANSITION_TO_FAULT,
-                AV_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_FAULT]
-                    .bIsAcked);
+                pObject->Acked_Transitions[TRANSITION_TO_FAULT].bIsAcked);
             bitstring_set_bit(&getalarm_data->acknowledgedTransitions,
                 TRANSITION_TO_NORMAL,
-                AV_Descr[index]
-                    .Acked_Transitions[TRANSITION_TO_NORMAL]
-                    .bIsAcked);
+                pObject->Acked_Transitions[TRANSITION_TO_NORMAL].bIsAcked);
 
             return 1; /* active alarm */
         } else
@@ -375,13 +375,18 @@ uint32_t bacfile_instance(char *filename)
 /* invokeID and file instance in a list or table */
 /* when the request was sent */
 uint32_t bacfile_instance_from_tsm(uint8_t invokeID)
+{
+    return bacfile_instance_from_tsm_peer(NULL, invokeID);
+}
+
+/* the same, for the request to the device that acknowledged it */
+uint32_t bacfile_instance_from_tsm_peer(BACNET_ADDRESS *src, uint8_t invokeID)
 {
     BACNET_NPDU_DATA npdu_data = { 0 }; /* dummy for getting npdu length */
     BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
     uint8_t service_choice = 0;
     uint8_t *service_request = NULL;
     uint16_t service_request_len = 0;
-    BACNET_ADDRESS dest; /* where the original packet was destined */
     uint8_t apdu[MAX_PDU] = { 0 }; /* original APDU packet */
     uint16_t apdu_len = 0; /* original APDU packet length */
     int len = 0; /* apdu header length */
@@ -389,8 +394,8 @@ uint32_t bacfile_instance_from_tsm(uint8_t invokeID)
     uint32_t object_instance = BACNET_MAX_INSTANCE + 1; /* return value */
     bool found = false;
 
-    found = tsm_get_transaction_pdu(
-        invokeID, &dest, &npdu_data, &apdu[0], &apdu_len);
+    found = tsm_get_transaction_pdu_peer(
+        src, invokeID, &npdu_data, &apdu[0], &apdu_len);
     if (found) {
         if (!npdu_data.network_layer_message &&
             npdu_data.data_expecting_reply &&
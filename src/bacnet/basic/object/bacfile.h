@@ -82,6 +82,10 @@ extern "C" {
     BACNET_STACK_EXPORT
     uint32_t bacfile_instance_from_tsm(
         uint8_t invokeID);
+    BACNET_STACK_EXPORT
+    uint32_t bacfile_instance_from_tsm_peer(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
 
     /* handler ACK helper */
     BACNET_STACK_EXPORT
@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacenum.h"
@@ -37,20 +38,29 @@
 #include "bacnet/cov.h"
 #include "bacnet/config.h" /* the custom stuff */
 #include "bacnet/basic/object/bi.h"
+#include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/keyhash.h"
 
+/* number of objects created by Binary_Input_Init() */
 #ifndef MAX_BINARY_INPUTS
 #define MAX_BINARY_INPUTS 5
 #endif
 
-/* stores the current value */
-static BACNET_BINARY_PV Present_Value[MAX_BINARY_INPUTS];
-/* out of service decouples physical input from Present_Value */
-static bool Out_Of_Service[MAX_BINARY_INPUTS];
-/* Change of Value flag */
-static bool Change_Of_Value[MAX_BINARY_INPUTS];
-/* Polarity of Input */
-static BACNET_POLARITY Polarity[MAX_BINARY_INPUTS];
+struct binary_input_descr {
+    /* stores the current value */
+    BACNET_BINARY_PV Present_Value;
+    /* out of service decouples physical input from Present_Value */
+    bool Out_Of_Service;
+    /* Change of Value flag */
+    bool Change_Of_Value;
+    /* Polarity of Input */
+    BACNET_POLARITY Polarity;
+};
+/* the objects, keyed by object instance */
+static OS_Keyhash Object_List;
+/* we need to have our objects created before answering any calls */
+static bool Binary_Input_Initialized = false;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Input_Properties_Required[] = { PROP_OBJECT_IDENTIFIER,
@@ -77,73 +87,195 @@ void Binary_Input_Property_Lists(
     return;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need validate that the */
-/* given instance exists */
-bool Binary_Input_Valid_Instance(uint32_t object_instance)
+/**
+ * Allocates and initializes a Binary Input object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  the new object, or NULL if out of memory
+ */
+static struct binary_input_descr *Binary_Input_Object_Create(
+    uint32_t object_instance)
+{
+    struct binary_input_descr *pObject = NULL;
+
+    if (!Object_List) {
+        Object_List = Keyhash_Create();
+    }
+    pObject = calloc(1, sizeof(struct binary_input_descr));
+    if (!pObject) {
+        return NULL;
+    }
+    pObject->Present_Value = BINARY_INACTIVE;
+    pObject->Out_Of_Service = false;
+    pObject->Change_Of_Value = false;
+    pObject->Polarity = POLARITY_NORMAL;
+    if (Keyhash_Data_Add(Object_List, object_instance, pObject) < 0) {
+        free(pObject);
+        return NULL;
+    }
+
+    return pObject;
+}
+
+/**
+ * Creates a Binary Input object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object exists or was created
+ */
+bool Binary_Input_Create(uint32_t object_instance)
+{
+    if (object_instance >= BACNET_MAX_INSTANCE) {
+        return false;
+    }
+    if (Keyhash_Data(Object_List, object_instance)) {
+        return true;
+    }
+    if (!Binary_Input_Object_Create(object_instance)) {
+        return false;
+    }
+    Device_Object_List_Changed();
+    Device_Inc_Database_Revision();
+
+    return true;
+}
+
+/**
+ * Deletes a Binary Input object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object was deleted
+ */
+bool Binary_Input_Delete(uint32_t object_instance)
 {
-    if (object_instance < MAX_BINARY_INPUTS) {
+    struct binary_input_descr *pObject = NULL;
+
+    pObject = Keyhash_Data_Delete(Object_List, object_instance);
+    if (pObject) {
+        free(pObject);
+        Device_Object_List_Changed();
+        Device_Inc_Database_Revision();
         return true;
     }
 
     return false;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then count how many you have */
+/**
+ * Deletes all the Binary Input objects
+ */
+void Binary_Input_Cleanup(void)
+{
+    struct binary_input_descr *pObject = NULL;
+
+    if (Object_List) {
+        while (Keyhash_Count(Object_List) > 0) {
+            pObject = Keyhash_Data_Delete_By_Index(Object_List, 0);
+            free(pObject);
+        }
+        Keyhash_Delete(Object_List);
+        Object_List = NULL;
+        Device_Object_List_Changed();
+    }
+    Binary_Input_Initialized = false;
+}
+
+/**
+ * Determines if a given Binary Input instance is valid
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the instance is valid, and false if not
+ */
+bool Binary_Input_Valid_Instance(uint32_t object_instance)
+{
+    return (Keyhash_Data(Object_List, object_instance) != NULL);
+}
+
+/**
+ * Determines the number of Binary Input objects
+ *
+ * @return  Number of Binary Input objects
+ */
 unsigned Binary_Input_Count(void)
 {
-    return MAX_BINARY_INPUTS;
+    return (unsigned)Keyhash_Count(Object_List);
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the instance */
-/* that correlates to the correct index */
+/**
+ * Determines the object instance-number for a given 0..N index
+ * of Binary Input objects where N is Binary_Input_Count().
+ *
+ * @param  index - 0..N where N is Binary_Input_Count()
+ *
+ * @return  object instance-number for the given index,
+ *          or BACNET_MAX_INSTANCE if the index is not valid
+ */
 uint32_t Binary_Input_Index_To_Instance(unsigned index)
 {
-    return index;
+    if (index < Binary_Input_Count()) {
+        return Keyhash_Key(Object_List, (int)index);
+    }
+
+    return BACNET_MAX_INSTANCE;
 }
 
-void Binary_Input_Init(void)
+/**
+ * For a given object instance-number, determines a 0..N index
+ * of Binary Input objects where N is Binary_Input_Count().
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  index for the given instance-number, or Binary_Input_Count()
+ *          if the instance is not valid.
+ */
+unsigned Binary_Input_Instance_To_Index(uint32_t object_instance)
 {
-    static bool initialized = false;
-    unsigned i;
-
-    if (!initialized) {
-        initialized = true;
+    int index;
 
-        /* initialize all the values */
-        for (i = 0; i < MAX_BINARY_INPUTS; i++) {
-            Present_Value[i] = BINARY_INACTIVE;
-        }
+    index = Keyhash_Index(Object_List, object_instance);
+    if (index < 0) {
+        return Binary_Input_Count();
     }
 
-    return;
+    return (unsigned)index;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the index */
-/* that correlates to the correct instance number */
-unsigned Binary_Input_Instance_To_Index(uint32_t object_instance)
+/**
+ * Initializes the Binary Input objects, creating MAX_BINARY_INPUTS
+ * objects with instances 0 to MAX_BINARY_INPUTS-1.
+ */
+void Binary_Input_Init(void)
 {
-    unsigned index = MAX_BINARY_INPUTS;
+    unsigned i;
 
-    if (object_instance < MAX_BINARY_INPUTS) {
-        index = object_instance;
+    if (!Binary_Input_Initialized) {
+        Binary_Input_Initialized = true;
+        if (!Object_List) {
+            Object_List = Keyhash_Create();
+        }
+        for (i = 0; i < MAX_BINARY_INPUTS; i++) {
+            if (!Keyhash_Data(Object_List, i)) {
+                (void)Binary_Input_Object_Create(i);
+            }
+        }
     }
 
-    return index;
+    return;
 }
 
 BACNET_BINARY_PV Binary_Input_Present_Value(uint32_t object_instance)
 {
     BACNET_BINARY_PV value = BINARY_INACTIVE;
-    unsigned index = 0;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        value = Present_Value[index];
-        if (Polarity[index] != POLARITY_NORMAL) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Present_Value;
+        if (pObject->Polarity != POLARITY_NORMAL) {
             if (value == BINARY_INACTIVE) {
                 value = BINARY_ACTIVE;
             } else {
@@ -158,11 +290,11 @@ BACNET_BINARY_PV Binary_Input_Present_Value(uint32_t object_instance)
 bool Binary_Input_Out_Of_Service(uint32_t object_instance)
 {
     bool value = false;
-    unsigned index = 0;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        value = Out_Of_Service[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Out_Of_Service;
     }
 
     return value;
@@ -171,11 +303,11 @@ bool Binary_Input_Out_Of_Service(uint32_t object_instance)
 bool Binary_Input_Change_Of_Value(uint32_t object_instance)
 {
     bool status = false;
-    unsigned index;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        status = Change_Of_Value[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        status = pObject->Change_Of_Value;
     }
 
     return status;
@@ -183,11 +315,11 @@ bool Binary_Input_Change_Of_Value(uint32_t object_instance)
 
 void Binary_Input_Change_Of_Value_Clear(uint32_t object_instance)
 {
-    unsigned index;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        Change_Of_Value[index] = false;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pObject->Change_Of_Value = false;
     }
 
     return;
@@ -248,22 +380,23 @@ bool Binary_Input_Encode_Value_List(
 bool Binary_Input_Present_Value_Set(
     uint32_t object_instance, BACNET_BINARY_PV value)
 {
-    unsigned index = 0;
+    struct binary_input_descr *pObject = NULL;
     bool status = false;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        if (Polarity[index] != POLARITY_NORMAL) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        if (pObject->Polarity != POLARITY_NORMAL) {
             if (value == BINARY_INACTIVE) {
                 value = BINARY_ACTIVE;
             } else {
                 value = BINARY_INACTIVE;
             }
         }
-        if (Present_Value[index] != value) {
-            Change_Of_Value[index] = true;
+        if (pObject->Present_Value != value) {
+            pObject->Change_Of_Value = true;
+            handler_cov_object_changed(OBJECT_BINARY_INPUT, object_instance);
         }
-        Present_Value[index] = value;
+        pObject->Present_Value = value;
         status = true;
     }
 
@@ -272,14 +405,15 @@ bool Binary_Input_Present_Value_Set(
 
 void Binary_Input_Out_Of_Service_Set(uint32_t object_instance, bool value)
 {
-    unsigned index = 0;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        if (Out_Of_Service[index] != value) {
-            Change_Of_Value[index] = true;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        if (pObject->Out_Of_Service != value) {
+            pObject->Change_Of_Value = true;
+            handler_cov_object_changed(OBJECT_BINARY_INPUT, object_instance);
         }
-        Out_Of_Service[index] = value;
+        pObject->Out_Of_Service = value;
     }
 
     return;
@@ -290,10 +424,10 @@ bool Binary_Input_Object_Name(
 {
     static char text_string[32] = ""; /* okay for single thread */
     bool status = false;
-    unsigned index = 0;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         sprintf(
             text_string, "BINARY INPUT %lu", (unsigned long)object_instance);
         status = characterstring_init_ansi(object_name, text_string);
@@ -305,11 +439,11 @@ bool Binary_Input_Object_Name(
 BACNET_POLARITY Binary_Input_Polarity(uint32_t object_instance)
 {
     BACNET_POLARITY polarity = POLARITY_NORMAL;
-    unsigned index = 0;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        polarity = Polarity[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        polarity = pObject->Polarity;
     }
 
     return polarity;
@@ -319,11 +453,11 @@ bool Binary_Input_Polarity_Set(
     uint32_t object_instance, BACNET_POLARITY polarity)
 {
     bool status = false;
-    unsigned index = 0;
+    struct binary_input_descr *pObject = NULL;
 
-    index = Binary_Input_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_INPUTS) {
-        Polarity[index] = polarity;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pObject->Polarity = polarity;
     }
 
     return status;
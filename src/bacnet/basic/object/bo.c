@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacenum.h"
@@ -36,8 +37,11 @@
 #include "bacnet/rp.h"
 #include "bacnet/wp.h"
 #include "bacnet/basic/object/bo.h"
+#include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/keyhash.h"
 
+/* number of objects created by Binary_Output_Init() */
 #ifndef MAX_BINARY_OUTPUTS
 #define MAX_BINARY_OUTPUTS 4
 #endif
@@ -45,12 +49,17 @@
 /* When all the priorities are level null, the present value returns */
 /* the Relinquish Default value */
 #define RELINQUISH_DEFAULT BINARY_INACTIVE
-/* Here is our Priority Array.*/
-static BACNET_BINARY_PV Binary_Output_Level[MAX_BINARY_OUTPUTS]
-                                           [BACNET_MAX_PRIORITY];
-/* Writable out-of-service allows others to play with our Present Value */
-/* without changing the physical output */
-static bool Out_Of_Service[MAX_BINARY_OUTPUTS];
+struct binary_output_descr {
+    /* Here is our Priority Array.*/
+    BACNET_BINARY_PV Level[BACNET_MAX_PRIORITY];
+    /* Writable out-of-service allows others to play with our Present Value */
+    /* without changing the physical output */
+    bool Out_Of_Service;
+};
+/* the objects, keyed by object instance */
+static OS_Keyhash Object_List;
+/* we need to have our objects created before answering any calls */
+static bool Binary_Output_Initialized = false;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Output_Properties_Required[] = { PROP_OBJECT_IDENTIFIER,
@@ -79,77 +88,199 @@ void Binary_Output_Property_Lists(
     return;
 }
 
-void Binary_Output_Init(void)
+/**
+ * Allocates and initializes a Binary Output object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  the new object, or NULL if out of memory
+ */
+static struct binary_output_descr *Binary_Output_Object_Create(
+    uint32_t object_instance)
 {
-    unsigned i, j;
-    static bool initialized = false;
+    struct binary_output_descr *pObject = NULL;
+    unsigned j;
 
-    if (!initialized) {
-        initialized = true;
+    if (!Object_List) {
+        Object_List = Keyhash_Create();
+    }
+    pObject = calloc(1, sizeof(struct binary_output_descr));
+    if (!pObject) {
+        return NULL;
+    }
+    /* initialize the priority array to NULL */
+    for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
+        pObject->Level[j] = BINARY_NULL;
+    }
+    pObject->Out_Of_Service = false;
+    if (Keyhash_Data_Add(Object_List, object_instance, pObject) < 0) {
+        free(pObject);
+        return NULL;
+    }
 
-        /* initialize all the analog output priority arrays to NULL */
-        for (i = 0; i < MAX_BINARY_OUTPUTS; i++) {
-            for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
-                Binary_Output_Level[i][j] = BINARY_NULL;
-            }
-        }
+    return pObject;
+}
+
+/**
+ * Creates a Binary Output object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object exists or was created
+ */
+bool Binary_Output_Create(uint32_t object_instance)
+{
+    if (object_instance >= BACNET_MAX_INSTANCE) {
+        return false;
+    }
+    if (Keyhash_Data(Object_List, object_instance)) {
+        return true;
+    }
+    if (!Binary_Output_Object_Create(object_instance)) {
+        return false;
     }
+    Device_Object_List_Changed();
+    Device_Inc_Database_Revision();
 
-    return;
+    return true;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need validate that the */
-/* given instance exists */
-bool Binary_Output_Valid_Instance(uint32_t object_instance)
+/**
+ * Deletes a Binary Output object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object was deleted
+ */
+bool Binary_Output_Delete(uint32_t object_instance)
 {
-    if (object_instance < MAX_BINARY_OUTPUTS) {
+    struct binary_output_descr *pObject = NULL;
+
+    pObject = Keyhash_Data_Delete(Object_List, object_instance);
+    if (pObject) {
+        free(pObject);
+        Device_Object_List_Changed();
+        Device_Inc_Database_Revision();
         return true;
     }
 
     return false;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then count how many you have */
+/**
+ * Deletes all the Binary Output objects
+ */
+void Binary_Output_Cleanup(void)
+{
+    struct binary_output_descr *pObject = NULL;
+
+    if (Object_List) {
+        while (Keyhash_Count(Object_List) > 0) {
+            pObject = Keyhash_Data_Delete_By_Index(Object_List, 0);
+            free(pObject);
+        }
+        Keyhash_Delete(Object_List);
+        Object_List = NULL;
+        Device_Object_List_Changed();
+    }
+    Binary_Output_Initialized = false;
+}
+
+/**
+ * Determines if a given Binary Output instance is valid
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the instance is valid, and false if not
+ */
+bool Binary_Output_Valid_Instance(uint32_t object_instance)
+{
+    return (Keyhash_Data(Object_List, object_instance) != NULL);
+}
+
+/**
+ * Determines the number of Binary Output objects
+ *
+ * @return  Number of Binary Output objects
+ */
 unsigned Binary_Output_Count(void)
 {
-    return MAX_BINARY_OUTPUTS;
+    return (unsigned)Keyhash_Count(Object_List);
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the instance */
-/* that correlates to the correct index */
+/**
+ * Determines the object instance-number for a given 0..N index
+ * of Binary Output objects where N is Binary_Output_Count().
+ *
+ * @param  index - 0..N where N is Binary_Output_Count()
+ *
+ * @return  object instance-number for the given index,
+ *          or BACNET_MAX_INSTANCE if the index is not valid
+ */
 uint32_t Binary_Output_Index_To_Instance(unsigned index)
 {
-    return index;
+    if (index < Binary_Output_Count()) {
+        return Keyhash_Key(Object_List, (int)index);
+    }
+
+    return BACNET_MAX_INSTANCE;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the index */
-/* that correlates to the correct instance number */
+/**
+ * For a given object instance-number, determines a 0..N index
+ * of Binary Output objects where N is Binary_Output_Count().
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  index for the given instance-number, or Binary_Output_Count()
+ *          if the instance is not valid.
+ */
 unsigned Binary_Output_Instance_To_Index(uint32_t object_instance)
 {
-    unsigned index = MAX_BINARY_OUTPUTS;
+    int index;
 
-    if (object_instance < MAX_BINARY_OUTPUTS) {
-        index = object_instance;
+    index = Keyhash_Index(Object_List, object_instance);
+    if (index < 0) {
+        return Binary_Output_Count();
     }
 
-    return index;
+    return (unsigned)index;
+}
+
+/**
+ * Initializes the Binary Output objects, creating MAX_BINARY_OUTPUTS
+ * objects with instances 0 to MAX_BINARY_OUTPUTS-1.
+ */
+void Binary_Output_Init(void)
+{
+    unsigned i;
+
+    if (!Binary_Output_Initialized) {
+        Binary_Output_Initialized = true;
+        if (!Object_List) {
+            Object_List = Keyhash_Create();
+        }
+        for (i = 0; i < MAX_BINARY_OUTPUTS; i++) {
+            if (!Keyhash_Data(Object_List, i)) {
+                (void)Binary_Output_Object_Create(i);
+            }
+        }
+    }
+
+    return;
 }
 
 BACNET_BINARY_PV Binary_Output_Present_Value(uint32_t object_instance)
 {
     BACNET_BINARY_PV value = RELINQUISH_DEFAULT;
-    unsigned index = 0;
+    struct binary_output_descr *pObject = NULL;
     unsigned i = 0;
 
-    index = Binary_Output_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_OUTPUTS) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
-            if (Binary_Output_Level[index][i] != BINARY_NULL) {
-                value = Binary_Output_Level[index][i];
+            if (pObject->Level[i] != BINARY_NULL) {
+                value = pObject->Level[i];
                 break;
             }
         }
@@ -161,11 +292,11 @@ BACNET_BINARY_PV Binary_Output_Present_Value(uint32_t object_instance)
 bool Binary_Output_Out_Of_Service(uint32_t object_instance)
 {
     bool value = false;
-    unsigned index = 0;
+    struct binary_output_descr *pObject = NULL;
 
-    index = Binary_Output_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_OUTPUTS) {
-        value = Out_Of_Service[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Out_Of_Service;
     }
 
     return value;
@@ -178,7 +309,7 @@ bool Binary_Output_Object_Name(
     static char text_string[32] = ""; /* okay for single thread */
     bool status = false;
 
-    if (object_instance < MAX_BINARY_OUTPUTS) {
+    if (Binary_Output_Valid_Instance(object_instance)) {
         sprintf(
             text_string, "BINARY OUTPUT %lu", (unsigned long)object_instance);
         status = characterstring_init_ansi(object_name, text_string);
@@ -196,7 +327,7 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
     BACNET_CHARACTER_STRING char_string;
     BACNET_BINARY_PV present_value = BINARY_INACTIVE;
     BACNET_POLARITY polarity = POLARITY_NORMAL;
-    unsigned object_index = 0;
+    struct binary_output_descr *pObject = NULL;
     unsigned i = 0;
     bool state = false;
     uint8_t *apdu = NULL;
@@ -205,6 +336,12 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
         (rpdata->application_data_len == 0)) {
         return 0;
     }
+    pObject = Keyhash_Data(Object_List, rpdata->object_instance);
+    if (!pObject) {
+        rpdata->error_class = ERROR_CLASS_OBJECT;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return BACNET_STATUS_ERROR;
+    }
     apdu = rpdata->application_data;
     switch (rpdata->object_property) {
         case PROP_OBJECT_IDENTIFIER:
@@ -243,9 +380,7 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                 encode_application_enumerated(&apdu[0], EVENT_STATE_NORMAL);
             break;
         case PROP_OUT_OF_SERVICE:
-            object_index =
-                Binary_Output_Instance_To_Index(rpdata->object_instance);
-            state = Out_Of_Service[object_index];
+            state = pObject->Out_Of_Service;
             apdu_len = encode_application_boolean(&apdu[0], state);
             break;
         case PROP_POLARITY:
@@ -260,14 +395,12 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                  */
                 /* into one packet. */
             } else if (rpdata->array_index == BACNET_ARRAY_ALL) {
-                object_index =
-                    Binary_Output_Instance_To_Index(rpdata->object_instance);
                 for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
                     /* FIXME: check if we have room before adding it to APDU */
-                    if (Binary_Output_Level[object_index][i] == BINARY_NULL) {
+                    if (pObject->Level[i] == BINARY_NULL) {
                         len = encode_application_null(&apdu[apdu_len]);
                     } else {
-                        present_value = Binary_Output_Level[object_index][i];
+                        present_value = pObject->Level[i];
                         len = encode_application_enumerated(
                             &apdu[apdu_len], present_value);
                     }
@@ -282,16 +415,12 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                     }
                 }
             } else {
-                object_index =
-                    Binary_Output_Instance_To_Index(rpdata->object_instance);
                 if (rpdata->array_index <= BACNET_MAX_PRIORITY) {
-                    if (Binary_Output_Level[object_index][rpdata->array_index -
-                            1] == BINARY_NULL) {
+                    if (pObject->Level[rpdata->array_index - 1] ==
+                        BINARY_NULL) {
                         apdu_len = encode_application_null(&apdu[apdu_len]);
                     } else {
-                        present_value =
-                            Binary_Output_Level[object_index]
-                                               [rpdata->array_index - 1];
+                        present_value = pObject->Level[rpdata->array_index - 1];
                         apdu_len = encode_application_enumerated(
                             &apdu[apdu_len], present_value);
                     }
@@ -338,7 +467,7 @@ int Binary_Output_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
 bool Binary_Output_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
 {
     bool status = false; /* return value */
-    unsigned int object_index = 0;
+    struct binary_output_descr *pObject = NULL;
     unsigned int priority = 0;
     BACNET_BINARY_PV level = BINARY_NULL;
     int len = 0;
@@ -361,6 +490,12 @@ bool Binary_Output_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
         wp_data->error_code = ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY;
         return false;
     }
+    pObject = Keyhash_Data(Object_List, wp_data->object_instance);
+    if (!pObject) {
+        wp_data->error_class = ERROR_CLASS_OBJECT;
+        wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return false;
+    }
     switch (wp_data->object_property) {
         case PROP_PRESENT_VALUE:
             if (value.tag == BACNET_APPLICATION_TAG_ENUMERATED) {
@@ -372,10 +507,8 @@ bool Binary_Output_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                     (priority != 6 /* reserved */) &&
                     (value.type.Enumerated <= MAX_BINARY_PV)) {
                     level = (BACNET_BINARY_PV)value.type.Enumerated;
-                    object_index = Binary_Output_Instance_To_Index(
-                        wp_data->object_instance);
                     priority--;
-                    Binary_Output_Level[object_index][priority] = level;
+                    pObject->Level[priority] = level;
                     /* Note: you could set the physical output here if we
                        are the highest priority.
                        However, if Out of Service is TRUE, then don't set the
@@ -398,12 +531,10 @@ bool Binary_Output_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                     &wp_data->error_class, &wp_data->error_code);
                 if (status) {
                     level = BINARY_NULL;
-                    object_index = Binary_Output_Instance_To_Index(
-                        wp_data->object_instance);
                     priority = wp_data->priority;
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
-                        Binary_Output_Level[object_index][priority] = level;
+                        pObject->Level[priority] = level;
                         /* Note: you could set the physical output here to the
                            next highest priority, or to the relinquish default
                            if no priorities are set. However, if Out of Service
@@ -423,9 +554,7 @@ bool Binary_Output_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
             status = WPValidateArgType(&value, BACNET_APPLICATION_TAG_BOOLEAN,
                 &wp_data->error_class, &wp_data->error_code);
             if (status) {
-                object_index =
-                    Binary_Output_Instance_To_Index(wp_data->object_instance);
-                Out_Of_Service[object_index] = value.type.Boolean;
+                pObject->Out_Of_Service = value.type.Boolean;
             }
             break;
         case PROP_OBJECT_IDENTIFIER:
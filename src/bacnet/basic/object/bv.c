@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacenum.h"
@@ -36,8 +37,11 @@
 #include "bacnet/wp.h"
 #include "bacnet/rp.h"
 #include "bacnet/basic/object/bv.h"
+#include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/keyhash.h"
 
+/* number of objects created by Binary_Value_Init() */
 #ifndef MAX_BINARY_VALUES
 #define MAX_BINARY_VALUES 10
 #endif
@@ -45,12 +49,17 @@
 /* When all the priorities are level null, the present value returns */
 /* the Relinquish Default value */
 #define RELINQUISH_DEFAULT BINARY_INACTIVE
-/* Here is our Priority Array.*/
-static BACNET_BINARY_PV Binary_Value_Level[MAX_BINARY_VALUES]
-                                          [BACNET_MAX_PRIORITY];
-/* Writable out-of-service allows others to play with our Present Value */
-/* without changing the physical output */
-static bool Out_Of_Service[MAX_BINARY_VALUES];
+struct binary_value_descr {
+    /* Here is our Priority Array.*/
+    BACNET_BINARY_PV Level[BACNET_MAX_PRIORITY];
+    /* Writable out-of-service allows others to play with our Present Value */
+    /* without changing the physical output */
+    bool Out_Of_Service;
+};
+/* the objects, keyed by object instance */
+static OS_Keyhash Object_List;
+/* we need to have our objects created before answering any calls */
+static bool Binary_Value_Initialized = false;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Value_Properties_Required[] = { PROP_OBJECT_IDENTIFIER,
@@ -87,39 +96,78 @@ void Binary_Value_Property_Lists(
 }
 
 /**
- * Initialize the binary values.
+ * Allocates and initializes a Binary Value object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  the new object, or NULL if out of memory
  */
-void Binary_Value_Init(void)
+static struct binary_value_descr *Binary_Value_Object_Create(
+    uint32_t object_instance)
 {
-    unsigned i, j;
-    static bool initialized = false;
+    struct binary_value_descr *pObject = NULL;
+    unsigned j;
+
+    if (!Object_List) {
+        Object_List = Keyhash_Create();
+    }
+    pObject = calloc(1, sizeof(struct binary_value_descr));
+    if (!pObject) {
+        return NULL;
+    }
+    /* initialize the priority array to NULL */
+    for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
+        pObject->Level[j] = BINARY_NULL;
+    }
+    pObject->Out_Of_Service = false;
+    if (Keyhash_Data_Add(Object_List, object_instance, pObject) < 0) {
+        free(pObject);
+        return NULL;
+    }
 
-    if (!initialized) {
-        initialized = true;
+    return pObject;
+}
 
-        /* initialize all the analog output priority arrays to NULL */
-        for (i = 0; i < MAX_BINARY_VALUES; i++) {
-            for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
-                Binary_Value_Level[i][j] = BINARY_NULL;
-            }
-        }
+/**
+ * Creates a Binary Value object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object exists or was created
+ */
+bool Binary_Value_Create(uint32_t object_instance)
+{
+    if (object_instance >= BACNET_MAX_INSTANCE) {
+        return false;
+    }
+    if (Keyhash_Data(Object_List, object_instance)) {
+        return true;
+    }
+    if (!Binary_Value_Object_Create(object_instance)) {
+        return false;
     }
+    Device_Object_List_Changed();
+    Device_Inc_Database_Revision();
 
-    return;
+    return true;
 }
 
 /**
- * We simply have 0-n object instances. Yours might be
- * more complex, and then you need validate that the
- * given instance exists.
+ * Deletes a Binary Value object
  *
- * @param object_instance Object instance
+ * @param  object_instance - object-instance number of the object
  *
- * @return true/false
+ * @return  true if the object was deleted
  */
-bool Binary_Value_Valid_Instance(uint32_t object_instance)
+bool Binary_Value_Delete(uint32_t object_instance)
 {
-    if (object_instance < MAX_BINARY_VALUES) {
+    struct binary_value_descr *pObject = NULL;
+
+    pObject = Keyhash_Data_Delete(Object_List, object_instance);
+    if (pObject) {
+        free(pObject);
+        Device_Object_List_Changed();
+        Device_Inc_Database_Revision();
         return true;
     }
 
@@ -127,47 +175,106 @@ bool Binary_Value_Valid_Instance(uint32_t object_instance)
 }
 
 /**
- * Return the count of analog values.
+ * Deletes all the Binary Value objects
+ */
+void Binary_Value_Cleanup(void)
+{
+    struct binary_value_descr *pObject = NULL;
+
+    if (Object_List) {
+        while (Keyhash_Count(Object_List) > 0) {
+            pObject = Keyhash_Data_Delete_By_Index(Object_List, 0);
+            free(pObject);
+        }
+        Keyhash_Delete(Object_List);
+        Object_List = NULL;
+        Device_Object_List_Changed();
+    }
+    Binary_Value_Initialized = false;
+}
+
+/**
+ * Determines if a given Binary Value instance is valid
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the instance is valid, and false if not
+ */
+bool Binary_Value_Valid_Instance(uint32_t object_instance)
+{
+    return (Keyhash_Data(Object_List, object_instance) != NULL);
+}
+
+/**
+ * Determines the number of Binary Value objects
  *
- * @return Count of binary values.
+ * @return  Number of Binary Value objects
  */
 unsigned Binary_Value_Count(void)
 {
-    return MAX_BINARY_VALUES;
+    return (unsigned)Keyhash_Count(Object_List);
 }
 
 /**
- * We simply have 0-n object instances.  Yours might be
- * more complex, and then you need to return the instance
- * that correlates to the correct index.
+ * Determines the object instance-number for a given 0..N index
+ * of Binary Value objects where N is Binary_Value_Count().
  *
- * @param index Index
+ * @param  index - 0..N where N is Binary_Value_Count()
  *
- * @return Object instance
+ * @return  object instance-number for the given index,
+ *          or BACNET_MAX_INSTANCE if the index is not valid
  */
 uint32_t Binary_Value_Index_To_Instance(unsigned index)
 {
-    return index;
+    if (index < Binary_Value_Count()) {
+        return Keyhash_Key(Object_List, (int)index);
+    }
+
+    return BACNET_MAX_INSTANCE;
 }
 
 /**
- * We simply have 0-n object instances. Yours might be
- * more complex, and then you need to return the index
- * that correlates to the correct instance number
+ * For a given object instance-number, determines a 0..N index
+ * of Binary Value objects where N is Binary_Value_Count().
  *
- * @param object_instance Object instance
+ * @param  object_instance - object-instance number of the object
  *
- * @return Index in the object table.
+ * @return  index for the given instance-number, or Binary_Value_Count()
+ *          if the instance is not valid.
  */
 unsigned Binary_Value_Instance_To_Index(uint32_t object_instance)
 {
-    unsigned index = MAX_BINARY_VALUES;
+    int index;
 
-    if (object_instance < MAX_BINARY_VALUES) {
-        index = object_instance;
+    index = Keyhash_Index(Object_List, object_instance);
+    if (index < 0) {
+        return Binary_Value_Count();
     }
 
-    return index;
+    return (unsigned)index;
+}
+
+/**
+ * Initializes the Binary Value objects, creating MAX_BINARY_VALUES
+ * objects with instances 0 to MAX_BINARY_VALUES-1.
+ */
+void Binary_Value_Init(void)
+{
+    unsigned i;
+
+    if (!Binary_Value_Initialized) {
+        Binary_Value_Initialized = true;
+        if (!Object_List) {
+            Object_List = Keyhash_Create();
+        }
+        for (i = 0; i < MAX_BINARY_VALUES; i++) {
+            if (!Keyhash_Data(Object_List, i)) {
+                (void)Binary_Value_Object_Create(i);
+            }
+        }
+    }
+
+    return;
 }
 
 /**
@@ -180,14 +287,14 @@ unsigned Binary_Value_Instance_To_Index(uint32_t object_instance)
 BACNET_BINARY_PV Binary_Value_Present_Value(uint32_t object_instance)
 {
     BACNET_BINARY_PV value = RELINQUISH_DEFAULT;
-    unsigned index = 0;
+    struct binary_value_descr *pObject = NULL;
     unsigned i = 0;
 
-    index = Binary_Value_Instance_To_Index(object_instance);
-    if (index < MAX_BINARY_VALUES) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
-            if (Binary_Value_Level[index][i] != BINARY_NULL) {
-                value = Binary_Value_Level[index][i];
+            if (pObject->Level[i] != BINARY_NULL) {
+                value = pObject->Level[i];
                 break;
             }
         }
@@ -212,7 +319,7 @@ bool Binary_Value_Object_Name(
     static char text_string[32] = ""; /* okay for single thread */
     bool status = false;
 
-    if (object_instance < MAX_BINARY_VALUES) {
+    if (Binary_Value_Valid_Instance(object_instance)) {
         sprintf(
             text_string, "BINARY VALUE %lu", (unsigned long)object_instance);
         status = characterstring_init_ansi(object_name, text_string);
@@ -230,12 +337,12 @@ bool Binary_Value_Object_Name(
  */
 bool Binary_Value_Out_Of_Service(uint32_t instance)
 {
-    unsigned index = 0;
+    struct binary_value_descr *pObject = NULL;
     bool oos_flag = false;
 
-    index = Binary_Value_Instance_To_Index(instance);
-    if (index < MAX_BINARY_VALUES) {
-        oos_flag = Out_Of_Service[index];
+    pObject = Keyhash_Data(Object_List, instance);
+    if (pObject) {
+        oos_flag = pObject->Out_Of_Service;
     }
 
     return oos_flag;
@@ -249,11 +356,11 @@ bool Binary_Value_Out_Of_Service(uint32_t instance)
  */
 void Binary_Value_Out_Of_Service_Set(uint32_t instance, bool oos_flag)
 {
-    unsigned index = 0;
+    struct binary_value_descr *pObject = NULL;
 
-    index = Binary_Value_Instance_To_Index(instance);
-    if (index < MAX_BINARY_VALUES) {
-        Out_Of_Service[index] = oos_flag;
+    pObject = Keyhash_Data(Object_List, instance);
+    if (pObject) {
+        pObject->Out_Of_Service = oos_flag;
     }
 }
 
@@ -271,7 +378,7 @@ int Binary_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
     BACNET_BIT_STRING bit_string;
     BACNET_CHARACTER_STRING char_string;
     BACNET_BINARY_PV present_value = BINARY_INACTIVE;
-    unsigned object_index = 0;
+    struct binary_value_descr *pObject = NULL;
     unsigned i = 0;
     bool state = false;
     uint8_t *apdu = NULL;
@@ -285,9 +392,9 @@ int Binary_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
         return 0;
     }
 
-    /* Valid object index? */
-    object_index = Binary_Value_Instance_To_Index(rpdata->object_instance);
-    if (object_index >= MAX_BINARY_VALUES) {
+    /* Valid object? */
+    pObject = Keyhash_Data(Object_List, rpdata->object_instance);
+    if (!pObject) {
         rpdata->error_class = ERROR_CLASS_OBJECT;
         rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
         return BACNET_STATUS_ERROR;
@@ -347,10 +454,10 @@ int Binary_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
             } else if (rpdata->array_index == BACNET_ARRAY_ALL) {
                 for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
                     /* FIXME: check if we have room before adding it to APDU */
-                    if (Binary_Value_Level[object_index][i] == BINARY_NULL) {
+                    if (pObject->Level[i] == BINARY_NULL) {
                         len = encode_application_null(&apdu[apdu_len]);
                     } else {
-                        present_value = Binary_Value_Level[object_index][i];
+                        present_value = pObject->Level[i];
                         len = encode_application_enumerated(
                             &apdu[apdu_len], present_value);
                     }
@@ -366,12 +473,10 @@ int Binary_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
                 }
             } else {
                 if (rpdata->array_index <= BACNET_MAX_PRIORITY) {
-                    if (Binary_Value_Level[object_index][rpdata->array_index] ==
-                        BINARY_NULL) {
+                    if (pObject->Level[rpdata->array_index] == BINARY_NULL) {
                         apdu_len = encode_application_null(&apdu[apdu_len]);
                     } else {
-                        present_value = Binary_Value_Level[object_index]
-                                                          [rpdata->array_index];
+                        present_value = pObject->Level[rpdata->array_index];
                         apdu_len = encode_application_enumerated(
                             &apdu[apdu_len], present_value);
                     }
@@ -415,7 +520,7 @@ int Binary_Value_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
 bool Binary_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
 {
     bool status = false; /* return value */
-    unsigned int object_index = 0;
+    struct binary_value_descr *pObject = NULL;
     unsigned int priority = 0;
     BACNET_BINARY_PV level = BINARY_NULL;
     int len = 0;
@@ -447,9 +552,9 @@ bool Binary_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
         return false;
     }
 
-    /* Valid object index? */
-    object_index = Binary_Value_Instance_To_Index(wp_data->object_instance);
-    if (object_index >= MAX_BINARY_VALUES) {
+    /* Valid object? */
+    pObject = Keyhash_Data(Object_List, wp_data->object_instance);
+    if (!pObject) {
         wp_data->error_class = ERROR_CLASS_OBJECT;
         wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
         return false;
@@ -467,7 +572,7 @@ bool Binary_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                     (value.type.Enumerated <= MAX_BINARY_PV)) {
                     level = (BACNET_BINARY_PV)value.type.Enumerated;
                     priority--;
-                    Binary_Value_Level[object_index][priority] = level;
+                    pObject->Level[priority] = level;
                     /* Note: you could set the physical output here if we
                        are the highest priority.
                        However, if Out of Service is TRUE, then don't set the
@@ -493,7 +598,7 @@ bool Binary_Value_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
                     priority = wp_data->priority;
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
-                        Binary_Value_Level[object_index][priority] = level;
+                        pObject->Level[priority] = level;
                         /* Note: you could set the physical output here to the
                            next highest priority, or to the relinquish default
                            if no priorities are set. However, if Out of Service
@@ -134,6 +134,9 @@ static object_functions_t Object_Table[] = {
         NULL /* COV */, NULL /* COV Clear */,
         NULL /* Intrinsic Reporting */ }
 };
+/* position+1 of each object type in the Object_Table, 0 if not present.
+   Built by Device_Init() so that lookups do not walk the table. */
+static uint8_t Object_Table_Index[MAX_BACNET_OBJECT_TYPE];
 
 /** Glue function to let the Device object, when called by a handler,
  * lookup which Object type needs to be invoked.
@@ -145,20 +148,38 @@ static object_functions_t Object_Table[] = {
  */
 static struct object_functions *Device_Objects_Find_Functions(
     BACNET_OBJECT_TYPE Object_Type)
+{
+    unsigned index = 0;
+
+    if (Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        index = Object_Table_Index[Object_Type];
+        if (index) {
+            return (&Object_Table[index - 1]);
+        }
+    }
+
+    return (NULL);
+}
+
+/** Build the direct-indexed lookup of the object types in the Object_Table.
+ * The first entry of a type wins, as it did with the table walk.
+ * @ingroup ObjHelpers
+ */
+static void Device_Objects_Index_Build(void)
 {
     struct object_functions *pObject = NULL;
+    unsigned index = 0;
 
+    memset(Object_Table_Index, 0, sizeof(Object_Table_Index));
     pObject = &Object_Table[0];
-    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
-        /* handle each object type */
-        if (pObject->Object_Type == Object_Type) {
-            return (pObject);
+    while ((pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) &&
+        (index < UINT8_MAX)) {
+        if (Object_Table_Index[pObject->Object_Type] == 0) {
+            Object_Table_Index[pObject->Object_Type] = (uint8_t)(index + 1);
         }
-
+        index++;
         pObject++;
     }
-
-    return (NULL);
 }
 
 /** For a given object type, returns the special property list.
@@ -519,6 +540,16 @@ void Device_Inc_Database_Revision(void)
     Database_Revision++;
 }
 
+/* there is no Object_List cache to keep up to date */
+void Device_Object_List_Changed(void)
+{
+}
+
+/* there is no object name index to keep up to date */
+void Device_Object_Name_Changed(void)
+{
+}
+
 /** Get the total count of objects supported by this Device Object.
  * @note Since many network clients depend on the object list
  *       for discovery, it must be consistent!
@@ -1058,6 +1089,7 @@ void Device_Init(object_functions_t *object_table)
     datetime_init();
     /* we don't use the object table passed in */
     (void)object_table;
+    Device_Objects_Index_Build();
     pObject = &Object_Table[0];
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         if (pObject->Object_Init) {
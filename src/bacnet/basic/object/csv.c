@@ -37,6 +37,7 @@
 #include "bacnet/rp.h"
 #include "bacnet/wp.h"
 #include "bacnet/basic/object/csv.h"
+#include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
 
 /* number of demo objects */
@@ -363,6 +364,9 @@ bool CharacterString_Value_Name_Set(uint32_t object_instance, char *new_name)
         } else {
             memset(&Object_Name[index][0], 0, sizeof(Object_Name[index]));
         }
+        /* a new object name is a change to the device database */
+        Device_Object_Name_Changed();
+        Device_Inc_Database_Revision();
     }
 
     return status;
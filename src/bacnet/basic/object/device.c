@@ -28,6 +28,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h> /* for memmove */
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
@@ -44,6 +45,7 @@
 #include "bacnet/basic/services.h"
 #include "bacnet/datalink/datalink.h"
 #include "bacnet/basic/binding/address.h"
+#include "bacnet/basic/sys/keyhash.h"
 /* include the device object */
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/object/acc.h"
@@ -88,6 +90,9 @@ extern bool Routed_Device_Write_Property_Local(
 
 /* may be overridden by outside table */
 static object_functions_t *Object_Table;
+/* position+1 of each object type in the Object_Table, 0 if not present.
+   Built by Device_Init() so that lookups do not walk the table. */
+static uint8_t Object_Table_Index[MAX_BACNET_OBJECT_TYPE];
 
 static object_functions_t My_Object_Table[] = {
     { OBJECT_DEVICE, NULL /* Init - don't init Device or it will recourse! */,
@@ -96,14 +101,15 @@ static object_functions_t My_Object_Table[] = {
         Device_Read_Property_Local, Device_Write_Property_Local,
         Device_Property_Lists, DeviceGetRRInfo, NULL /* Iterator */,
         NULL /* Value_Lists */, NULL /* COV */, NULL /* COV Clear */,
-        NULL /* Intrinsic Reporting */ },
+        NULL /* Intrinsic Reporting */, false /* COV Pushed */ },
 #if (BACNET_PROTOCOL_REVISION >= 17)
     { OBJECT_NETWORK_PORT, Network_Port_Init, Network_Port_Count,
         Network_Port_Index_To_Instance, Network_Port_Valid_Instance,
         Network_Port_Object_Name, Network_Port_Read_Property,
         Network_Port_Write_Property, Network_Port_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
 #endif
     { OBJECT_ANALOG_INPUT, Analog_Input_Init, Analog_Input_Count,
         Analog_Input_Index_To_Instance, Analog_Input_Valid_Instance,
@@ -111,39 +117,45 @@ static object_functions_t My_Object_Table[] = {
         Analog_Input_Write_Property, Analog_Input_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */,
         Analog_Input_Encode_Value_List, Analog_Input_Change_Of_Value,
-        Analog_Input_Change_Of_Value_Clear, Analog_Input_Intrinsic_Reporting },
+        Analog_Input_Change_Of_Value_Clear, Analog_Input_Intrinsic_Reporting,
+        true /* COV Pushed */ },
     { OBJECT_ANALOG_OUTPUT, Analog_Output_Init, Analog_Output_Count,
         Analog_Output_Index_To_Instance, Analog_Output_Valid_Instance,
         Analog_Output_Object_Name, Analog_Output_Read_Property,
         Analog_Output_Write_Property, Analog_Output_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_ANALOG_VALUE, Analog_Value_Init, Analog_Value_Count,
         Analog_Value_Index_To_Instance, Analog_Value_Valid_Instance,
         Analog_Value_Object_Name, Analog_Value_Read_Property,
         Analog_Value_Write_Property, Analog_Value_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */,
         Analog_Value_Encode_Value_List, Analog_Value_Change_Of_Value,
-        Analog_Value_Change_Of_Value_Clear, Analog_Value_Intrinsic_Reporting },
+        Analog_Value_Change_Of_Value_Clear, Analog_Value_Intrinsic_Reporting,
+        true /* COV Pushed */ },
     { OBJECT_BINARY_INPUT, Binary_Input_Init, Binary_Input_Count,
         Binary_Input_Index_To_Instance, Binary_Input_Valid_Instance,
         Binary_Input_Object_Name, Binary_Input_Read_Property,
         Binary_Input_Write_Property, Binary_Input_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */,
         Binary_Input_Encode_Value_List, Binary_Input_Change_Of_Value,
-        Binary_Input_Change_Of_Value_Clear, NULL /* Intrinsic Reporting */ },
+        Binary_Input_Change_Of_Value_Clear, NULL /* Intrinsic Reporting */,
+        true /* COV Pushed */ },
     { OBJECT_BINARY_OUTPUT, Binary_Output_Init, Binary_Output_Count,
         Binary_Output_Index_To_Instance, Binary_Output_Valid_Instance,
         Binary_Output_Object_Name, Binary_Output_Read_Property,
         Binary_Output_Write_Property, Binary_Output_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_BINARY_VALUE, Binary_Value_Init, Binary_Value_Count,
         Binary_Value_Index_To_Instance, Binary_Value_Valid_Instance,
         Binary_Value_Object_Name, Binary_Value_Read_Property,
         Binary_Value_Write_Property, Binary_Value_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_CHARACTERSTRING_VALUE, CharacterString_Value_Init,
         CharacterString_Value_Count, CharacterString_Value_Index_To_Instance,
         CharacterString_Value_Valid_Instance, CharacterString_Value_Object_Name,
@@ -151,18 +163,21 @@ static object_functions_t My_Object_Table[] = {
         CharacterString_Value_Write_Property,
         CharacterString_Value_Property_Lists, NULL /* ReadRangeInfo */,
         NULL /* Iterator */, NULL /* Value_Lists */, NULL /* COV */,
-        NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_COMMAND, Command_Init, Command_Count, Command_Index_To_Instance,
         Command_Valid_Instance, Command_Object_Name, Command_Read_Property,
         Command_Write_Property, Command_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_INTEGER_VALUE, Integer_Value_Init, Integer_Value_Count,
         Integer_Value_Index_To_Instance, Integer_Value_Valid_Instance,
         Integer_Value_Object_Name, Integer_Value_Read_Property,
         Integer_Value_Write_Property, Integer_Value_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
 #if defined(INTRINSIC_REPORTING)
     { OBJECT_NOTIFICATION_CLASS, Notification_Class_Init,
         Notification_Class_Count, Notification_Class_Index_To_Instance,
@@ -170,33 +185,38 @@ static object_functions_t My_Object_Table[] = {
         Notification_Class_Read_Property, Notification_Class_Write_Property,
         Notification_Class_Property_Lists, NULL /* ReadRangeInfo */,
         NULL /* Iterator */, NULL /* Value_Lists */, NULL /* COV */,
-        NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
 #endif
     { OBJECT_LIFE_SAFETY_POINT, Life_Safety_Point_Init, Life_Safety_Point_Count,
         Life_Safety_Point_Index_To_Instance, Life_Safety_Point_Valid_Instance,
         Life_Safety_Point_Object_Name, Life_Safety_Point_Read_Property,
         Life_Safety_Point_Write_Property, Life_Safety_Point_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_LOAD_CONTROL, Load_Control_Init, Load_Control_Count,
         Load_Control_Index_To_Instance, Load_Control_Valid_Instance,
         Load_Control_Object_Name, Load_Control_Read_Property,
         Load_Control_Write_Property, Load_Control_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_MULTI_STATE_INPUT, Multistate_Input_Init, Multistate_Input_Count,
         Multistate_Input_Index_To_Instance, Multistate_Input_Valid_Instance,
         Multistate_Input_Object_Name, Multistate_Input_Read_Property,
         Multistate_Input_Write_Property, Multistate_Input_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_MULTI_STATE_OUTPUT, Multistate_Output_Init,
         Multistate_Output_Count, Multistate_Output_Index_To_Instance,
         Multistate_Output_Valid_Instance, Multistate_Output_Object_Name,
         Multistate_Output_Read_Property, Multistate_Output_Write_Property,
         Multistate_Output_Property_Lists, NULL /* ReadRangeInfo */,
         NULL /* Iterator */, NULL /* Value_Lists */, NULL /* COV */,
-        NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_MULTI_STATE_VALUE, Multistate_Value_Init, Multistate_Value_Count,
         Multistate_Value_Index_To_Instance, Multistate_Value_Valid_Instance,
         Multistate_Value_Object_Name, Multistate_Value_Read_Property,
@@ -204,39 +224,44 @@ static object_functions_t My_Object_Table[] = {
         NULL /* ReadRangeInfo */, NULL /* Iterator */,
         Multistate_Value_Encode_Value_List, Multistate_Value_Change_Of_Value,
         Multistate_Value_Change_Of_Value_Clear,
-        NULL /* Intrinsic Reporting */ },
+        NULL /* Intrinsic Reporting */, true /* COV Pushed */ },
     { OBJECT_TRENDLOG, Trend_Log_Init, Trend_Log_Count,
         Trend_Log_Index_To_Instance, Trend_Log_Valid_Instance,
         Trend_Log_Object_Name, Trend_Log_Read_Property,
         Trend_Log_Write_Property, Trend_Log_Property_Lists, TrendLogGetRRInfo,
         NULL /* Iterator */, NULL /* Value_Lists */, NULL /* COV */,
-        NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
 #if (BACNET_PROTOCOL_REVISION >= 14) && defined(BACAPP_LIGHTING_COMMAND)
     { OBJECT_LIGHTING_OUTPUT, Lighting_Output_Init, Lighting_Output_Count,
         Lighting_Output_Index_To_Instance, Lighting_Output_Valid_Instance,
         Lighting_Output_Object_Name, Lighting_Output_Read_Property,
         Lighting_Output_Write_Property, Lighting_Output_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_CHANNEL, Channel_Init, Channel_Count, Channel_Index_To_Instance,
         Channel_Valid_Instance, Channel_Object_Name, Channel_Read_Property,
         Channel_Write_Property, Channel_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
 #endif
 #if defined(BACFILE)
     { OBJECT_FILE, bacfile_init, bacfile_count, bacfile_index_to_instance,
         bacfile_valid_instance, bacfile_object_name, bacfile_read_property,
         bacfile_write_property, BACfile_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
 #endif
     { OBJECT_OCTETSTRING_VALUE, OctetString_Value_Init, OctetString_Value_Count,
         OctetString_Value_Index_To_Instance, OctetString_Value_Valid_Instance,
         OctetString_Value_Object_Name, OctetString_Value_Read_Property,
         OctetString_Value_Write_Property, OctetString_Value_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_POSITIVE_INTEGER_VALUE, PositiveInteger_Value_Init,
         PositiveInteger_Value_Count, PositiveInteger_Value_Index_To_Instance,
         PositiveInteger_Value_Valid_Instance, PositiveInteger_Value_Object_Name,
@@ -244,28 +269,73 @@ static object_functions_t My_Object_Table[] = {
         PositiveInteger_Value_Write_Property,
         PositiveInteger_Value_Property_Lists, NULL /* ReadRangeInfo */,
         NULL /* Iterator */, NULL /* Value_Lists */, NULL /* COV */,
-        NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { OBJECT_SCHEDULE, Schedule_Init, Schedule_Count,
         Schedule_Index_To_Instance, Schedule_Valid_Instance,
         Schedule_Object_Name, Schedule_Read_Property, Schedule_Write_Property,
         Schedule_Property_Lists, NULL /* ReadRangeInfo */, NULL /* Iterator */,
         NULL /* Value_Lists */, NULL /* COV */, NULL /* COV Clear */,
-        NULL /* Intrinsic Reporting */ },
+        NULL /* Intrinsic Reporting */, false /* COV Pushed */ },
     { OBJECT_ACCUMULATOR, Accumulator_Init, Accumulator_Count,
         Accumulator_Index_To_Instance, Accumulator_Valid_Instance,
         Accumulator_Object_Name, Accumulator_Read_Property,
         Accumulator_Write_Property, Accumulator_Property_Lists,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
-        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */ },
+        NULL /* COV */, NULL /* COV Clear */, NULL /* Intrinsic Reporting */,
+        false /* COV Pushed */ },
     { MAX_BACNET_OBJECT_TYPE, NULL /* Init */, NULL /* Count */,
         NULL /* Index_To_Instance */, NULL /* Valid_Instance */,
         NULL /* Object_Name */, NULL /* Read_Property */,
         NULL /* Write_Property */, NULL /* Property_Lists */,
         NULL /* ReadRangeInfo */, NULL /* Iterator */, NULL /* Value_Lists */,
         NULL /* COV */, NULL /* COV Clear */,
-        NULL /* Intrinsic Reporting */ }
+        NULL /* Intrinsic Reporting */, false /* COV Pushed */ }
 };
 
+/* called around each access of the objects by Device_Read_Property()
+   and Device_Write_Property(), if set */
+static device_lock_function Device_Lock_Function;
+static device_lock_function Device_Unlock_Function;
+
+/** Set the functions that lock and unlock the objects, where their
+ * services run on more than one thread. Each property that is read or
+ * written through Device_Read_Property() or Device_Write_Property() is
+ * accessed with the lock held, so that the other threads may use the
+ * objects in between the properties of a long request.
+ * @ingroup ObjHelpers
+ *
+ * @param lock [in] Function that takes the lock, or NULL
+ * @param unlock [in] Function that releases the lock, or NULL
+ */
+void Device_Set_Lock_Functions(
+    device_lock_function lock, device_lock_function unlock)
+{
+    Device_Lock_Function = lock;
+    Device_Unlock_Function = unlock;
+}
+
+/** Take the lock of the objects, for a handler that reads an object
+ * through its own functions rather than Device_Read_Property().
+ * @ingroup ObjHelpers
+ */
+void Device_Objects_Lock(void)
+{
+    if (Device_Lock_Function) {
+        Device_Lock_Function();
+    }
+}
+
+/** Release the lock of the objects of Device_Objects_Lock().
+ * @ingroup ObjHelpers
+ */
+void Device_Objects_Unlock(void)
+{
+    if (Device_Unlock_Function) {
+        Device_Unlock_Function();
+    }
+}
+
 /** Glue function to let the Device object, when called by a handler,
  * lookup which Object type needs to be invoked.
  * @ingroup ObjHelpers
@@ -276,19 +346,38 @@ static object_functions_t My_Object_Table[] = {
  */
 static struct object_functions *Device_Objects_Find_Functions(
     BACNET_OBJECT_TYPE Object_Type)
+{
+    unsigned index = 0;
+
+    if ((Object_Table) && (Object_Type < MAX_BACNET_OBJECT_TYPE)) {
+        index = Object_Table_Index[Object_Type];
+        if (index) {
+            return (&Object_Table[index - 1]);
+        }
+    }
+
+    return (NULL);
+}
+
+/** Build the direct-indexed lookup of the object types in the Object_Table.
+ * The first entry of a type wins, as it did with the table walk.
+ * @ingroup ObjHelpers
+ */
+static void Device_Objects_Index_Build(void)
 {
     struct object_functions *pObject = NULL;
+    unsigned index = 0;
 
+    memset(Object_Table_Index, 0, sizeof(Object_Table_Index));
     pObject = Object_Table;
-    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
-        /* handle each object type */
-        if (pObject->Object_Type == Object_Type) {
-            return (pObject);
+    while ((pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) &&
+        (index < UINT8_MAX)) {
+        if (Object_Table_Index[pObject->Object_Type] == 0) {
+            Object_Table_Index[pObject->Object_Type] = (uint8_t)(index + 1);
         }
+        index++;
         pObject++;
     }
-
-    return (NULL);
 }
 
 /** Try to find a rr_info_function helper function for the requested object
@@ -444,6 +533,17 @@ static uint32_t Interval_Offset_Minutes;
 /* Max_Info_Frames - rely on MS/TP subsystem, if there is one */
 /* Device_Address_Binding - required, but relies on binding cache */
 static uint32_t Database_Revision = 0;
+/* flattened Object_List, rebuilt when the Database_Revision
+   or the number of objects changes, or when an object module
+   reports that it created or deleted an object */
+static BACNET_OBJECT_ID *Object_List_Cache;
+static unsigned Object_List_Cache_Size;
+static unsigned Object_List_Cache_Count;
+static uint32_t Object_List_Cache_Revision;
+static bool Object_List_Cache_Valid;
+/* Object_Name hash -> entry of the Object_List cache */
+static OS_Keyhash Object_Name_Index;
+static bool Object_Name_Index_Valid;
 /* Configuration_Files */
 /* Last_Restore_Time */
 /* Backup_Failure_Timeout */
@@ -551,7 +651,10 @@ bool Device_Set_Object_Instance_Number(uint32_t object_id)
 
     if (object_id <= BACNET_MAX_INSTANCE) {
         /* Make the change and update the database revision */
-        Object_Instance_Number = object_id;
+        if (Object_Instance_Number != object_id) {
+            Object_Instance_Number = object_id;
+            Device_Object_List_Changed();
+        }
         Device_Inc_Database_Revision();
     } else {
         status = false;
@@ -772,7 +875,11 @@ uint8_t Device_Protocol_Revision(void)
 
 BACNET_SEGMENTATION Device_Segmentation_Supported(void)
 {
+#if BACNET_SEGMENTATION_ENABLED
+    return SEGMENTATION_TRANSMIT;
+#else
     return SEGMENTATION_NONE;
+#endif
 }
 
 uint32_t Device_Database_Revision(void)
@@ -817,10 +924,83 @@ unsigned Device_Object_List_Count(void)
     return count;
 }
 
+/** Bring the flattened copy of the Object List up to date.
+ * The list is only rebuilt when the Database_Revision or the number
+ * of objects has changed since it was last built.
+ *
+ * @return True if the cached list can be used, false if there was
+ *         not enough memory for it.
+ */
+static bool Device_Object_List_Cache_Update(void)
+{
+    unsigned count = 0;
+    unsigned object_count = 0;
+    unsigned index = 0;
+    unsigned object_index = 0;
+    BACNET_OBJECT_ID *object_list = NULL;
+    struct object_functions *pObject = NULL;
+
+    count = Device_Object_List_Count();
+    if ((Object_List_Cache_Valid) &&
+        (Object_List_Cache_Revision == Database_Revision) &&
+        (Object_List_Cache_Count == count)) {
+        return true;
+    }
+    Object_List_Cache_Valid = false;
+    if (count > Object_List_Cache_Size) {
+        object_list = realloc(Object_List_Cache, count * sizeof(*object_list));
+        if (!object_list) {
+            return false;
+        }
+        Object_List_Cache = object_list;
+        Object_List_Cache_Size = count;
+    }
+    pObject = Object_Table;
+    while ((pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) && (index < count)) {
+        if (pObject->Object_Count) {
+            object_count = pObject->Object_Count();
+            /* Use the iterator function if available otherwise
+             * the object index is the position within the type */
+            if (pObject->Object_Iterator) {
+                object_index = pObject->Object_Iterator(~(unsigned)0);
+            } else {
+                object_index = 0;
+            }
+            while ((object_count > 0) && (index < count)) {
+                if (pObject->Object_Index_To_Instance) {
+                    Object_List_Cache[index].type = pObject->Object_Type;
+                    Object_List_Cache[index].instance =
+                        pObject->Object_Index_To_Instance(object_index);
+                } else {
+                    /* not reachable by array index */
+                    Object_List_Cache[index].type = MAX_BACNET_OBJECT_TYPE;
+                    Object_List_Cache[index].instance = BACNET_MAX_INSTANCE;
+                }
+                if (pObject->Object_Iterator) {
+                    object_index = pObject->Object_Iterator(object_index);
+                } else {
+                    object_index++;
+                }
+                object_count--;
+                index++;
+            }
+        }
+        pObject++;
+    }
+    Object_List_Cache_Count = index;
+    Object_List_Cache_Revision = Database_Revision;
+    Object_List_Cache_Valid = true;
+    /* the name index refers to the entries of the list */
+    Object_Name_Index_Valid = false;
+
+    return true;
+}
+
 /** Lookup the Object at the given array index in the Device's Object List.
  * Even though we don't keep a single linear array of objects in the Device,
  * this method acts as though we do and works through a virtual, concatenated
- * array of all of our object type arrays.
+ * array of all of our object type arrays.  The concatenated array is cached,
+ * so that reading the whole list one element at a time stays linear.
  *
  * @param array_index [in] The desired array index (1 to N)
  * @param object_type [out] The object's type, if found.
@@ -841,7 +1021,21 @@ bool Device_Object_List_Identifier(
         return status;
     }
     object_index = array_index - 1;
-    /* initialize the default return values */
+    if (Device_Object_List_Cache_Update()) {
+        if ((object_index < Object_List_Cache_Count) &&
+            (Object_List_Cache[object_index].type < MAX_BACNET_OBJECT_TYPE)) {
+            *object_type = Object_List_Cache[object_index].type;
+            if (*object_type == OBJECT_DEVICE) {
+                /* a routed gateway answers for several Device instances */
+                *instance = Device_Object_Instance_Number();
+            } else {
+                *instance = Object_List_Cache[object_index].instance;
+            }
+            status = true;
+        }
+        return status;
+    }
+    /* no memory for the cached list - walk the object types */
     pObject = Object_Table;
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         if (pObject->Object_Count) {
@@ -876,6 +1070,109 @@ bool Device_Object_List_Identifier(
     return status;
 }
 
+/** Compute the key of an object name for the object name index.
+ * @param object_name [in] The Object Name
+ * @return hash key of the name
+ */
+static KEY Device_Object_Name_Key(BACNET_CHARACTER_STRING *object_name)
+{
+    KEY key = KEYHASH_SEED;
+    uint8_t encoding = 0;
+
+    encoding = characterstring_encoding(object_name);
+    key = Keyhash_Hash(key, &encoding, sizeof(encoding));
+    key = Keyhash_Hash(key, characterstring_value(object_name),
+        characterstring_length(object_name));
+
+    return key;
+}
+
+/** Compare the name of an object in the name index to an object name.
+ * @param data [in] The object identifier stored in the name index
+ * @param context [in] The Object Name to compare
+ * @return true if the object has that name
+ */
+static bool Device_Object_Name_Match(void *data, const void *context)
+{
+    BACNET_OBJECT_ID *object_id = data;
+    BACNET_CHARACTER_STRING object_name;
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Objects_Find_Functions(object_id->type);
+    if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
+        pObject->Object_Name(object_id->instance, &object_name)) {
+        return characterstring_same(
+            (BACNET_CHARACTER_STRING *)context, &object_name);
+    }
+
+    return false;
+}
+
+/** Bring the object name index up to date with the Object_List cache.
+ * The Device object itself is not in the index, since a routed gateway
+ * answers with the name of the Device being addressed.
+ *
+ * @return True if the index can be used, false if there was
+ *         not enough memory for it.
+ */
+static bool Device_Object_Name_Index_Update(void)
+{
+    unsigned index = 0;
+    BACNET_OBJECT_ID *object_id = NULL;
+    BACNET_CHARACTER_STRING object_name;
+    struct object_functions *pObject = NULL;
+
+    if (!Device_Object_List_Cache_Update()) {
+        return false;
+    }
+    if (Object_Name_Index_Valid) {
+        return true;
+    }
+    Keyhash_Delete(Object_Name_Index);
+    Object_Name_Index = Keyhash_Create();
+    if (!Object_Name_Index) {
+        return false;
+    }
+    for (index = 0; index < Object_List_Cache_Count; index++) {
+        object_id = &Object_List_Cache[index];
+        if ((object_id->type == OBJECT_DEVICE) ||
+            (object_id->type >= MAX_BACNET_OBJECT_TYPE)) {
+            continue;
+        }
+        pObject = Device_Objects_Find_Functions(object_id->type);
+        if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
+            pObject->Object_Name(object_id->instance, &object_name)) {
+            if (Keyhash_Data_Add(Object_Name_Index,
+                    Device_Object_Name_Key(&object_name), object_id) < 0) {
+                return false;
+            }
+        }
+    }
+    Object_Name_Index_Valid = true;
+
+    return true;
+}
+
+/** Tell the Device that an object module created or deleted an object.
+ * A delete and a create leave the number of objects unchanged, so the
+ * Object_List cache and the object name index are rebuilt on next use.
+ */
+void Device_Object_List_Changed(void)
+{
+    Object_List_Cache_Valid = false;
+    Object_Name_Index_Valid = false;
+}
+
+/** Tell the Device that the name of one of its objects has changed.
+ * The object name index is keyed on the names, so any object module
+ * that renames an object must call this, even when the Database_Revision
+ * is not changed, or the renamed object will not be found by its name.
+ */
+void Device_Object_Name_Changed(void)
+{
+    Object_Name_Index_Valid = false;
+}
+
 /** Determine if we have an object with the given object_name.
  * If the object_type and object_instance pointers are not null,
  * and the lookup succeeds, they will be given the resulting values.
@@ -896,7 +1193,37 @@ bool Device_Valid_Object_Name(BACNET_CHARACTER_STRING *object_name1,
     bool check_id = false;
     BACNET_CHARACTER_STRING object_name2;
     struct object_functions *pObject = NULL;
-
+    BACNET_OBJECT_ID *object_id = NULL;
+
+    if (Device_Object_Name_Index_Update()) {
+        pObject = Device_Objects_Find_Functions(OBJECT_DEVICE);
+        instance = Device_Object_Instance_Number();
+        if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
+            (pObject->Object_Name(instance, &object_name2) &&
+                characterstring_same(object_name1, &object_name2))) {
+            found = true;
+            type = OBJECT_DEVICE;
+        } else {
+            object_id = Keyhash_Data_Match(Object_Name_Index,
+                Device_Object_Name_Key(object_name1),
+                Device_Object_Name_Match, object_name1);
+            if (object_id) {
+                found = true;
+                type = object_id->type;
+                instance = object_id->instance;
+            }
+        }
+        if (found) {
+            if (object_type) {
+                *object_type = type;
+            }
+            if (object_instance) {
+                *object_instance = instance;
+            }
+        }
+        return found;
+    }
+    /* no memory for the index - compare the name of every object */
     max_objects = Device_Object_List_Count();
     for (i = 1; i <= max_objects; i++) {
         check_id = Device_Object_List_Identifier(i, &type, &instance);
@@ -1333,6 +1660,9 @@ int Device_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
     /* initialize the default return values */
     rpdata->error_class = ERROR_CLASS_OBJECT;
     rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+    if (Device_Lock_Function) {
+        Device_Lock_Function();
+    }
     pObject = Device_Objects_Find_Functions(rpdata->object_type);
     if (pObject != NULL) {
         if (pObject->Object_Valid_Instance &&
@@ -1354,6 +1684,9 @@ int Device_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
             }
         }
     }
+    if (Device_Unlock_Function) {
+        Device_Unlock_Function();
+    }
 
     return apdu_len;
 }
@@ -1652,6 +1985,9 @@ bool Device_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
     /* initialize the default return values */
     wp_data->error_class = ERROR_CLASS_OBJECT;
     wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+    if (Device_Lock_Function) {
+        Device_Lock_Function();
+    }
     pObject = Device_Objects_Find_Functions(wp_data->object_type);
     if (pObject != NULL) {
         if (pObject->Object_Valid_Instance &&
@@ -1678,6 +2014,9 @@ bool Device_Write_Property(BACNET_WRITE_PROPERTY_DATA *wp_data)
         wp_data->error_class = ERROR_CLASS_OBJECT;
         wp_data->error_code = ERROR_CODE_UNKNOWN_OBJECT;
     }
+    if (Device_Unlock_Function) {
+        Device_Unlock_Function();
+    }
 
     return (status);
 }
@@ -1735,6 +2074,21 @@ bool Device_COV(BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
     return (status);
 }
 
+/** Checks if the objects of a type report their own COV changes
+ * @ingroup ObjHelpers
+ * @param [in] The object type to be looked up.
+ * @return True if the objects call handler_cov_object_changed(),
+ *  and false if their COV flag has to be polled
+ */
+bool Device_COV_Pushed(BACNET_OBJECT_TYPE object_type)
+{
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Objects_Find_Functions(object_type);
+
+    return (pObject != NULL) && pObject->Object_COV_Pushed;
+}
+
 /** Clears the COV flag in the requested Object
  * @ingroup ObjHelpers
  * @param [in] The object type to be looked up.
@@ -1837,6 +2191,8 @@ void Device_Init(object_functions_t *object_table)
     } else {
         Object_Table = &My_Object_Table[0];
     }
+    Device_Objects_Index_Build();
+    Object_List_Cache_Valid = false;
     pObject = Object_Table;
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         if (pObject->Object_Init) {
@@ -1908,7 +2264,10 @@ void Routing_Device_Init(uint32_t first_object_instance)
     Add_Routed_Device(first_object_instance, &My_Object_Name, Description);
 
     /* Now substitute our routed versions of the main object functions. */
-    pDevObject = Object_Table;
+    pDevObject = Device_Objects_Find_Functions(OBJECT_DEVICE);
+    if (!pDevObject) {
+        return;
+    }
     pDevObject->Object_Index_To_Instance = Routed_Device_Index_To_Instance;
     pDevObject->Object_Valid_Instance =
         Routed_Device_Valid_Object_Instance_Number;
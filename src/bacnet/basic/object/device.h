@@ -139,6 +139,14 @@ typedef void (
     *object_intrinsic_reporting_function) (
     uint32_t object_instance);
 
+/** Lock or unlock the objects, where their services run on more than
+ * one thread.
+ * @ingroup ObjHelpers
+ */
+typedef void (
+    *device_lock_function) (
+    void);
+
 
 /** Defines the group of object helper functions for any supported Object.
  * @ingroup ObjHelpers
@@ -165,6 +173,9 @@ typedef struct object_functions {
     object_cov_function Object_COV;
     object_cov_clear_function Object_COV_Clear;
     object_intrinsic_reporting_function Object_Intrinsic_Reporting;
+    /* true if the objects report their changes through
+       handler_cov_object_changed(), so that they are not polled */
+    bool Object_COV_Pushed;
 } object_functions_t;
 
 /* String Lengths - excluding any nul terminator */
@@ -288,6 +299,9 @@ extern "C" {
     void Device_COV_Clear(
         BACNET_OBJECT_TYPE object_type,
         uint32_t object_instance);
+    BACNET_STACK_EXPORT
+    bool Device_COV_Pushed(
+        BACNET_OBJECT_TYPE object_type);
 
     BACNET_STACK_EXPORT
     uint32_t Device_Object_Instance_Number(
@@ -409,6 +423,12 @@ extern "C" {
         void);
 
     BACNET_STACK_EXPORT
+    void Device_Object_List_Changed(
+        void);
+    BACNET_STACK_EXPORT
+    void Device_Object_Name_Changed(
+        void);
+    BACNET_STACK_EXPORT
     bool Device_Valid_Object_Name(
         BACNET_CHARACTER_STRING * object_name,
         BACNET_OBJECT_TYPE *object_type,
@@ -424,6 +444,16 @@ extern "C" {
     BACNET_STACK_EXPORT
     bool Device_Write_Property(
         BACNET_WRITE_PROPERTY_DATA * wp_data);
+    BACNET_STACK_EXPORT
+    void Device_Set_Lock_Functions(
+        device_lock_function lock,
+        device_lock_function unlock);
+    BACNET_STACK_EXPORT
+    void Device_Objects_Lock(
+        void);
+    BACNET_STACK_EXPORT
+    void Device_Objects_Unlock(
+        void);
 
     BACNET_STACK_EXPORT
     bool DeviceGetRRInfo(
@@ -523,7 +523,12 @@ bool Routed_Device_Set_Object_Instance_Number(uint32_t object_id)
 
     if (object_id <= BACNET_MAX_INSTANCE) {
         /* Make the change and update the database revision */
-        Devices[iCurrent_Device_Idx].bacObj.Object_Instance_Number = object_id;
+        if (Devices[iCurrent_Device_Idx].bacObj.Object_Instance_Number !=
+            object_id) {
+            Devices[iCurrent_Device_Idx].bacObj.Object_Instance_Number =
+                object_id;
+            Device_Object_List_Changed();
+        }
         Routed_Device_Inc_Database_Revision();
     } else {
         status = false;
@@ -309,6 +309,9 @@ bool Multistate_Input_Name_Set(uint32_t object_instance, char *new_name)
                 Object_Name[index][i] = 0;
             }
         }
+        /* a new object name is a change to the device database */
+        Device_Object_Name_Changed();
+        Device_Inc_Database_Revision();
     }
 
     return status;
@@ -332,7 +335,11 @@ static bool Multistate_Input_Object_Name_Write(uint32_t object_instance,
             if (encoding == CHARACTER_UTF8) {
                 status = characterstring_ansi_copy(Object_Name[index],
                     sizeof(Object_Name[index]), char_string);
-                if (!status) {
+                if (status) {
+                    /* a new object name is a change to the device database */
+                    Device_Object_Name_Changed();
+                    Device_Inc_Database_Revision();
+                } else {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
                 }
@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacenum.h"
@@ -35,10 +36,12 @@
 #include "bacnet/config.h" /* the custom stuff */
 #include "bacnet/rp.h"
 #include "bacnet/wp.h"
+#include "bacnet/basic/object/device.h"
 #include "bacnet/basic/object/msv.h"
 #include "bacnet/basic/services.h"
+#include "bacnet/basic/sys/keyhash.h"
 
-/* number of demo objects */
+/* number of demo objects created by Multistate_Value_Init() */
 #ifndef MAX_MULTISTATE_VALUES
 #define MAX_MULTISTATE_VALUES 4
 #endif
@@ -48,18 +51,26 @@
 #define MULTISTATE_NUMBER_OF_STATES (254)
 #endif
 
-/* Here is our Present Value */
-static uint8_t Present_Value[MAX_MULTISTATE_VALUES];
-/* Writable out-of-service allows others to manipulate our Present Value */
-static bool Out_Of_Service[MAX_MULTISTATE_VALUES];
-/* Change of Value flag */
-static bool Change_Of_Value[MAX_MULTISTATE_VALUES];
-/* object name storage */
-static char Object_Name[MAX_MULTISTATE_VALUES][64];
-/* object description storage */
-static char Object_Description[MAX_MULTISTATE_VALUES][64];
-/* object state text storage */
-static char State_Text[MAX_MULTISTATE_VALUES][MULTISTATE_NUMBER_OF_STATES][64];
+struct multistate_value_descr {
+    /* Here is our Present Value */
+    uint8_t Present_Value;
+    /* Writable out-of-service allows others to manipulate our Present Value */
+    bool Out_Of_Service;
+    /* Change of Value flag */
+    bool Change_Of_Value;
+    /* object name storage */
+    char Object_Name[64];
+    /* object description storage */
+    char Object_Description[64];
+    /* object state text storage - allocated when the first text is set */
+    char (*State_Text)[64];
+};
+/* the objects, keyed by object instance */
+static OS_Keyhash Object_List;
+/* we need to have our objects created before answering any calls */
+static bool Multistate_Value_Initialized = false;
+/* state text of objects without any state text */
+static char Empty_State_Text[1];
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Properties_Required[] = { PROP_OBJECT_IDENTIFIER,
@@ -87,69 +98,208 @@ void Multistate_Value_Property_Lists(
     return;
 }
 
-void Multistate_Value_Init(void)
+/**
+ * Frees a Multistate Value object and its state text
+ *
+ * @param  pObject - object to be freed
+ */
+static void Multistate_Value_Object_Free(struct multistate_value_descr *pObject)
 {
-    unsigned int i;
+    if (pObject) {
+        free(pObject->State_Text);
+        free(pObject);
+    }
+}
+
+/**
+ * Allocates and initializes a Multistate Value object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  the new object, or NULL if out of memory
+ */
+static struct multistate_value_descr *Multistate_Value_Object_Create(
+    uint32_t object_instance)
+{
+    struct multistate_value_descr *pObject = NULL;
 
-    /* initialize all the analog output priority arrays to NULL */
-    for (i = 0; i < MAX_MULTISTATE_VALUES; i++) {
-        Present_Value[i] = 1;
-        sprintf(&Object_Name[i][0], "MULTISTATE VALUE %u", i);
-        sprintf(&Object_Description[i][0], "MULTISTATE VALUE %u", i);
+    if (!Object_List) {
+        Object_List = Keyhash_Create();
+    }
+    pObject = calloc(1, sizeof(struct multistate_value_descr));
+    if (!pObject) {
+        return NULL;
+    }
+    pObject->Present_Value = 1;
+    sprintf(pObject->Object_Name, "MULTISTATE VALUE %lu",
+        (unsigned long)object_instance);
+    sprintf(pObject->Object_Description, "MULTISTATE VALUE %lu",
+        (unsigned long)object_instance);
+    if (Keyhash_Data_Add(Object_List, object_instance, pObject) < 0) {
+        free(pObject);
+        return NULL;
     }
 
-    return;
+    return pObject;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the index */
-/* that correlates to the correct instance number */
-unsigned Multistate_Value_Instance_To_Index(uint32_t object_instance)
+/**
+ * Creates a Multistate Value object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object exists or was created
+ */
+bool Multistate_Value_Create(uint32_t object_instance)
 {
-    unsigned index = MAX_MULTISTATE_VALUES;
+    if (object_instance >= BACNET_MAX_INSTANCE) {
+        return false;
+    }
+    if (Keyhash_Data(Object_List, object_instance)) {
+        return true;
+    }
+    if (!Multistate_Value_Object_Create(object_instance)) {
+        return false;
+    }
+    Device_Object_List_Changed();
+    Device_Inc_Database_Revision();
+
+    return true;
+}
 
-    if (object_instance < MAX_MULTISTATE_VALUES) {
-        index = object_instance;
+/**
+ * Deletes a Multistate Value object
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the object was deleted
+ */
+bool Multistate_Value_Delete(uint32_t object_instance)
+{
+    struct multistate_value_descr *pObject = NULL;
+
+    pObject = Keyhash_Data_Delete(Object_List, object_instance);
+    if (pObject) {
+        Multistate_Value_Object_Free(pObject);
+        Device_Object_List_Changed();
+        Device_Inc_Database_Revision();
+        return true;
     }
 
-    return index;
+    return false;
+}
+
+/**
+ * Deletes all the Multistate Value objects
+ */
+void Multistate_Value_Cleanup(void)
+{
+    struct multistate_value_descr *pObject = NULL;
+
+    if (Object_List) {
+        while (Keyhash_Count(Object_List) > 0) {
+            pObject = Keyhash_Data_Delete_By_Index(Object_List, 0);
+            Multistate_Value_Object_Free(pObject);
+        }
+        Keyhash_Delete(Object_List);
+        Object_List = NULL;
+        Device_Object_List_Changed();
+    }
+    Multistate_Value_Initialized = false;
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then you need to return the instance */
-/* that correlates to the correct index */
-uint32_t Multistate_Value_Index_To_Instance(unsigned index)
+/**
+ * Determines if a given Multistate Value instance is valid
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  true if the instance is valid, and false if not
+ */
+bool Multistate_Value_Valid_Instance(uint32_t object_instance)
 {
-    return index;
+    return (Keyhash_Data(Object_List, object_instance) != NULL);
 }
 
-/* we simply have 0-n object instances.  Yours might be */
-/* more complex, and then count how many you have */
+/**
+ * Determines the number of Multistate Value objects
+ *
+ * @return  Number of Multistate Value objects
+ */
 unsigned Multistate_Value_Count(void)
 {
-    return MAX_MULTISTATE_VALUES;
+    return (unsigned)Keyhash_Count(Object_List);
 }
 
-bool Multistate_Value_Valid_Instance(uint32_t object_instance)
+/**
+ * Determines the object instance-number for a given 0..N index
+ * of Multistate Value objects where N is Multistate_Value_Count().
+ *
+ * @param  index - 0..N where N is Multistate_Value_Count()
+ *
+ * @return  object instance-number for the given index,
+ *          or BACNET_MAX_INSTANCE if the index is not valid
+ */
+uint32_t Multistate_Value_Index_To_Instance(unsigned index)
 {
-    unsigned index = 0; /* offset from instance lookup */
+    if (index < Multistate_Value_Count()) {
+        return Keyhash_Key(Object_List, (int)index);
+    }
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        return true;
+    return BACNET_MAX_INSTANCE;
+}
+
+/**
+ * For a given object instance-number, determines a 0..N index
+ * of Multistate Value objects where N is Multistate_Value_Count().
+ *
+ * @param  object_instance - object-instance number of the object
+ *
+ * @return  index for the given instance-number, or Multistate_Value_Count()
+ *          if the instance is not valid.
+ */
+unsigned Multistate_Value_Instance_To_Index(uint32_t object_instance)
+{
+    int index;
+
+    index = Keyhash_Index(Object_List, object_instance);
+    if (index < 0) {
+        return Multistate_Value_Count();
     }
 
-    return false;
+    return (unsigned)index;
+}
+
+/**
+ * Initializes the Multistate Value objects, creating MAX_MULTISTATE_VALUES
+ * objects with instances 0 to MAX_MULTISTATE_VALUES-1.
+ */
+void Multistate_Value_Init(void)
+{
+    unsigned int i;
+
+    if (!Multistate_Value_Initialized) {
+        Multistate_Value_Initialized = true;
+        if (!Object_List) {
+            Object_List = Keyhash_Create();
+        }
+        for (i = 0; i < MAX_MULTISTATE_VALUES; i++) {
+            if (!Keyhash_Data(Object_List, i)) {
+                (void)Multistate_Value_Object_Create(i);
+            }
+        }
+    }
+
+    return;
 }
 
 uint32_t Multistate_Value_Present_Value(uint32_t object_instance)
 {
     uint32_t value = 1;
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        value = Present_Value[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Present_Value;
     }
 
     return value;
@@ -159,15 +309,17 @@ bool Multistate_Value_Present_Value_Set(
     uint32_t object_instance, uint32_t value)
 {
     bool status = false;
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         if ((value > 0) && (value <= MULTISTATE_NUMBER_OF_STATES)) {
-            if (Present_Value[index] != (uint8_t)value) {
-                Change_Of_Value[index] = true;
+            if (pObject->Present_Value != (uint8_t)value) {
+                pObject->Change_Of_Value = true;
+                handler_cov_object_changed(
+                    OBJECT_MULTI_STATE_VALUE, object_instance);
             }
-            Present_Value[index] = (uint8_t)value;
+            pObject->Present_Value = (uint8_t)value;
             status = true;
         }
     }
@@ -178,11 +330,11 @@ bool Multistate_Value_Present_Value_Set(
 bool Multistate_Value_Out_Of_Service(uint32_t object_instance)
 {
     bool value = false;
-    unsigned index = 0;
+    struct multistate_value_descr *pObject = NULL;
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        value = Out_Of_Service[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        value = pObject->Out_Of_Service;
     }
 
     return value;
@@ -190,14 +342,16 @@ bool Multistate_Value_Out_Of_Service(uint32_t object_instance)
 
 void Multistate_Value_Out_Of_Service_Set(uint32_t object_instance, bool value)
 {
-    unsigned index = 0;
-
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        if (Out_Of_Service[index] != value) {
-            Change_Of_Value[index] = true;
+    struct multistate_value_descr *pObject = NULL;
+
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        if (pObject->Out_Of_Service != value) {
+            pObject->Change_Of_Value = true;
+            handler_cov_object_changed(
+                OBJECT_MULTI_STATE_VALUE, object_instance);
         }
-        Out_Of_Service[index] = value;
+        pObject->Out_Of_Service = value;
     }
 
     return;
@@ -205,12 +359,12 @@ void Multistate_Value_Out_Of_Service_Set(uint32_t object_instance, bool value)
 
 char *Multistate_Value_Description(uint32_t object_instance)
 {
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
     char *pName = NULL; /* return value */
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        pName = Object_Description[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pName = pObject->Object_Description;
     }
 
     return pName;
@@ -218,23 +372,23 @@ char *Multistate_Value_Description(uint32_t object_instance)
 
 bool Multistate_Value_Description_Set(uint32_t object_instance, char *new_name)
 {
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
     size_t i = 0; /* loop counter */
     bool status = false; /* return value */
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         status = true;
         if (new_name) {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = new_name[i];
+            for (i = 0; i < sizeof(pObject->Object_Description); i++) {
+                pObject->Object_Description[i] = new_name[i];
                 if (new_name[i] == 0) {
                     break;
                 }
             }
         } else {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = 0;
+            for (i = 0; i < sizeof(pObject->Object_Description); i++) {
+                pObject->Object_Description[i] = 0;
             }
         }
     }
@@ -245,12 +399,12 @@ bool Multistate_Value_Description_Set(uint32_t object_instance, char *new_name)
 bool Multistate_Value_Object_Name(
     uint32_t object_instance, BACNET_CHARACTER_STRING *object_name)
 {
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
     bool status = false;
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        status = characterstring_init_ansi(object_name, Object_Name[index]);
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        status = characterstring_init_ansi(object_name, pObject->Object_Name);
     }
 
     return status;
@@ -259,26 +413,29 @@ bool Multistate_Value_Object_Name(
 /* note: the object name must be unique within this device */
 bool Multistate_Value_Name_Set(uint32_t object_instance, char *new_name)
 {
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
     size_t i = 0; /* loop counter */
     bool status = false; /* return value */
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
         status = true;
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = new_name[i];
+            for (i = 0; i < sizeof(pObject->Object_Name); i++) {
+                pObject->Object_Name[i] = new_name[i];
                 if (new_name[i] == 0) {
                     break;
                 }
             }
         } else {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = 0;
+            for (i = 0; i < sizeof(pObject->Object_Name); i++) {
+                pObject->Object_Name[i] = 0;
             }
         }
+        /* a new object name is a change to the device database */
+        Device_Object_Name_Changed();
+        Device_Inc_Database_Revision();
     }
 
     return status;
@@ -287,14 +444,18 @@ bool Multistate_Value_Name_Set(uint32_t object_instance, char *new_name)
 char *Multistate_Value_State_Text(
     uint32_t object_instance, uint32_t state_index)
 {
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
     char *pName = NULL; /* return value */
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if ((index < MAX_MULTISTATE_VALUES) && (state_index > 0) &&
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject && (state_index > 0) &&
         (state_index <= MULTISTATE_NUMBER_OF_STATES)) {
         state_index--;
-        pName = State_Text[index][state_index];
+        if (pObject->State_Text) {
+            pName = pObject->State_Text[state_index];
+        } else {
+            pName = Empty_State_Text;
+        }
     }
 
     return pName;
@@ -304,25 +465,31 @@ char *Multistate_Value_State_Text(
 bool Multistate_Value_State_Text_Set(
     uint32_t object_instance, uint32_t state_index, char *new_name)
 {
-    unsigned index = 0; /* offset from instance lookup */
+    struct multistate_value_descr *pObject = NULL;
     size_t i = 0; /* loop counter */
     bool status = false; /* return value */
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if ((index < MAX_MULTISTATE_VALUES) && (state_index > 0) &&
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject && (state_index > 0) &&
         (state_index <= MULTISTATE_NUMBER_OF_STATES)) {
         state_index--;
-        status = true;
-        if (new_name) {
-            for (i = 0; i < sizeof(State_Text[index][state_index]); i++) {
-                State_Text[index][state_index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
+        if (!pObject->State_Text) {
+            pObject->State_Text = calloc(
+                MULTISTATE_NUMBER_OF_STATES, sizeof(*pObject->State_Text));
+        }
+        if (pObject->State_Text) {
+            status = true;
+            if (new_name) {
+                for (i = 0; i < sizeof(pObject->State_Text[state_index]); i++) {
+                    pObject->State_Text[state_index][i] = new_name[i];
+                    if (new_name[i] == 0) {
+                        break;
+                    }
+                }
+            } else {
+                for (i = 0; i < sizeof(pObject->State_Text[state_index]); i++) {
+                    pObject->State_Text[state_index][i] = 0;
                 }
-            }
-        } else {
-            for (i = 0; i < sizeof(State_Text[index][state_index]); i++) {
-                State_Text[index][state_index][i] = 0;
             }
         }
     }
@@ -334,11 +501,11 @@ bool Multistate_Value_State_Text_Set(
 bool Multistate_Value_Change_Of_Value(uint32_t object_instance)
 {
     bool status = false;
-    unsigned index;
+    struct multistate_value_descr *pObject = NULL;
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        status = Change_Of_Value[index];
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        status = pObject->Change_Of_Value;
     }
 
     return status;
@@ -346,11 +513,11 @@ bool Multistate_Value_Change_Of_Value(uint32_t object_instance)
 
 void Multistate_Value_Change_Of_Value_Clear(uint32_t object_instance)
 {
-    unsigned index;
+    struct multistate_value_descr *pObject = NULL;
 
-    index = Multistate_Value_Instance_To_Index(object_instance);
-    if (index < MAX_MULTISTATE_VALUES) {
-        Change_Of_Value[index] = false;
+    pObject = Keyhash_Data(Object_List, object_instance);
+    if (pObject) {
+        pObject->Change_Of_Value = false;
     }
 
     return;
@@ -34,6 +34,7 @@
 #include <string.h>
 
 #include "bacnet/basic/binding/address.h"
+#include "bacnet/basic/binding/bind_schedule.h"
 #include "bacnet/bacdef.h"
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacenum.h"
@@ -804,6 +805,18 @@ static bool IsRecipientActive(
     return true;
 }
 
+/* send an unconfirmed event notification from a transmit buffer */
+static void Notification_Class_UEvent_Notify(
+    BACNET_EVENT_NOTIFICATION_DATA *event_data, BACNET_ADDRESS *dest)
+{
+    uint8_t *pdu = tsm_pdu_acquire();
+
+    if (pdu) {
+        Send_UEvent_Notify(pdu, event_data, dest);
+        tsm_pdu_release(pdu);
+    }
+}
+
 void Notification_Class_common_reporting_function(
     BACNET_EVENT_NOTIFICATION_DATA *event_data)
 {
@@ -885,8 +898,7 @@ void Notification_Class_common_reporting_function(
                 if (pBacDest->ConfirmedNotify == true)
                     Send_CEvent_Notify(device_id, event_data);
                 else if (address_get_by_device(device_id, &max_apdu, &dest))
-                    Send_UEvent_Notify(
-                        Handler_Transmit_Buffer, event_data, &dest);
+                    Notification_Class_UEvent_Notify(event_data, &dest);
             } else if (pBacDest->Recipient.RecipientType ==
                 RECIPIENT_TYPE_ADDRESS) {
                 /* send notification to the address indicated */
@@ -895,8 +907,7 @@ void Notification_Class_common_reporting_function(
                         Send_CEvent_Notify(device_id, event_data);
                 } else {
                     dest = pBacDest->Recipient._.Address;
-                    Send_UEvent_Notify(
-                        Handler_Transmit_Buffer, event_data, &dest);
+                    Notification_Class_UEvent_Notify(event_data, &dest);
                 }
             }
         }
@@ -930,8 +941,12 @@ void Notification_Class_find_recipient(void)
                                .Recipient._.DeviceIdentifier;
                 /* Send who_ is request only when address of device is unknown.
                  */
-                if (!address_bind_request(DeviceID, &max_apdu, &src))
-                    Send_WhoIs(DeviceID, DeviceID);
+                if (!address_bind_request(DeviceID, &max_apdu, &src)) {
+                    /* the Who-Is of many recipients share a range */
+                    if (!bind_schedule_device(DeviceID, NULL)) {
+                        Send_WhoIs(DeviceID, DeviceID);
+                    }
+                }
             } else if (CurrentNotify->Recipient_List[idx]
                            .Recipient.RecipientType == RECIPIENT_TYPE_ADDRESS) {
             }
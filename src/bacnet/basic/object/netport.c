@@ -253,6 +253,9 @@ bool Network_Port_Name_Set(uint32_t object_instance, char *new_name)
     index = Network_Port_Instance_To_Index(object_instance);
     if (index < BACNET_NETWORK_PORTS_MAX) {
         Object_List[index].Object_Name = new_name;
+        /* a new object name is a change to the device database */
+        Device_Object_Name_Changed();
+        Device_Inc_Database_Revision();
     }
 
     return status;
@@ -342,7 +345,10 @@ bool Network_Port_Object_Instance_Number_Set(
 
     if (index < BACNET_NETWORK_PORTS_MAX) {
         if (object_instance <= BACNET_MAX_INSTANCE) {
-            Object_List[index].Instance_Number = object_instance;
+            if (Object_List[index].Instance_Number != object_instance) {
+                Object_List[index].Instance_Number = object_instance;
+                Device_Object_List_Changed();
+            }
             status = true;
         }
     }
@@ -79,6 +79,7 @@ void handler_alarm_ack(uint8_t *service_request,
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
 #if PRINT_ENABLED
     int bytes_sent = 0;
 #endif
@@ -88,14 +89,17 @@ void handler_alarm_ack(uint8_t *service_request,
     BACNET_ALARM_ACK_DATA data;
     BACNET_ERROR_CODE error_code;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -111,7 +115,7 @@ void handler_alarm_ack(uint8_t *service_request,
 #endif
     if (len < 0) {
         /* bad decoding - send an abort */
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "Alarm Ack: Bad Encoding.  Sending Abort!\n");
@@ -134,7 +138,7 @@ void handler_alarm_ack(uint8_t *service_request,
        discussions can be directed to edward@bac-test.com */
     if (!Device_Valid_Object_Id(data.eventObjectIdentifier.type,
             data.eventObjectIdentifier.instance)) {
-        len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = bacerror_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM,
             ERROR_CLASS_OBJECT, ERROR_CODE_UNKNOWN_OBJECT);
     } else if (Alarm_Ack[data.eventObjectIdentifier.type]) {
@@ -143,7 +147,7 @@ void handler_alarm_ack(uint8_t *service_request,
 
         switch (ack_result) {
             case 1:
-                len = encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+                len = encode_simple_ack(&pdu[pdu_len],
                     service_data->invoke_id,
                     SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM);
 #if PRINT_ENABLED
@@ -154,7 +158,7 @@ void handler_alarm_ack(uint8_t *service_request,
                 break;
 
             case -1:
-                len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                len = bacerror_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id,
                     SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM, ERROR_CLASS_OBJECT,
                     error_code);
@@ -165,7 +169,7 @@ void handler_alarm_ack(uint8_t *service_request,
                 break;
 
             default:
-                len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                len = abort_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
                 fprintf(stderr, "Alarm Acknowledge: abort other!\n");
@@ -173,7 +177,7 @@ void handler_alarm_ack(uint8_t *service_request,
                 break;
         }
     } else {
-        len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = bacerror_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM,
             ERROR_CLASS_OBJECT, ERROR_CODE_NO_ALARM_CONFIGURED);
 #if PRINT_ENABLED
@@ -187,8 +191,7 @@ AA_ABORT:
 #if PRINT_ENABLED
     bytes_sent =
 #endif
-        datalink_send_pdu(
-            src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr,
@@ -196,6 +199,7 @@ AA_ABORT:
             "Failed to send PDU (%s)!\n",
             strerror(errno));
 #endif
+    tsm_pdu_release(pdu);
 
     return;
 }
@@ -108,6 +108,24 @@ void apdu_set_confirmed_handler(
     }
 }
 
+/* Runs the confirmed function handlers, if set */
+static confirmed_dispatch_function Confirmed_Dispatch;
+/* The received packet of the APDU being handled by this thread, if any */
+static BACNET_THREAD_LOCAL BACNET_PACKET *APDU_Packet;
+
+/**
+ * @brief Set a function that runs the handlers of confirmed services,
+ * instead of the APDU handler calling them, such as to run them on a
+ * pool of worker threads.
+ *
+ * @param pFunction  Pointer to the function, or NULL to call the
+ *                   handlers directly.
+ */
+void apdu_set_confirmed_dispatch(confirmed_dispatch_function pFunction)
+{
+    Confirmed_Dispatch = pFunction;
+}
+
 /* Allow the APDU handler to automatically reject */
 static confirmed_function Unrecognized_Service_Handler;
 
@@ -479,6 +497,41 @@ static bool apdu_unconfirmed_dcc_disabled(uint8_t service_choice)
     return status;
 }
 
+/** Invoke the handler of a decoded confirmed service request.
+ *
+ * @param service_choice [in] The confirmed service choice.
+ * @param service_request [in] The service request, or NULL if empty.
+ * @param service_request_len [in] The length of the service request.
+ * @param src [in] The BACNET_ADDRESS of the message's source.
+ * @param service_data [in] The decoded header of the request.
+ */
+static void apdu_handler_confirmed_service(uint8_t service_choice,
+    uint8_t *service_request,
+    uint16_t service_request_len,
+    BACNET_ADDRESS *src,
+    BACNET_CONFIRMED_SERVICE_DATA *service_data)
+{
+    if (apdu_confirmed_dcc_disabled(service_choice)) {
+        /* When network communications are completely disabled,
+           only DeviceCommunicationControl and ReinitializeDevice
+           APDUs shall be processed and no messages shall be
+           initiated. */
+        return;
+    }
+    if ((service_choice < MAX_BACNET_CONFIRMED_SERVICE) &&
+        (Confirmed_Function[service_choice]) && (Confirmed_Dispatch)) {
+        Confirmed_Dispatch(service_choice, Confirmed_Function[service_choice],
+            service_request, service_request_len, src, service_data);
+    } else if ((service_choice < MAX_BACNET_CONFIRMED_SERVICE) &&
+        (Confirmed_Function[service_choice])) {
+        Confirmed_Function[service_choice](
+            service_request, service_request_len, src, service_data);
+    } else if (Unrecognized_Service_Handler) {
+        Unrecognized_Service_Handler(
+            service_request, service_request_len, src, service_data);
+    }
+}
+
 /** Process the APDU header and invoke the appropriate service handler
  * to manage the received request.
  * Almost all requests and ACKs invoke this function.
@@ -513,21 +566,8 @@ void apdu_handler(BACNET_ADDRESS *src,
                 (void)apdu_decode_confirmed_service_request(&apdu[0], apdu_len,
                     &service_data, &service_choice, &service_request,
                     &service_request_len);
-                if (apdu_confirmed_dcc_disabled(service_choice)) {
-                    /* When network communications are completely disabled,
-                       only DeviceCommunicationControl and ReinitializeDevice
-                       APDUs shall be processed and no messages shall be
-                       initiated. */
-                    break;
-                }
-                if ((service_choice < MAX_BACNET_CONFIRMED_SERVICE) &&
-                    (Confirmed_Function[service_choice])) {
-                    Confirmed_Function[service_choice](service_request,
-                        service_request_len, src, &service_data);
-                } else if (Unrecognized_Service_Handler) {
-                    Unrecognized_Service_Handler(service_request,
-                        service_request_len, src, &service_data);
-                }
+                apdu_handler_confirmed_service(service_choice,
+                    service_request, service_request_len, src, &service_data);
                 break;
             case PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST:
                 if (apdu_len >= 2) {
@@ -581,7 +621,7 @@ void apdu_handler(BACNET_ADDRESS *src,
                                 Confirmed_ACK_Function[service_choice].simple(
                                     src, invoke_id);
                             }
-                            tsm_free_invoke_id(invoke_id);
+                            tsm_free_invoke_id_peer(src, invoke_id);
                             break;
                         default:
                             break;
@@ -603,6 +643,17 @@ void apdu_handler(BACNET_ADDRESS *src,
                     service_choice = apdu[len++];
                     service_request = &apdu[len];
                     service_request_len = apdu_len - (uint16_t)len;
+#if BACNET_SEGMENTATION_ENABLED
+                    if (service_ack_data.segmented_message) {
+                        /* the handler only sees the complete response */
+                        if (!tsm_segmented_ack_received(src,
+                                &service_ack_data, service_choice,
+                                service_request, service_request_len,
+                                &service_request, &service_request_len)) {
+                            break;
+                        }
+                    }
+#endif
                     switch (service_choice) {
                         case SERVICE_CONFIRMED_GET_ALARM_SUMMARY:
                         case SERVICE_CONFIRMED_GET_ENROLLMENT_SUMMARY:
@@ -628,7 +679,7 @@ void apdu_handler(BACNET_ADDRESS *src,
                                     service_request, service_request_len, src,
                                     &service_ack_data);
                             }
-                            tsm_free_invoke_id(invoke_id);
+                            tsm_free_invoke_id_peer(src, invoke_id);
                             break;
                         default:
                             break;
@@ -636,9 +687,17 @@ void apdu_handler(BACNET_ADDRESS *src,
                 }
                 break;
             case PDU_TYPE_SEGMENT_ACK:
-                /* FIXME: what about a denial of service attack here?
-                   we could check src to see if that matched the tsm */
-                tsm_free_invoke_id(invoke_id);
+                if (apdu_len >= 4) {
+                    server = apdu[0] & 0x01;
+                    invoke_id = apdu[1];
+#if BACNET_SEGMENTATION_ENABLED
+                    if (!server) {
+                        /* a client acknowledged segments of our response */
+                        tsm_segment_ack_received(
+                            src, invoke_id, apdu[2], apdu[3]);
+                    }
+#endif
+                }
                 break;
             case PDU_TYPE_ERROR:
                 if (apdu_len >= 3) {
@@ -707,7 +766,7 @@ void apdu_handler(BACNET_ADDRESS *src,
                                 (BACNET_ERROR_CODE)error_code);
                         }
                     }
-                    tsm_free_invoke_id(invoke_id);
+                    tsm_free_invoke_id_peer(src, invoke_id);
                 }
                 break;
             case PDU_TYPE_REJECT:
@@ -717,7 +776,7 @@ void apdu_handler(BACNET_ADDRESS *src,
                     if (Reject_Function) {
                         Reject_Function(src, invoke_id, reason);
                     }
-                    tsm_free_invoke_id(invoke_id);
+                    tsm_free_invoke_id_peer(src, invoke_id);
                 }
                 break;
             case PDU_TYPE_ABORT:
@@ -728,7 +787,15 @@ void apdu_handler(BACNET_ADDRESS *src,
                     if (Abort_Function) {
                         Abort_Function(src, invoke_id, reason, server);
                     }
-                    tsm_free_invoke_id(invoke_id);
+                    if (server) {
+                        tsm_free_invoke_id_peer(src, invoke_id);
+                    }
+#if BACNET_SEGMENTATION_ENABLED
+                    else {
+                        /* a client aborted our response */
+                        tsm_segmented_response_abort(src, invoke_id);
+                    }
+#endif
                 }
                 break;
             default:
@@ -737,3 +804,58 @@ void apdu_handler(BACNET_ADDRESS *src,
     }
     return;
 }
+
+/** Process the APDU of a received packet, in place in the buffer of
+ * the datalink. While its handlers run, apdu_packet() returns the
+ * packet, so that one that defers the service, such as to a worker
+ * thread, can retain it instead of copying the request. A confirmed
+ * request whose header the datalink parsed goes to its service
+ * handler without decoding the APDU header again.
+ * @ingroup MISCHNDLR
+ *
+ * @param packet [in] The received packet, with its APDU offset set.
+ */
+void apdu_handler_packet(BACNET_PACKET *packet)
+{
+    BACNET_PACKET *outer = APDU_Packet;
+    BACNET_PACKET_HEADER *header = NULL;
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    uint8_t *service_request = NULL;
+    uint16_t service_request_len = 0;
+
+    if (!packet || (packet->apdu_offset >= packet->length)) {
+        return;
+    }
+    APDU_Packet = packet;
+    header = &packet->header;
+    if (header->valid &&
+        ((header->pdu_type & 0xF0) == PDU_TYPE_CONFIRMED_SERVICE_REQUEST)) {
+        service_data.segmented_response_accepted =
+            (header->pdu_type & BIT(1)) ? true : false;
+        service_data.max_segs = decode_max_segs(header->max_segs_max_apdu);
+        service_data.max_resp = decode_max_apdu(header->max_segs_max_apdu);
+        service_data.invoke_id = header->invoke_id;
+        if (header->service_offset < packet->length) {
+            service_request = &packet->buffer[header->service_offset];
+            service_request_len =
+                (uint16_t)(packet->length - header->service_offset);
+        }
+        apdu_handler_confirmed_service(header->service_choice,
+            service_request, service_request_len, &packet->src,
+            &service_data);
+    } else {
+        apdu_handler(&packet->src, &packet->buffer[packet->apdu_offset],
+            (uint16_t)(packet->length - packet->apdu_offset));
+    }
+    APDU_Packet = outer;
+}
+
+/** The received packet whose APDU this thread is handling.
+ *
+ * @return Pointer to the packet given to apdu_handler_packet(), or NULL
+ *  if the APDU was given to apdu_handler() alone.
+ */
+BACNET_PACKET *apdu_packet(void)
+{
+    return APDU_Packet;
+}
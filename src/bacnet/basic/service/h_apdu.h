@@ -34,6 +34,7 @@
 #include "bacnet/bacdef.h"
 #include "bacnet/bacenum.h"
 #include "bacnet/apdu.h"
+#include "bacnet/basic/sys/pktbuf.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -74,6 +75,18 @@ extern "C" {
         BACNET_ADDRESS * src,
         BACNET_CONFIRMED_SERVICE_DATA * service_data);
 
+/* runs the handler of a confirmed service request, such as on a pool */
+/* of worker threads, which then has to retain apdu_packet() or copy */
+/* what it points to */
+    typedef void (
+        *confirmed_dispatch_function) (
+        uint8_t service_choice,
+        confirmed_function handler,
+        uint8_t * service_request,
+        uint16_t service_len,
+        BACNET_ADDRESS * src,
+        BACNET_CONFIRMED_SERVICE_DATA * service_data);
+
 /* generic confirmed simple ack function handler */
     typedef void (
         *confirmed_simple_ack_function) (
@@ -136,6 +149,10 @@ extern "C" {
         BACNET_UNCONFIRMED_SERVICE service_choice,
         unconfirmed_function pFunction);
 
+    BACNET_STACK_EXPORT
+    void apdu_set_confirmed_dispatch(
+        confirmed_dispatch_function pFunction);
+
 /* returns true if the service is supported by a handler */
     BACNET_STACK_EXPORT
     bool apdu_service_supported(
@@ -191,6 +208,12 @@ extern "C" {
         BACNET_ADDRESS * src,   /* source address */
         uint8_t * apdu, /* APDU data */
         uint16_t pdu_len);      /* for confirmed messages */
+    BACNET_STACK_EXPORT
+    void apdu_handler_packet(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
+    BACNET_PACKET *apdu_packet(
+        void);
 
 #ifdef __cplusplus
 }
@@ -105,6 +105,7 @@ void handler_atomic_read_file(uint8_t *service_request,
     BACNET_ATOMIC_READ_FILE_DATA data;
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     bool error = false;
     int bytes_sent = 0;
     BACNET_NPDU_DATA npdu_data;
@@ -115,13 +116,16 @@ void handler_atomic_read_file(uint8_t *service_request,
 #if PRINT_ENABLED
     fprintf(stderr, "Received Atomic-Read-File Request!\n");
 #endif
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (service_data->segmented_message) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -132,7 +136,7 @@ void handler_atomic_read_file(uint8_t *service_request,
     len = arf_decode_service_request(service_request, service_len, &data);
     /* bad decoding - send an abort */
     if (len < 0) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "Bad Encoding. Sending Abort!\n");
@@ -151,10 +155,10 @@ void handler_atomic_read_file(uint8_t *service_request,
                     (int)data.type.stream.fileStartPosition,
                     (int)data.type.stream.requestedOctetCount);
 #endif
-                len = arf_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                len = arf_ack_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, &data);
             } else {
-                len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                len = abort_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id,
                     ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
 #if PRINT_ENABLED
@@ -175,7 +179,7 @@ void handler_atomic_read_file(uint8_t *service_request,
                     (int)data.type.record.fileStartRecord,
                     (int)data.type.record.RecordCount);
 #endif
-                len = arf_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                len = arf_ack_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, &data);
             } else {
                 error = true;
@@ -196,19 +200,19 @@ void handler_atomic_read_file(uint8_t *service_request,
         error_code = ERROR_CODE_INCONSISTENT_OBJECT_TYPE;
     }
     if (error) {
-        len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = bacerror_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_ATOMIC_READ_FILE,
             error_class, error_code);
     }
 ARF_ABORT:
     pdu_len += len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
     }
 #endif
+    tsm_pdu_release(pdu);
 
     return;
 }
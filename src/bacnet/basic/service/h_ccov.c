@@ -73,6 +73,7 @@ void handler_ccov_notification(uint8_t *service_request,
 #endif
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
 
@@ -80,16 +81,19 @@ void handler_ccov_notification(uint8_t *service_request,
        than one property value is expected */
     bacapp_property_value_list_init(&property_value[0], MAX_COV_PROPERTIES);
     cov_data.listOfValues = &property_value[0];
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
 #if PRINT_ENABLED
     fprintf(stderr, "CCOV: Received Notification!\n");
 #endif
     if (service_data->segmented_message) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -129,14 +133,14 @@ void handler_ccov_notification(uint8_t *service_request,
 #endif
     /* bad decoding or something we didn't understand - send an abort */
     if (len <= 0) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "CCOV: Bad Encoding. Sending Abort!\n");
 #endif
         goto CCOV_ABORT;
     } else {
-        len = encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+        len = encode_simple_ack(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_COV_NOTIFICATION);
 #if PRINT_ENABLED
         fprintf(stderr, "CCOV: Sending Simple Ack!\n");
@@ -144,8 +148,7 @@ void handler_ccov_notification(uint8_t *service_request,
     }
 CCOV_ABORT:
     pdu_len += len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
         fprintf(stderr, "CCOV: Failed to send PDU (%s)!\n", strerror(errno));
@@ -153,6 +156,7 @@ CCOV_ABORT:
 #else
     bytes_sent = bytes_sent;
 #endif
+    tsm_pdu_release(pdu);
 
     return;
 }
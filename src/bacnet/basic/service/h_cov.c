@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include "bacnet/config.h"
@@ -42,6 +43,7 @@
 #include "bacnet/bactext.h"
 #endif
 /* basic objects, services, TSM, and datalink */
+#include "bacnet/basic/sys/keyhash.h"
 #include "bacnet/basic/tsm/tsm.h"
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/services.h"
@@ -53,8 +55,9 @@
 
 /** @file h_cov.c  Handles Change of Value (COV) services. */
 
+/* a recipient address, shared by all of its subscriptions */
 typedef struct BACnet_COV_Address {
-    bool valid : 1;
+    unsigned refcount; /* number of subscriptions using this address */
     BACNET_ADDRESS dest;
 } BACNET_COV_ADDRESS;
 
@@ -64,117 +67,382 @@ typedef struct BACnet_COV_Subscription_Flags {
     bool valid : 1;
     bool issueConfirmedNotifications : 1; /* optional */
     bool send_requested : 1;
+    bool pending : 1; /* member of the pending notification queue */
+    bool parked : 1; /* member of the list waiting for the TSM */
 } BACNET_COV_SUBSCRIPTION_FLAGS;
 
 typedef struct BACnet_COV_Subscription {
     BACNET_COV_SUBSCRIPTION_FLAGS flag;
-    unsigned dest_index;
+    BACNET_COV_ADDRESS *dest;
+    KEY key; /* hash of the address, process, and object */
     uint8_t invokeID; /* for confirmed COV */
     uint32_t subscriberProcessIdentifier;
     uint32_t lifetime; /* optional */
     BACNET_OBJECT_ID monitoredObjectIdentifier;
+    /* subscriptions monitoring the same object */
+    struct BACnet_COV_Subscription *next_object;
+    struct BACnet_COV_Subscription *prev_object;
+    /* next subscription in the pending notification queue,
+       or in the list waiting for the TSM */
+    struct BACnet_COV_Subscription *next_pending;
 } BACNET_COV_SUBSCRIPTION;
 
+/* search context for a subscription */
+typedef struct BACnet_COV_Subscription_Match {
+    BACNET_ADDRESS *src;
+    uint32_t subscriberProcessIdentifier;
+    BACNET_OBJECT_ID *monitoredObjectIdentifier;
+} BACNET_COV_SUBSCRIPTION_MATCH;
+
+/* optional limits on the number of subscriptions and recipient
+   addresses - zero means limited only by available memory */
 #ifndef MAX_COV_SUBCRIPTIONS
-#define MAX_COV_SUBCRIPTIONS 128
+#define MAX_COV_SUBCRIPTIONS 0
 #endif
-static BACNET_COV_SUBSCRIPTION COV_Subscriptions[MAX_COV_SUBCRIPTIONS];
 #ifndef MAX_COV_ADDRESSES
-#define MAX_COV_ADDRESSES 16
+#define MAX_COV_ADDRESSES 0
 #endif
-static BACNET_COV_ADDRESS COV_Addresses[MAX_COV_ADDRESSES];
+/* subscriptions keyed by subscriber address, process ID, and object */
+static OS_Keyhash COV_Subscription_List;
+/* first subscription for each monitored object, keyed by object ID */
+static OS_Keyhash COV_Object_List;
+/* recipient addresses keyed by address */
+static OS_Keyhash COV_Address_List;
+/* FIFO of subscriptions that need a notification or TSM housekeeping */
+static BACNET_COV_SUBSCRIPTION *COV_Pending_Head;
+static BACNET_COV_SUBSCRIPTION *COV_Pending_Tail;
+/* subscriptions whose confirmed notification waits for the TSM */
+static BACNET_COV_SUBSCRIPTION *COV_Parked_Head;
+
+/**
+ * Creates the COV lists, if they do not exist yet
+ *
+ * @return true if the lists exist
+ */
+static bool cov_list_create(void)
+{
+    if (!COV_Subscription_List) {
+        COV_Subscription_List = Keyhash_Create();
+    }
+    if (!COV_Object_List) {
+        COV_Object_List = Keyhash_Create();
+    }
+    if (!COV_Address_List) {
+        COV_Address_List = Keyhash_Create();
+    }
+
+    return COV_Subscription_List && COV_Object_List && COV_Address_List;
+}
 
 /**
- * Gets the address from the list of COV addresses
+ * Compares a COV address to a BACnet address
  *
- * @param  index - offset into COV address list where address is stored
- * @param  dest - address to be filled when found
+ * @param  data - COV address stored in the list
+ * @param  context - BACnet address to compare
  *
- * @return true if valid address, false if not valid or not found
+ * @return true if the addresses are the same
  */
-static BACNET_ADDRESS *cov_address_get(unsigned index)
+static bool cov_address_match(void *data, const void *context)
 {
-    BACNET_ADDRESS *cov_dest = NULL;
+    BACNET_COV_ADDRESS *cov_address = data;
 
-    if (index < MAX_COV_ADDRESSES) {
-        if (COV_Addresses[index].valid) {
-            cov_dest = &COV_Addresses[index].dest;
+    return bacnet_address_same(&cov_address->dest, (BACNET_ADDRESS *)context);
+}
+
+/**
+ * Compares list data to a pointer
+ *
+ * @param  data - data stored in the list
+ * @param  context - pointer to compare
+ *
+ * @return true if the data is the pointer
+ */
+static bool cov_pointer_match(void *data, const void *context)
+{
+    return (data == context);
+}
+
+/**
+ * Removes one use of a COV address, and frees the address
+ * when it is no longer used by any COV subscription
+ *
+ * @param  cov_address - address to be released
+ */
+static void cov_address_release(BACNET_COV_ADDRESS *cov_address)
+{
+    if (cov_address) {
+        if (cov_address->refcount) {
+            cov_address->refcount--;
+        }
+        if (cov_address->refcount == 0) {
+            (void)Keyhash_Data_Delete_Match(COV_Address_List,
+                bacnet_address_hash(&cov_address->dest), cov_pointer_match,
+                cov_address);
+            free(cov_address);
         }
     }
-
-    return cov_dest;
 }
 
 /**
- * Removes the address from the list of COV addresses, if it is not
- * used by other COV subscriptions
+ * Adds one use of an address to the list of COV addresses
+ *
+ * @param  dest - address to be added if there is room in the list
+ *
+ * @return the shared COV address, or NULL if unable to add
  */
-static void cov_address_remove_unused(void)
+static BACNET_COV_ADDRESS *cov_address_add(BACNET_ADDRESS *dest)
 {
-    unsigned index = 0;
-    unsigned cov_index = 0;
-    bool found = false;
+    BACNET_COV_ADDRESS *cov_address = NULL;
+    KEY key;
 
-    for (cov_index = 0; cov_index < MAX_COV_ADDRESSES; cov_index++) {
-        if (COV_Addresses[cov_index].valid) {
-            found = false;
-            for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-                if ((COV_Subscriptions[index].flag.valid) &&
-                    (COV_Subscriptions[index].dest_index == cov_index)) {
-                    found = true;
-                    break;
-                }
+    if (dest) {
+        key = bacnet_address_hash(dest);
+        cov_address = Keyhash_Data_Match(
+            COV_Address_List, key, cov_address_match, dest);
+        if (!cov_address) {
+            if ((MAX_COV_ADDRESSES) &&
+                (Keyhash_Count(COV_Address_List) >= MAX_COV_ADDRESSES)) {
+                return NULL;
             }
-            if (!found) {
-                COV_Addresses[cov_index].valid = false;
+            cov_address = calloc(1, sizeof(BACNET_COV_ADDRESS));
+            if (!cov_address) {
+                return NULL;
+            }
+            bacnet_address_copy(&cov_address->dest, dest);
+            if (Keyhash_Data_Add(COV_Address_List, key, cov_address) < 0) {
+                free(cov_address);
+                return NULL;
             }
         }
+        cov_address->refcount++;
     }
+
+    return cov_address;
 }
 
 /**
- * Adds the address to the list of COV addresses
+ * Computes the key of a subscription from its
+ * subscriber address, process ID, and monitored object
  *
- * @param  dest - address to be added if there is room in the list
+ * @param  src - address of the subscriber
+ * @param  process_id - subscriber process identifier
+ * @param  object_id - monitored object identifier
  *
- * @return index number 0..N, or -1 if unable to add
+ * @return hash key of the subscription
  */
-static int cov_address_add(BACNET_ADDRESS *dest)
+static KEY cov_subscription_key(
+    BACNET_ADDRESS *src, uint32_t process_id, BACNET_OBJECT_ID *object_id)
 {
-    int index = -1;
-    unsigned i = 0;
-    bool found = false;
-    bool valid = false;
-    BACNET_ADDRESS *cov_dest = NULL;
+    KEY key;
+    KEY object_key;
 
-    if (dest) {
-        for (i = 0; i < MAX_COV_ADDRESSES; i++) {
-            valid = COV_Addresses[i].valid;
-            if (valid) {
-                cov_dest = &COV_Addresses[i].dest;
-                found = bacnet_address_same(dest, cov_dest);
-                if (found) {
-                    index = i;
-                    break;
-                }
-            }
+    object_key = KEY_ENCODE(object_id->type, object_id->instance);
+    key = bacnet_address_hash(src);
+    key = Keyhash_Hash(key, &process_id, sizeof(process_id));
+    key = Keyhash_Hash(key, &object_key, sizeof(object_key));
+
+    return key;
+}
+
+/**
+ * Compares a subscription to a search context
+ *
+ * @param  data - subscription stored in the list
+ * @param  context - subscriber address, process ID, and monitored object
+ *
+ * @return true if the subscription matches
+ */
+static bool cov_subscription_match(void *data, const void *context)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription = data;
+    const BACNET_COV_SUBSCRIPTION_MATCH *match = context;
+
+    return (cov_subscription->monitoredObjectIdentifier.type ==
+               match->monitoredObjectIdentifier->type) &&
+        (cov_subscription->monitoredObjectIdentifier.instance ==
+            match->monitoredObjectIdentifier->instance) &&
+        (cov_subscription->subscriberProcessIdentifier ==
+            match->subscriberProcessIdentifier) &&
+        bacnet_address_same(&cov_subscription->dest->dest, match->src);
+}
+
+/**
+ * Adds a subscription to the monitored object index
+ *
+ * @param  cov_subscription - subscription to be added
+ */
+static bool cov_object_index_add(BACNET_COV_SUBSCRIPTION *cov_subscription)
+{
+    BACNET_COV_SUBSCRIPTION *head;
+    KEY key;
+
+    key = KEY_ENCODE(cov_subscription->monitoredObjectIdentifier.type,
+        cov_subscription->monitoredObjectIdentifier.instance);
+    head = Keyhash_Data(COV_Object_List, key);
+    cov_subscription->prev_object = head;
+    cov_subscription->next_object = NULL;
+    if (head) {
+        /* insert after the head, which stays in the index */
+        cov_subscription->next_object = head->next_object;
+        if (head->next_object) {
+            head->next_object->prev_object = cov_subscription;
         }
-        if (!found) {
-            /* find a free place to add a new address */
-            for (i = 0; i < MAX_COV_ADDRESSES; i++) {
-                valid = COV_Addresses[i].valid;
-                if (!valid) {
-                    index = i;
-                    cov_dest = &COV_Addresses[i].dest;
-                    bacnet_address_copy(cov_dest, dest);
-                    COV_Addresses[i].valid = true;
-                    break;
-                }
-            }
+        head->next_object = cov_subscription;
+    } else if (Keyhash_Data_Add(COV_Object_List, key, cov_subscription) < 0) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Removes a subscription from the monitored object index
+ *
+ * @param  cov_subscription - subscription to be removed
+ */
+static void cov_object_index_remove(BACNET_COV_SUBSCRIPTION *cov_subscription)
+{
+    BACNET_COV_SUBSCRIPTION *next;
+    KEY key;
+
+    next = cov_subscription->next_object;
+    if (next) {
+        next->prev_object = cov_subscription->prev_object;
+    }
+    if (cov_subscription->prev_object) {
+        cov_subscription->prev_object->next_object = next;
+    } else {
+        /* the head of the object list - next one is the new head */
+        key = KEY_ENCODE(cov_subscription->monitoredObjectIdentifier.type,
+            cov_subscription->monitoredObjectIdentifier.instance);
+        (void)Keyhash_Data_Delete(COV_Object_List, key);
+        if (next) {
+            (void)Keyhash_Data_Add(COV_Object_List, key, next);
+        }
+    }
+    cov_subscription->next_object = NULL;
+    cov_subscription->prev_object = NULL;
+}
+
+/**
+ * Appends a subscription to the pending notification queue,
+ * unless it is already waiting there, or waiting for the TSM, which
+ * queues it again when its confirmed notification is done.
+ *
+ * @param  cov_subscription - subscription to be queued
+ */
+static void cov_pending_add(BACNET_COV_SUBSCRIPTION *cov_subscription)
+{
+    if (cov_subscription->flag.pending || cov_subscription->flag.parked) {
+        return;
+    }
+    cov_subscription->flag.pending = true;
+    cov_subscription->next_pending = NULL;
+    if (COV_Pending_Tail) {
+        COV_Pending_Tail->next_pending = cov_subscription;
+    } else {
+        COV_Pending_Head = cov_subscription;
+    }
+    COV_Pending_Tail = cov_subscription;
+}
+
+/**
+ * Removes the first subscription from the pending notification queue
+ *
+ * @return subscription, or NULL if the queue is empty
+ */
+static BACNET_COV_SUBSCRIPTION *cov_pending_pop(void)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription = COV_Pending_Head;
+
+    if (cov_subscription) {
+        COV_Pending_Head = cov_subscription->next_pending;
+        if (!COV_Pending_Head) {
+            COV_Pending_Tail = NULL;
         }
+        cov_subscription->next_pending = NULL;
+        cov_subscription->flag.pending = false;
     }
 
-    return index;
+    return cov_subscription;
+}
+
+/**
+ * Parks a subscription whose confirmed notification is outstanding, or
+ * waits for a transaction of the TSM, so that the queue does not spin
+ * on it until the TSM is done.
+ *
+ * @param  cov_subscription - subscription to be parked
+ */
+static void cov_parked_add(BACNET_COV_SUBSCRIPTION *cov_subscription)
+{
+    cov_subscription->flag.parked = true;
+    cov_subscription->next_pending = COV_Parked_Head;
+    COV_Parked_Head = cov_subscription;
+}
+
+/**
+ * Determines if the TSM is done with the confirmed notification of a
+ * parked subscription, or it was parked without one.
+ *
+ * @param  cov_subscription - the parked subscription
+ *
+ * @return true if the subscription may be queued again
+ */
+static bool cov_parked_done(BACNET_COV_SUBSCRIPTION *cov_subscription)
+{
+    BACNET_ADDRESS *dest = &cov_subscription->dest->dest;
+
+    return (cov_subscription->invokeID == 0) ||
+        tsm_invoke_id_free_peer(dest, cov_subscription->invokeID) ||
+        tsm_invoke_id_failed_peer(dest, cov_subscription->invokeID);
+}
+
+/**
+ * Queues the parked subscriptions whose confirmed notification the TSM
+ * is done with, and frees those that were cancelled while parked.
+ */
+static void cov_parked_release(void)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription = COV_Parked_Head;
+    BACNET_COV_SUBSCRIPTION *next;
+
+    COV_Parked_Head = NULL;
+    while (cov_subscription) {
+        next = cov_subscription->next_pending;
+        cov_subscription->next_pending = NULL;
+        cov_subscription->flag.parked = false;
+        if (!cov_subscription->flag.valid) {
+            free(cov_subscription);
+        } else if (cov_parked_done(cov_subscription)) {
+            /* the queue frees the invoke ID, and sends what changed */
+            cov_pending_add(cov_subscription);
+        } else {
+            cov_parked_add(cov_subscription);
+        }
+        cov_subscription = next;
+    }
+}
+
+/**
+ * Removes a subscription from the lists and releases its resources.
+ * A subscription still in the pending queue, or parked, is freed when
+ * it is taken from there.
+ *
+ * @param  cov_subscription - subscription to be freed
+ */
+static void cov_subscription_free(BACNET_COV_SUBSCRIPTION *cov_subscription)
+{
+    (void)Keyhash_Data_Delete_Match(COV_Subscription_List,
+        cov_subscription->key, cov_pointer_match, cov_subscription);
+    cov_object_index_remove(cov_subscription);
+    cov_address_release(cov_subscription->dest);
+    cov_subscription->dest = NULL;
+    cov_subscription->flag.valid = false;
+    cov_subscription->flag.send_requested = false;
+    if (!cov_subscription->flag.pending && !cov_subscription->flag.parked) {
+        free(cov_subscription);
+    }
 }
 
 /*
@@ -213,13 +481,10 @@ static int cov_encode_subscription(
     BACNET_ADDRESS *dest = NULL;
 
     (void)max_apdu;
-    if (!cov_subscription) {
-        return 0;
-    }
-    dest = cov_address_get(cov_subscription->dest_index);
-    if (!dest) {
+    if ((!cov_subscription) || (!cov_subscription->dest)) {
         return 0;
     }
+    dest = &cov_subscription->dest->dest;
     /* Recipient [0] BACnetRecipientProcess - opening */
     len = encode_opening_tag(&apdu[apdu_len], 0);
     apdu_len += len;
@@ -297,18 +562,20 @@ int handler_cov_encode_subscriptions(uint8_t *apdu, int max_apdu)
 {
     int len = 0;
     int apdu_len = 0;
-    unsigned index = 0;
+    int index = 0;
+    BACNET_COV_SUBSCRIPTION *cov_subscription;
 
     if (apdu) {
-        for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-            if (COV_Subscriptions[index].flag.valid) {
-                len = cov_encode_subscription(&apdu[apdu_len],
-                    max_apdu - apdu_len, &COV_Subscriptions[index]);
-                apdu_len += len;
-                /* TODO: too late here to notice that we overran the buffer */
-                if (apdu_len > max_apdu) {
-                    return -2;
-                }
+        for (index = 0; index < Keyhash_Count(COV_Subscription_List);
+             index++) {
+            cov_subscription =
+                Keyhash_Data_Index(COV_Subscription_List, index);
+            len = cov_encode_subscription(
+                &apdu[apdu_len], max_apdu - apdu_len, cov_subscription);
+            apdu_len += len;
+            /* TODO: too late here to notice that we overran the buffer */
+            if (apdu_len > max_apdu) {
+                return -2;
             }
         }
     }
@@ -316,29 +583,33 @@ int handler_cov_encode_subscriptions(uint8_t *apdu, int max_apdu)
     return apdu_len;
 }
 
-/** Handler to initialize the COV list, clearing and disabling each entry.
+/** Handler to initialize the COV list, clearing and freeing each entry.
  * @ingroup DSCOV
  */
 void handler_cov_init(void)
 {
-    unsigned index = 0;
-
-    for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-        /* initialize with invalid COV address */
-        COV_Subscriptions[index].flag.valid = false;
-        COV_Subscriptions[index].dest_index = MAX_COV_ADDRESSES;
-        COV_Subscriptions[index].subscriberProcessIdentifier = 0;
-        COV_Subscriptions[index].monitoredObjectIdentifier.type =
-            OBJECT_ANALOG_INPUT;
-        COV_Subscriptions[index].monitoredObjectIdentifier.instance = 0;
-        COV_Subscriptions[index].flag.issueConfirmedNotifications = false;
-        COV_Subscriptions[index].invokeID = 0;
-        COV_Subscriptions[index].lifetime = 0;
-        COV_Subscriptions[index].flag.send_requested = false;
-    }
-    for (index = 0; index < MAX_COV_ADDRESSES; index++) {
-        COV_Addresses[index].valid = false;
+    BACNET_COV_SUBSCRIPTION *cov_subscription;
+
+    /* free the cancelled subscriptions still waiting in the queue,
+       or for the TSM */
+    while ((cov_subscription = cov_pending_pop()) != NULL) {
+        if (!cov_subscription->flag.valid) {
+            free(cov_subscription);
+        }
     }
+    while ((cov_subscription = COV_Parked_Head) != NULL) {
+        COV_Parked_Head = cov_subscription->next_pending;
+        cov_subscription->next_pending = NULL;
+        cov_subscription->flag.parked = false;
+        if (!cov_subscription->flag.valid) {
+            free(cov_subscription);
+        }
+    }
+    while (Keyhash_Count(COV_Subscription_List)) {
+        cov_subscription = Keyhash_Data_Index(COV_Subscription_List, 0);
+        cov_subscription_free(cov_subscription);
+    }
+    (void)cov_list_create();
 }
 
 static bool cov_list_subscribe(BACNET_ADDRESS *src,
@@ -346,88 +617,90 @@ static bool cov_list_subscribe(BACNET_ADDRESS *src,
     BACNET_ERROR_CLASS *error_class,
     BACNET_ERROR_CODE *error_code)
 {
-    bool existing_entry = false;
-    int index;
-    int first_invalid_index = -1;
     bool found = true;
-    bool address_match = false;
-    BACNET_ADDRESS *dest = NULL;
-
-    /* unable to subscribe - resources? */
-    /* unable to cancel subscription - other? */
+    KEY key;
+    BACNET_COV_SUBSCRIPTION_MATCH match;
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
 
+    if (!cov_list_create()) {
+        /* Out of resources */
+        *error_class = ERROR_CLASS_RESOURCES;
+        *error_code = ERROR_CODE_NO_SPACE_TO_ADD_LIST_ELEMENT;
+        return false;
+    }
     /* existing? - match Object ID and Process ID and address */
-    for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-        if (COV_Subscriptions[index].flag.valid) {
-            dest = cov_address_get(COV_Subscriptions[index].dest_index);
-            if (dest) {
-                address_match = bacnet_address_same(src, dest);
-            } else {
-                /* skip address matching - we don't have an address */
-                address_match = true;
-            }
-            if ((COV_Subscriptions[index].monitoredObjectIdentifier.type ==
-                    cov_data->monitoredObjectIdentifier.type) &&
-                (COV_Subscriptions[index].monitoredObjectIdentifier.instance ==
-                    cov_data->monitoredObjectIdentifier.instance) &&
-                (COV_Subscriptions[index].subscriberProcessIdentifier ==
-                    cov_data->subscriberProcessIdentifier) &&
-                address_match) {
-                existing_entry = true;
-                if (cov_data->cancellationRequest) {
-                    /* initialize with invalid COV address */
-                    COV_Subscriptions[index].flag.valid = false;
-                    COV_Subscriptions[index].dest_index = MAX_COV_ADDRESSES;
-                    cov_address_remove_unused();
-                } else {
-                    COV_Subscriptions[index].dest_index = cov_address_add(src);
-                    COV_Subscriptions[index].flag.issueConfirmedNotifications =
-                        cov_data->issueConfirmedNotifications;
-                    COV_Subscriptions[index].lifetime = cov_data->lifetime;
-                    COV_Subscriptions[index].flag.send_requested = true;
-                }
-                if (COV_Subscriptions[index].invokeID) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
-                }
-                break;
-            }
+    match.src = src;
+    match.subscriberProcessIdentifier = cov_data->subscriberProcessIdentifier;
+    match.monitoredObjectIdentifier = &cov_data->monitoredObjectIdentifier;
+    key = cov_subscription_key(src, cov_data->subscriberProcessIdentifier,
+        &cov_data->monitoredObjectIdentifier);
+    cov_subscription = Keyhash_Data_Match(
+        COV_Subscription_List, key, cov_subscription_match, &match);
+    if (cov_subscription) {
+        if (cov_subscription->invokeID) {
+            tsm_free_invoke_id_peer(src, cov_subscription->invokeID);
+            cov_subscription->invokeID = 0;
+        }
+        if (cov_data->cancellationRequest) {
+            cov_subscription_free(cov_subscription);
         } else {
-            if (first_invalid_index < 0) {
-                first_invalid_index = index;
-            }
+            cov_subscription->flag.issueConfirmedNotifications =
+                cov_data->issueConfirmedNotifications;
+            cov_subscription->lifetime = cov_data->lifetime;
+            cov_subscription->flag.send_requested = true;
+            cov_pending_add(cov_subscription);
         }
-    }
-    if (!existing_entry && (first_invalid_index >= 0) &&
-        (!cov_data->cancellationRequest)) {
-        index = first_invalid_index;
+    } else if (cov_data->cancellationRequest) {
+        /* cancellationRequest - valid object not subscribed */
+        /* From BACnet Standard 135-2010-13.14.2
+           ...Cancellations that are issued for which no matching COV
+           context can be found shall succeed as if a context had
+           existed, returning 'Result(+)'. */
         found = true;
-        COV_Subscriptions[index].flag.valid = true;
-        COV_Subscriptions[index].dest_index = cov_address_add(src);
-        COV_Subscriptions[index].monitoredObjectIdentifier.type =
-            cov_data->monitoredObjectIdentifier.type;
-        COV_Subscriptions[index].monitoredObjectIdentifier.instance =
-            cov_data->monitoredObjectIdentifier.instance;
-        COV_Subscriptions[index].subscriberProcessIdentifier =
-            cov_data->subscriberProcessIdentifier;
-        COV_Subscriptions[index].flag.issueConfirmedNotifications =
-            cov_data->issueConfirmedNotifications;
-        COV_Subscriptions[index].invokeID = 0;
-        COV_Subscriptions[index].lifetime = cov_data->lifetime;
-        COV_Subscriptions[index].flag.send_requested = true;
-    } else if (!existing_entry) {
-        if (first_invalid_index < 0) {
+    } else {
+        if ((!MAX_COV_SUBCRIPTIONS) ||
+            (Keyhash_Count(COV_Subscription_List) < MAX_COV_SUBCRIPTIONS)) {
+            cov_subscription = calloc(1, sizeof(BACNET_COV_SUBSCRIPTION));
+        }
+        if (cov_subscription) {
+            cov_subscription->dest = cov_address_add(src);
+            if (!cov_subscription->dest) {
+                free(cov_subscription);
+                cov_subscription = NULL;
+            }
+        }
+        if (cov_subscription) {
+            cov_subscription->key = key;
+            cov_subscription->monitoredObjectIdentifier.type =
+                cov_data->monitoredObjectIdentifier.type;
+            cov_subscription->monitoredObjectIdentifier.instance =
+                cov_data->monitoredObjectIdentifier.instance;
+            cov_subscription->subscriberProcessIdentifier =
+                cov_data->subscriberProcessIdentifier;
+            if (Keyhash_Data_Add(
+                    COV_Subscription_List, key, cov_subscription) < 0) {
+                cov_address_release(cov_subscription->dest);
+                free(cov_subscription);
+                cov_subscription = NULL;
+            } else if (!cov_object_index_add(cov_subscription)) {
+                cov_subscription->flag.valid = true;
+                cov_subscription_free(cov_subscription);
+                cov_subscription = NULL;
+            }
+        }
+        if (cov_subscription) {
+            cov_subscription->flag.valid = true;
+            cov_subscription->flag.issueConfirmedNotifications =
+                cov_data->issueConfirmedNotifications;
+            cov_subscription->invokeID = 0;
+            cov_subscription->lifetime = cov_data->lifetime;
+            cov_subscription->flag.send_requested = true;
+            cov_pending_add(cov_subscription);
+        } else {
             /* Out of resources */
             *error_class = ERROR_CLASS_RESOURCES;
             *error_code = ERROR_CODE_NO_SPACE_TO_ADD_LIST_ELEMENT;
             found = false;
-        } else {
-            /* cancellationRequest - valid object not subscribed */
-            /* From BACnet Standard 135-2010-13.14.2
-               ...Cancellations that are issued for which no matching COV
-               context can be found shall succeed as if a context had
-               existed, returning 'Result(+)'. */
-            found = true;
         }
     }
 
@@ -443,6 +716,7 @@ static bool cov_send_request(BACNET_COV_SUBSCRIPTION *cov_subscription,
     BACNET_ADDRESS my_address;
     int bytes_sent = 0;
     uint8_t invoke_id = 0;
+    uint8_t *pdu = NULL;
     bool status = false; /* return value */
     BACNET_COV_DATA cov_data;
     BACNET_ADDRESS *dest = NULL;
@@ -456,17 +730,20 @@ static bool cov_send_request(BACNET_COV_SUBSCRIPTION *cov_subscription,
     if (!cov_subscription) {
         return status;
     }
-    dest = cov_address_get(cov_subscription->dest_index);
-    if (!dest) {
+    if (!cov_subscription->dest) {
 #if PRINT_ENABLED
         fprintf(stderr, "COVnotification: dest not found!\n");
 #endif
         return status;
     }
+    dest = &cov_subscription->dest->dest;
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return status;
+    }
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], dest, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], dest, &my_address, &npdu_data);
     /* load the COV data structure for outgoing message */
     cov_data.subscriberProcessIdentifier =
         cov_subscription->subscriberProcessIdentifier;
@@ -479,26 +756,25 @@ static bool cov_send_request(BACNET_COV_SUBSCRIPTION *cov_subscription,
     cov_data.listOfValues = value_list;
     if (cov_subscription->flag.issueConfirmedNotifications) {
         npdu_data.data_expecting_reply = true;
-        invoke_id = tsm_next_free_invokeID();
+        invoke_id = tsm_next_free_invokeID_peer(dest);
         if (invoke_id) {
             cov_subscription->invokeID = invoke_id;
-            len = ccov_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-                sizeof(Handler_Transmit_Buffer) - pdu_len, invoke_id,
+            len = ccov_notify_encode_apdu(&pdu[pdu_len],
+                MAX_PDU - pdu_len, invoke_id,
                 &cov_data);
         } else {
             goto COV_FAILED;
         }
     } else {
-        len = ucov_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-            sizeof(Handler_Transmit_Buffer) - pdu_len, &cov_data);
+        len = ucov_notify_encode_apdu(&pdu[pdu_len],
+            MAX_PDU - pdu_len, &cov_data);
     }
     pdu_len += len;
     if (cov_subscription->flag.issueConfirmedNotifications) {
         tsm_set_confirmed_unsegmented_transaction(invoke_id, dest, &npdu_data,
-            &Handler_Transmit_Buffer[0], (uint16_t)pdu_len);
+            &pdu[0], (uint16_t)pdu_len);
     }
-    bytes_sent = datalink_send_pdu(
-        dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(dest, &npdu_data, &pdu[0], pdu_len);
     if (bytes_sent > 0) {
         status = true;
 #if PRINT_ENABLED
@@ -507,221 +783,250 @@ static bool cov_send_request(BACNET_COV_SUBSCRIPTION *cov_subscription,
     }
 
 COV_FAILED:
+    tsm_pdu_release(pdu);
 
     return status;
 }
 
 static void cov_lifetime_expiration_handler(
-    unsigned index, uint32_t elapsed_seconds, uint32_t lifetime_seconds)
+    BACNET_COV_SUBSCRIPTION *cov_subscription, uint32_t elapsed_seconds)
 {
-    if (index < MAX_COV_SUBCRIPTIONS) {
-        /* handle lifetime expiration */
-        if (lifetime_seconds >= elapsed_seconds) {
-            COV_Subscriptions[index].lifetime -= elapsed_seconds;
+    /* handle lifetime expiration */
+    if (cov_subscription->lifetime >= elapsed_seconds) {
+        cov_subscription->lifetime -= elapsed_seconds;
 #if 0
-            fprintf(stderr, "COVtimer: subscription[%d].lifetime=%lu\n", index,
-                (unsigned long) COV_Subscriptions[index].lifetime);
+        fprintf(stderr, "COVtimer: subscription.lifetime=%lu\n",
+            (unsigned long) cov_subscription->lifetime);
 #endif
-        } else {
-            COV_Subscriptions[index].lifetime = 0;
-        }
-        if (COV_Subscriptions[index].lifetime == 0) {
-            /* expire the subscription */
+    } else {
+        cov_subscription->lifetime = 0;
+    }
+    if (cov_subscription->lifetime == 0) {
+        /* expire the subscription */
 #if PRINT_ENABLED
-            fprintf(stderr, "COVtimer: PID=%u ",
-                COV_Subscriptions[index].subscriberProcessIdentifier);
-            fprintf(stderr, "%s %u ",
-                bactext_object_type_name(
-                    COV_Subscriptions[index].monitoredObjectIdentifier.type),
-                COV_Subscriptions[index].monitoredObjectIdentifier.instance);
-            fprintf(stderr, "time remaining=%u seconds ",
-                COV_Subscriptions[index].lifetime);
-            fprintf(stderr, "\n");
+        fprintf(stderr, "COVtimer: PID=%u ",
+            cov_subscription->subscriberProcessIdentifier);
+        fprintf(stderr, "%s %u ",
+            bactext_object_type_name(
+                cov_subscription->monitoredObjectIdentifier.type),
+            cov_subscription->monitoredObjectIdentifier.instance);
+        fprintf(stderr, "time remaining=%u seconds ",
+            cov_subscription->lifetime);
+        fprintf(stderr, "\n");
 #endif
-            /* initialize with invalid COV address */
-            COV_Subscriptions[index].flag.valid = false;
-            COV_Subscriptions[index].dest_index = MAX_COV_ADDRESSES;
-            cov_address_remove_unused();
-            if (COV_Subscriptions[index].flag.issueConfirmedNotifications) {
-                if (COV_Subscriptions[index].invokeID) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
-                }
+        if (cov_subscription->flag.issueConfirmedNotifications) {
+            if (cov_subscription->invokeID) {
+                tsm_free_invoke_id_peer(&cov_subscription->dest->dest,
+                    cov_subscription->invokeID);
+                cov_subscription->invokeID = 0;
             }
         }
+        cov_subscription_free(cov_subscription);
+    }
+}
+
+/** Check the monitored objects of the types that do not report their
+ * changes through handler_cov_object_changed(), but only set the flag
+ * that Device_COV() returns.  The objects that report them are not
+ * polled.
+ */
+static void cov_object_sweep(void)
+{
+    int index = 0;
+    BACNET_COV_SUBSCRIPTION *cov_subscription;
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+
+    for (index = 0; index < Keyhash_Count(COV_Object_List); index++) {
+        cov_subscription = Keyhash_Data_Index(COV_Object_List, index);
+        if (!cov_subscription) {
+            continue;
+        }
+        object_type = (BACNET_OBJECT_TYPE)
+                          cov_subscription->monitoredObjectIdentifier.type;
+        if (Device_COV_Pushed(object_type)) {
+            continue;
+        }
+        object_instance =
+            cov_subscription->monitoredObjectIdentifier.instance;
+        if (Device_COV(object_type, object_instance)) {
+            handler_cov_object_changed(object_type, object_instance);
+        }
     }
 }
 
-/** Handler to check the list of subscribed objects for any that have changed
- *  and so need to have notifications sent.
+/** Handler to check the list of subscriptions for any that have expired.
  * @ingroup DSCOV
  * This handler will be invoked by the main program every second or so.
- * This example only handles Binary Inputs, but can be easily extended to
- * support other types.
- * For each subscribed object,
+ * For each subscription,
  *  - See if the subscription has timed out
  *    - Remove it if it has timed out.
- *  - See if the subscribed object instance has changed
- *    (eg, check with Binary_Input_Change_Of_Value() )
- *  - If changed,
- *    - Clear the COV (eg, Binary_Input_Change_Of_Value_Clear() )
- *    - Send the notice with cov_send_request()
- *      - Will be confirmed or unconfirmed, as per the subscription.
- *
- * @note worst case tasking: MS/TP with the ability to send only
- *        one notification per task cycle.
+ * Changes in the monitored objects are reported by the objects through
+ * handler_cov_object_changed(), and the notifications are sent by
+ * handler_cov_task(). The objects that do not report their changes are
+ * checked here, once for each monitored object, and the subscriptions
+ * that wait for the TSM are queued again when it is done.
  *
  * @param elapsed_seconds [in] How many seconds have elapsed since last called.
  */
 void handler_cov_timer_seconds(uint32_t elapsed_seconds)
 {
-    unsigned index = 0;
-    uint32_t lifetime_seconds = 0;
+    int index = 0;
+    BACNET_COV_SUBSCRIPTION *cov_subscription;
 
+    cov_parked_release();
+    cov_object_sweep();
     if (elapsed_seconds) {
-        /* handle the subscription timeouts */
-        for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-            if (COV_Subscriptions[index].flag.valid) {
-                lifetime_seconds = COV_Subscriptions[index].lifetime;
-                if (lifetime_seconds) {
-                    /* only expire COV with definite lifetimes */
-                    cov_lifetime_expiration_handler(
-                        index, elapsed_seconds, lifetime_seconds);
-                }
+        /* handle the subscription timeouts - walk backwards, since
+           an expired subscription is replaced by the last one */
+        index = Keyhash_Count(COV_Subscription_List);
+        while (index > 0) {
+            index--;
+            cov_subscription =
+                Keyhash_Data_Index(COV_Subscription_List, index);
+            if (cov_subscription && cov_subscription->lifetime) {
+                /* only expire COV with definite lifetimes */
+                cov_lifetime_expiration_handler(
+                    cov_subscription, elapsed_seconds);
             }
         }
     }
 }
 
+/** Handler for a change in the COV properties of a monitored object.
+ * @ingroup DSCOV
+ * Object modules call this function when one of the values they report
+ * in a COV notification changes.  Only the subscriptions for that object
+ * are visited and queued for notification, so the cost is independent
+ * of the number of subscriptions in the device.
+ *
+ * @param object_type [in] The type of the object that changed.
+ * @param object_instance [in] The instance of the object that changed.
+ */
+void handler_cov_object_changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription;
+    bool marked = false;
+    bool release = false;
+
+    cov_subscription = Keyhash_Data(
+        COV_Object_List, KEY_ENCODE(object_type, object_instance));
+    while (cov_subscription) {
+        cov_subscription->flag.send_requested = true;
+        cov_pending_add(cov_subscription);
+        if (cov_subscription->flag.parked &&
+            cov_parked_done(cov_subscription)) {
+            /* confirmed already - send the change without waiting
+               for the timer */
+            release = true;
+        }
+        marked = true;
+#if PRINT_ENABLED
+        fprintf(stderr, "COVtask: Marking...\n");
+#endif
+        cov_subscription = cov_subscription->next_object;
+    }
+    if (marked) {
+        Device_COV_Clear(object_type, object_instance);
+    }
+    if (release) {
+        cov_parked_release();
+    }
+}
+
+/** Handler to send the queued COV notifications.
+ * @ingroup DSCOV
+ * Services one subscription from the pending queue per call:
+ *  - frees the invoke ID of a finished confirmed notification
+ *  - sends the notification if one was requested and can be sent now
+ *  - queues the subscription again if it still has to send, or parks
+ *    it while its confirmed notification is outstanding
+ *
+ * @return true if no more subscriptions are waiting in the queue
+ */
 bool handler_cov_fsm(void)
 {
-    static int index = 0;
+    BACNET_COV_SUBSCRIPTION *cov_subscription;
+    BACNET_ADDRESS *dest;
     BACNET_OBJECT_TYPE object_type = MAX_BACNET_OBJECT_TYPE;
     uint32_t object_instance = 0;
     bool status = false;
     bool send = false;
+    bool wait = false;
     BACNET_PROPERTY_VALUE value_list[MAX_COV_PROPERTIES];
-    /* states for transmitting */
-    static enum {
-        COV_STATE_IDLE = 0,
-        COV_STATE_MARK,
-        COV_STATE_CLEAR,
-        COV_STATE_FREE,
-        COV_STATE_SEND
-    } cov_task_state = COV_STATE_IDLE;
-
-    switch (cov_task_state) {
-        case COV_STATE_IDLE:
-            index = 0;
-            cov_task_state = COV_STATE_MARK;
-            break;
-        case COV_STATE_MARK:
-            /* mark any subscriptions where the value has changed */
-            if (COV_Subscriptions[index].flag.valid) {
-                object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
-                                  .monitoredObjectIdentifier.type;
-                object_instance =
-                    COV_Subscriptions[index].monitoredObjectIdentifier.instance;
-                status = Device_COV(object_type, object_instance);
-                if (status) {
-                    COV_Subscriptions[index].flag.send_requested = true;
-#if PRINT_ENABLED
-                    fprintf(stderr, "COVtask: Marking...\n");
-#endif
-                }
-            }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_CLEAR;
-            }
-            break;
-        case COV_STATE_CLEAR:
-            /* clear the COV flag after checking all subscriptions */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.send_requested)) {
-                object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
-                                  .monitoredObjectIdentifier.type;
-                object_instance =
-                    COV_Subscriptions[index].monitoredObjectIdentifier.instance;
-                Device_COV_Clear(object_type, object_instance);
-            }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_FREE;
+
+    cov_subscription = cov_pending_pop();
+    if (cov_subscription && !cov_subscription->flag.valid) {
+        /* freed while it was waiting in the queue */
+        free(cov_subscription);
+    } else if (cov_subscription) {
+        /* confirmed notification house keeping */
+        if ((cov_subscription->flag.issueConfirmedNotifications) &&
+            (cov_subscription->invokeID)) {
+            dest = &cov_subscription->dest->dest;
+            if (tsm_invoke_id_free_peer(dest, cov_subscription->invokeID)) {
+                cov_subscription->invokeID = 0;
+            } else if (tsm_invoke_id_failed_peer(
+                           dest, cov_subscription->invokeID)) {
+                tsm_free_invoke_id_peer(dest, cov_subscription->invokeID);
+                cov_subscription->invokeID = 0;
             }
-            break;
-        case COV_STATE_FREE:
-            /* confirmed notification house keeping */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.issueConfirmedNotifications) &&
-                (COV_Subscriptions[index].invokeID)) {
-                if (tsm_invoke_id_free(COV_Subscriptions[index].invokeID)) {
-                    COV_Subscriptions[index].invokeID = 0;
-                } else if (tsm_invoke_id_failed(
-                               COV_Subscriptions[index].invokeID)) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
+        }
+        /* send the COV if requested */
+        if (cov_subscription->flag.send_requested) {
+            send = true;
+            if (cov_subscription->flag.issueConfirmedNotifications) {
+                if (cov_subscription->invokeID != 0) {
+                    /* already sending */
+                    send = false;
                 }
-            }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_SEND;
-            }
-            break;
-        case COV_STATE_SEND:
-            /* send any COVs that are requested */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.send_requested)) {
-                send = true;
-                if (COV_Subscriptions[index].flag.issueConfirmedNotifications) {
-                    if (COV_Subscriptions[index].invokeID != 0) {
-                        /* already sending */
-                        send = false;
-                    }
-                    if (!tsm_transaction_available()) {
-                        /* no transactions available - can't send now */
-                        send = false;
-                    }
+                if (!tsm_transaction_available()) {
+                    /* no transactions available - can't send now */
+                    send = false;
                 }
-                if (send) {
-                    object_type = (BACNET_OBJECT_TYPE)COV_Subscriptions[index]
-                                      .monitoredObjectIdentifier.type;
-                    object_instance = COV_Subscriptions[index]
-                                          .monitoredObjectIdentifier.instance;
+                wait = !send;
+            }
+            if (send) {
+                object_type = (BACNET_OBJECT_TYPE)
+                                  cov_subscription->monitoredObjectIdentifier
+                                      .type;
+                object_instance =
+                    cov_subscription->monitoredObjectIdentifier.instance;
 #if PRINT_ENABLED
-                    fprintf(stderr, "COVtask: Sending...\n");
+                fprintf(stderr, "COVtask: Sending...\n");
 #endif
-                    /* configure the linked list for the two properties */
-                    bacapp_property_value_list_init(
-                        &value_list[0], MAX_COV_PROPERTIES);
-                    status = Device_Encode_Value_List(
-                        object_type, object_instance, &value_list[0]);
-                    if (status) {
-                        status = cov_send_request(
-                            &COV_Subscriptions[index], &value_list[0]);
-                    }
-                    if (status) {
-                        COV_Subscriptions[index].flag.send_requested = false;
-                    }
+                /* configure the linked list for the two properties */
+                bacapp_property_value_list_init(
+                    &value_list[0], MAX_COV_PROPERTIES);
+                status = Device_Encode_Value_List(
+                    object_type, object_instance, &value_list[0]);
+                if (status) {
+                    status = cov_send_request(cov_subscription, &value_list[0]);
+                }
+                if (status) {
+                    cov_subscription->flag.send_requested = false;
                 }
             }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_IDLE;
-            }
-            break;
-        default:
-            index = 0;
-            cov_task_state = COV_STATE_IDLE;
-            break;
+        }
+        if (cov_subscription->invokeID || wait) {
+            /* waiting for the confirmation, or for a transaction - the
+               timer queues it again when the TSM is done with it */
+            cov_parked_add(cov_subscription);
+        } else if (cov_subscription->flag.send_requested) {
+            /* still waiting to send */
+            cov_pending_add(cov_subscription);
+        }
     }
-    return (cov_task_state == COV_STATE_IDLE);
+
+    return (COV_Pending_Head == NULL);
 }
 
+/** Handler to send the COV notifications that are waiting in the queue.
+ * @ingroup DSCOV
+ * @note worst case tasking: MS/TP with the ability to send only
+ *        one notification per task cycle.
+ */
 void handler_cov_task(void)
 {
     handler_cov_fsm();
@@ -780,6 +1085,7 @@ void handler_cov_subscribe(uint8_t *service_request,
     BACNET_SUBSCRIBE_COV_DATA cov_data;
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int npdu_len = 0;
     int apdu_len = 0;
     BACNET_NPDU_DATA npdu_data;
@@ -790,11 +1096,14 @@ void handler_cov_subscribe(uint8_t *service_request,
 
     /* initialize a common abort code */
     cov_data.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    npdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    npdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
         len = BACNET_STATUS_ABORT;
@@ -817,7 +1126,7 @@ void handler_cov_subscribe(uint8_t *service_request,
             success = cov_subscribe(
                 src, &cov_data, &cov_data.error_class, &cov_data.error_code);
             if (success) {
-                apdu_len = encode_simple_ack(&Handler_Transmit_Buffer[npdu_len],
+                apdu_len = encode_simple_ack(&pdu[npdu_len],
                     service_data->invoke_id, SERVICE_CONFIRMED_SUBSCRIBE_COV);
 #if PRINT_ENABLED
                 fprintf(stderr, "SubscribeCOV: Sending Simple Ack!\n");
@@ -835,21 +1144,21 @@ void handler_cov_subscribe(uint8_t *service_request,
     /* Error? */
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
-            apdu_len = abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = abort_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(cov_data.error_code), true);
 #if PRINT_ENABLED
             fprintf(stderr, "SubscribeCOV: Sending Abort!\n");
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
-            apdu_len = bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = bacerror_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_SUBSCRIBE_COV,
                 cov_data.error_class, cov_data.error_code);
 #if PRINT_ENABLED
             fprintf(stderr, "SubscribeCOV: Sending Error!\n");
 #endif
         } else if (len == BACNET_STATUS_REJECT) {
-            apdu_len = reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = reject_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(cov_data.error_code));
 #if PRINT_ENABLED
@@ -858,14 +1167,14 @@ void handler_cov_subscribe(uint8_t *service_request,
         }
     }
     pdu_len = npdu_len + apdu_len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "SubscribeCOV: Failed to send PDU (%s)!\n",
             strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 
     return;
 }
@@ -105,19 +105,23 @@ void handler_device_communication_control(uint8_t *service_request,
     BACNET_CHARACTER_STRING password;
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the reply packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
 #if PRINT_ENABLED
     fprintf(stderr, "DeviceCommunicationControl!\n");
 #endif
     if (service_data->segmented_message) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -140,7 +144,7 @@ void handler_device_communication_control(uint8_t *service_request,
 #endif
     /* bad decoding or something we didn't understand - send an abort */
     if (len < 0) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr,
@@ -150,7 +154,7 @@ void handler_device_communication_control(uint8_t *service_request,
         goto DCC_ABORT;
     }
     if (state >= MAX_BACNET_COMMUNICATION_ENABLE_DISABLE) {
-        len = reject_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = reject_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, REJECT_REASON_UNDEFINED_ENUMERATION);
 #if PRINT_ENABLED
         fprintf(stderr,
@@ -162,13 +166,13 @@ void handler_device_communication_control(uint8_t *service_request,
         /* Check to see if the current Device supports this service. */
         len = Routed_Device_Service_Approval(
             SERVICE_CONFIRMED_DEVICE_COMMUNICATION_CONTROL, (int)state,
-            &Handler_Transmit_Buffer[pdu_len], service_data->invoke_id);
+            &pdu[pdu_len], service_data->invoke_id);
         if (len > 0)
             goto DCC_ABORT;
 #endif
 
         if (characterstring_ansi_same(&password, My_Password)) {
-            len = encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+            len = encode_simple_ack(&pdu[pdu_len],
                 service_data->invoke_id,
                 SERVICE_CONFIRMED_DEVICE_COMMUNICATION_CONTROL);
 #if PRINT_ENABLED
@@ -178,7 +182,7 @@ void handler_device_communication_control(uint8_t *service_request,
 #endif
             dcc_set_status_duration(state, timeDuration);
         } else {
-            len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            len = bacerror_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id,
                 SERVICE_CONFIRMED_DEVICE_COMMUNICATION_CONTROL,
                 ERROR_CLASS_SECURITY, ERROR_CODE_PASSWORD_FAILURE);
@@ -191,8 +195,7 @@ void handler_device_communication_control(uint8_t *service_request,
     }
 DCC_ABORT:
     pdu_len += len;
-    len = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    len = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
     if (len <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr,
@@ -201,6 +204,7 @@ DCC_ABORT:
             strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 
     return;
 }
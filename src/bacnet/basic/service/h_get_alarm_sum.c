@@ -57,6 +57,7 @@ void handler_get_alarm_summary(uint8_t *service_request,
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int apdu_len = 0;
     int bytes_sent = 0;
     int alarm_value = 0;
@@ -67,14 +68,17 @@ void handler_get_alarm_summary(uint8_t *service_request,
     BACNET_NPDU_DATA npdu_data;
     BACNET_GET_ALARM_SUMMARY_DATA getalarm_data;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
-        apdu_len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        apdu_len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -85,7 +89,7 @@ void handler_get_alarm_summary(uint8_t *service_request,
 
     /* init header */
     apdu_len = get_alarm_summary_ack_encode_apdu_init(
-        &Handler_Transmit_Buffer[pdu_len], service_data->invoke_id);
+        &pdu[pdu_len], service_data->invoke_id);
 
     for (i = 0; i < MAX_BACNET_OBJECT_TYPE; i++) {
         if (Get_Alarm_Summary[i]) {
@@ -93,7 +97,7 @@ void handler_get_alarm_summary(uint8_t *service_request,
                 alarm_value = Get_Alarm_Summary[i](j, &getalarm_data);
                 if (alarm_value > 0) {
                     len = get_alarm_summary_ack_encode_apdu_data(
-                        &Handler_Transmit_Buffer[pdu_len + apdu_len],
+                        &pdu[pdu_len + apdu_len],
                         service_data->max_resp - apdu_len, &getalarm_data);
                     if (len <= 0) {
                         error = true;
@@ -116,7 +120,7 @@ GET_ALARM_SUMMARY_ERROR:
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
             /* BACnet APDU too small to fit data, so proper response is Abort */
-            apdu_len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            apdu_len = abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id,
                 ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
 #if PRINT_ENABLED
@@ -124,7 +128,7 @@ GET_ALARM_SUMMARY_ERROR:
                 stderr, "GetAlarmSummary: Reply too big to fit into APDU!\n");
 #endif
         } else {
-            apdu_len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            apdu_len = bacerror_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_GET_ALARM_SUMMARY,
                 ERROR_CLASS_PROPERTY, ERROR_CODE_OTHER);
 #if PRINT_ENABLED
@@ -135,8 +139,7 @@ GET_ALARM_SUMMARY_ERROR:
 
 GET_ALARM_SUMMARY_ABORT:
     pdu_len += apdu_len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
         /*fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno)); */
@@ -144,6 +147,7 @@ GET_ALARM_SUMMARY_ABORT:
 #else
     bytes_sent = bytes_sent;
 #endif
+    tsm_pdu_release(pdu);
 
     return;
 }
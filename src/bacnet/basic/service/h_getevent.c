@@ -81,6 +81,7 @@ void handler_get_event_information(uint8_t *service_request,
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int apdu_len = 0;
     BACNET_NPDU_DATA npdu_data;
     bool error = false;
@@ -99,14 +100,17 @@ void handler_get_event_information(uint8_t *service_request,
     /* initialize type of 'Last Received Object Identifier' using max value */
     object_id.type = MAX_BACNET_OBJECT_TYPE;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -121,15 +125,15 @@ void handler_get_event_information(uint8_t *service_request,
         service_request, service_len, &object_id);
     if (len < 0) {
         /* bad decoding - send an abort */
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "GetEventInformation: Bad Encoding.  Sending Abort!\n");
 #endif
         goto GET_EVENT_ABORT;
     }
-    len = getevent_ack_encode_apdu_init(&Handler_Transmit_Buffer[pdu_len],
-        sizeof(Handler_Transmit_Buffer) - pdu_len, service_data->invoke_id);
+    len = getevent_ack_encode_apdu_init(&pdu[pdu_len],
+        MAX_PDU - pdu_len, service_data->invoke_id);
     if (len <= 0) {
         error = true;
         goto GET_EVENT_ERROR;
@@ -157,8 +161,8 @@ void handler_get_event_information(uint8_t *service_request,
 
                     getevent_data.next = NULL;
                     len = getevent_ack_encode_apdu_data(
-                        &Handler_Transmit_Buffer[pdu_len],
-                        sizeof(Handler_Transmit_Buffer) - pdu_len,
+                        &pdu[pdu_len],
+                        MAX_PDU - pdu_len,
                         &getevent_data);
                     if (len <= 0) {
                         error = true;
@@ -189,8 +193,8 @@ void handler_get_event_information(uint8_t *service_request,
             }
         }
     }
-    len = getevent_ack_encode_apdu_end(&Handler_Transmit_Buffer[pdu_len],
-        sizeof(Handler_Transmit_Buffer) - pdu_len, more_events);
+    len = getevent_ack_encode_apdu_end(&pdu[pdu_len],
+        MAX_PDU - pdu_len, more_events);
     if (len <= 0) {
         error = true;
         goto GET_EVENT_ERROR;
@@ -200,12 +204,11 @@ void handler_get_event_information(uint8_t *service_request,
 #endif
 GET_EVENT_ERROR:
     if (error) {
-        pdu_len = npdu_encode_pdu(
-            &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+        pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
 
         if (len == -2) {
             /* BACnet APDU too small to fit data, so proper response is Abort */
-            len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            len = abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id,
                 ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
 #if PRINT_ENABLED
@@ -214,7 +217,7 @@ GET_EVENT_ERROR:
                 "Reply too big to fit into APDU!\n");
 #endif
         } else {
-            len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            len = bacerror_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_READ_PROPERTY,
                 error_class, error_code);
 #if PRINT_ENABLED
@@ -227,12 +230,12 @@ GET_EVENT_ABORT:
 #if PRINT_ENABLED
     bytes_sent =
 #endif
-        datalink_send_pdu(
-            src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
 #endif
+    tsm_pdu_release(pdu);
 
     return;
 }
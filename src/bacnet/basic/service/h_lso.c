@@ -50,20 +50,24 @@ void handler_lso(uint8_t *service_request,
     BACNET_LSO_DATA data;
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
 #if PRINT_ENABLED
     int bytes_sent = 0;
 #endif
     BACNET_ADDRESS my_address;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -79,7 +83,7 @@ void handler_lso(uint8_t *service_request,
 #endif
     if (len < 0) {
         /* bad decoding - send an abort */
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "LSO: Bad Encoding.  Sending Abort!\n");
@@ -98,7 +102,7 @@ void handler_lso(uint8_t *service_request,
         (unsigned long)data.targetObject.instance);
 #endif
 
-    len = encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+    len = encode_simple_ack(&pdu[pdu_len],
         service_data->invoke_id, SERVICE_CONFIRMED_LIFE_SAFETY_OPERATION);
 #if PRINT_ENABLED
     fprintf(stderr,
@@ -111,8 +115,7 @@ LSO_ABORT:
 #if PRINT_ENABLED
     bytes_sent =
 #endif
-        datalink_send_pdu(
-            src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr,
@@ -120,6 +123,7 @@ LSO_ABORT:
             "Failed to send PDU (%s)!\n",
             strerror(errno));
 #endif
+    tsm_pdu_release(pdu);
 
     return;
 }
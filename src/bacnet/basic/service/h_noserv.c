@@ -58,6 +58,7 @@ void handler_unrecognized_service(uint8_t *service_request,
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int bytes_sent = 0;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
@@ -65,18 +66,20 @@ void handler_unrecognized_service(uint8_t *service_request,
     (void)service_request;
     (void)service_len;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     /* encode the APDU portion of the packet */
-    len = reject_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+    len = reject_encode_apdu(&pdu[pdu_len],
         service_data->invoke_id, REJECT_REASON_UNRECOGNIZED_SERVICE);
     pdu_len += len;
     /* send the data */
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
     if (bytes_sent > 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "Sent Reject!\n");
@@ -86,4 +89,5 @@ void handler_unrecognized_service(uint8_t *service_request,
         fprintf(stderr, "Failed to Send Reject (%s)!\n", strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 }
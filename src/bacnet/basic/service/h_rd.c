@@ -72,19 +72,23 @@ void handler_reinitialize_device(uint8_t *service_request,
     BACNET_REINITIALIZE_DEVICE_DATA rd_data;
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
 #if PRINT_ENABLED
     fprintf(stderr, "ReinitializeDevice!\n");
 #endif
     if (service_data->segmented_message) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -106,7 +110,7 @@ void handler_reinitialize_device(uint8_t *service_request,
 #endif
     /* bad decoding or something we didn't understand - send an abort */
     if (len < 0) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(
@@ -116,7 +120,7 @@ void handler_reinitialize_device(uint8_t *service_request,
     }
     /* check the data from the request */
     if (rd_data.state >= BACNET_REINIT_MAX) {
-        len = reject_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = reject_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, REJECT_REASON_UNDEFINED_ENUMERATION);
 #if PRINT_ENABLED
         fprintf(stderr,
@@ -127,19 +131,19 @@ void handler_reinitialize_device(uint8_t *service_request,
         /* Check to see if the current Device supports this service. */
         len = Routed_Device_Service_Approval(
             SERVICE_CONFIRMED_REINITIALIZE_DEVICE, (int)rd_data.state,
-            &Handler_Transmit_Buffer[pdu_len], service_data->invoke_id);
+            &pdu[pdu_len], service_data->invoke_id);
         if (len > 0)
             goto RD_ABORT;
 #endif
 
         if (Device_Reinitialize(&rd_data)) {
-            len = encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+            len = encode_simple_ack(&pdu[pdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_REINITIALIZE_DEVICE);
 #if PRINT_ENABLED
             fprintf(stderr, "ReinitializeDevice: Sending Simple Ack!\n");
 #endif
         } else {
-            len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            len = bacerror_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_REINITIALIZE_DEVICE,
                 rd_data.error_class, rd_data.error_code);
 #if PRINT_ENABLED
@@ -149,14 +153,14 @@ void handler_reinitialize_device(uint8_t *service_request,
     }
 RD_ABORT:
     pdu_len += len;
-    len = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    len = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
     if (len <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "ReinitializeDevice: Failed to send PDU (%s)!\n",
             strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 
     return;
 }
@@ -53,7 +53,7 @@
  * - an Abort if
  *   - the message is segmented
  *   - if decoding fails
- *   - if the response would be too large
+ *   - if the response would be too large, and cannot be segmented
  * - the result from Device_Read_Property(), if it succeeds
  * - an Error if Device_Read_Property() fails
  *   or there isn't enough room in the APDU to fit the data.
@@ -72,20 +72,27 @@ void handler_read_property(uint8_t *service_request,
     BACNET_READ_PROPERTY_DATA rpdata;
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int apdu_len = -1;
     int npdu_len = -1;
     BACNET_NPDU_DATA npdu_data;
     bool error = true; /* assume that there is an error */
+    bool sent = false;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *apdu = NULL;
+    uint16_t apdu_max = 0;
 
     /* configure default error code as an abort since it is common */
     rpdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    npdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    npdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (npdu_len <= 0) {
         /* If 0 or negative, there were problems with the data or encoding. */
         len = BACNET_STATUS_ABORT;
@@ -118,19 +125,36 @@ void handler_read_property(uint8_t *service_request,
                 rpdata.object_instance = Device_Object_Instance_Number();
             }
 
+#if BACNET_SEGMENTATION_ENABLED
+            /* encode where a response too large for the client
+               can be sent in segments */
+            apdu = tsm_segmented_response_buffer(service_data, &apdu_max);
+#endif
+            if (!apdu) {
+                apdu = &pdu[npdu_len];
+                apdu_max = MAX_PDU - npdu_len;
+            }
             apdu_len = rp_ack_encode_apdu_init(
-                &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id, &rpdata);
+                &apdu[0], service_data->invoke_id, &rpdata);
             /* configure our storage */
-            rpdata.application_data = &Handler_Transmit_Buffer[npdu_len + apdu_len];
-            rpdata.application_data_len =
-                sizeof(Handler_Transmit_Buffer) - (npdu_len + apdu_len);
+            rpdata.application_data = &apdu[apdu_len];
+            /* leave room for the closing tag */
+            rpdata.application_data_len = apdu_max - apdu_len - 1;
             len = Device_Read_Property(&rpdata);
             if (len >= 0) {
                 apdu_len += len;
-                len = rp_ack_encode_apdu_object_property_end(
-                    &Handler_Transmit_Buffer[npdu_len + apdu_len]);
+                len = rp_ack_encode_apdu_object_property_end(&apdu[apdu_len]);
                 apdu_len += len;
-                if (apdu_len > service_data->max_resp) {
+#if BACNET_SEGMENTATION_ENABLED
+                if (apdu != &pdu[npdu_len]) {
+                    /* sent unsegmented if it fits, or in segments */
+                    sent = tsm_segmented_response_send(src, &npdu_data,
+                        service_data, apdu, (uint16_t)apdu_len);
+                }
+#endif
+                if (!sent &&
+                    ((apdu != &pdu[npdu_len]) ||
+                        (apdu_len > service_data->max_resp))) {
                     /* too big for the sender - send an abort
                      * Setting of error code needed here as read property processing may
                      * have overriden the default set at start */
@@ -164,21 +188,21 @@ void handler_read_property(uint8_t *service_request,
 
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
-            apdu_len = abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = abort_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(rpdata.error_code), true);
 #if PRINT_ENABLED
             fprintf(stderr, "RP: Sending Abort!\n");
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
-            apdu_len = bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = bacerror_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_READ_PROPERTY,
                 rpdata.error_class, rpdata.error_code);
 #if PRINT_ENABLED
             fprintf(stderr, "RP: Sending Error!\n");
 #endif
         } else if (len == BACNET_STATUS_REJECT) {
-            apdu_len = reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = reject_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(rpdata.error_code));
 #if PRINT_ENABLED
@@ -187,14 +211,16 @@ void handler_read_property(uint8_t *service_request,
         }
     }
 
-    pdu_len = npdu_len + apdu_len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
-    if (bytes_sent <= 0) {
+    if (!sent) {
+        pdu_len = npdu_len + apdu_len;
+        bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
+        if (bytes_sent <= 0) {
 #if PRINT_ENABLED
-        fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
+            fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
 #endif
+        }
     }
+    tsm_pdu_release(pdu);
 
     return;
 }
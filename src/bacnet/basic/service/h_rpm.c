@@ -47,7 +47,7 @@
 
 /** @file h_rpm.c  Handles Read Property Multiple requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
+static BACNET_THREAD_LOCAL uint8_t Temp_Buf[MAX_APDU_SEGMENTED] = { 0 };
 
 static BACNET_PROPERTY_ID RPM_Object_Property(
     struct special_property_list_t *pPropertyList,
@@ -166,7 +166,7 @@ static int RPM_Encode_Property(
  * - an Abort if
  *   - the message is segmented
  *   - if decoding fails
- *   - if the response would be too large
+ *   - if the response would be too large, and cannot be segmented
  * - the result from each included read request, if it succeeds
  * - an Error if processing fails for all, or individual errors if only some
  * fail, or there isn't enough room in the APDU to fit the data.
@@ -187,6 +187,7 @@ void handler_read_property_multiple(uint8_t *service_request,
     uint16_t copy_len = 0;
     uint16_t decode_len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
     int bytes_sent;
     BACNET_ADDRESS my_address;
@@ -194,16 +195,29 @@ void handler_read_property_multiple(uint8_t *service_request,
     int apdu_len = 0;
     int npdu_len = 0;
     int error = 0;
+    uint8_t *apdu = NULL;
+    uint16_t apdu_max = MAX_APDU;
+    bool sent = false;
 
     if (service_data && (service_len > 0)) {
+        pdu = tsm_pdu_acquire();
+    }
+    if (pdu) {
         /* jps_debug - see if we are utilizing all the buffer */
-        /* memset(&Handler_Transmit_Buffer[0], 0xff,
-         * sizeof(Handler_Transmit_Buffer)); */
+        /* memset(&pdu[0], 0xff,
+         * MAX_PDU); */
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
         npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-        npdu_len = npdu_encode_pdu(
-            &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+        npdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
+#if BACNET_SEGMENTATION_ENABLED
+        /* encode where a response too large for the client
+           can be sent in segments */
+        apdu = tsm_segmented_response_buffer(service_data, &apdu_max);
+#endif
+        if (!apdu) {
+            apdu = &pdu[npdu_len];
+        }
 
         if (service_data->segmented_message) {
             rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
@@ -215,7 +229,7 @@ void handler_read_property_multiple(uint8_t *service_request,
             /* decode apdu request & encode apdu reply
                encode complex ack, invoke id, service choice */
             apdu_len = rpm_ack_encode_apdu_init(
-                &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id);
+                apdu, service_data->invoke_id);
 
             for (;;) {
                 /* Start by looking for an object ID */
@@ -242,8 +256,8 @@ void handler_read_property_multiple(uint8_t *service_request,
 
                 /* Stick this object id into the reply - if it will fit */
                 len = rpm_ack_encode_apdu_object_begin(&Temp_Buf[0], &rpmdata);
-                copy_len = memcopy(&Handler_Transmit_Buffer[npdu_len],
-                    &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                copy_len = memcopy(apdu,
+                    &Temp_Buf[0], apdu_len, len, apdu_max);
                 if (copy_len == 0) {
 #if PRINT_ENABLED
                     fprintf(stderr, "RPM: Response too big!\r\n");
@@ -290,8 +304,8 @@ void handler_read_property_multiple(uint8_t *service_request,
                                 rpmdata.array_index);
 
                             copy_len =
-                                memcopy(&Handler_Transmit_Buffer[npdu_len],
-                                    &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                                memcopy(apdu,
+                                    &Temp_Buf[0], apdu_len, len, apdu_max);
 
                             if (copy_len == 0) {
 #if PRINT_ENABLED
@@ -312,8 +326,8 @@ void handler_read_property_multiple(uint8_t *service_request,
                                 ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY);
 
                             copy_len =
-                                memcopy(&Handler_Transmit_Buffer[npdu_len],
-                                    &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                                memcopy(apdu,
+                                    &Temp_Buf[0], apdu_len, len, apdu_max);
 
                             if (copy_len == 0) {
 #if PRINT_ENABLED
@@ -350,8 +364,8 @@ void handler_read_property_multiple(uint8_t *service_request,
                                         RPM_Object_Property(&property_list,
                                             special_object_property, index);
                                     len = RPM_Encode_Property(
-                                        &Handler_Transmit_Buffer[npdu_len],
-                                        (uint16_t)apdu_len, MAX_APDU, &rpmdata);
+                                        apdu,
+                                        (uint16_t)apdu_len, apdu_max, &rpmdata);
                                     if (len > 0) {
                                         apdu_len += len;
                                     } else {
@@ -370,8 +384,8 @@ void handler_read_property_multiple(uint8_t *service_request,
                     } else {
                         /* handle an individual property */
                         len = RPM_Encode_Property(
-                            &Handler_Transmit_Buffer[npdu_len],
-                            (uint16_t)apdu_len, MAX_APDU, &rpmdata);
+                            apdu,
+                            (uint16_t)apdu_len, apdu_max, &rpmdata);
                         if (len > 0) {
                             apdu_len += len;
                         } else {
@@ -392,8 +406,8 @@ void handler_read_property_multiple(uint8_t *service_request,
                          */
                         decode_len++;
                         len = rpm_ack_encode_apdu_object_end(&Temp_Buf[0]);
-                        copy_len = memcopy(&Handler_Transmit_Buffer[npdu_len],
-                            &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                        copy_len = memcopy(apdu,
+                            &Temp_Buf[0], apdu_len, len, apdu_max);
                         if (copy_len == 0) {
 #if PRINT_ENABLED
                             fprintf(stderr,
@@ -422,7 +436,16 @@ void handler_read_property_multiple(uint8_t *service_request,
 
             /* If not having an error so far, check the remaining space. */
             if (!berror) {
-                if (apdu_len > service_data->max_resp) {
+#if BACNET_SEGMENTATION_ENABLED
+                if (apdu != &pdu[npdu_len]) {
+                    /* sent unsegmented if it fits, or in segments */
+                    sent = tsm_segmented_response_send(src, &npdu_data,
+                        service_data, apdu, (uint16_t)apdu_len);
+                }
+#endif
+                if (!sent &&
+                    ((apdu != &pdu[npdu_len]) ||
+                        (apdu_len > service_data->max_resp))) {
                     /* too big for the sender - send an abort */
                     rpmdata.error_code =
                         ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
@@ -438,7 +461,7 @@ void handler_read_property_multiple(uint8_t *service_request,
         /* Error fallback. */
         if (error) {
             if (error == BACNET_STATUS_ABORT) {
-                apdu_len = abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                apdu_len = abort_encode_apdu(&pdu[npdu_len],
                     service_data->invoke_id,
                     abort_convert_error_code(rpmdata.error_code), true);
 #if PRINT_ENABLED
@@ -446,7 +469,7 @@ void handler_read_property_multiple(uint8_t *service_request,
 #endif
             } else if (error == BACNET_STATUS_ERROR) {
                 apdu_len = bacerror_encode_apdu(
-                    &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                    &pdu[npdu_len], service_data->invoke_id,
                     SERVICE_CONFIRMED_READ_PROP_MULTIPLE, rpmdata.error_class,
                     rpmdata.error_code);
 #if PRINT_ENABLED
@@ -454,7 +477,7 @@ void handler_read_property_multiple(uint8_t *service_request,
 #endif
             } else if (error == BACNET_STATUS_REJECT) {
                 apdu_len = reject_encode_apdu(
-                    &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id,
+                    &pdu[npdu_len], service_data->invoke_id,
                     reject_convert_error_code(rpmdata.error_code));
 #if PRINT_ENABLED
                 fprintf(stderr, "RPM: Sending Reject!\n");
@@ -462,13 +485,16 @@ void handler_read_property_multiple(uint8_t *service_request,
             }
         }
 
-        pdu_len = apdu_len + npdu_len;
-        bytes_sent = datalink_send_pdu(
-            src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
-        if (bytes_sent <= 0) {
+        if (!sent) {
+            pdu_len = apdu_len + npdu_len;
+            bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
+            if (bytes_sent <= 0) {
 #if PRINT_ENABLED
-            fprintf(stderr, "RPM: Failed to send PDU (%s)!\n", strerror(errno));
+                fprintf(
+                    stderr, "RPM: Failed to send PDU (%s)!\n", strerror(errno));
 #endif
+            }
         }
     }
+    tsm_pdu_release(pdu);
 }
@@ -43,7 +43,7 @@
 
 /** @file h_rr.c  Handles Read Range requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
+static BACNET_THREAD_LOCAL uint8_t Temp_Buf[MAX_APDU_SEGMENTED] = { 0 };
 
 /**
  * Encodes the property APDU and returns the length,
@@ -69,6 +69,9 @@ static int Encode_RR_payload(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
     pRequest->error_class = ERROR_CLASS_SERVICES;
     pRequest->error_code = ERROR_CODE_OTHER;
 
+    /* the items are read from the object by its own function, with
+       the lock of the objects held as for each property of ReadProperty */
+    Device_Objects_Lock();
     /* handle each object type */
     info_fn_ptr = Device_Objects_RR_Info(pRequest->object_type);
 
@@ -107,6 +110,7 @@ static int Encode_RR_payload(uint8_t *apdu, BACNET_READ_RANGE_DATA *pRequest)
          * or array of lists */
         pRequest->error_code = ERROR_CODE_PROPERTY_IS_NOT_A_LIST;
     }
+    Device_Objects_Unlock();
 
     return apdu_len;
 }
@@ -128,23 +132,32 @@ void handler_read_range(uint8_t *service_request,
     BACNET_READ_RANGE_DATA data;
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
     bool error = false;
+    bool sent = false;
 #if PRINT_ENABLED
     int bytes_sent = 0;
 #endif
     BACNET_ADDRESS my_address;
+    uint8_t *apdu = NULL;
+#if BACNET_SEGMENTATION_ENABLED
+    uint16_t apdu_max = 0;
+#endif
 
     data.error_class = ERROR_CLASS_OBJECT;
     data.error_code = ERROR_CODE_UNKNOWN_OBJECT;
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -159,12 +172,23 @@ void handler_read_range(uint8_t *service_request,
     #endif
         if (len < 0) {
             /* bad decoding - send an abort */
-            len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            len = abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, ABORT_REASON_OTHER, true);
     #if PRINT_ENABLED
             fprintf(stderr, "RR: Bad Encoding.  Sending Abort!\n");
     #endif
         } else {
+#if BACNET_SEGMENTATION_ENABLED
+            /* encode where a response too large for the client
+               can be sent in segments */
+            apdu = tsm_segmented_response_buffer(service_data, &apdu_max);
+            if (apdu) {
+                data.MaxAPDU = apdu_max;
+            }
+#endif
+            if (!apdu) {
+                apdu = &pdu[pdu_len];
+            }
             /* assume that there is an error */
             error = true;
             len = Encode_RR_payload(&Temp_Buf[0], &data);
@@ -174,23 +198,36 @@ void handler_read_range(uint8_t *service_request,
                 data.application_data_len = len;
                 /* FIXME: probably need a length limitation sent with encode */
                 len = rr_ack_encode_apdu(
-                    &Handler_Transmit_Buffer[pdu_len], service_data->invoke_id, &data);
+                    apdu, service_data->invoke_id, &data);
+                error = false;
+#if BACNET_SEGMENTATION_ENABLED
+                if (apdu != &pdu[pdu_len]) {
+                    /* sent unsegmented if it fits, or in segments */
+                    sent = tsm_segmented_response_send(src, &npdu_data,
+                        service_data, apdu, (uint16_t)len);
+                    if (!sent) {
+                        error = true;
+                        len = -2;
+                    }
+                }
+#endif
         #if PRINT_ENABLED
-                fprintf(stderr, "RR: Sending Ack!\n");
+                if (!error) {
+                    fprintf(stderr, "RR: Sending Ack!\n");
+                }
         #endif
-                error = false;
             }
             if (error) {
                 if (len == -2) {
                     /* BACnet APDU too small to fit data, so proper response is Abort */
-                    len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    len = abort_encode_apdu(&pdu[pdu_len],
                         service_data->invoke_id,
                         ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
         #if PRINT_ENABLED
                     fprintf(stderr, "RR: Reply too big to fit into APDU!\n");
         #endif
                 } else {
-                    len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    len = bacerror_encode_apdu(&pdu[pdu_len],
                         service_data->invoke_id, SERVICE_CONFIRMED_READ_RANGE,
                         data.error_class, data.error_code);
         #if PRINT_ENABLED
@@ -201,16 +238,18 @@ void handler_read_range(uint8_t *service_request,
         }
     }
 
-    pdu_len += len;
+    if (!sent) {
+        pdu_len += len;
 #if PRINT_ENABLED
-    bytes_sent =
+        bytes_sent =
 #endif
-        datalink_send_pdu(
-            src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+            datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
-    if (bytes_sent <= 0)
-        fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
+        if (bytes_sent <= 0)
+            fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
 #endif
+    }
+    tsm_pdu_release(pdu);
 
     return;
 }
@@ -50,19 +50,25 @@ void handler_who_is(
     int len = 0;
     int32_t low_limit = 0;
     int32_t high_limit = 0;
+    uint8_t *pdu = NULL;
 
     (void)src;
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     len = whois_decode_service_request(
         service_request, service_len, &low_limit, &high_limit);
     if (len == 0) {
-        Send_I_Am(&Handler_Transmit_Buffer[0]);
+        Send_I_Am(&pdu[0]);
     } else if (len != BACNET_STATUS_ERROR) {
         /* is my device id within the limits? */
         if ((Device_Object_Instance_Number() >= (uint32_t)low_limit) &&
             (Device_Object_Instance_Number() <= (uint32_t)high_limit)) {
-            Send_I_Am(&Handler_Transmit_Buffer[0]);
+            Send_I_Am(&pdu[0]);
         }
     }
+    tsm_pdu_release(pdu);
 
     return;
 }
@@ -81,19 +87,25 @@ void handler_who_is_unicast(
     int len = 0;
     int32_t low_limit = 0;
     int32_t high_limit = 0;
+    uint8_t *pdu = NULL;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     len = whois_decode_service_request(
         service_request, service_len, &low_limit, &high_limit);
     /* If no limits, then always respond */
     if (len == 0) {
-        Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+        Send_I_Am_Unicast(&pdu[0], src);
     } else if (len != BACNET_STATUS_ERROR) {
         /* is my device id within the limits? */
         if ((Device_Object_Instance_Number() >= (uint32_t)low_limit) &&
             (Device_Object_Instance_Number() <= (uint32_t)high_limit)) {
-            Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+            Send_I_Am_Unicast(&pdu[0], src);
         }
     }
+    tsm_pdu_release(pdu);
 
     return;
 }
@@ -128,6 +140,7 @@ static void check_who_is_for_routing(uint8_t *service_request,
     int cursor = 0; /* Starting hint */
     int my_list[2] = { 0, -1 }; /* Not really used, so dummy values */
     BACNET_ADDRESS bcast_net;
+    uint8_t *pdu = NULL;
 
     len = whois_decode_service_request(
         service_request, service_len, &low_limit, &high_limit);
@@ -135,6 +148,10 @@ static void check_who_is_for_routing(uint8_t *service_request,
         /* Invalid; just leave */
         return;
     }
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* Go through all devices, starting with the root gateway Device */
     memset(&bcast_net, 0, sizeof(BACNET_ADDRESS));
     bcast_net.net = BACNET_BROADCAST_NETWORK; /* That's all we have to set */
@@ -145,11 +162,12 @@ static void check_who_is_for_routing(uint8_t *service_request,
         if ((len == 0) ||
             ((dev_instance >= low_limit) && (dev_instance <= high_limit))) {
             if (is_unicast)
-                Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+                Send_I_Am_Unicast(&pdu[0], src);
             else
-                Send_I_Am(&Handler_Transmit_Buffer[0]);
+                Send_I_Am(&pdu[0]);
         }
     }
+    tsm_pdu_release(pdu);
 }
 
 /** Handler for Who-Is requests in the virtual routing setup,
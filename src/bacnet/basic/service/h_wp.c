@@ -70,20 +70,24 @@ void handler_write_property(uint8_t *service_request,
     int len = 0;
     bool bcontinue = true;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
 #if PRINT_ENABLED
     fprintf(stderr, "WP: Received Request!\n");
 #endif
     if (service_data->segmented_message) {
-        len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -109,7 +113,7 @@ void handler_write_property(uint8_t *service_request,
 #endif
         /* bad decoding or something we didn't understand - send an abort */
         if (len <= 0) {
-            len = abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            len = abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
             fprintf(stderr, "WP: Bad Encoding. Sending Abort!\n");
@@ -119,13 +123,13 @@ void handler_write_property(uint8_t *service_request,
 
         if (bcontinue) {
             if (Device_Write_Property(&wp_data)) {
-                len = encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+                len = encode_simple_ack(&pdu[pdu_len],
                     service_data->invoke_id, SERVICE_CONFIRMED_WRITE_PROPERTY);
 #if PRINT_ENABLED
                 fprintf(stderr, "WP: Sending Simple Ack!\n");
 #endif
             } else {
-                len = bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                len = bacerror_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, SERVICE_CONFIRMED_WRITE_PROPERTY,
                     wp_data.error_class, wp_data.error_code);
 #if PRINT_ENABLED
@@ -137,13 +141,13 @@ void handler_write_property(uint8_t *service_request,
 
     /* Send PDU */
     pdu_len += len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "WP: Failed to send PDU (%s)!\n", strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 
     return;
 }
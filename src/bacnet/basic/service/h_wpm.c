@@ -71,6 +71,7 @@ void handler_write_property_multiple(uint8_t *service_request,
     int apdu_len = 0;
     int npdu_len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int decode_len = 0;
     bool error = false;
     BACNET_WRITE_PROPERTY_DATA wp_data;
@@ -161,16 +162,19 @@ void handler_write_property_multiple(uint8_t *service_request,
     } while (decode_len < service_len);
 
 WPM_ABORT:
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    npdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], src, &my_address, &npdu_data);
+    npdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npdu_data);
     apdu_len = 0;
     /* handle any errors */
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
-            apdu_len = abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = abort_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(wp_data.error_code), true);
 #if PRINT_ENABLED
@@ -178,13 +182,13 @@ WPM_ABORT:
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
             apdu_len =
-                wpm_error_ack_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                wpm_error_ack_encode_apdu(&pdu[npdu_len],
                     service_data->invoke_id, &wp_data);
 #if PRINT_ENABLED
             fprintf(stderr, "WPM: Sending Error!\n");
 #endif
         } else if (len == BACNET_STATUS_REJECT) {
-            apdu_len = reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+            apdu_len = reject_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(wp_data.error_code));
 #if PRINT_ENABLED
@@ -193,15 +197,14 @@ WPM_ABORT:
         }
     } else {
         apdu_len = wpm_ack_encode_apdu_init(
-            &Handler_Transmit_Buffer[npdu_len], service_data->invoke_id);
+            &pdu[npdu_len], service_data->invoke_id);
 #if PRINT_ENABLED
         fprintf(stderr, "WPM: Sending Ack!\n");
 #endif
     }
 
     pdu_len = npdu_len + apdu_len;
-    bytes_sent = datalink_send_pdu(
-        src, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(src, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
@@ -209,4 +212,5 @@ WPM_ABORT:
 #else
     bytes_sent = bytes_sent;
 #endif
+    tsm_pdu_release(pdu);
 }
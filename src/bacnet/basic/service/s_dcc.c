@@ -61,6 +61,7 @@ uint8_t Send_Device_Communication_Control_Request(uint32_t device_id,
     BACNET_ADDRESS my_address;
     unsigned max_apdu = 0;
     uint8_t invoke_id = 0;
+    uint8_t *pdu = NULL;
     bool status = false;
     int len = 0;
     int pdu_len = 0;
@@ -77,19 +78,21 @@ uint8_t Send_Device_Communication_Control_Request(uint32_t device_id,
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
-    /* is there a tsm available? */
+    /* is there a transmit buffer and a tsm available? */
     if (status) {
-        invoke_id = tsm_next_free_invokeID();
+        pdu = tsm_pdu_acquire();
+    }
+    if (pdu) {
+        invoke_id = tsm_next_free_invokeID_peer(&dest);
     }
     if (invoke_id) {
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
         npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
-        pdu_len = npdu_encode_pdu(
-            &Handler_Transmit_Buffer[0], &dest, &my_address, &npdu_data);
+        pdu_len = npdu_encode_pdu(&pdu[0], &dest, &my_address, &npdu_data);
         /* encode the APDU portion of the packet */
         characterstring_init_ansi(&password_string, password);
-        len = dcc_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+        len = dcc_encode_apdu(&pdu[pdu_len], invoke_id,
             timeDuration, state, password ? &password_string : NULL);
         pdu_len += len;
         /* will it fit in the sender?
@@ -99,12 +102,11 @@ uint8_t Send_Device_Communication_Control_Request(uint32_t device_id,
            max_apdu in the address binding table. */
         if ((unsigned)pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npdu_data, &Handler_Transmit_Buffer[0], (uint16_t)pdu_len);
+                &npdu_data, &pdu[0], (uint16_t)pdu_len);
 #if PRINT_ENABLED
             bytes_sent =
 #endif
-                datalink_send_pdu(
-                    &dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+                datalink_send_pdu(&dest, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr,
@@ -112,7 +114,7 @@ uint8_t Send_Device_Communication_Control_Request(uint32_t device_id,
                     strerror(errno));
 #endif
         } else {
-            tsm_free_invoke_id(invoke_id);
+            tsm_free_invoke_id_peer(&dest, invoke_id);
             invoke_id = 0;
 #if PRINT_ENABLED
             fprintf(stderr,
@@ -121,6 +123,7 @@ uint8_t Send_Device_Communication_Control_Request(uint32_t device_id,
 #endif
         }
     }
+    tsm_pdu_release(pdu);
 
     return invoke_id;
 }
@@ -55,34 +55,35 @@ uint8_t Send_Get_Alarm_Summary_Address(BACNET_ADDRESS *dest, uint16_t max_apdu)
     int len = 0;
     int pdu_len = 0;
     uint8_t invoke_id = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
 #if PRINT_ENABLED
     int bytes_sent = 0;
 #endif
 
-    /* is there a tsm available? */
-    invoke_id = tsm_next_free_invokeID();
+    /* is there a transmit buffer and a tsm available? */
+    pdu = tsm_pdu_acquire();
+    if (pdu) {
+        invoke_id = tsm_next_free_invokeID_peer(dest);
+    }
     if (invoke_id) {
         datalink_get_my_address(&my_address);
         /* encode the NPDU portion of the packet */
         npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
 
-        pdu_len = npdu_encode_pdu(
-            &Handler_Transmit_Buffer[0], dest, &my_address, &npdu_data);
+        pdu_len = npdu_encode_pdu(&pdu[0], dest, &my_address, &npdu_data);
         /* encode the APDU portion of the packet */
-        len = get_alarm_summary_encode_apdu(
-            &Handler_Transmit_Buffer[pdu_len], invoke_id);
+        len = get_alarm_summary_encode_apdu(&pdu[pdu_len], invoke_id);
 
         pdu_len += len;
         if ((uint16_t)pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, dest,
-                &npdu_data, &Handler_Transmit_Buffer[0], (uint16_t)pdu_len);
+                &npdu_data, &pdu[0], (uint16_t)pdu_len);
 #if PRINT_ENABLED
             bytes_sent =
 #endif
-                datalink_send_pdu(
-                    dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+                datalink_send_pdu(dest, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr,
@@ -90,7 +91,7 @@ uint8_t Send_Get_Alarm_Summary_Address(BACNET_ADDRESS *dest, uint16_t max_apdu)
                     strerror(errno));
 #endif
         } else {
-            tsm_free_invoke_id(invoke_id);
+            tsm_free_invoke_id_peer(dest, invoke_id);
             invoke_id = 0;
 #if PRINT_ENABLED
             fprintf(stderr,
@@ -99,6 +100,7 @@ uint8_t Send_Get_Alarm_Summary_Address(BACNET_ADDRESS *dest, uint16_t max_apdu)
 #endif
         }
     }
+    tsm_pdu_release(pdu);
 
     return invoke_id;
 }
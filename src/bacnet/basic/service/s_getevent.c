@@ -56,27 +56,31 @@ uint8_t Send_GetEvent(BACNET_ADDRESS *target_address,
     int bytes_sent = 0;
 #endif
     uint8_t invoke_id = 0;
+    uint8_t *pdu = NULL;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return 0;
+    }
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
 
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], target_address, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], target_address, &my_address, &npdu_data);
 
     invoke_id = tsm_next_free_invokeID();
     if (invoke_id) {
         /* encode the APDU portion of the packet */
-        len = getevent_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+        len = getevent_encode_apdu(&pdu[pdu_len], invoke_id,
             lastReceivedObjectIdentifier);
         pdu_len += len;
 #if PRINT_ENABLED
         bytes_sent =
 #endif
             datalink_send_pdu(target_address, &npdu_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
 #if PRINT_ENABLED
         if (bytes_sent <= 0)
             fprintf(stderr,
@@ -92,6 +96,7 @@ uint8_t Send_GetEvent(BACNET_ADDRESS *target_address,
             "(exceeds destination maximum APDU)!\n");
 #endif
     }
+    tsm_pdu_release(pdu);
     return invoke_id;
 }
 
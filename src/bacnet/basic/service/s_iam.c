@@ -57,28 +57,33 @@ void Send_I_Am_To_Network(BACNET_ADDRESS *target_address,
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int bytes_sent = 0;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
 
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], target_address, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], target_address, &my_address, &npdu_data);
     /* encode the APDU portion of the packet */
     /* encode the APDU portion of the packet */
-    len = iam_encode_apdu(&Handler_Transmit_Buffer[pdu_len], device_id,
+    len = iam_encode_apdu(&pdu[pdu_len], device_id,
         max_apdu, segmentation, vendor_id);
     pdu_len += len;
     bytes_sent = datalink_send_pdu(
-        target_address, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        target_address, &npdu_data, &pdu[0], pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "Failed to Send I-Am Request (%s)!\n", strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 }
 
 /** Encode an I Am message to be broadcast.
@@ -57,6 +57,7 @@ void Send_I_Have(uint32_t device_id,
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_ADDRESS dest;
     int bytes_sent = 0;
     BACNET_I_HAVE_DATA data;
@@ -68,12 +69,15 @@ void Send_I_Have(uint32_t device_id,
     if (!dcc_communication_enabled()) {
         return;
     }
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* Who-Has is a global broadcast */
     datalink_get_broadcast_address(&dest);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], &dest, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, &my_address, &npdu_data);
 
     /* encode the APDU portion of the packet */
     data.device_id.type = OBJECT_DEVICE;
@@ -81,14 +85,14 @@ void Send_I_Have(uint32_t device_id,
     data.object_id.type = object_type;
     data.object_id.instance = object_instance;
     characterstring_copy(&data.object_name, object_name);
-    len = ihave_encode_apdu(&Handler_Transmit_Buffer[pdu_len], &data);
+    len = ihave_encode_apdu(&pdu[pdu_len], &data);
     pdu_len += len;
     /* send the data */
-    bytes_sent = datalink_send_pdu(
-        &dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(&dest, &npdu_data, &pdu[0], pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "Failed to Send I-Have Reply (%s)!\n", strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 }
@@ -67,6 +67,7 @@ uint8_t Send_Read_Property_Request_Address(BACNET_ADDRESS *dest,
 {
     BACNET_ADDRESS my_address;
     uint8_t invoke_id = 0;
+    uint8_t *pdu = NULL;
     int len = 0;
     int pdu_len = 0;
     int bytes_sent = 0;
@@ -79,21 +80,22 @@ uint8_t Send_Read_Property_Request_Address(BACNET_ADDRESS *dest,
     if (!dest) {
         return 0;
     }
-    /* is there a tsm available? */
-    invoke_id = tsm_next_free_invokeID();
+    /* is there a transmit buffer and a tsm available? */
+    pdu = tsm_pdu_acquire();
+    if (pdu) {
+        invoke_id = tsm_next_free_invokeID_peer(dest);
+    }
     if (invoke_id) {
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
         npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
-        pdu_len = npdu_encode_pdu(
-            &Handler_Transmit_Buffer[0], dest, &my_address, &npdu_data);
+        pdu_len = npdu_encode_pdu(&pdu[0], dest, &my_address, &npdu_data);
         /* encode the APDU portion of the packet */
         data.object_type = object_type;
         data.object_instance = object_instance;
         data.object_property = object_property;
         data.array_index = array_index;
-        len =
-            rp_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id, &data);
+        len = rp_encode_apdu(&pdu[pdu_len], invoke_id, &data);
         pdu_len += len;
         /* will it fit in the sender?
            note: if there is a bottleneck router in between
@@ -102,9 +104,8 @@ uint8_t Send_Read_Property_Request_Address(BACNET_ADDRESS *dest,
            max_apdu in the address binding table. */
         if ((uint16_t)pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, dest,
-                &npdu_data, &Handler_Transmit_Buffer[0], (uint16_t)pdu_len);
-            bytes_sent = datalink_send_pdu(
-                dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+                &npdu_data, &pdu[0], (uint16_t)pdu_len);
+            bytes_sent = datalink_send_pdu(dest, &npdu_data, &pdu[0], pdu_len);
             if (bytes_sent <= 0) {
 #if PRINT_ENABLED
                 fprintf(stderr, "Failed to Send ReadProperty Request (%s)!\n",
@@ -112,7 +113,7 @@ uint8_t Send_Read_Property_Request_Address(BACNET_ADDRESS *dest,
 #endif
             }
         } else {
-            tsm_free_invoke_id(invoke_id);
+            tsm_free_invoke_id_peer(dest, invoke_id);
             invoke_id = 0;
 #if PRINT_ENABLED
             fprintf(stderr,
@@ -121,6 +122,7 @@ uint8_t Send_Read_Property_Request_Address(BACNET_ADDRESS *dest,
 #endif
         }
     }
+    tsm_pdu_release(pdu);
 
     return invoke_id;
 }
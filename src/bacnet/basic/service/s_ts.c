@@ -54,6 +54,7 @@ void Send_TimeSync_Remote(
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
 #if PRINT_ENABLED
     int bytes_sent = 0;
 #endif
@@ -64,25 +65,28 @@ void Send_TimeSync_Remote(
         return;
     }
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], dest, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], dest, &my_address, &npdu_data);
     /* encode the APDU portion of the packet */
-    len = timesync_encode_apdu(&Handler_Transmit_Buffer[pdu_len], bdate, btime);
+    len = timesync_encode_apdu(&pdu[pdu_len], bdate, btime);
     pdu_len += len;
     /* send it out the datalink */
 #if PRINT_ENABLED
     bytes_sent =
 #endif
-        datalink_send_pdu(
-            dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        datalink_send_pdu(dest, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Failed to Send Time-Synchronization Request (%s)!\n",
             strerror(errno));
 #endif
+    tsm_pdu_release(pdu);
 }
 
 /**
@@ -111,6 +115,7 @@ void Send_TimeSyncUTC_Remote(
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
 #if PRINT_ENABLED
     int bytes_sent = 0;
 #endif
@@ -121,26 +126,28 @@ void Send_TimeSyncUTC_Remote(
         return;
     }
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], dest, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], dest, &my_address, &npdu_data);
     /* encode the APDU portion of the packet */
-    len = timesync_utc_encode_apdu(
-        &Handler_Transmit_Buffer[pdu_len], bdate, btime);
+    len = timesync_utc_encode_apdu(&pdu[pdu_len], bdate, btime);
     pdu_len += len;
 #if PRINT_ENABLED
     bytes_sent =
 #endif
-        datalink_send_pdu(
-            dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        datalink_send_pdu(dest, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr,
             "Failed to Send UTC-Time-Synchronization Request (%s)!\n",
             strerror(errno));
 #endif
+    tsm_pdu_release(pdu);
 }
 
 /**
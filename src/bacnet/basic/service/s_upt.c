@@ -47,6 +47,7 @@ int Send_UnconfirmedPrivateTransfer(
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int bytes_sent = 0;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
@@ -55,18 +56,19 @@ int Send_UnconfirmedPrivateTransfer(
         return bytes_sent;
     }
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return 0;
+    }
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], dest, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], dest, &my_address, &npdu_data);
 
     /* encode the APDU portion of the packet */
-    len =
-        uptransfer_encode_apdu(&Handler_Transmit_Buffer[pdu_len], private_data);
+    len = uptransfer_encode_apdu(&pdu[pdu_len], private_data);
     pdu_len += len;
-    bytes_sent = datalink_send_pdu(
-        dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+    bytes_sent = datalink_send_pdu(dest, &npdu_data, &pdu[0], pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr,
@@ -74,6 +76,7 @@ int Send_UnconfirmedPrivateTransfer(
             strerror(errno));
 #endif
     }
+    tsm_pdu_release(pdu);
 
     return bytes_sent;
 }
@@ -57,6 +57,7 @@ void Send_WhoHas_Name(
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_ADDRESS dest;
 #if PRINT_ENABLED
     int bytes_sent = 0;
@@ -69,32 +70,35 @@ void Send_WhoHas_Name(
     if (!dcc_communication_enabled()) {
         return;
     }
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* Who-Has is a global broadcast */
     datalink_get_broadcast_address(&dest);
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], &dest, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, &my_address, &npdu_data);
 
     /* encode the APDU portion of the packet */
     data.low_limit = low_limit;
     data.high_limit = high_limit;
     data.is_object_name = true;
     characterstring_init_ansi(&data.object.name, object_name);
-    len = whohas_encode_apdu(&Handler_Transmit_Buffer[pdu_len], &data);
+    len = whohas_encode_apdu(&pdu[pdu_len], &data);
     pdu_len += len;
     /* send the data */
 #if PRINT_ENABLED
     bytes_sent =
 #endif
-        datalink_send_pdu(
-            &dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        datalink_send_pdu(&dest, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(
             stderr, "Failed to Send Who-Has Request (%s)!\n", strerror(errno));
 #endif
+    tsm_pdu_release(pdu);
 }
 
 /** Send a Who-Has request for a device which has a specific Object type and ID.
@@ -115,6 +119,7 @@ void Send_WhoHas_Object(int32_t low_limit,
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     BACNET_ADDRESS dest;
 #if PRINT_ENABLED
     int bytes_sent = 0;
@@ -127,13 +132,16 @@ void Send_WhoHas_Object(int32_t low_limit,
     if (!dcc_communication_enabled()) {
         return;
     }
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     /* Who-Has is a global broadcast */
     datalink_get_broadcast_address(&dest);
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], &dest, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, &my_address, &npdu_data);
 
     /* encode the APDU portion of the packet */
     data.low_limit = low_limit;
@@ -141,16 +149,16 @@ void Send_WhoHas_Object(int32_t low_limit,
     data.is_object_name = false;
     data.object.identifier.type = object_type;
     data.object.identifier.instance = object_instance;
-    len = whohas_encode_apdu(&Handler_Transmit_Buffer[pdu_len], &data);
+    len = whohas_encode_apdu(&pdu[pdu_len], &data);
     pdu_len += len;
 #if PRINT_ENABLED
     bytes_sent =
 #endif
-        datalink_send_pdu(
-            &dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        datalink_send_pdu(&dest, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(
             stderr, "Failed to Send Who-Has Request (%s)!\n", strerror(errno));
 #endif
+    tsm_pdu_release(pdu);
 }
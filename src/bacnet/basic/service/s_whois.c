@@ -61,22 +61,25 @@ void Send_WhoIs_To_Network(
 {
     int len = 0;
     int pdu_len = 0;
+    uint8_t *pdu = NULL;
     int bytes_sent = 0;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
 
+    pdu = tsm_pdu_acquire();
+    if (!pdu) {
+        return;
+    }
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
 
-    pdu_len = npdu_encode_pdu(
-        &Handler_Transmit_Buffer[0], target_address, &my_address, &npdu_data);
+    pdu_len = npdu_encode_pdu(&pdu[0], target_address, &my_address, &npdu_data);
     /* encode the APDU portion of the packet */
-    len = whois_encode_apdu(
-        &Handler_Transmit_Buffer[pdu_len], low_limit, high_limit);
+    len = whois_encode_apdu(&pdu[pdu_len], low_limit, high_limit);
     pdu_len += len;
     bytes_sent = datalink_send_pdu(
-        target_address, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+        target_address, &npdu_data, &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(
@@ -84,6 +87,7 @@ void Send_WhoIs_To_Network(
 #else
     (void)bytes_sent;
 #endif
+    tsm_pdu_release(pdu);
 }
 
 /** Send a global Who-Is request for a specific device, a range, or any device.
@@ -157,7 +161,8 @@ void Send_WhoIs_Local(int32_t low_limit, int32_t high_limit)
  * If low_limit and high_limit have the same non-negative value, then only
  * that device will respond.
  * Otherwise, low_limit must be less than high_limit.
- * @param target_address [in] BACnet address of target router
+ * @param target_address [in] BACnet address of target router, or NULL
+ *  for a global broadcast
  * @param low_limit [in] Device Instance Low Range, 0 - 4,194,303 or -1
  * @param high_limit [in] Device Instance High Range, 0 - 4,194,303 or -1
  */
@@ -168,7 +173,11 @@ void Send_WhoIs_Remote(
         return;
     }
 
-    Send_WhoIs_To_Network(target_address, low_limit, high_limit);
+    if (target_address) {
+        Send_WhoIs_To_Network(target_address, low_limit, high_limit);
+    } else {
+        Send_WhoIs_Global(low_limit, high_limit);
+    }
 }
 
 /** Send a global Who-Is request for a specific device, a range, or any device.
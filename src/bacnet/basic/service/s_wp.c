@@ -56,6 +56,7 @@ uint8_t Send_Write_Property_Request_Data(uint32_t device_id,
     BACNET_ADDRESS my_address;
     unsigned max_apdu = 0;
     uint8_t invoke_id = 0;
+    uint8_t *pdu = NULL;
     bool status = false;
     int len = 0;
     int pdu_len = 0;
@@ -69,16 +70,18 @@ uint8_t Send_Write_Property_Request_Data(uint32_t device_id,
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
-    /* is there a tsm available? */
+    /* is there a transmit buffer and a tsm available? */
     if (status) {
-        invoke_id = tsm_next_free_invokeID();
+        pdu = tsm_pdu_acquire();
+    }
+    if (pdu) {
+        invoke_id = tsm_next_free_invokeID_peer(&dest);
     }
     if (invoke_id) {
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
         npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
-        pdu_len = npdu_encode_pdu(
-            &Handler_Transmit_Buffer[0], &dest, &my_address, &npdu_data);
+        pdu_len = npdu_encode_pdu(&pdu[0], &dest, &my_address, &npdu_data);
         /* encode the APDU portion of the packet */
         data.object_type = object_type;
         data.object_instance = object_instance;
@@ -88,8 +91,7 @@ uint8_t Send_Write_Property_Request_Data(uint32_t device_id,
         memcpy(&data.application_data[0], &application_data[0],
             application_data_len);
         data.priority = priority;
-        len =
-            wp_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id, &data);
+        len = wp_encode_apdu(&pdu[pdu_len], invoke_id, &data);
         pdu_len += len;
         /* will it fit in the sender?
            note: if there is a bottleneck router in between
@@ -98,9 +100,8 @@ uint8_t Send_Write_Property_Request_Data(uint32_t device_id,
            max_apdu in the address binding table. */
         if ((unsigned)pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npdu_data, &Handler_Transmit_Buffer[0], (uint16_t)pdu_len);
-            bytes_sent = datalink_send_pdu(
-                &dest, &npdu_data, &Handler_Transmit_Buffer[0], pdu_len);
+                &npdu_data, &pdu[0], (uint16_t)pdu_len);
+            bytes_sent = datalink_send_pdu(&dest, &npdu_data, &pdu[0], pdu_len);
             if (bytes_sent <= 0) {
 #if PRINT_ENABLED
                 fprintf(stderr, "Failed to Send WriteProperty Request (%s)!\n",
@@ -108,7 +109,7 @@ uint8_t Send_Write_Property_Request_Data(uint32_t device_id,
 #endif
             }
         } else {
-            tsm_free_invoke_id(invoke_id);
+            tsm_free_invoke_id_peer(&dest, invoke_id);
             invoke_id = 0;
 #if PRINT_ENABLED
             fprintf(stderr,
@@ -117,6 +118,7 @@ uint8_t Send_Write_Property_Request_Data(uint32_t device_id,
 #endif
         }
     }
+    tsm_pdu_release(pdu);
 
     return invoke_id;
 }
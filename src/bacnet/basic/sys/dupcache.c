@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief Cache of the messages seen recently, to drop their repeats
+ *
+ * @section DESCRIPTION
+ *
+ * Each digest has one place in the table.  A message whose digest takes
+ * the place of another one that is still alive replaces it, so that the
+ * cache forgets a message early rather than grow; its repeat is then
+ * passed on once more.  Two messages with the same digest are taken as
+ * the same message, which, within the lifetime of a digest, is unlikely.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bacnet/basic/sys/dupcache.h"
+
+/**
+ * Set up a cache with a table of digests, all of them empty.
+ *
+ * @param cache - the cache
+ * @param entries - the table of digests
+ * @param size - the number of entries of the table
+ * @param lifetime - milliseconds during which a repeat is dropped
+ */
+void dupcache_init(DUPCACHE *cache,
+    DUPCACHE_ENTRY *entries,
+    unsigned size,
+    unsigned long lifetime)
+{
+    if (cache) {
+        cache->entries = entries;
+        cache->size = entries ? size : 0;
+        cache->lifetime = lifetime;
+        dupcache_clear(cache);
+    }
+}
+
+/**
+ * Forget the messages seen, and reset the counters.
+ *
+ * @param cache - the cache
+ */
+void dupcache_clear(DUPCACHE *cache)
+{
+    if (cache) {
+        if (cache->size) {
+            memset(cache->entries, 0, cache->size * sizeof(DUPCACHE_ENTRY));
+        }
+        cache->hits = 0;
+        cache->misses = 0;
+    }
+}
+
+/**
+ * Determine if a message is a repeat of one seen within the lifetime,
+ * and remember it if not.  The time of a message is not renewed by its
+ * repeats, so that a message sent again on purpose passes once the
+ * lifetime is over.
+ *
+ * @param cache - the cache
+ * @param key - digest of the origin and the contents of the message
+ * @param now - the time, in milliseconds
+ * @return true if the message is a repeat
+ */
+bool dupcache_seen(DUPCACHE *cache, uint32_t key, unsigned long now)
+{
+    DUPCACHE_ENTRY *entry;
+
+    if (!cache || !cache->size) {
+        return false;
+    }
+    entry = &cache->entries[key % cache->size];
+    if (entry->valid && (entry->key == key) &&
+        ((now - entry->time) < cache->lifetime)) {
+        cache->hits++;
+        return true;
+    }
+    entry->key = key;
+    entry->time = now;
+    entry->valid = true;
+    cache->misses++;
+
+    return false;
+}
+
+/**
+ * Get the number of repeats that were found.
+ *
+ * @param cache - the cache
+ * @return the number of hits
+ */
+unsigned long dupcache_hits(DUPCACHE *cache)
+{
+    return cache ? cache->hits : 0;
+}
+
+/**
+ * Get the number of messages that were seen first.
+ *
+ * @param cache - the cache
+ * @return the number of misses
+ */
+unsigned long dupcache_misses(DUPCACHE *cache)
+{
+    return cache ? cache->misses : 0;
+}
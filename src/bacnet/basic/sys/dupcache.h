@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Cache of the messages seen recently, to drop their repeats
+ *
+ * @section DESCRIPTION
+ *
+ * A message that can reach a node by more than one path, such as a
+ * broadcast forwarded by several BBMDs, or one that circulates through
+ * a loop of forwards, is reduced to a 32-bit digest of its origin and
+ * its contents, with Keyhash_Hash().  The cache keeps the digests seen
+ * within their lifetime, in a direct-mapped table, and tells whether a
+ * message is a repeat.  It counts the repeats (hits) and the messages
+ * seen first (misses).
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef DUPCACHE_H
+#define DUPCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacnet/bacnet_stack_exports.h"
+
+/**
+ * Digest of a message seen recently
+ *
+ * @{
+ */
+typedef struct dupcache_entry {
+    /** digest of the origin and the contents */
+    uint32_t key;
+    /** time, in milliseconds, when it was seen first */
+    unsigned long time;
+    bool valid;
+} DUPCACHE_ENTRY;
+/** @} */
+
+/**
+ * Cache of the messages seen recently
+ *
+ * @{
+ */
+typedef struct dupcache {
+    /** the table of digests, owned by the user of the cache */
+    DUPCACHE_ENTRY *entries;
+    /** the number of entries of the table */
+    unsigned size;
+    /** milliseconds during which a repeat of a message is dropped */
+    unsigned long lifetime;
+    /** the number of repeats */
+    unsigned long hits;
+    /** the number of messages seen first */
+    unsigned long misses;
+} DUPCACHE;
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    BACNET_STACK_EXPORT
+    void dupcache_init(
+        DUPCACHE * cache,
+        DUPCACHE_ENTRY * entries,
+        unsigned size,
+        unsigned long lifetime);
+    BACNET_STACK_EXPORT
+    void dupcache_clear(
+        DUPCACHE * cache);
+    BACNET_STACK_EXPORT
+    bool dupcache_seen(
+        DUPCACHE * cache,
+        uint32_t key,
+        unsigned long now);
+    BACNET_STACK_EXPORT
+    unsigned long dupcache_hits(
+        DUPCACHE * cache);
+    BACNET_STACK_EXPORT
+    unsigned long dupcache_misses(
+        DUPCACHE * cache);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,439 @@
+/**
+ * @file
+ * @brief Keyed hash list library
+ *
+ * @section DESCRIPTION
+ *
+ * This is an array of nodes that is also chained into hash buckets.
+ * It stores a pointer to data, which you must malloc and free on
+ * your own, or just use static data.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bacnet/basic/sys/keyhash.h" /* check for valid prototypes */
+
+/* minimum number of nodes to allocate memory for - power of two */
+#define KEYHASH_CHUNK 8
+
+/******************************************************************** */
+/* Generic node routines */
+/******************************************************************** */
+
+/** Spread the bits of a key so that sequential keys, such as
+ * object instances, land in different buckets.
+ *
+ * @param key  Key to be mixed
+ * @param size  Number of buckets - a power of two
+ *
+ * @return bucket number 0..size-1
+ */
+static int BucketIndex(KEY key, int size)
+{
+    uint32_t h = key;
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35UL;
+    h ^= h >> 16;
+
+    return (int)(h & (uint32_t)(size - 1));
+}
+
+/** Link every node into the buckets of the current size.
+ *
+ * @param list  Pointer to the list
+ */
+static void Rehash(OS_Keyhash list)
+{
+    int i;
+    int bucket;
+
+    for (i = 0; i < list->size; i++) {
+        list->buckets[i] = -1;
+    }
+    for (i = 0; i < list->count; i++) {
+        bucket = BucketIndex(list->array[i].key, list->size);
+        list->array[i].next = list->buckets[bucket];
+        list->buckets[bucket] = i;
+    }
+}
+
+/** Check to see if the array is big enough for an addition
+ * or is too big when we are deleting and we can shrink.
+ * The number of buckets always equals the number of nodes.
+ *
+ * @param list  Pointer to the list to be tested.
+ *
+ * @return Returns true if success, false if failed
+ */
+static bool CheckArraySize(OS_Keyhash list)
+{
+    int new_size = 0; /* no size change is the default */
+    struct Keyhash_Node *new_array = NULL;
+    int *new_buckets = NULL;
+    int i;
+
+    if (!list) {
+        return false;
+    }
+    if (list->count == list->size) {
+        /* indicates the need for more memory allocation */
+        if (list->size) {
+            new_size = list->size * 2;
+        } else {
+            new_size = KEYHASH_CHUNK;
+        }
+    } else if ((list->size > KEYHASH_CHUNK) &&
+        (list->count < (list->size / 4))) {
+        /* allow for shrinking memory */
+        new_size = list->size / 2;
+    }
+    if (new_size) {
+        new_array = calloc((size_t)new_size, sizeof(struct Keyhash_Node));
+        new_buckets = calloc((size_t)new_size, sizeof(int));
+        if (!new_array || !new_buckets) {
+            free(new_array);
+            free(new_buckets);
+            return false;
+        }
+        if (list->array) {
+            for (i = 0; i < list->count; i++) {
+                new_array[i] = list->array[i];
+            }
+            free(list->array);
+        }
+        free(list->buckets);
+        list->array = new_array;
+        list->buckets = new_buckets;
+        list->size = new_size;
+        Rehash(list);
+    }
+
+    return true;
+}
+
+/** Find the index of the first node with the key whose data matches.
+ *
+ * @param list  Pointer to the list
+ * @param key  Key to search for
+ * @param match  Function to compare the data, or NULL to match any data
+ * @param context  Search context passed to the match function
+ *
+ * @return index of the node, or -1 if not found
+ */
+static int FindIndex(OS_Keyhash list,
+    KEY key,
+    keyhash_match_function match,
+    const void *context)
+{
+    int index = -1;
+
+    if (list && list->count) {
+        index = list->buckets[BucketIndex(key, list->size)];
+        while (index >= 0) {
+            if ((list->array[index].key == key) &&
+                ((!match) || match(list->array[index].data, context))) {
+                break;
+            }
+            index = list->array[index].next;
+        }
+    }
+
+    return index;
+}
+
+/** Find the link that refers to a node, either a bucket
+ * or the next member of another node in the same bucket.
+ *
+ * @param list  Pointer to the list
+ * @param index  Index of the node
+ *
+ * @return pointer to the link that holds the index
+ */
+static int *FindLink(OS_Keyhash list, int index)
+{
+    int *link;
+
+    link = &list->buckets[BucketIndex(list->array[index].key, list->size)];
+    while (*link != index) {
+        link = &list->array[*link].next;
+    }
+
+    return link;
+}
+
+/******************************************************************** */
+/* list data functions */
+/******************************************************************** */
+
+/** Adds a node to the list.
+ *
+ * @param list  Pointer to the list
+ * @param key  Key to be added - need not be unique
+ * @param data  Pointer to the data hold by the key.
+ *              This pointer needs to be pointing to static or allocated
+ *              memory as it will be stored in the list and later used
+ *              by retrieving the key again.
+ *
+ * @return index of the node, or -1 if there was no memory
+ */
+int Keyhash_Data_Add(OS_Keyhash list, KEY key, void *data)
+{
+    int index = -1;
+    int bucket;
+
+    if (list && CheckArraySize(list)) {
+        index = list->count;
+        bucket = BucketIndex(key, list->size);
+        list->array[index].key = key;
+        list->array[index].data = data;
+        list->array[index].next = list->buckets[bucket];
+        list->buckets[bucket] = index;
+        list->count++;
+    }
+
+    return index;
+}
+
+/** Deletes a node specified by its index.
+ * The last node of the list takes the place of the deleted node.
+ *
+ * @param list  Pointer to the list
+ * @param index Index of the node to be deleted
+ *
+ * @returns Pointer to the data of the deleted node or NULL.
+ */
+void *Keyhash_Data_Delete_By_Index(OS_Keyhash list, int index)
+{
+    void *data = NULL;
+    int last;
+    int *link;
+
+    if (list && (index >= 0) && (index < list->count)) {
+        data = list->array[index].data;
+        link = FindLink(list, index);
+        *link = list->array[index].next;
+        last = list->count - 1;
+        if (index != last) {
+            /* move the last node into the hole */
+            link = FindLink(list, last);
+            *link = index;
+            list->array[index] = list->array[last];
+        }
+        list->count--;
+        /* potentially reduce the size of the array */
+        (void)CheckArraySize(list);
+    }
+
+    return data;
+}
+
+/** Deletes the first node with the given key.
+ *
+ * @param list  Pointer to the list
+ * @param key  Key to be deleted
+ *
+ * @returns Pointer to the data of the deleted node or NULL.
+ */
+void *Keyhash_Data_Delete(OS_Keyhash list, KEY key)
+{
+    return Keyhash_Data_Delete_By_Index(list, FindIndex(list, key, NULL, NULL));
+}
+
+/** Deletes the first node with the given key whose data matches.
+ *
+ * @param list  Pointer to the list
+ * @param key  Key to be deleted
+ * @param match  Function to compare the data with the context
+ * @param context  Search context passed to the match function
+ *
+ * @returns Pointer to the data of the deleted node or NULL.
+ */
+void *Keyhash_Data_Delete_Match(OS_Keyhash list,
+    KEY key,
+    keyhash_match_function match,
+    const void *context)
+{
+    return Keyhash_Data_Delete_By_Index(
+        list, FindIndex(list, key, match, context));
+}
+
+/** Returns the data from the first node with the given key.
+ *
+ * @param list  Pointer to the list
+ * @param key  Key to be found
+ *
+ * @returns Pointer to the data, that might be NULL.
+ */
+void *Keyhash_Data(OS_Keyhash list, KEY key)
+{
+    return Keyhash_Data_Index(list, FindIndex(list, key, NULL, NULL));
+}
+
+/** Returns the data from the first node with the given key
+ * whose data matches.
+ *
+ * @param list  Pointer to the list
+ * @param key  Key to be found
+ * @param match  Function to compare the data with the context
+ * @param context  Search context passed to the match function
+ *
+ * @returns Pointer to the data, that might be NULL.
+ */
+void *Keyhash_Data_Match(OS_Keyhash list,
+    KEY key,
+    keyhash_match_function match,
+    const void *context)
+{
+    return Keyhash_Data_Index(list, FindIndex(list, key, match, context));
+}
+
+/** Returns the index of the first node with the given key.
+ *
+ * @param list  Pointer to the list
+ * @param key  Key whose index shall be retrieved.
+ *
+ * @return Index of the key or -1, if not found.
+ */
+int Keyhash_Index(OS_Keyhash list, KEY key)
+{
+    return FindIndex(list, key, NULL, NULL);
+}
+
+/** Returns the data specified by index
+ *
+ * @param list  Pointer to the list
+ * @param index  Index whose data shall be retrieved.
+ *
+ * @return Pointer to the data that might be NULL.
+ */
+void *Keyhash_Data_Index(OS_Keyhash list, int index)
+{
+    void *data = NULL;
+
+    if (list && (index >= 0) && (index < list->count)) {
+        data = list->array[index].data;
+    }
+
+    return data;
+}
+
+/** Return the key at the given index.
+ *
+ * @param list  Pointer to the list
+ * @param index  Index that shall be returned
+ *
+ * @return Key for the index or 0.
+ */
+KEY Keyhash_Key(OS_Keyhash list, int index)
+{
+    KEY key = 0;
+
+    if (list && (index >= 0) && (index < list->count)) {
+        key = list->array[index].key;
+    }
+
+    return key;
+}
+
+/** Return the number of nodes in this list.
+ *
+ * @param list  Pointer to the list
+ *
+ * @return Count of nodes in the list.
+ */
+int Keyhash_Count(OS_Keyhash list)
+{
+    int cnt = 0;
+
+    if (list) {
+        cnt = list->count;
+    }
+
+    return cnt;
+}
+
+/** Accumulate a buffer into a hash key (FNV-1a).
+ * Start with KEYHASH_SEED, and feed the parts of a
+ * composite key one after another.
+ *
+ * @param hash  Hash of the previous parts, or KEYHASH_SEED
+ * @param buffer  Bytes to be added to the hash
+ * @param length  Number of bytes in the buffer
+ *
+ * @return the new hash key
+ */
+KEY Keyhash_Hash(KEY hash, const void *buffer, size_t length)
+{
+    const uint8_t *octets = buffer;
+    size_t i;
+
+    if (octets) {
+        for (i = 0; i < length; i++) {
+            hash ^= octets[i];
+            hash *= 16777619UL;
+        }
+    }
+
+    return hash;
+}
+
+/******************************************************************** */
+/* Public List functions */
+/******************************************************************** */
+
+/** Returns head of the list or NULL on failure.
+ *
+ * @return Pointer to the hash list or NULL if creation failed.
+ */
+OS_Keyhash Keyhash_Create(void)
+{
+    struct Keyhash *list;
+
+    list = calloc(1, sizeof(struct Keyhash));
+    if (list) {
+        if (!CheckArraySize(list)) {
+            free(list);
+            list = NULL;
+        }
+    }
+
+    return list;
+}
+
+/** Delete specified list.
+ * The data is not freed.
+ *
+ * @param list  Pointer to the list
+ */
+void Keyhash_Delete(OS_Keyhash list)
+{
+    if (list) {
+        free(list->array);
+        free(list->buckets);
+        free(list);
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ * @file
+ * @brief Keyed hash list library header file.
+ *
+ * @section DESCRIPTION
+ *
+ * The keyed hash list is a companion to the keyed list (keylist.h).
+ * It stores a pointer to data under a 32-bit key, like the keyed list,
+ * but finds, adds and deletes in constant time instead of keeping the
+ * keys sorted.  Keys need not be unique: a composite key, such as a
+ * BACnet address plus an object identifier, is reduced to a KEY with
+ * Keyhash_Hash() and the exact entry is picked with a match function.
+ *
+ * The nodes are kept in a dense array, so the data can also be walked
+ * by index from 0 to Keyhash_Count()-1.  Deleting a node moves the last
+ * node into its place.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef KEYHASH_H
+#define KEYHASH_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "bacnet/bacnet_stack_exports.h"
+#include "key.h"
+
+/* initial value for Keyhash_Hash() */
+#define KEYHASH_SEED 2166136261UL
+
+/** Compare the data stored with a key to a search context.
+ * @param data [in] The data stored in the hash list.
+ * @param context [in] The search context given by the caller.
+ * @return true if the data matches the context.
+ */
+typedef bool (*keyhash_match_function) (
+    void *data,
+    const void *context);
+
+struct Keyhash_Node {
+    KEY key;    /* hash key - need not be unique */
+    void *data; /* pointer to some data that is stored */
+    int next;   /* index of the next node in the same bucket, or -1 */
+};
+
+typedef struct Keyhash {
+    struct Keyhash_Node *array; /* dense array of nodes */
+    int *buckets; /* index of the first node in each bucket, or -1 */
+    int count;  /* number of nodes in this list */
+    int size;   /* number of available nodes and buckets - can grow or shrink */
+} KEYHASH_TYPE;
+typedef KEYHASH_TYPE *OS_Keyhash;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    BACNET_STACK_EXPORT
+    OS_Keyhash Keyhash_Create(
+        void);
+
+    BACNET_STACK_EXPORT
+    void Keyhash_Delete(
+        OS_Keyhash list);
+
+    BACNET_STACK_EXPORT
+    int Keyhash_Data_Add(
+        OS_Keyhash list,
+        KEY key,
+        void *data);
+
+    BACNET_STACK_EXPORT
+    void *Keyhash_Data_Delete(
+        OS_Keyhash list,
+        KEY key);
+
+    BACNET_STACK_EXPORT
+    void *Keyhash_Data_Delete_Match(
+        OS_Keyhash list,
+        KEY key,
+        keyhash_match_function match,
+        const void *context);
+
+    BACNET_STACK_EXPORT
+    void *Keyhash_Data_Delete_By_Index(
+        OS_Keyhash list,
+        int index);
+
+    BACNET_STACK_EXPORT
+    void *Keyhash_Data(
+        OS_Keyhash list,
+        KEY key);
+
+    BACNET_STACK_EXPORT
+    void *Keyhash_Data_Match(
+        OS_Keyhash list,
+        KEY key,
+        keyhash_match_function match,
+        const void *context);
+
+    BACNET_STACK_EXPORT
+    int Keyhash_Index(
+        OS_Keyhash list,
+        KEY key);
+
+    BACNET_STACK_EXPORT
+    void *Keyhash_Data_Index(
+        OS_Keyhash list,
+        int index);
+
+    BACNET_STACK_EXPORT
+    KEY Keyhash_Key(
+        OS_Keyhash list,
+        int index);
+
+    BACNET_STACK_EXPORT
+    int Keyhash_Count(
+        OS_Keyhash list);
+
+    BACNET_STACK_EXPORT
+    KEY Keyhash_Hash(
+        KEY hash,
+        const void *buffer,
+        size_t length);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
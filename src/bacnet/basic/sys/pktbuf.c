@@ -0,0 +1,236 @@
+/**
+ * @file
+ * @brief Descriptor of a received packet, which the layers share
+ *
+ * @section DESCRIPTION
+ *
+ * The users of a descriptor are counted under the lock functions, if
+ * any, since the thread that handles a packet may not be the thread of
+ * the datalink that received it.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bacnet/basic/sys/pktbuf.h"
+
+static pktbuf_lock_function Pktbuf_Lock;
+static pktbuf_lock_function Pktbuf_Unlock;
+
+/**
+ * @brief Set the functions that serialize the count of the users,
+ * where the packets are handled on more than one thread.
+ *
+ * @param lock  Function to take the lock, or NULL
+ * @param unlock  Function to release the lock, or NULL
+ */
+void pktbuf_set_lock_functions(
+    pktbuf_lock_function lock, pktbuf_lock_function unlock)
+{
+    Pktbuf_Lock = lock;
+    Pktbuf_Unlock = unlock;
+}
+
+/**
+ * @brief Attach a descriptor to a buffer of the datalink. It is free
+ * until a packet is received into the buffer.
+ *
+ * @param packet  Descriptor
+ * @param buffer  Buffer that the datalink receives into
+ * @param buffer_size  Size of the buffer
+ */
+void pktbuf_init(BACNET_PACKET *packet, uint8_t *buffer, uint16_t buffer_size)
+{
+    if (packet) {
+        memset(packet, 0, sizeof(*packet));
+        packet->buffer = buffer;
+        packet->buffer_size = buffer_size;
+    }
+}
+
+/**
+ * @brief Start the descriptor of a packet that was received into its
+ * buffer, with the datalink as its one user. The headers and the
+ * source are not yet known, so each offset is at the start.
+ *
+ * @param packet  Descriptor that is free
+ * @param length  Number of bytes received
+ *
+ * @return true if the descriptor was free, and now holds the packet
+ */
+bool pktbuf_receive(BACNET_PACKET *packet, uint16_t length)
+{
+    bool status = false;
+
+    if (packet && packet->buffer && (length <= packet->buffer_size)) {
+        if (Pktbuf_Lock) {
+            Pktbuf_Lock();
+        }
+        if (packet->users == 0) {
+            packet->users = 1;
+            status = true;
+        }
+        if (Pktbuf_Unlock) {
+            Pktbuf_Unlock();
+        }
+    }
+    if (status) {
+        packet->length = length;
+        packet->bvlc_offset = 0;
+        packet->npdu_offset = 0;
+        packet->apdu_offset = 0;
+        memset(&packet->header, 0, sizeof(packet->header));
+        memset(&packet->src, 0, sizeof(packet->src));
+    }
+
+    return status;
+}
+
+/**
+ * @brief Add a user to a packet, which keeps its buffer from being
+ * received into until each user has released it.
+ *
+ * @param packet  Descriptor that holds a packet
+ *
+ * @return true if the packet was retained
+ */
+bool pktbuf_retain(BACNET_PACKET *packet)
+{
+    bool status = false;
+
+    if (packet) {
+        if (Pktbuf_Lock) {
+            Pktbuf_Lock();
+        }
+        if (packet->users) {
+            packet->users++;
+            status = true;
+        }
+        if (Pktbuf_Unlock) {
+            Pktbuf_Unlock();
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Release a user of a packet. The buffer is free after the
+ * last user.
+ *
+ * @param packet  Descriptor that holds a packet, or NULL
+ */
+void pktbuf_release(BACNET_PACKET *packet)
+{
+    if (packet) {
+        if (Pktbuf_Lock) {
+            Pktbuf_Lock();
+        }
+        if (packet->users) {
+            packet->users--;
+        }
+        if (Pktbuf_Unlock) {
+            Pktbuf_Unlock();
+        }
+    }
+}
+
+/**
+ * @brief Determine if a packet is still in use.
+ *
+ * @param packet  Descriptor
+ *
+ * @return true if the buffer has a user, and cannot be received into
+ */
+bool pktbuf_busy(BACNET_PACKET *packet)
+{
+    bool status = false;
+
+    if (packet) {
+        if (Pktbuf_Lock) {
+            Pktbuf_Lock();
+        }
+        status = (packet->users > 0);
+        if (Pktbuf_Unlock) {
+            Pktbuf_Unlock();
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief The NPDU of a packet, in place in its buffer.
+ *
+ * @param packet  Descriptor that holds a packet
+ *
+ * @return Pointer to the NPDU
+ */
+uint8_t *pktbuf_npdu(BACNET_PACKET *packet)
+{
+    return &packet->buffer[packet->npdu_offset];
+}
+
+/**
+ * @brief The length of the NPDU of a packet.
+ *
+ * @param packet  Descriptor that holds a packet
+ *
+ * @return Number of bytes from the NPDU to the end of the packet
+ */
+uint16_t pktbuf_npdu_len(BACNET_PACKET *packet)
+{
+    if (packet->npdu_offset >= packet->length) {
+        return 0;
+    }
+
+    return (uint16_t)(packet->length - packet->npdu_offset);
+}
+
+/**
+ * @brief The APDU of a packet, in place in its buffer.
+ *
+ * @param packet  Descriptor that holds a packet
+ *
+ * @return Pointer to the APDU
+ */
+uint8_t *pktbuf_apdu(BACNET_PACKET *packet)
+{
+    return &packet->buffer[packet->apdu_offset];
+}
+
+/**
+ * @brief The length of the APDU of a packet.
+ *
+ * @param packet  Descriptor that holds a packet
+ *
+ * @return Number of bytes from the APDU to the end of the packet
+ */
+uint16_t pktbuf_apdu_len(BACNET_PACKET *packet)
+{
+    if (packet->apdu_offset >= packet->length) {
+        return 0;
+    }
+
+    return (uint16_t)(packet->length - packet->apdu_offset);
+}
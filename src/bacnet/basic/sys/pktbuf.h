@@ -0,0 +1,141 @@
+/**
+ * @file
+ * @brief Descriptor of a received packet, which the layers share
+ *
+ * @section DESCRIPTION
+ *
+ * A datalink receives each packet into a buffer of its own, and hands
+ * the layers above a descriptor of it, instead of a copy. Each layer
+ * records where its header is in the buffer, the BVLC or other link
+ * header, the NPDU and the APDU, and passes the descriptor on. A layer
+ * that keeps the packet after it returns, such as to handle it on
+ * another thread or to forward it, retains the descriptor, and releases
+ * it when done; the datalink reuses the buffer after the last release.
+ *
+ * @section LICENSE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef PKTBUF_H
+#define PKTBUF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacnet/bacnet_stack_exports.h"
+#include "bacnet/bacdef.h"
+
+/** Take or release the lock of the descriptors. */
+typedef void (*pktbuf_lock_function)(void);
+
+/**
+ * Compact header of a packet, parsed in one pass by the datalink,
+ * so that the network and application layers need not decode it again
+ *
+ * @{
+ */
+typedef struct bacnet_packet_header {
+    /** true if the datalink parsed the header into the fields below */
+    bool valid;
+    /** the NPDU control octet */
+    uint8_t npdu_control;
+    /** the first octet of the APDU: the PDU type and its flags */
+    uint8_t pdu_type;
+    /** the max segments and max APDU octet of a confirmed request */
+    uint8_t max_segs_max_apdu;
+    /** the invoke ID of a confirmed request */
+    uint8_t invoke_id;
+    /** the service choice */
+    uint8_t service_choice;
+    /** start of the service request, or the length if there is none */
+    uint16_t service_offset;
+} BACNET_PACKET_HEADER;
+/** @} */
+
+/**
+ * Descriptor of a received packet
+ *
+ * @{
+ */
+typedef struct bacnet_packet {
+    /** the packet as received, owned by the datalink */
+    uint8_t *buffer;
+    /** the size of the buffer */
+    uint16_t buffer_size;
+    /** the number of bytes received */
+    uint16_t length;
+    /** start of the BVLC or other link header */
+    uint16_t bvlc_offset;
+    /** start of the NPDU, or the length if there is none */
+    uint16_t npdu_offset;
+    /** start of the APDU, or the length if there is none */
+    uint16_t apdu_offset;
+    /** the header, if the datalink parsed it */
+    BACNET_PACKET_HEADER header;
+    /** the source address */
+    BACNET_ADDRESS src;
+    /** the number of users; the buffer is free when it is 0 */
+    unsigned users;
+} BACNET_PACKET;
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    BACNET_STACK_EXPORT
+    void pktbuf_init(
+        BACNET_PACKET * packet,
+        uint8_t * buffer,
+        uint16_t buffer_size);
+    BACNET_STACK_EXPORT
+    bool pktbuf_receive(
+        BACNET_PACKET * packet,
+        uint16_t length);
+    BACNET_STACK_EXPORT
+    bool pktbuf_retain(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
+    void pktbuf_release(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
+    bool pktbuf_busy(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
+    void pktbuf_set_lock_functions(
+        pktbuf_lock_function lock,
+        pktbuf_lock_function unlock);
+
+    BACNET_STACK_EXPORT
+    uint8_t *pktbuf_npdu(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
+    uint16_t pktbuf_npdu_len(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
+    uint8_t *pktbuf_apdu(
+        BACNET_PACKET * packet);
+    BACNET_STACK_EXPORT
+    uint16_t pktbuf_apdu_len(
+        BACNET_PACKET * packet);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
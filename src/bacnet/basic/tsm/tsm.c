@@ -35,6 +35,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "bacnet/bits.h"
 #include "bacnet/apdu.h"
 #include "bacnet/bacaddr.h"
@@ -48,8 +49,167 @@
 #include "bacnet/basic/binding/address.h"
 
 /** @file tsm.c  BACnet Transaction State Machine operations  */
-/* FIXME: modify basic service handlers to use TSM rather than this buffer! */
-uint8_t Handler_Transmit_Buffer[MAX_PDU] = { 0 };
+/* deprecated: the basic services encode into the buffers of the pool */
+BACNET_THREAD_LOCAL uint8_t Handler_Transmit_Buffer[MAX_PDU] = { 0 };
+
+/* The transmit buffers are handed out from a fixed pool.  Each buffer
+   has a count of its users: the service that encodes into it, and the
+   transaction that keeps it to send it again, so that the transaction
+   does not need a copy of the PDU. */
+static uint8_t TSM_PDU_Buffer[MAX_PDU_BUFFERS][MAX_PDU];
+static uint8_t TSM_PDU_Users[MAX_PDU_BUFFERS];
+/* stack of the free buffers */
+static uint16_t TSM_PDU_Free_List[MAX_PDU_BUFFERS];
+static unsigned TSM_PDU_Free_Count;
+static bool TSM_PDU_Initialized;
+/* where the services run on more than one thread */
+static tsm_pdu_lock_function TSM_PDU_Lock;
+static tsm_pdu_lock_function TSM_PDU_Unlock;
+
+/** Set the functions that serialize the use of the buffer pool and
+ *  of the segmented responses, where the services run on more than
+ *  one thread.  The lock is taken again while it is held, when a
+ *  segment is sent, so it has to be a recursive one.
+ *
+ * @param lock  Function to take the lock, or NULL
+ * @param unlock  Function to release the lock, or NULL
+ */
+void tsm_pdu_set_lock_functions(
+    tsm_pdu_lock_function lock, tsm_pdu_lock_function unlock)
+{
+    TSM_PDU_Lock = lock;
+    TSM_PDU_Unlock = unlock;
+}
+
+/** Find the buffer of the pool that a PDU is in.
+ *
+ * @param pdu  Start of a buffer of tsm_pdu_acquire()
+ *
+ * @return Index of the buffer, or MAX_PDU_BUFFERS if the PDU is not
+ *  a buffer of the pool.
+ */
+static unsigned tsm_pdu_index(const uint8_t *pdu)
+{
+    size_t offset;
+
+    if (!pdu || (pdu < &TSM_PDU_Buffer[0][0]) ||
+        (pdu > &TSM_PDU_Buffer[MAX_PDU_BUFFERS - 1][0])) {
+        return MAX_PDU_BUFFERS;
+    }
+    offset = (size_t)(pdu - &TSM_PDU_Buffer[0][0]);
+    if (offset % MAX_PDU) {
+        return MAX_PDU_BUFFERS;
+    }
+
+    return (unsigned)(offset / MAX_PDU);
+}
+
+/** Take a transmit buffer of MAX_PDU bytes from the pool.
+ *  Give it back with tsm_pdu_release() when it has been sent.
+ *
+ * @return The buffer, or NULL if all of them are in use.
+ */
+uint8_t *tsm_pdu_acquire(void)
+{
+    uint8_t *pdu = NULL;
+    unsigned i;
+
+    if (TSM_PDU_Lock) {
+        TSM_PDU_Lock();
+    }
+    if (!TSM_PDU_Initialized) {
+        TSM_PDU_Initialized = true;
+        /* hand out the lowest buffers first */
+        for (i = 0; i < MAX_PDU_BUFFERS; i++) {
+            TSM_PDU_Free_List[i] = (uint16_t)(MAX_PDU_BUFFERS - 1 - i);
+        }
+        TSM_PDU_Free_Count = MAX_PDU_BUFFERS;
+    }
+    if (TSM_PDU_Free_Count) {
+        TSM_PDU_Free_Count--;
+        i = TSM_PDU_Free_List[TSM_PDU_Free_Count];
+        TSM_PDU_Users[i] = 1;
+        pdu = &TSM_PDU_Buffer[i][0];
+    }
+    if (TSM_PDU_Unlock) {
+        TSM_PDU_Unlock();
+    }
+
+    return pdu;
+}
+
+/** Add a user to a transmit buffer, which keeps it from going back
+ *  to the pool until each user has released it.
+ *
+ * @param pdu  Buffer of tsm_pdu_acquire()
+ *
+ * @return true if the PDU is a buffer of the pool in use
+ */
+bool tsm_pdu_retain(uint8_t *pdu)
+{
+    unsigned i = tsm_pdu_index(pdu);
+    bool status = false;
+
+    if (i < MAX_PDU_BUFFERS) {
+        if (TSM_PDU_Lock) {
+            TSM_PDU_Lock();
+        }
+        if (TSM_PDU_Users[i] && (TSM_PDU_Users[i] < UINT8_MAX)) {
+            TSM_PDU_Users[i]++;
+            status = true;
+        }
+        if (TSM_PDU_Unlock) {
+            TSM_PDU_Unlock();
+        }
+    }
+
+    return status;
+}
+
+/** Release a user of a transmit buffer, and give the buffer back to
+ *  the pool after its last user.
+ *
+ * @param pdu  Buffer of tsm_pdu_acquire(), or NULL
+ */
+void tsm_pdu_release(uint8_t *pdu)
+{
+    unsigned i = tsm_pdu_index(pdu);
+
+    if (i < MAX_PDU_BUFFERS) {
+        if (TSM_PDU_Lock) {
+            TSM_PDU_Lock();
+        }
+        if (TSM_PDU_Users[i]) {
+            TSM_PDU_Users[i]--;
+            if (TSM_PDU_Users[i] == 0) {
+                TSM_PDU_Free_List[TSM_PDU_Free_Count] = (uint16_t)i;
+                TSM_PDU_Free_Count++;
+            }
+        }
+        if (TSM_PDU_Unlock) {
+            TSM_PDU_Unlock();
+        }
+    }
+}
+
+/** Count the transmit buffers that are free.
+ *
+ * @return Number of buffers that tsm_pdu_acquire() can hand out
+ */
+unsigned tsm_pdu_free_count(void)
+{
+    unsigned count;
+
+    if (TSM_PDU_Lock) {
+        TSM_PDU_Lock();
+    }
+    count = TSM_PDU_Initialized ? TSM_PDU_Free_Count : MAX_PDU_BUFFERS;
+    if (TSM_PDU_Unlock) {
+        TSM_PDU_Unlock();
+    }
+
+    return count;
+}
 
 #if (MAX_TSM_TRANSACTIONS)
 /* Really only needed for segmented messages */
@@ -63,16 +223,156 @@ uint8_t Handler_Transmit_Buffer[MAX_PDU] = { 0 };
 /* table rules: an Invoke ID = 0 is an unused spot in the table */
 static BACNET_TSM_DATA TSM_List[MAX_TSM_TRANSACTIONS];
 
+/* Invoke IDs are handed out from two kinds of space.  The shared space
+   of tsm_next_free_invokeID() is unique across all peers, so that an
+   invoke ID alone identifies the transaction.  The per-peer spaces of
+   tsm_next_free_invokeID_peer() are only unique for each destination,
+   as BACnet requires, so each peer gets its own 255 invoke IDs.
+   An invoke ID in use in the shared space is not used by any peer. */
+/* Table index of each invoke ID of the shared space,
+   or MAX_TSM_TRANSACTIONS if unused.
+   Invoke ID 0 is never used, so its entry always reads unused. */
+static uint16_t TSM_Invoke_ID_Index[256];
+/* number of transactions in any space that use each invoke ID */
+static uint16_t TSM_Invoke_ID_Users[256];
+/* The per-peer transactions are chained into the buckets of a hash
+   of the peer address and invoke ID. */
+#ifndef TSM_PEER_HASH_SIZE
+#define TSM_PEER_HASH_SIZE 256 /* buckets - power of two */
+#endif
+/* bucket of a transaction in the shared space */
+#define TSM_PEER_NONE TSM_PEER_HASH_SIZE
+static uint16_t TSM_Peer_Hash[TSM_PEER_HASH_SIZE];
+static uint16_t TSM_Peer_Next[MAX_TSM_TRANSACTIONS];
+static uint16_t TSM_Peer_Bucket[MAX_TSM_TRANSACTIONS];
+/* stack of the free table entries */
+static uint16_t TSM_Free_List[MAX_TSM_TRANSACTIONS];
+static unsigned TSM_Free_Count;
+static bool TSM_Initialized;
+
+/* The transactions awaiting confirmation are kept in a hashed timing
+   wheel: each one is linked into the bucket of the wheel tick in which
+   its timer expires, so that the timer only has to look at the buckets
+   of the ticks that passed since the last call. */
+#ifndef TSM_TIMER_WHEEL_SIZE
+#define TSM_TIMER_WHEEL_SIZE 64 /* buckets - power of two */
+#endif
+#ifndef TSM_TIMER_WHEEL_TICK
+#define TSM_TIMER_WHEEL_TICK 64 /* milliseconds per bucket */
+#endif
+/* marks the end of a list of table entries */
+#define TSM_TIMER_NONE MAX_TSM_TRANSACTIONS
+/* bucket of an entry that is not on the wheel */
+#define TSM_TIMER_STOPPED TSM_TIMER_WHEEL_SIZE
+static uint16_t TSM_Timer_Wheel[TSM_TIMER_WHEEL_SIZE];
+static uint16_t TSM_Timer_Next[MAX_TSM_TRANSACTIONS];
+static uint16_t TSM_Timer_Prev[MAX_TSM_TRANSACTIONS];
+static uint16_t TSM_Timer_Bucket[MAX_TSM_TRANSACTIONS];
+/* time at which the timer of each transaction expires */
+static uint32_t TSM_Timer_Expires[MAX_TSM_TRANSACTIONS];
+/* milliseconds elapsed, and the last wheel tick that was handled */
+static uint32_t TSM_Time;
+static uint32_t TSM_Timer_Tick;
+
 /* invoke ID for incrementing between subsequent calls. */
 static uint8_t Current_Invoke_ID = 1;
 
 static tsm_timeout_function Timeout_Function;
+static tsm_timeout_peer_function Timeout_Peer_Function;
 
 void tsm_set_timeout_handler(tsm_timeout_function pFunction)
 {
     Timeout_Function = pFunction;
 }
 
+/** Set the handler that is called when a transaction of a per-peer
+ *  invoke ID space times out.  The handler of tsm_set_timeout_handler()
+ *  is only called for the transactions of the shared space.
+ *
+ * @param pFunction  Function to call with the peer and invoke ID
+ */
+void tsm_set_timeout_peer_handler(tsm_timeout_peer_function pFunction)
+{
+    Timeout_Peer_Function = pFunction;
+}
+
+/** Set up the invoke ID index, the free list and the timer wheel
+ *  the first time that they are needed.
+ */
+static void tsm_init(void)
+{
+    unsigned i = 0; /* counter */
+
+    if (TSM_Initialized) {
+        return;
+    }
+    TSM_Initialized = true;
+    for (i = 0; i < 256; i++) {
+        TSM_Invoke_ID_Index[i] = MAX_TSM_TRANSACTIONS;
+        TSM_Invoke_ID_Users[i] = 0;
+    }
+    for (i = 0; i < TSM_PEER_HASH_SIZE; i++) {
+        TSM_Peer_Hash[i] = MAX_TSM_TRANSACTIONS;
+    }
+    /* hand out the lowest table entries first */
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        TSM_Free_List[i] = (uint16_t)(MAX_TSM_TRANSACTIONS - 1 - i);
+        TSM_Timer_Bucket[i] = TSM_TIMER_STOPPED;
+        TSM_Peer_Bucket[i] = TSM_PEER_NONE;
+    }
+    TSM_Free_Count = MAX_TSM_TRANSACTIONS;
+    for (i = 0; i < TSM_TIMER_WHEEL_SIZE; i++) {
+        TSM_Timer_Wheel[i] = TSM_TIMER_NONE;
+    }
+}
+
+/** Hash a peer address and an invoke ID into a bucket.
+ *  Only the parts of the address that bacnet_address_same()
+ *  compares are used.
+ *
+ * @param peer  BACnet address of the peer
+ * @param invokeID  Invoke ID
+ *
+ * @return bucket 0..TSM_PEER_HASH_SIZE-1
+ */
+static uint16_t tsm_peer_bucket(BACNET_ADDRESS *peer, uint8_t invokeID)
+{
+    uint32_t hash;
+
+    /* FNV-1a of the address, continued with the invoke ID */
+    hash = (bacnet_address_hash(peer) ^ invokeID) * 16777619UL;
+    hash ^= hash >> 16;
+
+    return (uint16_t)(hash & (TSM_PEER_HASH_SIZE - 1));
+}
+
+/** Find the transaction of a peer's invoke ID space.
+ *
+ * @param peer  BACnet address of the peer
+ * @param invokeID  Invoke ID
+ *
+ * @return Index of the transaction or MAX_TSM_TRANSACTIONS
+ *         if not found
+ */
+static uint16_t tsm_find_peer_index(BACNET_ADDRESS *peer, uint8_t invokeID)
+{
+    uint16_t index = MAX_TSM_TRANSACTIONS;
+
+    tsm_init();
+    if (peer && invokeID && TSM_Invoke_ID_Users[invokeID]) {
+        index = TSM_Peer_Hash[tsm_peer_bucket(peer, invokeID)];
+        while (index != MAX_TSM_TRANSACTIONS) {
+            if ((TSM_List[index].InvokeID == invokeID) &&
+                bacnet_address_same(&TSM_List[index].dest, peer)) {
+                break;
+            }
+            index = TSM_Peer_Next[index];
+        }
+    }
+
+    return index;
+}
+
 /** Find the given Invoke-Id in the list and
  *  return the index.
  *
@@ -81,86 +381,189 @@ void tsm_set_timeout_handler(tsm_timeout_function pFunction)
  * @return Index of the id or MAX_TSM_TRANSACTIONS
  *         if not found
  */
-static uint8_t tsm_find_invokeID_index(uint8_t invokeID)
+static uint16_t tsm_find_invokeID_index(uint8_t invokeID)
 {
-    unsigned i = 0; /* counter */
-    uint8_t index = MAX_TSM_TRANSACTIONS; /* return value */
+    tsm_init();
 
-    const BACNET_TSM_DATA *plist = TSM_List;
+    return TSM_Invoke_ID_Index[invokeID];
+}
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->InvokeID == invokeID) {
-            index = (uint8_t)i;
-            break;
-        }
+/** Find the transaction of an invoke ID of a peer, in the peer's
+ *  invoke ID space or else in the shared space.  An invoke ID is
+ *  never in use in both, so the result is unambiguous.
+ *
+ * @param peer  BACnet address of the peer, or NULL
+ * @param invokeID  Invoke ID
+ *
+ * @return Index of the transaction or MAX_TSM_TRANSACTIONS
+ *         if not found
+ */
+static uint16_t tsm_find_index(BACNET_ADDRESS *peer, uint8_t invokeID)
+{
+    uint16_t index;
+
+    index = tsm_find_peer_index(peer, invokeID);
+    if (index == MAX_TSM_TRANSACTIONS) {
+        index = tsm_find_invokeID_index(invokeID);
     }
 
     return index;
 }
 
-/** Find the first free index in the TSM table.
+/** Take the first free index from the TSM table.
  *
- * @return Index of the id or MAX_TSM_TRANSACTIONS
+ * @return Index of the entry or MAX_TSM_TRANSACTIONS
  *         if no entry is free.
  */
-static uint8_t tsm_find_first_free_index(void)
+static uint16_t tsm_find_first_free_index(void)
 {
-    unsigned i = 0; /* counter */
-    uint8_t index = MAX_TSM_TRANSACTIONS; /* return value */
+    uint16_t index = MAX_TSM_TRANSACTIONS; /* return value */
 
-    const BACNET_TSM_DATA *plist = TSM_List;
-
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->InvokeID == 0) {
-            index = (uint8_t)i;
-            break;
-        }
+    tsm_init();
+    if (TSM_Free_Count) {
+        TSM_Free_Count--;
+        index = TSM_Free_List[TSM_Free_Count];
     }
 
     return index;
 }
 
-/** Check if space for transactions is available.
+/** Remove a transaction from the timer wheel.
  *
- * @return true/false
+ * @param index  Index of the transaction
  */
-bool tsm_transaction_available(void)
+static void tsm_timer_stop(uint16_t index)
 {
-    bool status = false; /* return value */
-    unsigned i = 0; /* counter */
-
-    const BACNET_TSM_DATA *plist = TSM_List;
+    uint16_t bucket = TSM_Timer_Bucket[index];
+    uint16_t next = TSM_Timer_Next[index];
+    uint16_t prev = TSM_Timer_Prev[index];
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->InvokeID == 0) {
-            /* one is available! */
-            status = true;
-            break;
-        }
+    if (bucket == TSM_TIMER_STOPPED) {
+        return;
+    }
+    if (prev == TSM_TIMER_NONE) {
+        TSM_Timer_Wheel[bucket] = next;
+    } else {
+        TSM_Timer_Next[prev] = next;
     }
+    if (next != TSM_TIMER_NONE) {
+        TSM_Timer_Prev[next] = prev;
+    }
+    TSM_Timer_Bucket[index] = TSM_TIMER_STOPPED;
+}
 
-    return status;
+/** Put a transaction on the timer wheel to expire after the APDU timeout.
+ *
+ * @param index  Index of the transaction
+ */
+static void tsm_timer_start(uint16_t index)
+{
+    uint16_t timeout = apdu_timeout();
+    uint32_t tick;
+    uint16_t bucket;
+
+    tsm_timer_stop(index);
+    TSM_List[index].RequestTimer = timeout;
+    TSM_Timer_Expires[index] = TSM_Time + timeout;
+    tick = TSM_Timer_Expires[index] / TSM_TIMER_WHEEL_TICK;
+    bucket = (uint16_t)(tick % TSM_TIMER_WHEEL_SIZE);
+    TSM_Timer_Prev[index] = TSM_TIMER_NONE;
+    TSM_Timer_Next[index] = TSM_Timer_Wheel[bucket];
+    if (TSM_Timer_Wheel[bucket] != TSM_TIMER_NONE) {
+        TSM_Timer_Prev[TSM_Timer_Wheel[bucket]] = index;
+    }
+    TSM_Timer_Wheel[bucket] = index;
+    TSM_Timer_Bucket[index] = bucket;
 }
 
-/** Return the count of idle transaction.
+/** Take a free entry and reserve it for an invoke ID.
  *
- * @return Count of idle transaction.
+ * @param invokeID  Invoke ID that is not in use in the space
+ *
+ * @return Index of the entry or MAX_TSM_TRANSACTIONS
+ *         if no entry is free.
  */
-uint8_t tsm_transaction_idle_count(void)
+static uint16_t tsm_reserve_index(uint8_t invokeID)
 {
-    uint8_t count = 0; /* return value */
-    unsigned i = 0; /* counter */
+    uint16_t index;
+    BACNET_TSM_DATA *plist;
+
+    index = tsm_find_first_free_index();
+    if (index != MAX_TSM_TRANSACTIONS) {
+        plist = &TSM_List[index];
+        plist->InvokeID = invokeID;
+        plist->state = TSM_STATE_IDLE;
+        plist->RequestTimer = apdu_timeout();
+        plist->apdu = NULL;
+        plist->apdu_len = 0;
+        TSM_Peer_Bucket[index] = TSM_PEER_NONE;
+        TSM_Invoke_ID_Users[invokeID]++;
+    }
+
+    return index;
+}
+
+#if BACNET_SEGMENTATION_ENABLED
+static void tsm_segmented_confirmation_release(BACNET_TSM_DATA *plist);
+#endif
 
-    const BACNET_TSM_DATA *plist = TSM_List;
+/** Return an entry to the free list.
+ *
+ * @param index  Index of the entry
+ */
+static void tsm_free_index(uint16_t index)
+{
+    BACNET_TSM_DATA *plist = &TSM_List[index];
+    uint16_t *link;
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if ((plist->InvokeID == 0) && (plist->state == TSM_STATE_IDLE)) {
-            /* one is available! */
-            count++;
+    tsm_timer_stop(index);
+#if BACNET_SEGMENTATION_ENABLED
+    if (plist->state == TSM_STATE_SEGMENTED_CONFIRMATION) {
+        tsm_segmented_confirmation_release(plist);
+    }
+#endif
+    if (plist->InvokeID != 0) {
+        if (TSM_Peer_Bucket[index] == TSM_PEER_NONE) {
+            TSM_Invoke_ID_Index[plist->InvokeID] = MAX_TSM_TRANSACTIONS;
+        } else {
+            link = &TSM_Peer_Hash[TSM_Peer_Bucket[index]];
+            while (*link != index) {
+                link = &TSM_Peer_Next[*link];
+            }
+            *link = TSM_Peer_Next[index];
+            TSM_Peer_Bucket[index] = TSM_PEER_NONE;
         }
+        TSM_Invoke_ID_Users[plist->InvokeID]--;
+        tsm_pdu_release(plist->apdu);
+        plist->apdu = NULL;
+        plist->apdu_len = 0;
+        TSM_Free_List[TSM_Free_Count] = index;
+        TSM_Free_Count++;
     }
+    plist->state = TSM_STATE_IDLE;
+    plist->InvokeID = 0;
+}
 
-    return count;
+/** Check if space for transactions is available.
+ *
+ * @return true/false
+ */
+bool tsm_transaction_available(void)
+{
+    tsm_init();
+
+    return (TSM_Free_Count > 0);
+}
+
+/** Return the count of idle transaction.
+ *
+ * @return Count of idle transaction.
+ */
+uint16_t tsm_transaction_idle_count(void)
+{
+    tsm_init();
+
+    return (uint16_t)TSM_Free_Count;
 }
 
 /**
@@ -176,7 +579,18 @@ void tsm_invokeID_set(uint8_t invokeID)
     Current_Invoke_ID = invokeID;
 }
 
-/** Gets the next free invokeID,
+/** Advance the current invoke ID, skipping zero - we treat
+ *  that internally as invalid or no free.
+ */
+static void tsm_invokeID_next(void)
+{
+    Current_Invoke_ID++;
+    if (Current_Invoke_ID == 0) {
+        Current_Invoke_ID = 1;
+    }
+}
+
+/** Gets the next free invokeID of the shared space,
  * and reserves a spot in the table
  * returns 0 if none are available.
  *
@@ -184,42 +598,68 @@ void tsm_invokeID_set(uint8_t invokeID)
  */
 uint8_t tsm_next_free_invokeID(void)
 {
-    uint8_t index = 0;
+    uint16_t index = 0;
     uint8_t invokeID = 0;
-    bool found = false;
-    BACNET_TSM_DATA *plist = NULL;
+    unsigned i;
 
     /* Is there even space available? */
     if (tsm_transaction_available()) {
-        while (!found) {
-            index = tsm_find_invokeID_index(Current_Invoke_ID);
-            if (index == MAX_TSM_TRANSACTIONS) {
-                /* Not found, so this invokeID is not used */
-                found = true;
-                /* set this id into the table */
-                index = tsm_find_first_free_index();
+        for (i = 0; i < 255; i++) {
+            if (TSM_Invoke_ID_Users[Current_Invoke_ID] == 0) {
+                /* this invokeID is not used by anyone */
+                index = tsm_reserve_index(Current_Invoke_ID);
                 if (index != MAX_TSM_TRANSACTIONS) {
-                    plist = &TSM_List[index];
-                    plist->InvokeID = invokeID = Current_Invoke_ID;
-                    plist->state = TSM_STATE_IDLE;
-                    plist->RequestTimer = apdu_timeout();
-                    /* update for the next call or check */
-                    Current_Invoke_ID++;
-                    /* skip zero - we treat that internally as invalid or no
-                     * free */
-                    if (Current_Invoke_ID == 0) {
-                        Current_Invoke_ID = 1;
-                    }
+                    invokeID = Current_Invoke_ID;
+                    TSM_Invoke_ID_Index[invokeID] = index;
                 }
-            } else {
-                /* found! This invokeID is already used */
-                /* try next one */
-                Current_Invoke_ID++;
-                /* skip zero - we treat that internally as invalid or no free */
-                if (Current_Invoke_ID == 0) {
-                    Current_Invoke_ID = 1;
+                /* update for the next call or check */
+                tsm_invokeID_next();
+                break;
+            }
+            /* this invokeID is already used, try the next one */
+            tsm_invokeID_next();
+        }
+    }
+
+    return invokeID;
+}
+
+/** Gets the next free invokeID of the invoke ID space of a peer,
+ * and reserves a spot in the table for a request to that peer.
+ * Each peer has its own 255 invoke IDs.
+ * returns 0 if none are available.
+ *
+ * @param dest  BACnet address of the peer
+ *
+ * @return free invoke ID
+ */
+uint8_t tsm_next_free_invokeID_peer(BACNET_ADDRESS *dest)
+{
+    uint16_t index = 0;
+    uint16_t bucket;
+    uint8_t invokeID = 0;
+    unsigned i;
+
+    if (dest && tsm_transaction_available()) {
+        for (i = 0; i < 255; i++) {
+            if ((TSM_Invoke_ID_Index[Current_Invoke_ID] ==
+                    MAX_TSM_TRANSACTIONS) &&
+                (tsm_find_peer_index(dest, Current_Invoke_ID) ==
+                    MAX_TSM_TRANSACTIONS)) {
+                /* this invokeID is not used for this peer */
+                index = tsm_reserve_index(Current_Invoke_ID);
+                if (index != MAX_TSM_TRANSACTIONS) {
+                    invokeID = Current_Invoke_ID;
+                    bacnet_address_copy(&TSM_List[index].dest, dest);
+                    bucket = tsm_peer_bucket(dest, invokeID);
+                    TSM_Peer_Next[index] = TSM_Peer_Hash[bucket];
+                    TSM_Peer_Hash[bucket] = index;
+                    TSM_Peer_Bucket[index] = bucket;
                 }
+                tsm_invokeID_next();
+                break;
             }
+            tsm_invokeID_next();
         }
     }
 
@@ -228,12 +668,16 @@ uint8_t tsm_next_free_invokeID(void)
 
 /** Set for an unsegmented transaction
  *  the state to await confirmation.
+ *  The invoke ID is looked up in the invoke ID space of the
+ *  destination, and else in the shared space.
  *
  * @param invokeID  Invoke-ID
  * @param dest  Pointer to the BACnet destination address.
  * @param ndpu_data  Pointer to the NPDU structure.
- * @param apdu  Pointer to the received message.
- * @param apdu_len  Bytes valid in the received message.
+ * @param apdu  Pointer to the PDU to send again.  A buffer of
+ *  tsm_pdu_acquire() is retained until the transaction is freed;
+ *  any other is copied.
+ * @param apdu_len  Bytes valid in the PDU.
  */
 void tsm_set_confirmed_unsegmented_transaction(uint8_t invokeID,
     BACNET_ADDRESS *dest,
@@ -241,24 +685,32 @@ void tsm_set_confirmed_unsegmented_transaction(uint8_t invokeID,
     uint8_t *apdu,
     uint16_t apdu_len)
 {
-    uint16_t j = 0;
-    uint8_t index;
+    uint16_t index;
     BACNET_TSM_DATA *plist;
+    uint8_t *pdu;
 
-    if (invokeID && ndpu_data && apdu && (apdu_len > 0)) {
-        index = tsm_find_invokeID_index(invokeID);
+    if (invokeID && ndpu_data && apdu && (apdu_len > 0) &&
+        (apdu_len <= MAX_PDU)) {
+        index = tsm_find_index(dest, invokeID);
         if (index < MAX_TSM_TRANSACTIONS) {
             plist = &TSM_List[index];
             /* SendConfirmedUnsegmented */
             plist->state = TSM_STATE_AWAIT_CONFIRMATION;
             plist->RetryCount = 0;
             /* start the timer */
-            plist->RequestTimer = apdu_timeout();
-            /* copy the data */
-            for (j = 0; j < apdu_len; j++) {
-                plist->apdu[j] = apdu[j];
+            tsm_timer_start(index);
+            /* keep the buffer of the pool, or else a copy in one */
+            pdu = plist->apdu;
+            if (tsm_pdu_retain(apdu)) {
+                plist->apdu = apdu;
+            } else {
+                plist->apdu = tsm_pdu_acquire();
+                if (plist->apdu) {
+                    memcpy(plist->apdu, apdu, apdu_len);
+                }
             }
-            plist->apdu_len = apdu_len;
+            tsm_pdu_release(pdu);
+            plist->apdu_len = plist->apdu ? apdu_len : 0;
             npdu_copy_data(&plist->npdu_data, ndpu_data);
             bacnet_address_copy(&plist->dest, dest);
         }
@@ -267,9 +719,52 @@ void tsm_set_confirmed_unsegmented_transaction(uint8_t invokeID,
     return;
 }
 
+/** Copy out the payload of a transaction.
+ *
+ * @param index  Index of the transaction, or MAX_TSM_TRANSACTIONS
+ * @param dest  Pointer to the BACnet destination address, or NULL.
+ * @param ndpu_data  Pointer to the NPDU structure.
+ * @param apdu  Pointer to the received message.
+ * @param apdu_len  Pointer to a variable, that takes
+ *                  the count of bytes valid in the
+ *                  received message.
+ *
+ * @return true if the transaction was found
+ */
+static bool tsm_transaction_pdu(uint16_t index,
+    BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *ndpu_data,
+    uint8_t *apdu,
+    uint16_t *apdu_len)
+{
+    BACNET_TSM_DATA *plist;
+
+    /* how much checking is needed?  state?  dest match? just invokeID? */
+    if (index >= MAX_TSM_TRANSACTIONS) {
+        return false;
+    }
+    /* FIXME: we may want to free the transaction so it doesn't timeout
+     */
+    /* retrieve the transaction */
+    plist = &TSM_List[index];
+    *apdu_len = (uint16_t)plist->apdu_len;
+    if (*apdu_len > MAX_PDU) {
+        *apdu_len = MAX_PDU;
+    }
+    if (*apdu_len) {
+        memcpy(apdu, plist->apdu, *apdu_len);
+    }
+    npdu_copy_data(ndpu_data, &plist->npdu_data);
+    if (dest) {
+        bacnet_address_copy(dest, &plist->dest);
+    }
+
+    return true;
+}
+
 /** Used to retrieve the transaction payload. Used
  *  if we wanted to find out what we sent (i.e. when
- *  we get an ack).
+ *  we get an ack).  Only the shared invoke ID space is searched.
  *
  * @param invokeID  Invoke-ID
  * @param dest  Pointer to the BACnet destination address.
@@ -285,91 +780,870 @@ bool tsm_get_transaction_pdu(uint8_t invokeID,
     uint8_t *apdu,
     uint16_t *apdu_len)
 {
-    uint16_t j = 0;
-    uint8_t index;
     bool found = false;
-    BACNET_TSM_DATA *plist;
 
     if (invokeID && apdu && ndpu_data && apdu_len) {
-        index = tsm_find_invokeID_index(invokeID);
-        /* how much checking is needed?  state?  dest match? just invokeID? */
-        if (index < MAX_TSM_TRANSACTIONS) {
-            /* FIXME: we may want to free the transaction so it doesn't timeout
-             */
-            /* retrieve the transaction */
-            plist = &TSM_List[index];
-            *apdu_len = (uint16_t)plist->apdu_len;
-            if (*apdu_len > MAX_PDU) {
-                *apdu_len = MAX_PDU;
-            }
-            for (j = 0; j < *apdu_len; j++) {
-                apdu[j] = plist->apdu[j];
+        found = tsm_transaction_pdu(tsm_find_invokeID_index(invokeID), dest,
+            ndpu_data, apdu, apdu_len);
+    }
+
+    return found;
+}
+
+/** Used to retrieve the payload of a transaction with a peer, when
+ *  its reply arrives.  The invoke ID is looked up in the invoke ID
+ *  space of the peer, and else in the shared space.
+ *
+ * @param peer  BACnet address of the peer that replied
+ * @param invokeID  Invoke-ID
+ * @param ndpu_data  Pointer to the NPDU structure.
+ * @param apdu  Pointer to the received message.
+ * @param apdu_len  Pointer to a variable, that takes
+ *                  the count of bytes valid in the
+ *                  received message.
+ */
+bool tsm_get_transaction_pdu_peer(BACNET_ADDRESS *peer,
+    uint8_t invokeID,
+    BACNET_NPDU_DATA *ndpu_data,
+    uint8_t *apdu,
+    uint16_t *apdu_len)
+{
+    bool found = false;
+
+    if (invokeID && apdu && ndpu_data && apdu_len) {
+        found = tsm_transaction_pdu(tsm_find_index(peer, invokeID), NULL,
+            ndpu_data, apdu, apdu_len);
+    }
+
+    return found;
+}
+
+/** Mark a transaction as failed, and tell the application.
+ *
+ * @param index  Index of the transaction
+ */
+static void tsm_transaction_failed(uint16_t index)
+{
+    BACNET_TSM_DATA *plist = &TSM_List[index];
+
+    /* note: the invoke id has not been cleared yet
+       and this indicates a failed message:
+       IDLE and a valid invoke id */
+    plist->state = TSM_STATE_IDLE;
+    plist->RequestTimer = 0;
+    if (plist->InvokeID != 0) {
+        if (TSM_Peer_Bucket[index] == TSM_PEER_NONE) {
+            if (Timeout_Function) {
+                Timeout_Function(plist->InvokeID);
             }
-            npdu_copy_data(ndpu_data, &plist->npdu_data);
-            bacnet_address_copy(dest, &plist->dest);
-            found = true;
+        } else if (Timeout_Peer_Function) {
+            Timeout_Peer_Function(&plist->dest, plist->InvokeID);
         }
     }
+}
 
-    return found;
+/** Retry or time out a transaction whose timer expired.
+ *
+ * @param index  Index of the transaction
+ */
+static void tsm_timer_expired(uint16_t index)
+{
+    BACNET_TSM_DATA *plist = &TSM_List[index];
+
+    /* AWAIT_CONFIRMATION */
+    if (plist->RetryCount < apdu_retries()) {
+        tsm_timer_start(index);
+        plist->RetryCount++;
+        if (plist->apdu) {
+            datalink_send_pdu(
+                &plist->dest, &plist->npdu_data, plist->apdu, plist->apdu_len);
+        }
+    } else {
+        tsm_transaction_failed(index);
+    }
+}
+
+#if BACNET_SEGMENTATION_ENABLED
+/* The server side of segmented ComplexACK responses (clause 5.4.5).
+   The whole response is kept until the client has acknowledged the
+   last segment, and is sent one window of segments at a time. */
+#ifndef TSM_SEGMENT_WINDOW_SIZE
+#define TSM_SEGMENT_WINDOW_SIZE 16 /* proposed window size 1..127 */
+#endif
+/* type, invoke ID, sequence number, proposed window size, service choice */
+#define TSM_SEGMENT_HEADER_LEN 5
+/* sequence numbers are not wrapped, which limits the segments */
+#define TSM_SEGMENTS_MAX 256
+
+typedef struct TSM_Segmented_Response {
+    BACNET_TSM_STATE state;
+    /* the client and its invoke ID */
+    BACNET_ADDRESS dest;
+    uint8_t InvokeID;
+    uint8_t ServiceChoice;
+    BACNET_NPDU_DATA npdu_data;
+    /* first sequence number of the window that is sent */
+    uint8_t InitialSequenceNumber;
+    uint8_t ActualWindowSize;
+    uint8_t SegmentRetryCount;
+    /* in milliseconds */
+    uint16_t SegmentTimer;
+    /* octets of the service ACK in each segment */
+    uint16_t SegmentLength;
+    uint16_t SegmentCount;
+    /* the service ACK, without the APDU header */
+    uint16_t service_ack_len;
+    uint8_t service_ack[MAX_APDU_SEGMENTED];
+} TSM_SEGMENTED_RESPONSE;
+
+static TSM_SEGMENTED_RESPONSE
+    TSM_Segmented_Response[MAX_TSM_SEGMENTED_RESPONSES];
+/* the handlers encode a response that may need segments here, each
+   thread into its own, and the response keeps a copy of it */
+static BACNET_THREAD_LOCAL uint8_t TSM_Response_Buffer[MAX_APDU_SEGMENTED];
+/* each segment, or an unsegmented response, is sent from here */
+static BACNET_THREAD_LOCAL uint8_t TSM_Segment_PDU[MAX_PDU];
+
+/** Take the lock of the segmented responses, which is the one of the
+ *  buffer pool. */
+static void tsm_segmented_response_lock(void)
+{
+    if (TSM_PDU_Lock) {
+        TSM_PDU_Lock();
+    }
+}
+
+/** Release the lock of the segmented responses. */
+static void tsm_segmented_response_unlock(void)
+{
+    if (TSM_PDU_Unlock) {
+        TSM_PDU_Unlock();
+    }
+}
+
+/** Find the segmented response to a request of a client.
+ *
+ * @param src  BACnet address of the client
+ * @param invokeID  Invoke ID of the request
+ *
+ * @return the response, or NULL if not found
+ */
+static TSM_SEGMENTED_RESPONSE *tsm_segmented_response_find(
+    BACNET_ADDRESS *src, uint8_t invokeID)
+{
+    TSM_SEGMENTED_RESPONSE *response;
+    unsigned i;
+
+    for (i = 0; i < MAX_TSM_SEGMENTED_RESPONSES; i++) {
+        response = &TSM_Segmented_Response[i];
+        if ((response->state == TSM_STATE_SEGMENTED_RESPONSE) &&
+            (response->InvokeID == invokeID) &&
+            bacnet_address_same(&response->dest, src)) {
+            return response;
+        }
+    }
+
+    return NULL;
+}
+
+/** Find an idle segmented response.
+ *
+ * @return the response, or NULL if all are busy
+ */
+static TSM_SEGMENTED_RESPONSE *tsm_segmented_response_idle(void)
+{
+    unsigned i;
+
+    for (i = 0; i < MAX_TSM_SEGMENTED_RESPONSES; i++) {
+        if (TSM_Segmented_Response[i].state == TSM_STATE_IDLE) {
+            return &TSM_Segmented_Response[i];
+        }
+    }
+
+    return NULL;
+}
+
+/** Return the largest APDU that a client accepts in one segment,
+ *  or unsegmented.
+ *
+ * @param service_data  The header of the request of the client
+ *
+ * @return length of the APDU
+ */
+static uint16_t tsm_segment_apdu_max(
+    BACNET_CONFIRMED_SERVICE_DATA *service_data)
+{
+    uint16_t apdu_max = MAX_APDU;
+
+    if ((service_data->max_resp > 0) &&
+        (service_data->max_resp < apdu_max)) {
+        apdu_max = (uint16_t)service_data->max_resp;
+    }
+
+    return apdu_max;
+}
+
+/** Return the number of segments that a client accepts.
+ *
+ * @param service_data  The header of the request of the client
+ *
+ * @return number of segments
+ */
+static unsigned tsm_segments_accepted(
+    BACNET_CONFIRMED_SERVICE_DATA *service_data)
+{
+    /* unspecified, or more than 64 */
+    if ((service_data->max_segs == 0) || (service_data->max_segs > 64)) {
+        return TSM_SEGMENTS_MAX;
+    }
+
+    return (unsigned)service_data->max_segs;
+}
+
+/** Return the buffer in which a handler encodes a ComplexACK that
+ *  may be sent in segments, if the client accepts segmented responses
+ *  and one can be sent now.
+ *
+ * @param service_data  The header of the request of the client
+ * @param apdu_max  Takes the largest APDU that the client accepts
+ *
+ * @return the buffer, or NULL if the response must fit unsegmented
+ */
+uint8_t *tsm_segmented_response_buffer(
+    BACNET_CONFIRMED_SERVICE_DATA *service_data, uint16_t *apdu_max)
+{
+    uint32_t max;
+    bool idle;
+
+    if (!service_data || !apdu_max ||
+        !service_data->segmented_response_accepted) {
+        return NULL;
+    }
+    /* the response is taken when it is sent, so this is a hint */
+    tsm_segmented_response_lock();
+    idle = (tsm_segmented_response_idle() != NULL);
+    tsm_segmented_response_unlock();
+    if (!idle) {
+        return NULL;
+    }
+    /* the APDU header of an unsegmented ComplexACK is 3 octets */
+    max = tsm_segment_apdu_max(service_data) - TSM_SEGMENT_HEADER_LEN;
+    max = 3 + (max * tsm_segments_accepted(service_data));
+    if (max > sizeof(TSM_Response_Buffer)) {
+        max = sizeof(TSM_Response_Buffer);
+    }
+    *apdu_max = (uint16_t)max;
+
+    return &TSM_Response_Buffer[0];
+}
+
+/** Send one segment of a segmented response.
+ *
+ * @param response  The segmented response
+ * @param sequence_number  Sequence number of the segment
+ */
+static void tsm_segment_send(
+    TSM_SEGMENTED_RESPONSE *response, unsigned sequence_number)
+{
+    BACNET_ADDRESS my_address;
+    unsigned offset;
+    unsigned len;
+    int pdu_len;
+
+    offset = sequence_number * response->SegmentLength;
+    len = response->service_ack_len - offset;
+    if (len > response->SegmentLength) {
+        len = response->SegmentLength;
+    }
+    datalink_get_my_address(&my_address);
+    pdu_len = npdu_encode_pdu(&TSM_Segment_PDU[0], &response->dest,
+        &my_address, &response->npdu_data);
+    TSM_Segment_PDU[pdu_len] = PDU_TYPE_COMPLEX_ACK | BIT(3);
+    if ((sequence_number + 1) < response->SegmentCount) {
+        /* more follows */
+        TSM_Segment_PDU[pdu_len] |= BIT(2);
+    }
+    TSM_Segment_PDU[pdu_len + 1] = response->InvokeID;
+    TSM_Segment_PDU[pdu_len + 2] = (uint8_t)sequence_number;
+    TSM_Segment_PDU[pdu_len + 3] = TSM_SEGMENT_WINDOW_SIZE;
+    TSM_Segment_PDU[pdu_len + 4] = response->ServiceChoice;
+    pdu_len += TSM_SEGMENT_HEADER_LEN;
+    memcpy(&TSM_Segment_PDU[pdu_len], &response->service_ack[offset], len);
+    pdu_len += len;
+    datalink_send_pdu(&response->dest, &response->npdu_data,
+        &TSM_Segment_PDU[0], (unsigned)pdu_len);
+}
+
+/** Send the segments of the current window, and start the segment timer.
+ *
+ * @param response  The segmented response
+ */
+static void tsm_segment_fill_window(TSM_SEGMENTED_RESPONSE *response)
+{
+    unsigned sequence_number;
+    unsigned i;
+
+    for (i = 0; i < response->ActualWindowSize; i++) {
+        sequence_number = response->InitialSequenceNumber + i;
+        if (sequence_number >= response->SegmentCount) {
+            break;
+        }
+        tsm_segment_send(response, sequence_number);
+    }
+    response->SegmentTimer = apdu_timeout();
+}
+
+/** Send a ComplexACK to a client, unsegmented if it fits into the
+ *  max-APDU-length-accepted of the client, and else in segments.
+ *
+ * @param dest  BACnet address of the client
+ * @param npdu_data  NPDU of the response
+ * @param service_data  The header of the request of the client
+ * @param apdu  The unsegmented ComplexACK
+ * @param apdu_len  Length of the ComplexACK
+ *
+ * @return true if the response is sent, false if it is too large
+ *         for the client, or no segmented response is available
+ */
+bool tsm_segmented_response_send(BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    BACNET_CONFIRMED_SERVICE_DATA *service_data,
+    uint8_t *apdu,
+    uint16_t apdu_len)
+{
+    TSM_SEGMENTED_RESPONSE *response;
+    BACNET_ADDRESS my_address;
+    uint16_t apdu_max;
+    uint16_t service_ack_len;
+    unsigned count;
+    int pdu_len;
+
+    if (!dest || !npdu_data || !service_data || !apdu || (apdu_len < 3)) {
+        return false;
+    }
+    apdu_max = tsm_segment_apdu_max(service_data);
+    if (apdu_len <= apdu_max) {
+        /* it fits - send it unsegmented */
+        datalink_get_my_address(&my_address);
+        pdu_len = npdu_encode_pdu(
+            &TSM_Segment_PDU[0], dest, &my_address, npdu_data);
+        memcpy(&TSM_Segment_PDU[pdu_len], apdu, apdu_len);
+        pdu_len += apdu_len;
+        datalink_send_pdu(
+            dest, npdu_data, &TSM_Segment_PDU[0], (unsigned)pdu_len);
+        return true;
+    }
+    /* the service ACK follows the 3 octets of the APDU header */
+    service_ack_len = (uint16_t)(apdu_len - 3);
+    if (!service_data->segmented_response_accepted ||
+        ((size_t)service_ack_len > sizeof(response->service_ack))) {
+        return false;
+    }
+    apdu_max -= TSM_SEGMENT_HEADER_LEN;
+    count = (service_ack_len + apdu_max - 1) / apdu_max;
+    if (count > tsm_segments_accepted(service_data)) {
+        return false;
+    }
+    tsm_segmented_response_lock();
+    response = tsm_segmented_response_idle();
+    if (!response) {
+        tsm_segmented_response_unlock();
+        return false;
+    }
+    bacnet_address_copy(&response->dest, dest);
+    npdu_copy_data(&response->npdu_data, npdu_data);
+    /* the header of the unsegmented ComplexACK */
+    response->InvokeID = apdu[1];
+    response->ServiceChoice = apdu[2];
+    response->service_ack_len = service_ack_len;
+    memcpy(&response->service_ack[0], &apdu[3], response->service_ack_len);
+    response->SegmentLength = apdu_max;
+    response->SegmentCount = (uint16_t)count;
+    /* the first segment is sent alone, and the SegmentACK of the
+       client tells the window size for the following segments */
+    response->state = TSM_STATE_SEGMENTED_RESPONSE;
+    response->InitialSequenceNumber = 0;
+    response->ActualWindowSize = 1;
+    response->SegmentRetryCount = 0;
+    tsm_segment_fill_window(response);
+    tsm_segmented_response_unlock();
+
+    return true;
+}
+
+/** Handle a SegmentACK of a client for a segmented response.
+ *
+ * @param src  BACnet address of the client
+ * @param invokeID  Invoke ID of the request
+ * @param sequence_number  Last segment received in order
+ * @param actual_window_size  Number of segments for the next window
+ */
+void tsm_segment_ack_received(BACNET_ADDRESS *src,
+    uint8_t invokeID,
+    uint8_t sequence_number,
+    uint8_t actual_window_size)
+{
+    TSM_SEGMENTED_RESPONSE *response;
+    uint8_t window_offset;
+
+    tsm_segmented_response_lock();
+    response = tsm_segmented_response_find(src, invokeID);
+    if (!response) {
+        tsm_segmented_response_unlock();
+        return;
+    }
+    window_offset =
+        (uint8_t)(sequence_number - response->InitialSequenceNumber);
+    if (window_offset >= response->ActualWindowSize) {
+        /* DuplicateACK_Received */
+        response->SegmentTimer = apdu_timeout();
+    } else if ((sequence_number + 1U) >= response->SegmentCount) {
+        /* FinalACK_Received */
+        response->state = TSM_STATE_IDLE;
+    } else {
+        /* NewACK_Received - a negative ACK is handled the same way,
+           by sending the window after the last segment received */
+        if (actual_window_size == 0) {
+            actual_window_size = 1;
+        } else if (actual_window_size > 127) {
+            actual_window_size = 127;
+        }
+        response->InitialSequenceNumber = sequence_number + 1;
+        response->ActualWindowSize = actual_window_size;
+        response->SegmentRetryCount = 0;
+        tsm_segment_fill_window(response);
+    }
+    tsm_segmented_response_unlock();
+}
+
+/** Stop a segmented response when the client aborts it.
+ *
+ * @param src  BACnet address of the client
+ * @param invokeID  Invoke ID of the request
+ */
+void tsm_segmented_response_abort(BACNET_ADDRESS *src, uint8_t invokeID)
+{
+    TSM_SEGMENTED_RESPONSE *response;
+
+    tsm_segmented_response_lock();
+    response = tsm_segmented_response_find(src, invokeID);
+    if (response) {
+        response->state = TSM_STATE_IDLE;
+    }
+    tsm_segmented_response_unlock();
+}
+
+/** Resend the window of the segmented responses whose segment timer
+ *  expired, or give up after the APDU retries.
+ *
+ * @param milliseconds - Count of milliseconds passed, since the last call.
+ */
+static void tsm_segmented_response_timer(uint16_t milliseconds)
+{
+    TSM_SEGMENTED_RESPONSE *response;
+    unsigned i;
+
+    tsm_segmented_response_lock();
+    for (i = 0; i < MAX_TSM_SEGMENTED_RESPONSES; i++) {
+        response = &TSM_Segmented_Response[i];
+        if (response->state != TSM_STATE_SEGMENTED_RESPONSE) {
+            continue;
+        }
+        if (response->SegmentTimer > milliseconds) {
+            response->SegmentTimer -= milliseconds;
+        } else if (response->SegmentRetryCount < apdu_retries()) {
+            response->SegmentRetryCount++;
+            tsm_segment_fill_window(response);
+        } else {
+            response->state = TSM_STATE_IDLE;
+        }
+    }
+    tsm_segmented_response_unlock();
+}
+
+/* The client side of segmented ComplexACK responses (clause 5.4.4).
+   The segments are reassembled into a buffer of the pool, and the
+   SegmentACKs tell the server the window size that we accept. */
+typedef struct TSM_Segmented_Confirmation {
+    BACNET_TSM_STATE state;
+    /* the server and the invoke ID of our request */
+    BACNET_ADDRESS src;
+    uint8_t InvokeID;
+    uint8_t ServiceChoice;
+    /* sequence number of the last segment received in order */
+    uint8_t LastSequenceNumber;
+    /* sequence number of the segment before the current window */
+    uint8_t InitialSequenceNumber;
+    uint8_t ActualWindowSize;
+    /* in milliseconds */
+    uint32_t SegmentTimer;
+    /* the service ACK, without the APDU headers of the segments */
+    uint16_t service_ack_len;
+    uint8_t service_ack[MAX_APDU_SEGMENTED];
+} TSM_SEGMENTED_CONFIRMATION;
+
+static TSM_SEGMENTED_CONFIRMATION
+    TSM_Segmented_Confirmation[MAX_TSM_SEGMENTED_CONFIRMATIONS];
+
+/** Find the reassembly of a segmented response from a server.
+ *
+ * @param src  BACnet address of the server
+ * @param invokeID  Invoke ID of our request
+ *
+ * @return the reassembly, or NULL if not found
+ */
+static TSM_SEGMENTED_CONFIRMATION *tsm_segmented_confirmation_find(
+    BACNET_ADDRESS *src, uint8_t invokeID)
+{
+    TSM_SEGMENTED_CONFIRMATION *confirmation;
+    unsigned i;
+
+    for (i = 0; i < MAX_TSM_SEGMENTED_CONFIRMATIONS; i++) {
+        confirmation = &TSM_Segmented_Confirmation[i];
+        if ((confirmation->state == TSM_STATE_SEGMENTED_CONFIRMATION) &&
+            (confirmation->InvokeID == invokeID) &&
+            bacnet_address_same(&confirmation->src, src)) {
+            return confirmation;
+        }
+    }
+
+    return NULL;
+}
+
+/** Find an idle reassembly buffer.
+ *
+ * @return the reassembly, or NULL if all are busy
+ */
+static TSM_SEGMENTED_CONFIRMATION *tsm_segmented_confirmation_idle(void)
+{
+    unsigned i;
+
+    for (i = 0; i < MAX_TSM_SEGMENTED_CONFIRMATIONS; i++) {
+        if (TSM_Segmented_Confirmation[i].state == TSM_STATE_IDLE) {
+            return &TSM_Segmented_Confirmation[i];
+        }
+    }
+
+    return NULL;
+}
+
+/** Give back the reassembly buffer of a transaction that is freed.
+ *
+ * @param plist  The transaction in the SEGMENTED_CONFIRMATION state
+ */
+static void tsm_segmented_confirmation_release(BACNET_TSM_DATA *plist)
+{
+    TSM_SEGMENTED_CONFIRMATION *confirmation;
+
+    confirmation =
+        tsm_segmented_confirmation_find(&plist->dest, plist->InvokeID);
+    if (confirmation) {
+        confirmation->state = TSM_STATE_IDLE;
+    }
+}
+
+/** Send a SegmentACK, or an Abort, to a server.
+ *
+ * @param dest  BACnet address of the server
+ * @param apdu  The APDU
+ * @param apdu_len  Length of the APDU
+ */
+static void tsm_client_pdu_send(
+    BACNET_ADDRESS *dest, uint8_t *apdu, unsigned apdu_len)
+{
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS my_address;
+    int pdu_len;
+
+    datalink_get_my_address(&my_address);
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len =
+        npdu_encode_pdu(&TSM_Segment_PDU[0], dest, &my_address, &npdu_data);
+    memcpy(&TSM_Segment_PDU[pdu_len], apdu, apdu_len);
+    pdu_len += apdu_len;
+    datalink_send_pdu(dest, &npdu_data, &TSM_Segment_PDU[0], (unsigned)pdu_len);
+}
+
+/** Acknowledge the segments of a server up to the last one
+ *  received in order, and restart the segment timer.
+ *
+ * @param confirmation  The reassembly
+ * @param negative  true if a segment was received out of order
+ */
+static void tsm_segmented_confirmation_ack(
+    TSM_SEGMENTED_CONFIRMATION *confirmation, bool negative)
+{
+    uint8_t apdu[4];
+
+    /* sent by a client, so the SRV bit is clear */
+    apdu[0] = PDU_TYPE_SEGMENT_ACK;
+    if (negative) {
+        apdu[0] |= BIT(1);
+    }
+    apdu[1] = confirmation->InvokeID;
+    apdu[2] = confirmation->LastSequenceNumber;
+    apdu[3] = confirmation->ActualWindowSize;
+    tsm_client_pdu_send(&confirmation->src, &apdu[0], sizeof(apdu));
+    confirmation->SegmentTimer = 4UL * apdu_timeout();
+}
+
+/** Abort a segmented response that we cannot reassemble,
+ *  and mark our request as failed.
+ *
+ * @param src  BACnet address of the server
+ * @param invokeID  Invoke ID of our request
+ * @param abort_reason  Reason that is sent to the server
+ */
+static void tsm_segmented_confirmation_abort(
+    BACNET_ADDRESS *src, uint8_t invokeID, uint8_t abort_reason)
+{
+    uint8_t apdu[3];
+    uint16_t index;
+
+    apdu[0] = PDU_TYPE_ABORT;
+    apdu[1] = invokeID;
+    apdu[2] = abort_reason;
+    tsm_client_pdu_send(src, &apdu[0], sizeof(apdu));
+    index = tsm_find_index(src, invokeID);
+    if (index < MAX_TSM_TRANSACTIONS) {
+        if (TSM_List[index].state == TSM_STATE_SEGMENTED_CONFIRMATION) {
+            tsm_segmented_confirmation_release(&TSM_List[index]);
+        }
+        tsm_timer_stop(index);
+        tsm_transaction_failed(index);
+    }
 }
 
+/** Handle a segment of a ComplexACK to one of our requests.
+ *  The segments are acknowledged, and put together until the
+ *  last one is received.
+ *
+ * @param src  BACnet address of the server
+ * @param service_ack_data  The APDU header of the segment
+ * @param service_choice  Service choice of the segment
+ * @param service_ack  The service ACK data in the segment
+ * @param service_ack_len  Length of the service ACK data in the segment
+ * @param apdu  Takes the complete service ACK data
+ * @param apdu_len  Takes the length of the complete service ACK data
+ *
+ * @return true if the last segment was received, and the complete
+ *         service ACK data can be given to the confirmed ACK handler
+ */
+bool tsm_segmented_ack_received(BACNET_ADDRESS *src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA *service_ack_data,
+    uint8_t service_choice,
+    uint8_t *service_ack,
+    uint16_t service_ack_len,
+    uint8_t **apdu,
+    uint16_t *apdu_len)
+{
+    TSM_SEGMENTED_CONFIRMATION *confirmation;
+    uint8_t invokeID;
+    uint8_t sequence_number;
+    uint8_t window_size;
+    uint16_t index;
+
+    if (!src || !service_ack_data || !service_ack || !apdu || !apdu_len) {
+        return false;
+    }
+    tsm_init();
+    invokeID = service_ack_data->invoke_id;
+    sequence_number = service_ack_data->sequence_number;
+    confirmation = tsm_segmented_confirmation_find(src, invokeID);
+    if (!confirmation) {
+        /* the first segment is only expected as the reply to a request */
+        if (sequence_number != 0) {
+            return false;
+        }
+        index = tsm_find_index(src, invokeID);
+        if ((index >= MAX_TSM_TRANSACTIONS) ||
+            (TSM_List[index].state != TSM_STATE_AWAIT_CONFIRMATION)) {
+            return false;
+        }
+        confirmation = tsm_segmented_confirmation_idle();
+        if (!confirmation || (service_ack_len > MAX_APDU_SEGMENTED)) {
+            tsm_segmented_confirmation_abort(
+                src, invokeID, ABORT_REASON_BUFFER_OVERFLOW);
+            return false;
+        }
+        /* SegmentedResponseReceived - no more request retries */
+        tsm_timer_stop(index);
+        TSM_List[index].state = TSM_STATE_SEGMENTED_CONFIRMATION;
+        confirmation->state = TSM_STATE_SEGMENTED_CONFIRMATION;
+        bacnet_address_copy(&confirmation->src, src);
+        confirmation->InvokeID = invokeID;
+        confirmation->ServiceChoice = service_choice;
+        confirmation->LastSequenceNumber = 0;
+        confirmation->InitialSequenceNumber = 0;
+        window_size = service_ack_data->proposed_window_number;
+        if (window_size == 0) {
+            window_size = 1;
+        } else if (window_size > TSM_SEGMENT_WINDOW_SIZE) {
+            window_size = TSM_SEGMENT_WINDOW_SIZE;
+        }
+        confirmation->ActualWindowSize = window_size;
+        memcpy(&confirmation->service_ack[0], service_ack, service_ack_len);
+        confirmation->service_ack_len = service_ack_len;
+        tsm_segmented_confirmation_ack(confirmation, false);
+    } else if (sequence_number !=
+        (uint8_t)(confirmation->LastSequenceNumber + 1)) {
+        /* SegmentReceivedOutOfOrder - ask again for the segments
+           after the last one that was received in order */
+        confirmation->InitialSequenceNumber =
+            confirmation->LastSequenceNumber;
+        tsm_segmented_confirmation_ack(confirmation, true);
+        return false;
+    } else if ((service_choice != confirmation->ServiceChoice) ||
+        (service_ack_len >
+            (MAX_APDU_SEGMENTED - confirmation->service_ack_len))) {
+        tsm_segmented_confirmation_abort(
+            src, invokeID, ABORT_REASON_BUFFER_OVERFLOW);
+        return false;
+    } else {
+        memcpy(&confirmation->service_ack[confirmation->service_ack_len],
+            service_ack, service_ack_len);
+        confirmation->service_ack_len += service_ack_len;
+        confirmation->LastSequenceNumber = sequence_number;
+        if (!service_ack_data->more_follows ||
+            (sequence_number ==
+                (uint8_t)(confirmation->InitialSequenceNumber +
+                    confirmation->ActualWindowSize))) {
+            /* LastSegmentOfGroupReceived or LastSegmentOfMessageReceived */
+            confirmation->InitialSequenceNumber = sequence_number;
+            tsm_segmented_confirmation_ack(confirmation, false);
+        } else {
+            /* NewSegmentReceived */
+            confirmation->SegmentTimer = 4UL * apdu_timeout();
+        }
+    }
+    if (service_ack_data->more_follows) {
+        return false;
+    }
+    /* the buffer keeps the data until it is used for another reassembly,
+       and the transaction is freed by the confirmed ACK handling */
+    confirmation->state = TSM_STATE_IDLE;
+    *apdu = &confirmation->service_ack[0];
+    *apdu_len = confirmation->service_ack_len;
+
+    return true;
+}
+
+/** Give up the reassemblies whose segment timer expired.
+ *
+ * @param milliseconds - Count of milliseconds passed, since the last call.
+ */
+static void tsm_segmented_confirmation_timer(uint16_t milliseconds)
+{
+    TSM_SEGMENTED_CONFIRMATION *confirmation;
+    uint16_t index;
+    unsigned i;
+
+    for (i = 0; i < MAX_TSM_SEGMENTED_CONFIRMATIONS; i++) {
+        confirmation = &TSM_Segmented_Confirmation[i];
+        if (confirmation->state != TSM_STATE_SEGMENTED_CONFIRMATION) {
+            continue;
+        }
+        if (confirmation->SegmentTimer > milliseconds) {
+            confirmation->SegmentTimer -= milliseconds;
+        } else {
+            confirmation->state = TSM_STATE_IDLE;
+            index = tsm_find_index(
+                &confirmation->src, confirmation->InvokeID);
+            if ((index < MAX_TSM_TRANSACTIONS) &&
+                (TSM_List[index].state ==
+                    TSM_STATE_SEGMENTED_CONFIRMATION)) {
+                tsm_transaction_failed(index);
+            }
+        }
+    }
+}
+#endif
+
 /** Called once a millisecond or slower.
  *  This function calls the handler for a
  *  timeout 'Timeout_Function', if neccessary.
+ *  Only the wheel buckets of the ticks that passed are visited.
  *
  * @param milliseconds - Count of milliseconds passed, since the last call.
  */
 void tsm_timer_milliseconds(uint16_t milliseconds)
 {
+    uint16_t expired[MAX_TSM_TRANSACTIONS];
+    unsigned expired_count = 0;
     unsigned i = 0; /* counter */
+    uint32_t tick;
+    uint32_t ticks;
+    uint16_t index;
+    uint16_t next;
 
-    BACNET_TSM_DATA *plist = &TSM_List[0];
-
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++, plist++) {
-        if (plist->state == TSM_STATE_AWAIT_CONFIRMATION) {
-            if (plist->RequestTimer > milliseconds) {
-                plist->RequestTimer -= milliseconds;
-            } else {
-                plist->RequestTimer = 0;
-            }
-            /* AWAIT_CONFIRMATION */
-            if (plist->RequestTimer == 0) {
-                if (plist->RetryCount < apdu_retries()) {
-                    plist->RequestTimer = apdu_timeout();
-                    plist->RetryCount++;
-                    datalink_send_pdu(&plist->dest, &plist->npdu_data,
-                        &plist->apdu[0], plist->apdu_len);
-                } else {
-                    /* note: the invoke id has not been cleared yet
-                       and this indicates a failed message:
-                       IDLE and a valid invoke id */
-                    plist->state = TSM_STATE_IDLE;
-                    if (plist->InvokeID != 0) {
-                        if (Timeout_Function) {
-                            Timeout_Function(plist->InvokeID);
-                        }
-                    }
-                }
+    tsm_init();
+#if BACNET_SEGMENTATION_ENABLED
+    tsm_segmented_response_timer(milliseconds);
+    tsm_segmented_confirmation_timer(milliseconds);
+#endif
+    TSM_Time += milliseconds;
+    tick = TSM_Time / TSM_TIMER_WHEEL_TICK;
+    ticks = tick - TSM_Timer_Tick;
+    if (ticks >= TSM_TIMER_WHEEL_SIZE) {
+        /* a long pause - every bucket is due */
+        ticks = TSM_TIMER_WHEEL_SIZE - 1;
+        TSM_Timer_Tick = tick - ticks;
+    }
+    /* the bucket of the current tick is visited again on the next call,
+       because it can hold timers that expire later in this tick */
+    for (i = 0; i <= ticks; i++) {
+        index = TSM_Timer_Wheel[(TSM_Timer_Tick + i) % TSM_TIMER_WHEEL_SIZE];
+        while (index != TSM_TIMER_NONE) {
+            next = TSM_Timer_Next[index];
+            if ((int32_t)(TSM_Timer_Expires[index] - TSM_Time) <= 0) {
+                tsm_timer_stop(index);
+                expired[expired_count] = index;
+                expired_count++;
             }
+            index = next;
+        }
+    }
+    TSM_Timer_Tick = tick;
+    /* the timeout handler may start or free transactions,
+       so the wheel is not walked while calling it */
+    for (i = 0; i < expired_count; i++) {
+        index = expired[i];
+        if ((TSM_List[index].state == TSM_STATE_AWAIT_CONFIRMATION) &&
+            (TSM_Timer_Bucket[index] == TSM_TIMER_STOPPED)) {
+            tsm_timer_expired(index);
         }
     }
 }
 
-/** Frees the invokeID and sets its state to IDLE
+/** Frees the invokeID of the shared space and sets its state to IDLE
  *
  * @param invokeID  Invoke-ID
  */
 void tsm_free_invoke_id(uint8_t invokeID)
 {
-    uint8_t index;
-    BACNET_TSM_DATA *plist;
+    uint16_t index;
 
     index = tsm_find_invokeID_index(invokeID);
     if (index < MAX_TSM_TRANSACTIONS) {
-        plist = &TSM_List[index];
-        plist->state = TSM_STATE_IDLE;
-        plist->InvokeID = 0;
+        tsm_free_index(index);
+    }
+}
+
+/** Frees the invokeID of a peer and sets its state to IDLE.
+ *  The invoke ID is looked up in the invoke ID space of the
+ *  peer, and else in the shared space, so this is used for
+ *  the replies of either.
+ *
+ * @param peer  BACnet address of the peer that replied
+ * @param invokeID  Invoke-ID
+ */
+void tsm_free_invoke_id_peer(BACNET_ADDRESS *peer, uint8_t invokeID)
+{
+    uint16_t index;
+
+    index = tsm_find_index(peer, invokeID);
+    if (index < MAX_TSM_TRANSACTIONS) {
+        tsm_free_index(index);
     }
 }
 
@@ -380,15 +1654,19 @@ void tsm_free_invoke_id(uint8_t invokeID)
  */
 bool tsm_invoke_id_free(uint8_t invokeID)
 {
-    bool status = true;
-    uint8_t index;
-
-    index = tsm_find_invokeID_index(invokeID);
-    if (index < MAX_TSM_TRANSACTIONS) {
-        status = false;
-    }
+    return (tsm_find_invokeID_index(invokeID) == MAX_TSM_TRANSACTIONS);
+}
 
-    return status;
+/** Check if the invoke ID of a peer has been made free by the
+ *  Transaction State Machine.
+ * @param peer [in] The BACnet address of the peer.
+ * @param invokeID [in] The invokeID to be checked, normally of last message
+ * sent.
+ * @return True if it is free (done with), False if still pending in the TSM.
+ */
+bool tsm_invoke_id_free_peer(BACNET_ADDRESS *peer, uint8_t invokeID)
+{
+    return (tsm_find_index(peer, invokeID) == MAX_TSM_TRANSACTIONS);
 }
 
 /** See if we failed get a confirmation for the message associated
@@ -401,7 +1679,7 @@ bool tsm_invoke_id_free(uint8_t invokeID)
 bool tsm_invoke_id_failed(uint8_t invokeID)
 {
     bool status = false;
-    uint8_t index;
+    uint16_t index;
 
     index = tsm_find_invokeID_index(invokeID);
     if (index < MAX_TSM_TRANSACTIONS) {
@@ -415,6 +1693,29 @@ bool tsm_invoke_id_failed(uint8_t invokeID)
     return status;
 }
 
+/** See if we failed get a confirmation for the message to a peer
+ *  associated with this invoke ID.
+ * @param peer [in] The BACnet address of the peer.
+ * @param invokeID [in] The invokeID to be checked, normally of last message
+ * sent.
+ * @return True if already failed, False if done or segmented or still waiting
+ *         for a confirmation.
+ */
+bool tsm_invoke_id_failed_peer(BACNET_ADDRESS *peer, uint8_t invokeID)
+{
+    bool status = false;
+    uint16_t index;
+
+    index = tsm_find_index(peer, invokeID);
+    if (index < MAX_TSM_TRANSACTIONS) {
+        if (TSM_List[index].state == TSM_STATE_IDLE) {
+            status = true;
+        }
+    }
+
+    return status;
+}
+
 #ifdef BAC_TEST
 #include <assert.h>
 #include <string.h>
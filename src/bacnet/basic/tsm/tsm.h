@@ -31,18 +31,42 @@
 #include "bacnet/config.h"
 #include "bacnet/bacdef.h"
 #include "bacnet/npdu.h"
+#include "bacnet/apdu.h"
 
 /* note: TSM functionality is optional - only needed if we are
    doing client requests */
 
+typedef void (
+    *tsm_pdu_lock_function) (
+    void);
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
-    /* FIXME: modify basic service handlers to use TSM rather than this buffer! */
-    BACNET_STACK_EXPORT extern 
+    /* deprecated: the basic services encode into the buffers of
+       tsm_pdu_acquire(); this one is left for the applications */
+    BACNET_STACK_EXPORT extern BACNET_THREAD_LOCAL
     uint8_t Handler_Transmit_Buffer[MAX_PDU];
 
+/* pool of MAX_PDU_BUFFERS transmit buffers of MAX_PDU bytes */
+    BACNET_STACK_EXPORT
+    uint8_t *tsm_pdu_acquire(
+        void);
+    BACNET_STACK_EXPORT
+    bool tsm_pdu_retain(
+        uint8_t * pdu);
+    BACNET_STACK_EXPORT
+    void tsm_pdu_release(
+        uint8_t * pdu);
+    BACNET_STACK_EXPORT
+    unsigned tsm_pdu_free_count(
+        void);
+    BACNET_STACK_EXPORT
+    void tsm_pdu_set_lock_functions(
+        tsm_pdu_lock_function lock,
+        tsm_pdu_lock_function unlock);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -50,13 +74,15 @@ extern "C" {
 
 #if (!MAX_TSM_TRANSACTIONS)
 #define tsm_free_invoke_id(x) (void)x;
+#define tsm_free_invoke_id_peer(p, x) (void)p; (void)x;
 #else
 typedef enum {
     TSM_STATE_IDLE,
     TSM_STATE_AWAIT_CONFIRMATION,
     TSM_STATE_AWAIT_RESPONSE,
     TSM_STATE_SEGMENTED_REQUEST,
-    TSM_STATE_SEGMENTED_CONFIRMATION
+    TSM_STATE_SEGMENTED_CONFIRMATION,
+    TSM_STATE_SEGMENTED_RESPONSE
 } BACNET_TSM_STATE;
 
 /* 5.4.1 Variables And Parameters */
@@ -91,14 +117,19 @@ typedef struct BACnet_TSM_Data {
     BACNET_ADDRESS dest;
     /* the network layer info */
     BACNET_NPDU_DATA npdu_data;
-    /* copy of the APDU, should we need to send it again */
-    uint8_t apdu[MAX_PDU];
+    /* the PDU, should we need to send it again: a buffer of
+       tsm_pdu_acquire() that the transaction retains, or NULL */
+    uint8_t *apdu;
     unsigned apdu_len;
 } BACNET_TSM_DATA;
 
 typedef void (
     *tsm_timeout_function) (
     uint8_t invoke_id);
+typedef void (
+    *tsm_timeout_peer_function) (
+    BACNET_ADDRESS * dest,
+    uint8_t invoke_id);
 
 
 #ifdef __cplusplus
@@ -108,12 +139,15 @@ extern "C" {
     BACNET_STACK_EXPORT
     void tsm_set_timeout_handler(
         tsm_timeout_function pFunction);
+    BACNET_STACK_EXPORT
+    void tsm_set_timeout_peer_handler(
+        tsm_timeout_peer_function pFunction);
 
     BACNET_STACK_EXPORT
     bool tsm_transaction_available(
         void);
     BACNET_STACK_EXPORT
-    uint8_t tsm_transaction_idle_count(
+    uint16_t tsm_transaction_idle_count(
         void);
     BACNET_STACK_EXPORT
     void tsm_timer_milliseconds(
@@ -122,6 +156,10 @@ extern "C" {
     BACNET_STACK_EXPORT
     void tsm_free_invoke_id(
         uint8_t invokeID);
+    BACNET_STACK_EXPORT
+    void tsm_free_invoke_id_peer(
+        BACNET_ADDRESS * peer,
+        uint8_t invokeID);
 /* use these in tandem */
     BACNET_STACK_EXPORT
     uint8_t tsm_next_free_invokeID(
@@ -129,6 +167,10 @@ extern "C" {
     BACNET_STACK_EXPORT
     void tsm_invokeID_set(
         uint8_t invokeID);
+/* invoke IDs that are only unique for the destination */
+    BACNET_STACK_EXPORT
+    uint8_t tsm_next_free_invokeID_peer(
+        BACNET_ADDRESS * dest);
 /* returns the same invoke ID that was given */
     BACNET_STACK_EXPORT
     void tsm_set_confirmed_unsegmented_transaction(
@@ -145,6 +187,13 @@ extern "C" {
         BACNET_NPDU_DATA * ndpu_data,
         uint8_t * apdu,
         uint16_t * apdu_len);
+    BACNET_STACK_EXPORT
+    bool tsm_get_transaction_pdu_peer(
+        BACNET_ADDRESS * peer,
+        uint8_t invokeID,
+        BACNET_NPDU_DATA * ndpu_data,
+        uint8_t * apdu,
+        uint16_t * apdu_len);
 
     BACNET_STACK_EXPORT
     bool tsm_invoke_id_free(
@@ -152,6 +201,49 @@ extern "C" {
     BACNET_STACK_EXPORT
     bool tsm_invoke_id_failed(
         uint8_t invokeID);
+    BACNET_STACK_EXPORT
+    bool tsm_invoke_id_free_peer(
+        BACNET_ADDRESS * peer,
+        uint8_t invokeID);
+    BACNET_STACK_EXPORT
+    bool tsm_invoke_id_failed_peer(
+        BACNET_ADDRESS * peer,
+        uint8_t invokeID);
+
+#if BACNET_SEGMENTATION_ENABLED
+/* server side segmented responses */
+    BACNET_STACK_EXPORT
+    uint8_t *tsm_segmented_response_buffer(
+        BACNET_CONFIRMED_SERVICE_DATA * service_data,
+        uint16_t * apdu_max);
+    BACNET_STACK_EXPORT
+    bool tsm_segmented_response_send(
+        BACNET_ADDRESS * dest,
+        BACNET_NPDU_DATA * npdu_data,
+        BACNET_CONFIRMED_SERVICE_DATA * service_data,
+        uint8_t * apdu,
+        uint16_t apdu_len);
+    BACNET_STACK_EXPORT
+    void tsm_segment_ack_received(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID,
+        uint8_t sequence_number,
+        uint8_t actual_window_size);
+    BACNET_STACK_EXPORT
+    void tsm_segmented_response_abort(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+/* client side segmented responses */
+    BACNET_STACK_EXPORT
+    bool tsm_segmented_ack_received(
+        BACNET_ADDRESS * src,
+        BACNET_CONFIRMED_SERVICE_ACK_DATA * service_ack_data,
+        uint8_t service_choice,
+        uint8_t * service_ack,
+        uint16_t service_ack_len,
+        uint8_t ** apdu,
+        uint16_t * apdu_len);
+#endif
 
 #ifdef __cplusplus
 }
@@ -108,18 +108,59 @@
 /* for confirmed messages, this is the number of transactions */
 /* that we hold in a queue waiting for timeout. */
 /* Configure to zero if you don't want any confirmed messages */
-/* Configure from 1..255 for number of outstanding confirmed */
-/* requests available. */
+/* Configure from 1..65534 for number of outstanding confirmed */
+/* requests available.  More than 255 are only usable with the */
+/* per-peer invoke IDs of tsm_next_free_invokeID_peer(). */
 #if !defined(MAX_TSM_TRANSACTIONS)
 #define MAX_TSM_TRANSACTIONS 255
 #endif
+/* Transmit buffers of the services, each acquired while a request is */
+/* encoded and kept by the TSM while a confirmed request awaits its */
+/* reply.  Configure for the transactions, plus one for each thread */
+/* that may be encoding at the same time. */
+#if !defined(MAX_PDU_BUFFERS)
+#define MAX_PDU_BUFFERS (MAX_TSM_TRANSACTIONS + 8)
+#endif
+/* Segmented ComplexACK responses, for replies that do not fit into */
+/* the max-APDU-length-accepted of the client.  Configure to 1 to */
+/* send segmented responses, and to accept them for our requests - */
+/* they need the TSM. */
+#if !defined(BACNET_SEGMENTATION_ENABLED)
+#define BACNET_SEGMENTATION_ENABLED 0
+#endif
+#if BACNET_SEGMENTATION_ENABLED && !(MAX_TSM_TRANSACTIONS)
+#undef BACNET_SEGMENTATION_ENABLED
+#define BACNET_SEGMENTATION_ENABLED 0
+#endif
+/* the largest APDU that is sent in segments, up to 65535 octets */
+#if !defined(MAX_APDU_SEGMENTED)
+#if BACNET_SEGMENTATION_ENABLED
+#define MAX_APDU_SEGMENTED (MAX_APDU * 16)
+#else
+#define MAX_APDU_SEGMENTED MAX_APDU
+#endif
+#endif
+/* the number of segmented responses that are sent at the same time */
+#if !defined(MAX_TSM_SEGMENTED_RESPONSES)
+#define MAX_TSM_SEGMENTED_RESPONSES 4
+#endif
+/* the number of segmented responses to our requests that are */
+/* reassembled at the same time */
+#if !defined(MAX_TSM_SEGMENTED_CONFIRMATIONS)
+#define MAX_TSM_SEGMENTED_CONFIRMATIONS 2
+#endif
+/* the max-segments-accepted of our requests */
+#define MAX_SEGMENTS_ACCEPTED (MAX_APDU_SEGMENTED / MAX_APDU)
 /* The address cache is used for binding to BACnet devices */
 /* The number of entries corresponds to the number of */
 /* devices that might respond to an I-Am on the network. */
 /* If your device is a simple server and does not need to bind, */
 /* then you don't need to use this. */
-#if !defined(MAX_ADDRESS_CACHE)
-#define MAX_ADDRESS_CACHE 255
+/* The cache grows as devices are added, up to this number of octets */
+/* of memory, which address_cache_memory_limit_set() changes. The */
+/* default, UINT32_MAX / 2, leaves the cache as large as the site. */
+#if !defined(ADDRESS_CACHE_MEMORY_LIMIT)
+#define ADDRESS_CACHE_MEMORY_LIMIT 0x7FFFFFFFUL
 #endif
 
 /* some modules have debugging enabled using PRINT_ENABLED */
@@ -127,6 +168,13 @@
 #define PRINT_ENABLED 0
 #endif
 
+/* Storage class of the scratch buffers of the service handlers. */
+/* Define as __thread or _Thread_local where the confirmed services */
+/* run on more than one thread, so that each encodes into its own. */
+#if !defined(BACNET_THREAD_LOCAL)
+#define BACNET_THREAD_LOCAL
+#endif
+
 /* BACAPP decodes WriteProperty service requests
    Choose the datatypes that your application supports */
 #if !(defined(BACAPP_ALL) || \
@@ -31,6 +31,7 @@
 #include "bacnet/bacdef.h"
 #include "bacnet/npdu.h"
 #include "bacnet/datalink/bvlc.h"
+#include "bacnet/basic/sys/pktbuf.h"
 
 /* specific defines for BACnet/IP over Ethernet */
 #define BIP_HEADER_MAX (1 + 1 + 2)
@@ -38,6 +39,13 @@
 /* for legacy demo applications */
 #define MAX_MPDU BIP_MPDU_MAX
 
+/** Handle a packet received by a worker thread of the sharded receive.
+ * The worker releases the packet on return; a handler that keeps it
+ * shall retain it.
+ * @param packet - the packet, with its source address and NPDU offset
+ */
+typedef void (*bip_shard_handler)(BACNET_PACKET *packet);
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -57,6 +65,19 @@ extern "C" {
     /* common BACnet/IP functions */
     BACNET_STACK_EXPORT
     bool bip_valid(void);
+    /* file descriptor to wait on for received data, or -1 */
+    BACNET_STACK_EXPORT
+    int bip_get_fd(void);
+
+    /* receive with a group of sockets and worker threads (Linux) */
+    BACNET_STACK_EXPORT
+    bool bip_shards_start(unsigned count, bip_shard_handler handler);
+    BACNET_STACK_EXPORT
+    void bip_shards_stop(void);
+    BACNET_STACK_EXPORT
+    void bip_shards_lock(void);
+    BACNET_STACK_EXPORT
+    void bip_shards_unlock(void);
 
     BACNET_STACK_EXPORT
     void bip_get_broadcast_address(BACNET_ADDRESS *dest);
@@ -73,12 +94,22 @@ extern "C" {
     /* implement in ports module */
     BACNET_STACK_EXPORT
     int bip_send_mpdu(BACNET_IP_ADDRESS *dest, uint8_t *mtu, uint16_t mtu_len);
+    BACNET_STACK_EXPORT
+    int bip_send_mpdu_list(BACNET_IP_ADDRESS *dest,
+        unsigned dest_count,
+        uint8_t *mtu,
+        uint16_t mtu_len);
 
     BACNET_STACK_EXPORT
     uint16_t bip_receive(BACNET_ADDRESS *src,
         uint8_t *pdu,
         uint16_t max_pdu,
         unsigned timeout);
+    /* receive without a copy into the caller's buffer (Linux) */
+    BACNET_STACK_EXPORT
+    BACNET_PACKET *bip_receive_packet(unsigned timeout);
+    BACNET_STACK_EXPORT
+    bool bip_receive_pending(void);
 
     /* use host byte order for setting UDP port */
     BACNET_STACK_EXPORT
@@ -41,6 +41,9 @@ extern "C" {
     void bip6_cleanup(
         void);
     BACNET_STACK_EXPORT
+    int bip6_get_fd(
+        void);
+    BACNET_STACK_EXPORT
     void bip6_get_broadcast_address(
         BACNET_ADDRESS * my_address);
     BACNET_STACK_EXPORT
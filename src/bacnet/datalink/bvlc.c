@@ -39,6 +39,7 @@
 #include "bacnet/bacdcode.h"
 #include "bacnet/bacint.h"
 #include "bacnet/bacdef.h"
+#include "bacnet/bits.h"
 #include "bacnet/datalink/bvlc.h"
 
 /**
@@ -1472,6 +1473,64 @@ int bvlc_decode_original_unicast(uint8_t *pdu,
     return bytes_consumed;
 }
 
+/**
+ * @brief Parse the headers of an Original-Unicast-NPDU that carries a
+ * confirmed request, in one pass over the received packet.
+ *
+ * The BVLC, NPDU and APDU headers are checked against the length as
+ * they are read. Only the common case is parsed: a BVLC length that
+ * matches the packet, an NPDU of this protocol version without DNET,
+ * SNET or a network layer message, and an unsegmented confirmed
+ * request. Any other packet is left for bvlc_decode_header() and the
+ * handlers, which decode it fully.
+ *
+ * @param packet - the received packet, from its BVLC offset
+ *
+ * @return true if the NPDU and APDU offsets and the compact header of
+ *  the packet are set
+ */
+bool bvlc_decode_packet_header(BACNET_PACKET *packet)
+{
+    uint8_t *pdu = NULL;
+    uint16_t pdu_len = 0;
+    uint16_t length = 0;
+    uint16_t offset = 0;
+    bool status = false;
+
+    if (!packet || !packet->buffer ||
+        (packet->bvlc_offset >= packet->length)) {
+        return false;
+    }
+    packet->header.valid = false;
+    pdu = &packet->buffer[packet->bvlc_offset];
+    pdu_len = packet->length - packet->bvlc_offset;
+    if ((pdu_len >= BVLC_PACKET_HEADER_MIN) &&
+        (pdu[0] == BVLL_TYPE_BACNET_IP) &&
+        (pdu[1] == BVLC_ORIGINAL_UNICAST_NPDU)) {
+        decode_unsigned16(&pdu[2], &length);
+        /* NPDU: this version, without DNET, SNET or a network layer
+           message. APDU: an unsegmented confirmed request. */
+        if ((length == pdu_len) && (pdu[4] == BACNET_PROTOCOL_VERSION) &&
+            ((pdu[5] & (BIT(7) | BIT(5) | BIT(3))) == 0) &&
+            ((pdu[6] & 0xF0) == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) &&
+            ((pdu[6] & (BIT(3) | BIT(2))) == 0)) {
+            offset = packet->bvlc_offset;
+            packet->npdu_offset = offset + 4;
+            packet->apdu_offset = offset + 6;
+            packet->header.npdu_control = pdu[5];
+            packet->header.pdu_type = pdu[6];
+            packet->header.max_segs_max_apdu = pdu[7];
+            packet->header.invoke_id = pdu[8];
+            packet->header.service_choice = pdu[9];
+            packet->header.service_offset = offset + BVLC_PACKET_HEADER_MIN;
+            packet->header.valid = true;
+            status = true;
+        }
+    }
+
+    return status;
+}
+
 /**
  * @brief J.2.12 Original-Broadcast-NPDU: Encode
  *
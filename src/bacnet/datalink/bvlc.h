@@ -29,6 +29,7 @@
 #include <stddef.h>
 #include "bacnet/bacdef.h"
 #include "bacnet/npdu.h"
+#include "bacnet/basic/sys/pktbuf.h"
 
 /**
  * BVLL for BACnet/IPv4
@@ -37,6 +38,14 @@
 #define BVLL_TYPE_BACNET_IP (0x81)
 /** @} */
 
+/**
+ * Smallest packet of the fast-path header parser: the BVLC header,
+ * the NPDU version and control, and the header of a confirmed request
+ * @{
+ */
+#define BVLC_PACKET_HEADER_MIN (4 + 2 + 4)
+/** @} */
+
 /**
  * B/IPv4 BVLL Messages
  * @{
@@ -427,6 +436,9 @@ extern "C" {
         uint16_t npdu_size,
         uint16_t *npdu_len);
 
+    BACNET_STACK_EXPORT
+    bool bvlc_decode_packet_header(BACNET_PACKET *packet);
+
     BACNET_STACK_EXPORT
     int bvlc_encode_original_broadcast(
         uint8_t *pdu, uint16_t pdu_size, uint8_t *npdu, uint16_t npdu_len);
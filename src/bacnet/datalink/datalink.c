@@ -84,6 +84,24 @@ void (*datalink_get_broadcast_address)(BACNET_ADDRESS *dest);
 
 void (*datalink_get_my_address)(BACNET_ADDRESS *my_address);
 
+/* file descriptor of the datalink, where it has one */
+static int (*Datalink_Get_Fd)(void);
+
+/** Function template to get the file descriptor to wait on for received
+ * data, such as with select() or epoll.
+ * @ingroup DLTemplates
+ *
+ * @return The file descriptor, or -1 if the datalink has none.
+ */
+int datalink_get_fd(void)
+{
+    if (Datalink_Get_Fd) {
+        return Datalink_Get_Fd();
+    }
+
+    return -1;
+}
+
 void datalink_set(char *datalink_string)
 {
     if (strcasecmp("bip", datalink_string) == 0) {
@@ -93,6 +111,7 @@ void datalink_set(char *datalink_string)
         datalink_cleanup = bip_cleanup;
         datalink_get_broadcast_address = bip_get_broadcast_address;
         datalink_get_my_address = bip_get_my_address;
+        Datalink_Get_Fd = bip_get_fd;
     } else if (strcasecmp("bvlc", datalink_string) == 0) {
         datalink_init = bip_init;
         datalink_send_pdu = bvlc_send_pdu;
@@ -100,6 +119,7 @@ void datalink_set(char *datalink_string)
         datalink_cleanup = bip_cleanup;
         datalink_get_broadcast_address = bip_get_broadcast_address;
         datalink_get_my_address = bip_get_my_address;
+        Datalink_Get_Fd = bip_get_fd;
     } else if (strcasecmp("bip6", datalink_string) == 0) {
         datalink_init = bip6_init;
         datalink_send_pdu = bip6_send_pdu;
@@ -107,6 +127,7 @@ void datalink_set(char *datalink_string)
         datalink_cleanup = bip6_cleanup;
         datalink_get_broadcast_address = bip6_get_broadcast_address;
         datalink_get_my_address = bip6_get_my_address;
+        Datalink_Get_Fd = bip6_get_fd;
     } else if (strcasecmp("bvlc6", datalink_string) == 0) {
         datalink_init = bip6_init;
         datalink_send_pdu = bvlc6_send_pdu;
@@ -114,6 +135,7 @@ void datalink_set(char *datalink_string)
         datalink_cleanup = bip6_cleanup;
         datalink_get_broadcast_address = bip6_get_broadcast_address;
         datalink_get_my_address = bip6_get_my_address;
+        Datalink_Get_Fd = bip6_get_fd;
     } else if (strcasecmp("ethernet", datalink_string) == 0) {
         datalink_init = ethernet_init;
         datalink_send_pdu = ethernet_send_pdu;
@@ -121,6 +143,7 @@ void datalink_set(char *datalink_string)
         datalink_cleanup = ethernet_cleanup;
         datalink_get_broadcast_address = ethernet_get_broadcast_address;
         datalink_get_my_address = ethernet_get_my_address;
+        Datalink_Get_Fd = NULL;
     } else if (strcasecmp("arcnet", datalink_string) == 0) {
         datalink_init = arcnet_init;
         datalink_send_pdu = arcnet_send_pdu;
@@ -128,6 +151,7 @@ void datalink_set(char *datalink_string)
         datalink_cleanup = arcnet_cleanup;
         datalink_get_broadcast_address = arcnet_get_broadcast_address;
         datalink_get_my_address = arcnet_get_my_address;
+        Datalink_Get_Fd = NULL;
     } else if (strcasecmp("mstp", datalink_string) == 0) {
         datalink_init = dlmstp_init;
         datalink_send_pdu = dlmstp_send_pdu;
@@ -135,6 +159,7 @@ void datalink_set(char *datalink_string)
         datalink_cleanup = dlmstp_cleanup;
         datalink_get_broadcast_address = dlmstp_get_broadcast_address;
         datalink_get_my_address = dlmstp_get_my_address;
+        Datalink_Get_Fd = dlmstp_get_fd;
     }
 }
 #endif
@@ -178,4 +203,9 @@ void datalink_maintenance_timer(uint16_t seconds)
 {
     (void)seconds;
 }
+
+int datalink_get_fd(void)
+{
+    return -1;
+}
 #endif
@@ -38,6 +38,7 @@
 #define datalink_get_broadcast_address ethernet_get_broadcast_address
 #define datalink_get_my_address ethernet_get_my_address
 #define datalink_maintenance_timer(s)
+#define datalink_get_fd() (-1)
 
 #elif defined(BACDL_ARCNET)
 #include "bacnet/datalink/arcnet.h"
@@ -49,6 +50,7 @@
 #define datalink_get_broadcast_address arcnet_get_broadcast_address
 #define datalink_get_my_address arcnet_get_my_address
 #define datalink_maintenance_timer(s)
+#define datalink_get_fd() (-1)
 
 #elif defined(BACDL_MSTP)
 #include "bacnet/datalink/dlmstp.h"
@@ -60,6 +62,7 @@
 #define datalink_get_broadcast_address dlmstp_get_broadcast_address
 #define datalink_get_my_address dlmstp_get_my_address
 #define datalink_maintenance_timer(s)
+#define datalink_get_fd dlmstp_get_fd
 
 #elif defined(BACDL_BIP)
 #include "bacnet/datalink/bip.h"
@@ -80,6 +83,7 @@ void routed_get_my_address(
 #define datalink_get_my_address bip_get_my_address
 #endif
 #define datalink_maintenance_timer(s) bvlc_maintenance_timer(s)
+#define datalink_get_fd bip_get_fd
 
 #elif defined(BACDL_BIP6)
 #include "bacnet/datalink/bip6.h"
@@ -91,6 +95,7 @@ void routed_get_my_address(
 #define datalink_get_broadcast_address bip6_get_broadcast_address
 #define datalink_get_my_address bip6_get_my_address
 #define datalink_maintenance_timer(s) bvlc6_maintenance_timer(s)
+#define datalink_get_fd bip6_get_fd
 
 #elif defined(BACDL_ALL) || defined(BACDL_NONE)
 #include "bacnet/npdu.h"
@@ -139,6 +144,9 @@ extern "C" {
     BACNET_STACK_EXPORT
     void datalink_maintenance_timer(uint16_t seconds);
 
+    BACNET_STACK_EXPORT
+    int datalink_get_fd(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
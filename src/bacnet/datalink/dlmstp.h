@@ -57,6 +57,10 @@ extern "C" {
     BACNET_STACK_EXPORT
     void dlmstp_cleanup(
         void);
+    /* file descriptor to wait on for a received packet, or -1 */
+    BACNET_STACK_EXPORT
+    int dlmstp_get_fd(
+        void);
 
     /* returns number of bytes sent on success, negative on failure */
     BACNET_STACK_EXPORT
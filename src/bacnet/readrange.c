@@ -77,7 +77,11 @@ int rr_encode_apdu(
 
     if (apdu) {
         apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
-        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+#if BACNET_SEGMENTATION_ENABLED
+        /* segmented-response-accepted */
+        apdu[0] |= 0x02;
+#endif
+        apdu[1] = encode_max_segs_max_apdu(MAX_SEGMENTS_ACCEPTED, MAX_APDU);
         apdu[2] = invoke_id;
         apdu[3] = SERVICE_CONFIRMED_READ_RANGE; /* service choice */
         apdu_len = 4;
@@ -179,6 +183,7 @@ int rr_decode_service_request(
         len += decode_enumerated(&apdu[len], len_value_type, &enum_value);
         rrdata->object_property = (BACNET_PROPERTY_ID)enum_value;
         rrdata->Overhead = RR_OVERHEAD; /* Start with the fixed overhead */
+        rrdata->MaxAPDU = MAX_APDU; /* unless the response is segmented */
 
         /* Tag 2: Optional Array Index - set to ALL if not present */
         rrdata->array_index = BACNET_ARRAY_ALL; /* Assuming this is the most
@@ -353,8 +358,13 @@ int rr_ack_encode_apdu(
     int imax = 0;
     int len = 0; /* length of each encoding */
     int apdu_len = 0; /* total length of the apdu, return value */
+    int apdu_max = MAX_APDU;
 
     if (apdu) {
+        /* a segmented response may be larger */
+        if (rrdata->MaxAPDU > apdu_max) {
+            apdu_max = rrdata->MaxAPDU;
+        }
         apdu[0] = PDU_TYPE_COMPLEX_ACK; /* complex ACK service */
         apdu[1] = invoke_id; /* original invoke id from request */
         apdu[2] = SERVICE_CONFIRMED_READ_RANGE; /* service choice */
@@ -382,8 +392,8 @@ int rr_ack_encode_apdu(
         apdu_len += encode_opening_tag(&apdu[apdu_len], 5);
         if (rrdata->ItemCount != 0) {
             imax = rrdata->application_data_len;
-            if (imax > (MAX_APDU - apdu_len - 2 /*closing*/)) {
-                imax = (MAX_APDU - apdu_len - 2);
+            if (imax > (apdu_max - apdu_len - 2 /*closing*/)) {
+                imax = (apdu_max - apdu_len - 2);
             }
             for (len = 0; len < imax; len++) {
                 apdu[apdu_len++] = rrdata->application_data[len];
@@ -395,7 +405,7 @@ int rr_ack_encode_apdu(
             (rrdata->RequestType != RR_BY_POSITION) &&
             (rrdata->RequestType != RR_READ_ALL)) {
             /* Context 6 Sequence number of first item */
-            if (apdu_len < (MAX_APDU - 4)) {
+            if (apdu_len < (apdu_max - 4)) {
                 apdu_len += encode_context_unsigned(
                     &apdu[apdu_len], 6, rrdata->FirstSequence);
             }
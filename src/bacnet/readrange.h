@@ -43,6 +43,7 @@ extern "C" {
         BACNET_BIT_STRING ResultFlags;  /**<  FIRST_ITEM, LAST_ITEM, MORE_ITEMS. */
         int RequestType;/**< Index, sequence or time based request. */
         int Overhead;    /**< How much space the baggage takes in the response. */
+        int MaxAPDU;     /**< The largest response that may be encoded. */
         uint32_t ItemCount;
         uint32_t FirstSequence;
         union { /**< Pick the appropriate data type. */
@@ -37,6 +37,7 @@
 #include "bacnet/datalink/bip.h"
 #include "bacnet/datalink/bvlc.h"
 #include "bacnet/basic/sys/debug.h"
+#include "bacnet/basic/sys/mstimer.h"
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/bbmd/h_bbmd.h"
 #include "ctest.h"
@@ -56,6 +57,10 @@ static uint8_t Test_Sent_Message_Length;
 static uint8_t Test_Sent_Message_Buffer[MAX_MPDU];
 static uint16_t Test_Sent_Message_Buffer_Length;
 static BACNET_IP_ADDRESS Test_Sent_Message_Dest;
+/* for the forwards sent from the handler */
+static unsigned Test_Sent_List_Count;
+/* the time, in milliseconds */
+static unsigned long Test_Time;
 
 /* network stub functions */
 /**
@@ -106,6 +111,46 @@ int bip_send_mpdu(BACNET_IP_ADDRESS *dest, uint8_t *mtu, uint16_t mtu_len)
     return 0;
 }
 
+/**
+ * The send function for BACnet/IP driver layer, of one datagram to each
+ * of a list of destinations.
+ *
+ * @param dest - Points to an array of BACNET_IP_ADDRESS structures
+ *  containing the destination addresses.
+ * @param dest_count - number of destination addresses
+ * @param mtu - the bytes of data to send
+ * @param mtu_len - the number of bytes of data to send
+ *
+ * @return the number of datagrams sent
+ */
+int bip_send_mpdu_list(BACNET_IP_ADDRESS *dest,
+    unsigned dest_count,
+    uint8_t *mtu,
+    uint16_t mtu_len)
+{
+    unsigned i;
+
+    for (i = 0; i < dest_count; i++) {
+        /* the BBMD never forwards to itself */
+        if (!bvlc_address_different(&dest[i], &IUT.BIP_Addr)) {
+            return -1;
+        }
+    }
+    Test_Sent_List_Count += dest_count;
+
+    return (int)dest_count;
+}
+
+/**
+ * Get the time, for the cache of broadcasts
+ *
+ * @return the time, in milliseconds
+ */
+unsigned long mstimer_now(void)
+{
+    return Test_Time;
+}
+
 /** Return the Object Instance number for our (single) Device Object.
  * This is a key function, widely invoked by the handler code, since
  * it provides "our" (ie, local) address.
@@ -240,6 +285,186 @@ static void test_BBMD_Result(Test *pTest)
     }
 }
 
+/**
+ * @brief Test the forwarding of a broadcast to each foreign device
+ */
+static void test_BBMD_Fanout(Test *pTest)
+{
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint16_t mtu_len = 0;
+    uint8_t pdu[MAX_MPDU] = { 0 };
+    int pdu_len = 0;
+    BACNET_IP_ADDRESS addr[3];
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    unsigned i = 0;
+
+    test_setup();
+    IUT.BIP_Addr.port = 0xBAC0;
+    bvlc_address_set(&addr[0], 192, 168, 2, 1);
+    bvlc_address_set(&addr[1], 192, 168, 3, 1);
+    /* a registration from our own address is not forwarded to */
+    bvlc_address_copy(&addr[2], &IUT.BIP_Addr);
+    for (i = 0; i < 3; i++) {
+        addr[i].port = 0xBAC0;
+        mtu_len = bvlc_encode_register_foreign_device(mtu, sizeof(mtu), 60);
+        bvlc_bbmd_enabled_handler(&addr[i], &src, mtu, mtu_len);
+        ct_test(pTest, Test_Sent_Message_Type == BVLC_RESULT);
+        ct_test(pTest, Test_Sent_Message_Buffer[0] == 0);
+        ct_test(pTest, Test_Sent_Message_Buffer[1] ==
+            BVLC_RESULT_SUCCESSFUL_COMPLETION);
+    }
+    dest.net = BACNET_BROADCAST_NETWORK;
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, &IUT.BACnet_Address, &npdu_data);
+    pdu_len += iam_encode_apdu(&pdu[pdu_len], IUT.Device_ID, MAX_APDU,
+        SEGMENTATION_NONE, BACNET_VENDOR_ID);
+    Test_Sent_List_Count = 0;
+    bvlc_send_pdu(&dest, &npdu_data, pdu, pdu_len);
+    ct_test(pTest, Test_Sent_List_Count == 2);
+    /* a deleted foreign device is no longer forwarded to */
+    mtu_len = bvlc_encode_delete_foreign_device(mtu, sizeof(mtu), &addr[0]);
+    bvlc_bbmd_enabled_handler(&addr[1], &src, mtu, mtu_len);
+    Test_Sent_List_Count = 0;
+    bvlc_send_pdu(&dest, &npdu_data, pdu, pdu_len);
+    ct_test(pTest, Test_Sent_List_Count == 1);
+    /* nor is an expired one */
+    bvlc_maintenance_timer(60 + 30);
+    Test_Sent_List_Count = 0;
+    bvlc_send_pdu(&dest, &npdu_data, pdu, pdu_len);
+    ct_test(pTest, Test_Sent_List_Count == 0);
+    test_cleanup();
+}
+
+/**
+ * @brief Test the registration and expiry of many foreign devices
+ */
+static void test_BBMD_FDT(Test *pTest)
+{
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint16_t mtu_len = 0;
+    uint8_t pdu[MAX_MPDU] = { 0 };
+    int pdu_len = 0;
+    BACNET_IP_ADDRESS addr = { 0 };
+    BACNET_IP_FOREIGN_DEVICE_TABLE_ENTRY fdt_entry = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    unsigned count = 1000;
+    unsigned i = 0;
+
+    test_setup();
+    IUT.BIP_Addr.port = 0xBAC0;
+    /* more than fit in a fixed table, half of them with a longer TTL */
+    for (i = 0; i < count; i++) {
+        bvlc_address_set(&addr, 10, 0, (uint8_t)(i >> 8), (uint8_t)i);
+        addr.port = 0xBAC0;
+        mtu_len = bvlc_encode_register_foreign_device(
+            mtu, sizeof(mtu), (i & 1) ? 600 : 60);
+        bvlc_bbmd_enabled_handler(&addr, &src, mtu, mtu_len);
+        ct_test(pTest, Test_Sent_Message_Type == BVLC_RESULT);
+        ct_test(pTest, Test_Sent_Message_Buffer[1] ==
+            BVLC_RESULT_SUCCESSFUL_COMPLETION);
+    }
+    dest.net = BACNET_BROADCAST_NETWORK;
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, &IUT.BACnet_Address, &npdu_data);
+    pdu_len += iam_encode_apdu(&pdu[pdu_len], IUT.Device_ID, MAX_APDU,
+        SEGMENTATION_NONE, BACNET_VENDOR_ID);
+    Test_Sent_List_Count = 0;
+    bvlc_send_pdu(&dest, &npdu_data, pdu, pdu_len);
+    ct_test(pTest, Test_Sent_List_Count == count);
+    /* a registration again restarts the timer of the same entry */
+    bvlc_maintenance_timer(60);
+    bvlc_address_set(&addr, 10, 0, 0, 0);
+    addr.port = 0xBAC0;
+    mtu_len = bvlc_encode_register_foreign_device(mtu, sizeof(mtu), 60);
+    bvlc_bbmd_enabled_handler(&addr, &src, mtu, mtu_len);
+    /* the entries of 60 seconds expire, in steps of the timer */
+    for (i = 0; i < 30; i++) {
+        bvlc_maintenance_timer(1);
+    }
+    Test_Sent_List_Count = 0;
+    bvlc_send_pdu(&dest, &npdu_data, pdu, pdu_len);
+    ct_test(pTest, Test_Sent_List_Count == (count / 2) + 1);
+    bvlc_maintenance_timer(60);
+    Test_Sent_List_Count = 0;
+    bvlc_send_pdu(&dest, &npdu_data, pdu, pdu_len);
+    ct_test(pTest, Test_Sent_List_Count == (count / 2));
+    /* the rest expire in one long step of the timer */
+    bvlc_maintenance_timer(600);
+    Test_Sent_List_Count = 0;
+    bvlc_send_pdu(&dest, &npdu_data, pdu, pdu_len);
+    ct_test(pTest, Test_Sent_List_Count == 0);
+    /* the seconds remaining are read back, including the grace period */
+    mtu_len = bvlc_encode_register_foreign_device(mtu, sizeof(mtu), 60);
+    bvlc_bbmd_enabled_handler(&addr, &src, mtu, mtu_len);
+    bvlc_maintenance_timer(10);
+    mtu_len = bvlc_encode_read_foreign_device_table(mtu, sizeof(mtu));
+    bvlc_bbmd_enabled_handler(&addr, &src, mtu, mtu_len);
+    ct_test(pTest,
+        Test_Sent_Message_Type == BVLC_READ_FOREIGN_DEVICE_TABLE_ACK);
+    ct_test(pTest, Test_Sent_Message_Buffer_Length ==
+        BACNET_IP_FDT_ENTRY_SIZE);
+    bvlc_decode_foreign_device_table_entry(Test_Sent_Message_Buffer,
+        Test_Sent_Message_Buffer_Length, &fdt_entry);
+    ct_test(pTest, !bvlc_address_different(&fdt_entry.dest_address, &addr));
+    ct_test(pTest, fdt_entry.ttl_seconds == 60);
+    ct_test(pTest, fdt_entry.ttl_seconds_remaining == 80);
+    test_cleanup();
+}
+
+/**
+ * @brief Test that a broadcast received again is dropped
+ */
+static void test_BBMD_Repeated_Broadcast(Test *pTest)
+{
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint16_t mtu_len = 0;
+    uint8_t pdu[MAX_MPDU] = { 0 };
+    int pdu_len = 0;
+    BACNET_IP_ADDRESS peer = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+
+    test_setup();
+    TD.BIP_Addr.port = 0xBAC0;
+    bvlc_address_set(&peer, 192, 168, 2, 10);
+    peer.port = 0xBAC0;
+    dest.net = BACNET_BROADCAST_NETWORK;
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, &TD.BACnet_Address, &npdu_data);
+    pdu_len += iam_encode_apdu(&pdu[pdu_len], TD.Device_ID, MAX_APDU,
+        SEGMENTATION_NONE, BACNET_VENDOR_ID);
+    mtu_len = bvlc_encode_original_broadcast(mtu, sizeof(mtu), pdu, pdu_len);
+    Test_Time = 0;
+    ct_test(pTest, bvlc_bbmd_enabled_handler(&TD.BIP_Addr, &src, mtu,
+        mtu_len) == 4);
+    ct_test(pTest, bvlc_broadcast_cache_misses() == 1);
+    /* the same broadcast, again, and forwarded back by a peer BBMD */
+    ct_test(pTest, bvlc_bbmd_enabled_handler(&TD.BIP_Addr, &src, mtu,
+        mtu_len) == 0);
+    mtu_len = bvlc_encode_forwarded_npdu(mtu, sizeof(mtu), &TD.BIP_Addr,
+        pdu, pdu_len);
+    Test_Sent_List_Count = 0;
+    ct_test(pTest, bvlc_bbmd_enabled_handler(&peer, &src, mtu,
+        mtu_len) == 0);
+    ct_test(pTest, Test_Sent_List_Count == 0);
+    ct_test(pTest, bvlc_broadcast_cache_hits() == 2);
+    /* a plain node hands it up, since a device may repeat it on purpose */
+    ct_test(pTest, bvlc_bbmd_disabled_handler(&peer, &src, mtu,
+        mtu_len) == 10);
+    ct_test(pTest, bvlc_broadcast_cache_hits() == 2);
+    /* sent again later, it is passed on */
+    Test_Time = 1000;
+    ct_test(pTest, bvlc_bbmd_enabled_handler(&peer, &src, mtu,
+        mtu_len) == 10);
+    ct_test(pTest, bvlc_broadcast_cache_misses() == 2);
+    test_cleanup();
+}
+
 static void test_BBMD_Handler(Test *pTest)
 {
     bool rc;
@@ -249,6 +474,12 @@ static void test_BBMD_Handler(Test *pTest)
     assert(rc);
     rc = ct_addTestFunction(pTest, test_Initiate_Original_Broadcast_NPDU);
     assert(rc);
+    rc = ct_addTestFunction(pTest, test_BBMD_Fanout);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, test_BBMD_FDT);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, test_BBMD_Repeated_Broadcast);
+    assert(rc);
 }
 
 int main(void)
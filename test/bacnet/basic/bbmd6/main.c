@@ -37,6 +37,7 @@
 #include "bacnet/datalink/bip6.h"
 #include "bacnet/datalink/bvlc6.h"
 #include "bacnet/basic/sys/debug.h"
+#include "bacnet/basic/sys/mstimer.h"
 #include "bacnet/basic/object/device.h"
 #include "bacnet/basic/bbmd6/h_bbmd6.h"
 #include "bacnet/basic/bbmd6/vmac.h"
@@ -57,6 +58,8 @@ static uint8_t Test_Sent_Message_Length;
 static uint8_t Test_Sent_Message_Buffer[MAX_MPDU];
 static uint16_t Test_Sent_Message_Buffer_Length;
 static BACNET_IP6_ADDRESS Test_Sent_Message_Dest;
+/* the time, in milliseconds */
+static unsigned long Test_Time;
 
 /* network stub functions */
 /**
@@ -107,6 +110,16 @@ int bip6_send_mpdu(BACNET_IP6_ADDRESS *dest, uint8_t *mtu, uint16_t mtu_len)
     return 0;
 }
 
+/**
+ * Get the time, for the cache of broadcasts
+ *
+ * @return the time, in milliseconds
+ */
+unsigned long mstimer_now(void)
+{
+    return Test_Time;
+}
+
 /** Return the Object Instance number for our (single) Device Object.
  * This is a key function, widely invoked by the handler code, since
  * it provides "our" (ie, local) address.
@@ -283,6 +296,109 @@ static void test_BBMD_Result(Test *pTest)
     }
 }
 
+/**
+ * @brief Test that a broadcast received again is dropped
+ */
+static void test_BBMD_Repeated_Broadcast(Test *pTest)
+{
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint16_t mtu_len = 0;
+    uint8_t pdu[MAX_MPDU] = { 0 };
+    int pdu_len = 0;
+    BACNET_IP6_ADDRESS bbmd = { { 0 } };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    int offset = 0;
+
+    test_setup();
+    bvlc6_address_set(&bbmd, 0x2001, 0x0DBB, 0xAC10, 0xFE02, 0, 0, 0,
+        BIP6_MULTICAST_GROUP_ID);
+    dest.net = BACNET_BROADCAST_NETWORK;
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, &TD.BACnet_Address, &npdu_data);
+    pdu_len += iam_encode_apdu(&pdu[pdu_len], TD.Device_ID, MAX_APDU,
+        SEGMENTATION_NONE, BACNET_VENDOR_ID);
+    mtu_len = bvlc6_encode_original_broadcast(mtu, sizeof(mtu),
+        TD.Device_ID, pdu, pdu_len);
+    Test_Time = 0;
+    offset = bvlc6_bbmd_disabled_handler(&TD.BIP6_Addr, &src, mtu, mtu_len);
+    ct_test(pTest, offset > 0);
+    /* the same broadcast, forwarded by a BBMD */
+    mtu_len = bvlc6_encode_forwarded_npdu(mtu, sizeof(mtu), TD.Device_ID,
+        &TD.BIP6_Addr, pdu, pdu_len);
+    offset = bvlc6_bbmd_disabled_handler(&bbmd, &src, mtu, mtu_len);
+    ct_test(pTest, offset == 0);
+    ct_test(pTest, bvlc6_broadcast_cache_hits() == 1);
+    ct_test(pTest, bvlc6_broadcast_cache_misses() == 1);
+    /* sent again later, it is passed on */
+    Test_Time = 1000;
+    offset = bvlc6_bbmd_disabled_handler(&bbmd, &src, mtu, mtu_len);
+    ct_test(pTest, offset > 0);
+    test_cleanup();
+}
+
+/**
+ * @brief Test the VMAC table, by Device ID and by address
+ */
+static void test_VMAC_Table(Test *pTest)
+{
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint16_t mtu_len = 0;
+    struct vmac_data vmac = { { 0 } };
+    struct vmac_data *pVMAC = NULL;
+    BACNET_ADDRESS src = { 0 };
+    uint32_t device_id = 0;
+    unsigned count = 2000;
+    unsigned i = 0;
+
+    test_setup();
+    vmac.mac_len = VMAC_MAC_MAX;
+    for (i = 0; i < count; i++) {
+        vmac.mac[0] = 0x20;
+        vmac.mac[14] = (uint8_t)(i >> 8);
+        vmac.mac[15] = (uint8_t)i;
+        ct_test(pTest, VMAC_Add(1000 + i, &vmac));
+    }
+    ct_test(pTest, VMAC_Count() == count);
+    ct_test(pTest, !VMAC_Add(1000, &vmac));
+    for (i = 0; i < count; i += 2) {
+        ct_test(pTest, VMAC_Delete(1000 + i));
+    }
+    ct_test(pTest, VMAC_Count() == (count / 2));
+    for (i = 0; i < count; i++) {
+        vmac.mac[14] = (uint8_t)(i >> 8);
+        vmac.mac[15] = (uint8_t)i;
+        device_id = 0;
+        if (i & 1) {
+            ct_test(pTest, VMAC_Find_By_Data(&vmac, &device_id));
+            ct_test(pTest, device_id == (1000 + i));
+            pVMAC = VMAC_Find_By_Key(device_id);
+            ct_test(pTest, VMAC_Match(pVMAC, &vmac));
+        } else {
+            ct_test(pTest, !VMAC_Find_By_Data(&vmac, &device_id));
+            ct_test(pTest, VMAC_Find_By_Key(1000 + i) == NULL);
+        }
+    }
+    /* a device that is resolved at a new address moves there */
+    mtu_len = bvlc6_encode_address_resolution(
+        mtu, sizeof(mtu), 1001, IUT.Device_ID);
+    bvlc6_bbmd_disabled_handler(&TD.BIP6_Addr, &src, mtu, mtu_len);
+    ct_test(pTest, VMAC_Count() == (count / 2));
+    ct_test(pTest, VMAC_Find_By_Data(VMAC_Find_By_Key(1001), &device_id));
+    ct_test(pTest, device_id == 1001);
+    /* and another device at that address takes its place */
+    mtu_len = bvlc6_encode_address_resolution(
+        mtu, sizeof(mtu), TD.Device_ID, IUT.Device_ID);
+    bvlc6_bbmd_disabled_handler(&TD.BIP6_Addr, &src, mtu, mtu_len);
+    ct_test(pTest, VMAC_Find_By_Key(1001) == NULL);
+    ct_test(pTest, VMAC_Find_By_Data(VMAC_Find_By_Key(TD.Device_ID),
+        &device_id));
+    ct_test(pTest, device_id == TD.Device_ID);
+    ct_test(pTest, VMAC_Count() == (count / 2));
+    test_cleanup();
+}
+
 static void test_BBMD6(Test *pTest)
 {
     bool rc;
@@ -294,6 +410,10 @@ static void test_BBMD6(Test *pTest)
     assert(rc);
     rc = ct_addTestFunction(pTest, test_Initiate_Original_Broadcast_NPDU);
     assert(rc);
+    rc = ct_addTestFunction(pTest, test_BBMD_Repeated_Broadcast);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, test_VMAC_Table);
+    assert(rc);
 }
 
 int main(void)
@@ -18,6 +18,8 @@
 #define BACNET_ADDRESS_CACHE_FILE
 #endif
 #endif
+/* more devices than the 255 that the cache used to be limited to */
+#define ADDRESS_TEST_DEVICES 1000
 
 /**
  * @addtogroup bacnet_tests
@@ -32,14 +34,17 @@ static void set_address(unsigned index, BACNET_ADDRESS *dest)
     unsigned i;
 
     for (i = 0; i < MAX_MAC_LEN; i++) {
-        dest->mac[i] = index;
+        dest->mac[i] = (uint8_t)index;
     }
+    /* more than 255 devices differ in the second octet */
+    dest->mac[1] = (uint8_t)(index >> 8);
     dest->mac_len = MAX_MAC_LEN;
     dest->net = 7;
     dest->len = MAX_MAC_LEN;
     for (i = 0; i < MAX_MAC_LEN; i++) {
-        dest->adr[i] = index;
+        dest->adr[i] = (uint8_t)index;
     }
+    dest->adr[1] = (uint8_t)(index >> 8);
 }
 
 #if 0 /* Not used */
@@ -140,7 +145,7 @@ static void testAddress(void)
     unsigned test_max_apdu = 0;
 
     /* create a fake address database */
-    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+    for (i = 0; i < ADDRESS_TEST_DEVICES; i++) {
         set_address(i, &src);
         device_id = i * 255;
         address_add(device_id, max_apdu, &src);
@@ -148,7 +153,7 @@ static void testAddress(void)
         zassert_equal(count, (i + 1), NULL);
     }
 
-    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+    for (i = 0; i < ADDRESS_TEST_DEVICES; i++) {
         device_id = i * 255;
         set_address(i, &src);
         /* test the lookup by device id */
@@ -162,21 +167,304 @@ static void testAddress(void)
         zassert_equal(test_device_id, device_id, NULL);
         zassert_equal(test_max_apdu, max_apdu, NULL);
         zassert_true(bacnet_address_same(&test_address, &src), NULL);
-        zassert_equal(address_count(), MAX_ADDRESS_CACHE, NULL);
+        zassert_equal(address_count(), ADDRESS_TEST_DEVICES, NULL);
         /* test the lookup by MAC */
         zassert_true(address_get_device_id(&src, &test_device_id), NULL);
         zassert_equal(test_device_id, device_id, NULL);
     }
 
-    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+    for (i = 0; i < ADDRESS_TEST_DEVICES; i++) {
         device_id = i * 255;
         address_remove_device(device_id);
         zassert_false(
             address_get_by_device(device_id, &test_max_apdu, &test_address), NULL);
         count = address_count();
-        zassert_equal(count, (MAX_ADDRESS_CACHE - i - 1), NULL);
+        zassert_equal(count, (ADDRESS_TEST_DEVICES - i - 1), NULL);
     }
 }
+
+/**
+ * @brief Test that the lookups follow the changes of the cache entries
+ */
+static void testAddressIndex(void)
+{
+    BACNET_ADDRESS src, moved, test_address;
+    uint32_t test_device_id = 0;
+    unsigned i;
+    unsigned test_max_apdu = 0;
+
+    address_init();
+    set_address(1, &src);
+    set_address(2, &moved);
+    /* a bind request is found by device, but not by address */
+    zassert_false(address_bind_request(1234, &test_max_apdu, &test_address),
+        NULL);
+    zassert_false(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_false(
+        address_get_by_device(1234, &test_max_apdu, &test_address), NULL);
+    address_add_binding(1234, 480, &src);
+    zassert_true(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_equal(test_device_id, 1234, NULL);
+    zassert_true(address_bind_request(1234, &test_max_apdu, &test_address),
+        NULL);
+    zassert_true(bacnet_address_same(&test_address, &src), NULL);
+    /* a device that moved is only found at its new address */
+    address_add(1234, 1476, &moved);
+    zassert_false(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_true(address_get_device_id(&moved, &test_device_id), NULL);
+    zassert_equal(test_device_id, 1234, NULL);
+    zassert_true(
+        address_get_by_device(1234, &test_max_apdu, &test_address), NULL);
+    zassert_equal(test_max_apdu, 1476, NULL);
+    /* an expired entry is gone from both lookups */
+    for (i = 0; i <= 24; i++) {
+        address_cache_timer(60 * 60);
+    }
+    zassert_false(
+        address_get_by_device(1234, &test_max_apdu, &test_address), NULL);
+    zassert_false(address_get_device_id(&moved, &test_device_id), NULL);
+    /* removing a device leaves the others */
+    address_add(1, 480, &src);
+    address_add(2, 480, &moved);
+    zassert_true(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_equal(test_device_id, 1, NULL);
+    address_remove_device(1);
+    zassert_false(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_true(address_get_device_id(&moved, &test_device_id), NULL);
+    zassert_equal(test_device_id, 2, NULL);
+    address_init();
+    zassert_false(address_get_device_id(&moved, &test_device_id), NULL);
+    zassert_equal(address_count(), 0, NULL);
+}
+
+/**
+ * @brief Test that the protected entries, set before the first entry
+ * is added, are not evicted
+ */
+static void testAddressProtected(void)
+{
+    BACNET_ADDRESS src, test_address;
+    unsigned test_max_apdu = 0;
+    unsigned size, i;
+
+    address_cache_cleanup();
+    address_protected_entry_index_set(1);
+    set_address(1, &src);
+    address_add(1, 480, &src);
+    size = address_cache_size();
+    address_cache_memory_limit_set(address_cache_memory_size());
+    for (i = 2; i <= size; i++) {
+        set_address(i, &src);
+        address_add(i, 480, &src);
+    }
+    /* the first device is the least recent, but protected */
+    set_address(size + 1, &src);
+    address_add(size + 1, 480, &src);
+    zassert_true(address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    zassert_false(
+        address_get_by_device(2, &test_max_apdu, &test_address), NULL);
+    address_protected_entry_index_set(0);
+    address_cache_memory_limit_set((size_t)-1);
+    address_cache_cleanup();
+}
+
+/**
+ * @brief Test that the cache grows, and evicts the least recently used
+ * opportunistic entries at its limit
+ */
+static void testAddressGrowth(void)
+{
+    BACNET_ADDRESS src, test_address;
+    BACNET_READ_RANGE_DATA request = { 0 };
+    uint8_t apdu[480] = { 0 };
+    uint32_t test_device_id = 0;
+    unsigned test_max_apdu = 0;
+    unsigned size, i;
+    size_t memory;
+
+    address_cache_cleanup();
+    zassert_equal(address_cache_size(), 0, NULL);
+    zassert_equal(address_cache_memory_size(), 0, NULL);
+    set_address(1, &src);
+    address_add(1, 480, &src);
+    size = address_cache_size();
+    zassert_true(size > 1, NULL);
+    /* no more memory than the table holds now */
+    memory = address_cache_memory_size();
+    address_cache_memory_limit_set(memory);
+    /* two devices that we asked for, the rest picked up from I-Am */
+    for (i = 2; i <= 3; i++) {
+        set_address(i, &src);
+        zassert_false(address_bind_request(i, &test_max_apdu, &test_address),
+            NULL);
+        address_add_binding(i, 480, &src);
+    }
+    for (i = 4; i <= size; i++) {
+        set_address(i, &src);
+        address_add(i, 480, &src);
+    }
+    zassert_equal(address_count(), size, NULL);
+    /* the first device is used, so the fourth is the least recent */
+    zassert_true(address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    set_address(size + 1, &src);
+    address_add(size + 1, 480, &src);
+    zassert_equal(address_cache_size(), size, NULL);
+    zassert_equal(address_cache_memory_size(), memory, NULL);
+    zassert_equal(address_count(), size, NULL);
+    zassert_true(address_get_by_device(1, &test_max_apdu, &test_address), NULL);
+    zassert_true(address_get_by_device(2, &test_max_apdu, &test_address), NULL);
+    zassert_true(address_get_by_device(3, &test_max_apdu, &test_address), NULL);
+    zassert_false(
+        address_get_by_device(4, &test_max_apdu, &test_address), NULL);
+    zassert_true(address_get_device_id(&src, &test_device_id), NULL);
+    zassert_equal(test_device_id, size + 1, NULL);
+    /* without the limit, it grows as devices are added */
+    address_cache_memory_limit_set((size_t)-1);
+    for (i = 1; i <= ADDRESS_TEST_DEVICES; i++) {
+        set_address(i, &src);
+        address_add(i, 480, &src);
+    }
+    zassert_true(address_cache_size() >= ADDRESS_TEST_DEVICES, NULL);
+    zassert_equal(address_count(), ADDRESS_TEST_DEVICES, NULL);
+    zassert_true(address_cache_memory_size() > memory, NULL);
+    for (i = 1; i <= ADDRESS_TEST_DEVICES; i++) {
+        zassert_true(
+            address_get_by_device(i, &test_max_apdu, &test_address), NULL);
+    }
+    /* the list of bindings is read by position */
+    request.RequestType = RR_BY_POSITION;
+    request.Range.RefIndex = ADDRESS_TEST_DEVICES - 1;
+    request.Count = 3;
+    request.MaxAPDU = sizeof(apdu);
+    zassert_true(rr_address_list_encode(apdu, &request) > 0, NULL);
+    zassert_equal(request.ItemCount, 2, NULL);
+    zassert_true(
+        bitstring_bit(&request.ResultFlags, RESULT_FLAG_LAST_ITEM), NULL);
+    zassert_true(address_list_encode(apdu, sizeof(apdu)) > 0, NULL);
+    address_cache_cleanup();
+    zassert_equal(address_count(), 0, NULL);
+}
+
+static void testAddressSnapshot(void)
+{
+    const char *pFilename = "address_snapshot.bin";
+    BACNET_ADDRESS src, test_address;
+    uint32_t test_device_id = 0;
+    unsigned test_max_apdu = 0;
+    FILE *pFile = NULL;
+    unsigned i;
+
+    address_init();
+    for (i = 1; i <= 4; i++) {
+        set_address(i, &src);
+        address_add(i, 480 + i, &src);
+    }
+    address_set_device_TTL(2, 0, true);
+    /* a bind request is not saved */
+    zassert_false(address_bind_request(5, &test_max_apdu, &test_address),
+        NULL);
+    zassert_true(address_cache_snapshot_save(pFilename), NULL);
+    /* the temporary file was renamed */
+    pFile = fopen("address_snapshot.bin.tmp", "rb");
+    zassert_is_null(pFile, NULL);
+
+    address_init();
+    zassert_equal(address_count(), 0, NULL);
+    zassert_true(address_cache_snapshot_load(pFilename), NULL);
+    zassert_equal(address_count(), 4, NULL);
+    for (i = 1; i <= 4; i++) {
+        set_address(i, &src);
+        zassert_true(
+            address_get_by_device(i, &test_max_apdu, &test_address), NULL);
+        zassert_equal(test_max_apdu, 480 + i, NULL);
+        zassert_true(bacnet_address_same(&test_address, &src), NULL);
+        zassert_true(address_get_device_id(&src, &test_device_id), NULL);
+        zassert_equal(test_device_id, i, NULL);
+    }
+    zassert_false(address_get_by_device(5, &test_max_apdu, &test_address),
+        NULL);
+    /* the static binding does not expire */
+    for (i = 0; i < 25; i++) {
+        address_cache_timer(3600);
+    }
+    zassert_true(address_get_by_device(2, &test_max_apdu, &test_address),
+        NULL);
+    zassert_false(address_get_by_device(1, &test_max_apdu, &test_address),
+        NULL);
+
+    /* a damaged snapshot is not loaded */
+    pFile = fopen(pFilename, "r+b");
+    zassert_not_null(pFile, NULL);
+    fseek(pFile, -1L, SEEK_END);
+    fputc(0xA5, pFile);
+    fclose(pFile);
+    address_init();
+    zassert_false(address_cache_snapshot_load(pFilename), NULL);
+    zassert_equal(address_count(), 0, NULL);
+    remove(pFilename);
+    zassert_false(address_cache_snapshot_load(pFilename), NULL);
+}
+
+/**
+ * @brief Move the save time of a snapshot back into the past
+ * @param pFilename  Name of the snapshot file
+ * @param seconds  Number of seconds to move the save time back
+ */
+static void snapshot_save_time_back(const char *pFilename, uint32_t seconds)
+{
+    FILE *pFile = NULL;
+    uint32_t save_time = 0;
+    /* the save time follows the magic, version, size, count and checksum */
+    const long offset = 16;
+
+    pFile = fopen(pFilename, "r+b");
+    zassert_not_null(pFile, NULL);
+    zassert_equal(fseek(pFile, offset, SEEK_SET), 0, NULL);
+    zassert_equal(fread(&save_time, sizeof(save_time), 1, pFile), 1, NULL);
+    save_time -= seconds;
+    zassert_equal(fseek(pFile, offset, SEEK_SET), 0, NULL);
+    zassert_equal(fwrite(&save_time, sizeof(save_time), 1, pFile), 1, NULL);
+    fclose(pFile);
+}
+
+static void testAddressSnapshotAge(void)
+{
+    const char *pFilename = "address_snapshot_age.bin";
+    BACNET_ADDRESS src, test_address;
+    unsigned test_max_apdu = 0;
+    unsigned i;
+
+    address_init();
+    for (i = 1; i <= 4; i++) {
+        set_address(i, &src);
+        address_add(i, 480 + i, &src);
+    }
+    address_set_device_TTL(2, 0, true);
+    zassert_true(address_cache_snapshot_save(pFilename), NULL);
+    /* the expired bindings are not loaded */
+    snapshot_save_time_back(pFilename, 2UL * 24UL * 3600UL);
+    address_init();
+    zassert_true(address_cache_snapshot_load(pFilename), NULL);
+    zassert_equal(address_count(), 1, NULL);
+    zassert_true(address_get_by_device(2, &test_max_apdu, &test_address),
+        NULL);
+    /* the time while stopped counts against the TimeToLive */
+    for (i = 1; i <= 4; i++) {
+        set_address(i, &src);
+        address_add(i, 480 + i, &src);
+    }
+    zassert_true(address_cache_snapshot_save(pFilename), NULL);
+    /* the added bindings live for an hour, and half of it has passed */
+    snapshot_save_time_back(pFilename, 1800UL);
+    address_init();
+    zassert_true(address_cache_snapshot_load(pFilename), NULL);
+    zassert_equal(address_count(), 4, NULL);
+    address_cache_timer(1801);
+    zassert_equal(address_count(), 1, NULL);
+    zassert_true(address_get_by_device(2, &test_max_apdu, &test_address),
+        NULL);
+    remove(pFilename);
+}
 /**
  * @}
  */
@@ -187,13 +475,23 @@ void test_main(void)
 #ifdef BACNET_ADDRESS_CACHE_FILE
     ztest_test_suite(address_tests,
      ztest_unit_test(testAddressFile),
-     ztest_unit_test(testAddress)
+     ztest_unit_test(testAddress),
+     ztest_unit_test(testAddressIndex),
+     ztest_unit_test(testAddressGrowth),
+     ztest_unit_test(testAddressProtected),
+     ztest_unit_test(testAddressSnapshot),
+     ztest_unit_test(testAddressSnapshotAge)
      );
 
     ztest_run_test_suite(address_tests);
 #else
     ztest_test_suite(address_tests,
-     ztest_unit_test(testAddress)
+     ztest_unit_test(testAddress),
+     ztest_unit_test(testAddressIndex),
+     ztest_unit_test(testAddressGrowth),
+     ztest_unit_test(testAddressProtected),
+     ztest_unit_test(testAddressSnapshot),
+     ztest_unit_test(testAddressSnapshotAge)
      );
 
     ztest_run_test_suite(address_tests);
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2020 Legrand North America, LLC.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief test of the Who-Is scheduler of address bind requests
+ */
+
+#include <ztest.h>
+#include <bacnet/bacaddr.h>
+#include <bacnet/basic/binding/bind_schedule.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+#define TEST_WHOIS_MAX 64
+
+static struct test_whois {
+    bool global;
+    uint16_t net;
+    int32_t low_limit;
+    int32_t high_limit;
+} Test_WhoIs[TEST_WHOIS_MAX];
+static unsigned Test_WhoIs_Count;
+
+/**
+ * @brief Record the Who-Is requests that are sent
+ */
+static void test_send_whois(
+    BACNET_ADDRESS *target_address, int32_t low_limit, int32_t high_limit)
+{
+    struct test_whois *whois;
+
+    zassert_true(Test_WhoIs_Count < TEST_WHOIS_MAX, NULL);
+    whois = &Test_WhoIs[Test_WhoIs_Count++];
+    whois->global = (target_address == NULL);
+    whois->net = target_address ? target_address->net : 0;
+    whois->low_limit = low_limit;
+    whois->high_limit = high_limit;
+}
+
+/**
+ * @brief Test the merging of bind requests into Who-Is ranges
+ */
+static void testBindScheduleRanges(void)
+{
+    uint32_t device_id;
+
+    bind_schedule_init(NULL);
+    zassert_false(bind_schedule_device(1, NULL), NULL);
+    bind_schedule_init(test_send_whois);
+    Test_WhoIs_Count = 0;
+    zassert_false(bind_schedule_device(BACNET_MAX_INSTANCE, NULL), NULL);
+    for (device_id = 199; device_id >= 100; device_id--) {
+        zassert_true(bind_schedule_device(device_id, NULL), NULL);
+    }
+    zassert_true(bind_schedule_device(1000, NULL), NULL);
+    zassert_true(bind_schedule_device(1040, NULL), NULL);
+    /* within the gap of a range */
+    zassert_true(bind_schedule_device(5000, NULL), NULL);
+    zassert_true(bind_schedule_device(5020, NULL), NULL);
+    zassert_true(bind_schedule_device(150, NULL), NULL);
+    zassert_equal(bind_schedule_pending(), 4, NULL);
+    /* gathered for a window before the first Who-Is */
+    bind_schedule_timer(100);
+    zassert_equal(Test_WhoIs_Count, 0, NULL);
+    bind_schedule_timer(400);
+    zassert_equal(Test_WhoIs_Count, 4, NULL);
+    zassert_equal(bind_schedule_pending(), 0, NULL);
+    zassert_true(Test_WhoIs[0].global, NULL);
+    zassert_equal(Test_WhoIs[0].low_limit, 100, NULL);
+    zassert_equal(Test_WhoIs[0].high_limit, 199, NULL);
+    zassert_equal(Test_WhoIs[1].low_limit, 1000, NULL);
+    zassert_equal(Test_WhoIs[1].high_limit, 1000, NULL);
+    zassert_equal(Test_WhoIs[2].low_limit, 1040, NULL);
+    zassert_equal(Test_WhoIs[2].high_limit, 1040, NULL);
+    zassert_equal(Test_WhoIs[3].low_limit, 5000, NULL);
+    zassert_equal(Test_WhoIs[3].high_limit, 5020, NULL);
+
+    /* a request that bridges two ranges joins them */
+    bind_schedule_init(test_send_whois);
+    Test_WhoIs_Count = 0;
+    zassert_true(bind_schedule_device(100, NULL), NULL);
+    zassert_true(bind_schedule_device(160, NULL), NULL);
+    zassert_equal(bind_schedule_pending(), 2, NULL);
+    zassert_true(bind_schedule_device(130, NULL), NULL);
+    zassert_equal(bind_schedule_pending(), 1, NULL);
+    bind_schedule_timer(500);
+    zassert_equal(Test_WhoIs_Count, 1, NULL);
+    zassert_equal(Test_WhoIs[0].low_limit, 100, NULL);
+    zassert_equal(Test_WhoIs[0].high_limit, 160, NULL);
+
+    /* when the ranges are full, the closest two are merged */
+    bind_schedule_init(test_send_whois);
+    for (device_id = 0; device_id < 31; device_id++) {
+        zassert_true(bind_schedule_device(device_id * 1000, NULL), NULL);
+    }
+    zassert_true(bind_schedule_device(4100, NULL), NULL);
+    zassert_equal(bind_schedule_pending(), 32, NULL);
+    zassert_true(bind_schedule_device(10500, NULL), NULL);
+    zassert_equal(bind_schedule_pending(), 32, NULL);
+    Test_WhoIs_Count = 0;
+    bind_schedule_timer(500);
+    zassert_equal(Test_WhoIs_Count, 4, NULL);
+    zassert_equal(Test_WhoIs[3].low_limit, 3000, NULL);
+    zassert_equal(Test_WhoIs[3].high_limit, 3000, NULL);
+    bind_schedule_timer(250);
+    zassert_equal(Test_WhoIs_Count, 5, NULL);
+    zassert_equal(Test_WhoIs[4].low_limit, 4000, NULL);
+    zassert_equal(Test_WhoIs[4].high_limit, 4100, NULL);
+}
+
+/**
+ * @brief Test the rate of Who-Is requests per network
+ */
+static void testBindScheduleRate(void)
+{
+    BACNET_ADDRESS target = { 0 };
+    uint32_t device_id;
+    unsigned i;
+
+    bind_schedule_init(test_send_whois);
+    Test_WhoIs_Count = 0;
+    target.net = 5;
+    target.mac_len = 1;
+    target.mac[0] = 1;
+    for (device_id = 1; device_id <= 6; device_id++) {
+        zassert_true(bind_schedule_device(device_id * 1000, NULL), NULL);
+        zassert_true(bind_schedule_device(device_id * 1000, &target), NULL);
+    }
+    zassert_equal(bind_schedule_pending(), 12, NULL);
+    /* a burst for each network */
+    bind_schedule_timer(500);
+    zassert_equal(Test_WhoIs_Count, 8, NULL);
+    zassert_equal(bind_schedule_pending(), 4, NULL);
+    for (i = 0; i < Test_WhoIs_Count; i++) {
+        zassert_equal(Test_WhoIs[i].low_limit, Test_WhoIs[i].high_limit, NULL);
+        if (Test_WhoIs[i].global) {
+            zassert_equal(Test_WhoIs[i].net, 0, NULL);
+        } else {
+            zassert_equal(Test_WhoIs[i].net, 5, NULL);
+        }
+    }
+    /* then one more per interval */
+    bind_schedule_timer(100);
+    zassert_equal(Test_WhoIs_Count, 8, NULL);
+    bind_schedule_timer(150);
+    zassert_equal(Test_WhoIs_Count, 10, NULL);
+    zassert_equal(Test_WhoIs[8].low_limit, 5000, NULL);
+    zassert_equal(Test_WhoIs[9].low_limit, 5000, NULL);
+    bind_schedule_timer(250);
+    zassert_equal(Test_WhoIs_Count, 12, NULL);
+    zassert_equal(bind_schedule_pending(), 0, NULL);
+    /* a new request while the rate is still limited */
+    zassert_true(bind_schedule_device(9000, &target), NULL);
+    bind_schedule_timer(500);
+    zassert_equal(Test_WhoIs_Count, 13, NULL);
+    zassert_false(Test_WhoIs[12].global, NULL);
+    zassert_equal(Test_WhoIs[12].low_limit, 9000, NULL);
+}
+/**
+ * @}
+ */
+
+void test_main(void)
+{
+    ztest_test_suite(bind_schedule_tests,
+     ztest_unit_test(testBindScheduleRanges),
+     ztest_unit_test(testBindScheduleRate)
+     );
+
+    ztest_run_test_suite(bind_schedule_tests);
+}
@@ -46,6 +46,48 @@ static void testAnalogInput(void)
 
     return;
 }
+
+/**
+ * @brief Test sparse object instances created at runtime
+ */
+static void testAnalogInputCreateDelete(void)
+{
+    const uint32_t instance = 100000;
+    unsigned count = 0;
+    unsigned index = 0;
+
+    Analog_Input_Init();
+    count = Analog_Input_Count();
+    zassert_false(Analog_Input_Valid_Instance(instance), NULL);
+    zassert_true(Analog_Input_Create(instance), NULL);
+    zassert_true(Analog_Input_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Input_Count(), count + 1, NULL);
+    /* creating an existing object is not an error */
+    zassert_true(Analog_Input_Create(instance), NULL);
+    zassert_equal(Analog_Input_Count(), count + 1, NULL);
+    zassert_false(Analog_Input_Create(BACNET_MAX_INSTANCE), NULL);
+    /* the objects are created only once */
+    Analog_Input_Init();
+    zassert_true(Analog_Input_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Input_Count(), count + 1, NULL);
+    index = Analog_Input_Instance_To_Index(instance);
+    zassert_true(index < Analog_Input_Count(), NULL);
+    zassert_equal(Analog_Input_Index_To_Instance(index), instance, NULL);
+    Analog_Input_Present_Value_Set(instance, 42.0f);
+    zassert_equal(Analog_Input_Present_Value(instance), 42.0f, NULL);
+    zassert_true(Analog_Input_Delete(instance), NULL);
+    zassert_false(Analog_Input_Delete(instance), NULL);
+    zassert_false(Analog_Input_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Input_Count(), count, NULL);
+    zassert_equal(Analog_Input_Instance_To_Index(instance), count, NULL);
+    Analog_Input_Cleanup();
+    zassert_equal(Analog_Input_Count(), 0, NULL);
+    /* the default objects are created again after a cleanup */
+    Analog_Input_Init();
+    zassert_equal(Analog_Input_Count(), count, NULL);
+
+    return;
+}
 /**
  * @}
  */
@@ -54,7 +96,8 @@ static void testAnalogInput(void)
 void test_main(void)
 {
     ztest_test_suite(ai_tests,
-     ztest_unit_test(testAnalogInput)
+     ztest_unit_test(testAnalogInput),
+     ztest_unit_test(testAnalogInputCreateDelete)
      );
 
     ztest_run_test_suite(ai_tests);
@@ -46,6 +46,48 @@ static void testAnalogOutput(void)
 
     return;
 }
+
+/**
+ * @brief Test sparse object instances created at runtime
+ */
+static void testAnalogOutputCreateDelete(void)
+{
+    const uint32_t instance = 100000;
+    unsigned count = 0;
+    unsigned index = 0;
+
+    Analog_Output_Init();
+    count = Analog_Output_Count();
+    zassert_false(Analog_Output_Valid_Instance(instance), NULL);
+    zassert_true(Analog_Output_Create(instance), NULL);
+    zassert_true(Analog_Output_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Output_Count(), count + 1, NULL);
+    /* creating an existing object is not an error */
+    zassert_true(Analog_Output_Create(instance), NULL);
+    zassert_equal(Analog_Output_Count(), count + 1, NULL);
+    zassert_false(Analog_Output_Create(BACNET_MAX_INSTANCE), NULL);
+    /* the objects are created only once */
+    Analog_Output_Init();
+    zassert_true(Analog_Output_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Output_Count(), count + 1, NULL);
+    index = Analog_Output_Instance_To_Index(instance);
+    zassert_true(index < Analog_Output_Count(), NULL);
+    zassert_equal(Analog_Output_Index_To_Instance(index), instance, NULL);
+    zassert_true(Analog_Output_Present_Value_Set(instance, 42.0f, 1), NULL);
+    zassert_equal(Analog_Output_Present_Value(instance), 42.0f, NULL);
+    zassert_true(Analog_Output_Delete(instance), NULL);
+    zassert_false(Analog_Output_Delete(instance), NULL);
+    zassert_false(Analog_Output_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Output_Count(), count, NULL);
+    zassert_equal(Analog_Output_Instance_To_Index(instance), count, NULL);
+    Analog_Output_Cleanup();
+    zassert_equal(Analog_Output_Count(), 0, NULL);
+    /* the default objects are created again after a cleanup */
+    Analog_Output_Init();
+    zassert_equal(Analog_Output_Count(), count, NULL);
+
+    return;
+}
 /**
  * @}
  */
@@ -54,7 +96,8 @@ static void testAnalogOutput(void)
 void test_main(void)
 {
     ztest_test_suite(ao_tests,
-     ztest_unit_test(testAnalogOutput)
+     ztest_unit_test(testAnalogOutput),
+     ztest_unit_test(testAnalogOutputCreateDelete)
      );
 
     ztest_run_test_suite(ao_tests);
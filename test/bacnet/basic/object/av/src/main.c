@@ -46,6 +46,48 @@ static void testAnalog_Value(void)
 
     return;
 }
+
+/**
+ * @brief Test sparse object instances created at runtime
+ */
+static void testAnalogValueCreateDelete(void)
+{
+    const uint32_t instance = 100000;
+    unsigned count = 0;
+    unsigned index = 0;
+
+    Analog_Value_Init();
+    count = Analog_Value_Count();
+    zassert_false(Analog_Value_Valid_Instance(instance), NULL);
+    zassert_true(Analog_Value_Create(instance), NULL);
+    zassert_true(Analog_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Value_Count(), count + 1, NULL);
+    /* creating an existing object is not an error */
+    zassert_true(Analog_Value_Create(instance), NULL);
+    zassert_equal(Analog_Value_Count(), count + 1, NULL);
+    zassert_false(Analog_Value_Create(BACNET_MAX_INSTANCE), NULL);
+    /* the objects are created only once */
+    Analog_Value_Init();
+    zassert_true(Analog_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Value_Count(), count + 1, NULL);
+    index = Analog_Value_Instance_To_Index(instance);
+    zassert_true(index < Analog_Value_Count(), NULL);
+    zassert_equal(Analog_Value_Index_To_Instance(index), instance, NULL);
+    zassert_true(Analog_Value_Present_Value_Set(instance, 42.0f, 1), NULL);
+    zassert_equal(Analog_Value_Present_Value(instance), 42.0f, NULL);
+    zassert_true(Analog_Value_Delete(instance), NULL);
+    zassert_false(Analog_Value_Delete(instance), NULL);
+    zassert_false(Analog_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Analog_Value_Count(), count, NULL);
+    zassert_equal(Analog_Value_Instance_To_Index(instance), count, NULL);
+    Analog_Value_Cleanup();
+    zassert_equal(Analog_Value_Count(), 0, NULL);
+    /* the default objects are created again after a cleanup */
+    Analog_Value_Init();
+    zassert_equal(Analog_Value_Count(), count, NULL);
+
+    return;
+}
 /**
  * @}
  */
@@ -54,7 +96,8 @@ static void testAnalog_Value(void)
 void test_main(void)
 {
     ztest_test_suite(av_tests,
-     ztest_unit_test(testAnalog_Value)
+     ztest_unit_test(testAnalog_Value),
+     ztest_unit_test(testAnalogValueCreateDelete)
      );
 
     ztest_run_test_suite(av_tests);
@@ -46,6 +46,49 @@ static void testBinaryInput(void)
 
     return;
 }
+
+/**
+ * @brief Test sparse object instances created at runtime
+ */
+static void testBinaryInputCreateDelete(void)
+{
+    const uint32_t instance = 100000;
+    unsigned count = 0;
+    unsigned index = 0;
+
+    Binary_Input_Init();
+    count = Binary_Input_Count();
+    zassert_false(Binary_Input_Valid_Instance(instance), NULL);
+    zassert_true(Binary_Input_Create(instance), NULL);
+    zassert_true(Binary_Input_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Input_Count(), count + 1, NULL);
+    /* creating an existing object is not an error */
+    zassert_true(Binary_Input_Create(instance), NULL);
+    zassert_equal(Binary_Input_Count(), count + 1, NULL);
+    zassert_false(Binary_Input_Create(BACNET_MAX_INSTANCE), NULL);
+    /* the objects are created only once */
+    Binary_Input_Init();
+    zassert_true(Binary_Input_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Input_Count(), count + 1, NULL);
+    index = Binary_Input_Instance_To_Index(instance);
+    zassert_true(index < Binary_Input_Count(), NULL);
+    zassert_equal(Binary_Input_Index_To_Instance(index), instance, NULL);
+    zassert_true(
+        Binary_Input_Present_Value_Set(instance, BINARY_ACTIVE), NULL);
+    zassert_equal(Binary_Input_Present_Value(instance), BINARY_ACTIVE, NULL);
+    zassert_true(Binary_Input_Delete(instance), NULL);
+    zassert_false(Binary_Input_Delete(instance), NULL);
+    zassert_false(Binary_Input_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Input_Count(), count, NULL);
+    zassert_equal(Binary_Input_Instance_To_Index(instance), count, NULL);
+    Binary_Input_Cleanup();
+    zassert_equal(Binary_Input_Count(), 0, NULL);
+    /* the default objects are created again after a cleanup */
+    Binary_Input_Init();
+    zassert_equal(Binary_Input_Count(), count, NULL);
+
+    return;
+}
 /**
  * @}
  */
@@ -54,7 +97,8 @@ static void testBinaryInput(void)
 void test_main(void)
 {
     ztest_test_suite(bi_tests,
-     ztest_unit_test(testBinaryInput)
+     ztest_unit_test(testBinaryInput),
+     ztest_unit_test(testBinaryInputCreateDelete)
      );
 
     ztest_run_test_suite(bi_tests);
@@ -46,6 +46,50 @@ static void testBinaryOutput(void)
 
     return;
 }
+
+/**
+ * @brief Test sparse object instances created at runtime
+ */
+static void testBinaryOutputCreateDelete(void)
+{
+    const uint32_t instance = 100000;
+    unsigned count = 0;
+    unsigned index = 0;
+
+    Binary_Output_Init();
+    count = Binary_Output_Count();
+    zassert_false(Binary_Output_Valid_Instance(instance), NULL);
+    zassert_true(Binary_Output_Create(instance), NULL);
+    zassert_true(Binary_Output_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Output_Count(), count + 1, NULL);
+    /* creating an existing object is not an error */
+    zassert_true(Binary_Output_Create(instance), NULL);
+    zassert_equal(Binary_Output_Count(), count + 1, NULL);
+    zassert_false(Binary_Output_Create(BACNET_MAX_INSTANCE), NULL);
+    /* the objects are created only once */
+    Binary_Output_Init();
+    zassert_true(Binary_Output_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Output_Count(), count + 1, NULL);
+    index = Binary_Output_Instance_To_Index(instance);
+    zassert_true(index < Binary_Output_Count(), NULL);
+    zassert_equal(Binary_Output_Index_To_Instance(index), instance, NULL);
+    /* a new object starts out at the relinquish default */
+    zassert_equal(
+        Binary_Output_Present_Value(instance), BINARY_INACTIVE, NULL);
+    zassert_false(Binary_Output_Out_Of_Service(instance), NULL);
+    zassert_true(Binary_Output_Delete(instance), NULL);
+    zassert_false(Binary_Output_Delete(instance), NULL);
+    zassert_false(Binary_Output_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Output_Count(), count, NULL);
+    zassert_equal(Binary_Output_Instance_To_Index(instance), count, NULL);
+    Binary_Output_Cleanup();
+    zassert_equal(Binary_Output_Count(), 0, NULL);
+    /* the default objects are created again after a cleanup */
+    Binary_Output_Init();
+    zassert_equal(Binary_Output_Count(), count, NULL);
+
+    return;
+}
 /**
  * @}
  */
@@ -54,7 +98,8 @@ static void testBinaryOutput(void)
 void test_main(void)
 {
     ztest_test_suite(bo_tests,
-     ztest_unit_test(testBinaryOutput)
+     ztest_unit_test(testBinaryOutput),
+     ztest_unit_test(testBinaryOutputCreateDelete)
      );
 
     ztest_run_test_suite(bo_tests);
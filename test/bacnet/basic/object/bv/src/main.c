@@ -46,6 +46,48 @@ static void testBinary_Value(void)
 
     return;
 }
+
+/**
+ * @brief Test sparse object instances created at runtime
+ */
+static void testBinaryValueCreateDelete(void)
+{
+    const uint32_t instance = 100000;
+    unsigned count = 0;
+    unsigned index = 0;
+
+    Binary_Value_Init();
+    count = Binary_Value_Count();
+    zassert_false(Binary_Value_Valid_Instance(instance), NULL);
+    zassert_true(Binary_Value_Create(instance), NULL);
+    zassert_true(Binary_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Value_Count(), count + 1, NULL);
+    /* creating an existing object is not an error */
+    zassert_true(Binary_Value_Create(instance), NULL);
+    zassert_equal(Binary_Value_Count(), count + 1, NULL);
+    zassert_false(Binary_Value_Create(BACNET_MAX_INSTANCE), NULL);
+    /* the objects are created only once */
+    Binary_Value_Init();
+    zassert_true(Binary_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Value_Count(), count + 1, NULL);
+    index = Binary_Value_Instance_To_Index(instance);
+    zassert_true(index < Binary_Value_Count(), NULL);
+    zassert_equal(Binary_Value_Index_To_Instance(index), instance, NULL);
+    Binary_Value_Out_Of_Service_Set(instance, true);
+    zassert_true(Binary_Value_Out_Of_Service(instance), NULL);
+    zassert_true(Binary_Value_Delete(instance), NULL);
+    zassert_false(Binary_Value_Delete(instance), NULL);
+    zassert_false(Binary_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Binary_Value_Count(), count, NULL);
+    zassert_equal(Binary_Value_Instance_To_Index(instance), count, NULL);
+    Binary_Value_Cleanup();
+    zassert_equal(Binary_Value_Count(), 0, NULL);
+    /* the default objects are created again after a cleanup */
+    Binary_Value_Init();
+    zassert_equal(Binary_Value_Count(), count, NULL);
+
+    return;
+}
 /**
  * @}
  */
@@ -54,7 +96,8 @@ static void testBinary_Value(void)
 void test_main(void)
 {
     ztest_test_suite(bv_tests,
-     ztest_unit_test(testBinary_Value)
+     ztest_unit_test(testBinary_Value),
+     ztest_unit_test(testBinaryValueCreateDelete)
      );
 
     ztest_run_test_suite(bv_tests);
@@ -41,3 +41,11 @@ bool WPValidateArgType(BACNET_APPLICATION_DATA_VALUE *pValue,
 
     return false;
 }
+
+void Device_Inc_Database_Revision(void)
+{
+}
+
+void Device_Object_List_Changed(void)
+{
+}
@@ -10,6 +10,8 @@
 
 #include <ztest.h>
 #include <bacnet/basic/object/device.h>
+#include <bacnet/basic/object/msv.h>
+#include <bacnet/basic/object/netport.h>
 
 /**
  * @addtogroup bacnet_tests
@@ -49,6 +51,235 @@ static void testDevice(void)
 
     return;
 }
+
+/**
+ * @brief Test the lookup of the object types in the object table
+ */
+static void testDeviceObjectTable(void)
+{
+    uint32_t instance;
+
+    Device_Init(NULL);
+    instance = Device_Object_Instance_Number();
+    zassert_true(Device_Valid_Object_Id(OBJECT_DEVICE, instance), NULL);
+    zassert_false(Device_Valid_Object_Id(OBJECT_DEVICE, instance + 1), NULL);
+    zassert_true(Device_Valid_Object_Id(OBJECT_ANALOG_INPUT, 0), NULL);
+    zassert_false(Device_Valid_Object_Id(OBJECT_PROPRIETARY_MIN, 0), NULL);
+    zassert_false(
+        Device_Valid_Object_Id(MAX_BACNET_OBJECT_TYPE - 1, 0), NULL);
+    zassert_false(Device_Valid_Object_Id(MAX_BACNET_OBJECT_TYPE, 0), NULL);
+}
+
+/**
+ * @brief Test the Object_List array access
+ */
+static void testDeviceObjectList(void)
+{
+    unsigned count;
+    unsigned i;
+    bool status;
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t instance;
+    uint32_t revision;
+
+    Device_Init(NULL);
+    count = Device_Object_List_Count();
+    zassert_true(count > 0, NULL);
+    status = Device_Object_List_Identifier(0, &object_type, &instance);
+    zassert_false(status, NULL);
+    status = Device_Object_List_Identifier(count + 1, &object_type, &instance);
+    zassert_false(status, NULL);
+    status = Device_Object_List_Identifier(1, &object_type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(object_type, OBJECT_DEVICE, NULL);
+    zassert_equal(instance, Device_Object_Instance_Number(), NULL);
+    for (i = 1; i <= count; i++) {
+        status = Device_Object_List_Identifier(i, &object_type, &instance);
+        zassert_true(status, NULL);
+        zassert_true(Device_Valid_Object_Id(object_type, instance), NULL);
+    }
+    /* a new revision is seen in the list */
+    revision = Device_Database_Revision();
+    status = Device_Set_Object_Instance_Number(instance + 1);
+    zassert_true(status, NULL);
+    zassert_not_equal(Device_Database_Revision(), revision, NULL);
+    status = Device_Object_List_Identifier(1, &object_type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(instance, Device_Object_Instance_Number(), NULL);
+}
+
+/**
+ * @brief Test the lookup of objects by name
+ */
+static void testDeviceObjectName(void)
+{
+    bool status;
+    BACNET_CHARACTER_STRING object_name;
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t instance;
+    uint32_t msv_instance;
+    uint32_t revision;
+
+    Device_Init(NULL);
+    status = Device_Object_Name_Copy(OBJECT_ANALOG_INPUT, 0, &object_name);
+    zassert_true(status, NULL);
+    status = Device_Valid_Object_Name(&object_name, &object_type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(object_type, OBJECT_ANALOG_INPUT, NULL);
+    zassert_equal(instance, 0, NULL);
+    status = Device_Object_Name_Copy(
+        OBJECT_DEVICE, Device_Object_Instance_Number(), &object_name);
+    zassert_true(status, NULL);
+    status = Device_Valid_Object_Name(&object_name, &object_type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(object_type, OBJECT_DEVICE, NULL);
+    zassert_equal(instance, Device_Object_Instance_Number(), NULL);
+    characterstring_init_ansi(&object_name, "Nobody Home");
+    status = Device_Valid_Object_Name(&object_name, NULL, NULL);
+    zassert_false(status, NULL);
+    /* a renamed object is found by its new name */
+    msv_instance = Multistate_Value_Index_To_Instance(0);
+    status = Multistate_Value_Name_Set(msv_instance, "Nobody Home");
+    zassert_true(status, NULL);
+    status = Device_Valid_Object_Name(&object_name, &object_type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(object_type, OBJECT_MULTI_STATE_VALUE, NULL);
+    zassert_equal(instance, msv_instance, NULL);
+    /* a rename is found even if the Database_Revision did not change */
+    revision = Device_Database_Revision();
+    status = Multistate_Value_Name_Set(msv_instance, "Somebody Home");
+    zassert_true(status, NULL);
+    Device_Set_Database_Revision(revision);
+    characterstring_init_ansi(&object_name, "Somebody Home");
+    status = Device_Valid_Object_Name(&object_name, &object_type, &instance);
+    zassert_true(status, NULL);
+    zassert_equal(instance, msv_instance, NULL);
+    characterstring_init_ansi(&object_name, "Nobody Home");
+    status = Device_Valid_Object_Name(&object_name, NULL, NULL);
+    zassert_false(status, NULL);
+}
+
+/**
+ * @brief Test that a delete and a create are seen in the Object_List
+ */
+static void testDeviceObjectListChanged(void)
+{
+    bool status;
+    unsigned count;
+    unsigned index;
+    uint32_t revision;
+    uint32_t msv_instance;
+    uint32_t port_instance;
+    uint32_t instance;
+    BACNET_OBJECT_TYPE object_type;
+
+    Device_Init(NULL);
+    count = Device_Object_List_Count();
+    msv_instance = Multistate_Value_Index_To_Instance(0);
+    revision = Device_Database_Revision();
+    /* fill the Object_List cache */
+    status = Device_Object_List_Identifier(1, &object_type, &instance);
+    zassert_true(status, NULL);
+    status = Multistate_Value_Delete(msv_instance);
+    zassert_true(status, NULL);
+    status = Multistate_Value_Create(BACNET_MAX_INSTANCE - 1);
+    zassert_true(status, NULL);
+    /* same count and same revision, yet the cache is not stale */
+    Device_Set_Database_Revision(revision);
+    zassert_equal(Device_Object_List_Count(), count, NULL);
+    status = false;
+    for (index = 1; index <= count; index++) {
+        zassert_true(Device_Object_List_Identifier(
+            index, &object_type, &instance), NULL);
+        if (object_type == OBJECT_MULTI_STATE_VALUE) {
+            zassert_not_equal(instance, msv_instance, NULL);
+            if (instance == (BACNET_MAX_INSTANCE - 1)) {
+                status = true;
+            }
+        }
+    }
+    zassert_true(status, NULL);
+    (void)Multistate_Value_Delete(BACNET_MAX_INSTANCE - 1);
+    (void)Multistate_Value_Create(msv_instance);
+    /* a renumbered object shows up with its new instance */
+    port_instance = Network_Port_Index_To_Instance(0);
+    status = Device_Object_List_Identifier(1, &object_type, &instance);
+    zassert_true(status, NULL);
+    status = Network_Port_Object_Instance_Number_Set(
+        0, BACNET_MAX_INSTANCE - 2);
+    zassert_true(status, NULL);
+    status = false;
+    for (index = 1; index <= Device_Object_List_Count(); index++) {
+        zassert_true(Device_Object_List_Identifier(
+            index, &object_type, &instance), NULL);
+        if (object_type == OBJECT_NETWORK_PORT) {
+            zassert_not_equal(instance, port_instance, NULL);
+            if (instance == (BACNET_MAX_INSTANCE - 2)) {
+                status = true;
+            }
+        }
+    }
+    zassert_true(status, NULL);
+    (void)Network_Port_Object_Instance_Number_Set(0, port_instance);
+}
+
+static unsigned Lock_Count;
+static unsigned Unlock_Count;
+
+static void testLock(void)
+{
+    Lock_Count++;
+}
+
+static void testUnlock(void)
+{
+    Unlock_Count++;
+}
+
+/**
+ * @brief Test that the properties are read and written with the lock held
+ */
+static void testDeviceLock(void)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    BACNET_READ_PROPERTY_DATA rpdata = { 0 };
+    BACNET_WRITE_PROPERTY_DATA wpdata = { 0 };
+    BACNET_CHARACTER_STRING location;
+    int len;
+
+    Device_Init(NULL);
+    Device_Set_Lock_Functions(testLock, testUnlock);
+    rpdata.application_data = apdu;
+    rpdata.application_data_len = sizeof(apdu);
+    rpdata.object_type = OBJECT_DEVICE;
+    rpdata.object_instance = Device_Object_Instance_Number();
+    rpdata.object_property = PROP_OBJECT_NAME;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    len = Device_Read_Property(&rpdata);
+    zassert_true(len > 0, NULL);
+    zassert_equal(Lock_Count, 1, NULL);
+    zassert_equal(Unlock_Count, 1, NULL);
+    /* the lock is released when the object is unknown */
+    rpdata.object_type = OBJECT_ANALOG_INPUT;
+    rpdata.object_instance = BACNET_MAX_INSTANCE;
+    len = Device_Read_Property(&rpdata);
+    zassert_true(len < 0, NULL);
+    zassert_equal(Lock_Count, 2, NULL);
+    zassert_equal(Unlock_Count, 2, NULL);
+    wpdata.object_type = OBJECT_DEVICE;
+    wpdata.object_instance = Device_Object_Instance_Number();
+    wpdata.object_property = PROP_LOCATION;
+    wpdata.array_index = BACNET_ARRAY_ALL;
+    characterstring_init_ansi(&location, "Basement");
+    wpdata.application_data_len = encode_application_character_string(
+        wpdata.application_data, &location);
+    (void)Device_Write_Property(&wpdata);
+    zassert_equal(Lock_Count, 3, NULL);
+    zassert_equal(Unlock_Count, 3, NULL);
+    Device_Set_Lock_Functions(NULL, NULL);
+    len = Device_Read_Property(&rpdata);
+    zassert_equal(Lock_Count, 3, NULL);
+}
 /**
  * @}
  */
@@ -57,7 +288,12 @@ static void testDevice(void)
 void test_main(void)
 {
     ztest_test_suite(device_tests,
-     ztest_unit_test(testDevice)
+     ztest_unit_test(testDevice),
+     ztest_unit_test(testDeviceObjectTable),
+     ztest_unit_test(testDeviceObjectList),
+     ztest_unit_test(testDeviceObjectName),
+     ztest_unit_test(testDeviceObjectListChanged),
+     ztest_unit_test(testDeviceLock)
      );
 
     ztest_run_test_suite(device_tests);
@@ -57,3 +57,11 @@ bool datetime_local(
 {
     return true;
 }
+
+void Device_Inc_Database_Revision(void)
+{
+}
+
+void Device_Object_List_Changed(void)
+{
+}
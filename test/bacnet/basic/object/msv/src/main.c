@@ -46,6 +46,48 @@ static void testMultistateInput(void)
 
     return;
 }
+
+/**
+ * @brief Test sparse object instances created at runtime
+ */
+static void testMultistateValueCreateDelete(void)
+{
+    const uint32_t instance = 100000;
+    unsigned count = 0;
+    unsigned index = 0;
+
+    Multistate_Value_Init();
+    count = Multistate_Value_Count();
+    zassert_false(Multistate_Value_Valid_Instance(instance), NULL);
+    zassert_true(Multistate_Value_Create(instance), NULL);
+    zassert_true(Multistate_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Multistate_Value_Count(), count + 1, NULL);
+    /* creating an existing object is not an error */
+    zassert_true(Multistate_Value_Create(instance), NULL);
+    zassert_equal(Multistate_Value_Count(), count + 1, NULL);
+    zassert_false(Multistate_Value_Create(BACNET_MAX_INSTANCE), NULL);
+    /* the objects are created only once */
+    Multistate_Value_Init();
+    zassert_true(Multistate_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Multistate_Value_Count(), count + 1, NULL);
+    index = Multistate_Value_Instance_To_Index(instance);
+    zassert_true(index < Multistate_Value_Count(), NULL);
+    zassert_equal(Multistate_Value_Index_To_Instance(index), instance, NULL);
+    zassert_true(Multistate_Value_Present_Value_Set(instance, 2), NULL);
+    zassert_equal(Multistate_Value_Present_Value(instance), 2, NULL);
+    zassert_true(Multistate_Value_Delete(instance), NULL);
+    zassert_false(Multistate_Value_Delete(instance), NULL);
+    zassert_false(Multistate_Value_Valid_Instance(instance), NULL);
+    zassert_equal(Multistate_Value_Count(), count, NULL);
+    zassert_equal(Multistate_Value_Instance_To_Index(instance), count, NULL);
+    Multistate_Value_Cleanup();
+    zassert_equal(Multistate_Value_Count(), 0, NULL);
+    /* the default objects are created again after a cleanup */
+    Multistate_Value_Init();
+    zassert_equal(Multistate_Value_Count(), count, NULL);
+
+    return;
+}
 /**
  * @}
  */
@@ -54,7 +96,8 @@ static void testMultistateInput(void)
 void test_main(void)
 {
     ztest_test_suite(msv_tests,
-     ztest_unit_test(testMultistateInput)
+     ztest_unit_test(testMultistateInput),
+     ztest_unit_test(testMultistateValueCreateDelete)
      );
 
     ztest_run_test_suite(msv_tests);
@@ -41,3 +41,22 @@ bool WPValidateArgType(BACNET_APPLICATION_DATA_VALUE *pValue,
 
     return false;
 }
+
+void handler_cov_object_changed(
+    BACNET_OBJECT_TYPE object_type, uint32_t object_instance)
+{
+    (void)object_type;
+    (void)object_instance;
+}
+
+void Device_Inc_Database_Revision(void)
+{
+}
+
+void Device_Object_List_Changed(void)
+{
+}
+
+void Device_Object_Name_Changed(void)
+{
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Legrand North America, LLC.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief test the cache of the messages seen recently
+ */
+
+#include <ztest.h>
+#include <bacnet/basic/sys/dupcache.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+/**
+ * @brief Unit Test for the repeats of a message within its lifetime
+ */
+static void testDuplicateLifetime(void)
+{
+    DUPCACHE cache;
+    DUPCACHE_ENTRY entries[16];
+
+    dupcache_init(&cache, entries, 16, 1000);
+    zassert_false(dupcache_seen(&cache, 0x12345678, 0), NULL);
+    zassert_true(dupcache_seen(&cache, 0x12345678, 10), NULL);
+    zassert_false(dupcache_seen(&cache, 0x12345679, 10), NULL);
+    /* a repeat does not renew the time of the message */
+    zassert_true(dupcache_seen(&cache, 0x12345678, 999), NULL);
+    zassert_false(dupcache_seen(&cache, 0x12345678, 1000), NULL);
+    zassert_true(dupcache_seen(&cache, 0x12345678, 1001), NULL);
+    zassert_equal(dupcache_hits(&cache), 3, NULL);
+    zassert_equal(dupcache_misses(&cache), 3, NULL);
+    /* the time may wrap around */
+    zassert_false(dupcache_seen(&cache, 0x10, (unsigned long)-10), NULL);
+    zassert_true(dupcache_seen(&cache, 0x10, 10), NULL);
+    dupcache_clear(&cache);
+    zassert_equal(dupcache_hits(&cache), 0, NULL);
+    zassert_equal(dupcache_misses(&cache), 0, NULL);
+    zassert_false(dupcache_seen(&cache, 0x10, 10), NULL);
+}
+
+/**
+ * @brief Unit Test for two messages that take the same place
+ */
+static void testDuplicateReplace(void)
+{
+    DUPCACHE cache;
+    DUPCACHE_ENTRY entries[16];
+
+    dupcache_init(&cache, entries, 16, 1000);
+    zassert_false(dupcache_seen(&cache, 0x01, 0), NULL);
+    zassert_false(dupcache_seen(&cache, 0x11, 0), NULL);
+    /* the first one was forgotten */
+    zassert_false(dupcache_seen(&cache, 0x01, 0), NULL);
+    zassert_true(dupcache_seen(&cache, 0x01, 0), NULL);
+    /* without a table, nothing is a repeat */
+    dupcache_init(&cache, NULL, 16, 1000);
+    zassert_false(dupcache_seen(&cache, 0x01, 0), NULL);
+    zassert_false(dupcache_seen(&cache, 0x01, 0), NULL);
+}
+/**
+ * @}
+ */
+
+void test_main(void)
+{
+    ztest_test_suite(dupcache_tests,
+     ztest_unit_test(testDuplicateLifetime),
+     ztest_unit_test(testDuplicateReplace)
+     );
+
+    ztest_run_test_suite(dupcache_tests);
+}
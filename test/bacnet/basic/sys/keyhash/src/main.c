@@ -0,0 +1,218 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief test keyed hash list APIs
+ */
+
+#include <string.h>
+#include <ztest.h>
+#include <bacnet/basic/sys/keyhash.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+static bool testKeyHashMatch(void *data, const void *context)
+{
+    return strcmp(data, context) == 0;
+}
+
+static void testKeyHashDataKey(void)
+{
+    OS_Keyhash list;
+    KEY key;
+    int index;
+    char *data1 = "Joshua";
+    char *data2 = "Anna";
+    char *data3 = "Mary";
+    char *data;
+
+    list = Keyhash_Create();
+    zassert_not_null(list, NULL);
+
+    key = 1;
+    index = Keyhash_Data_Add(list, key, data1);
+    zassert_equal(index, 0, NULL);
+    zassert_equal(Keyhash_Key(list, index), key, NULL);
+    key = 2;
+    index = Keyhash_Data_Add(list, key, data2);
+    zassert_equal(index, 1, NULL);
+    zassert_equal(Keyhash_Key(list, index), key, NULL);
+    key = 3;
+    index = Keyhash_Data_Add(list, key, data3);
+    zassert_equal(index, 2, NULL);
+    zassert_equal(Keyhash_Key(list, index), key, NULL);
+    zassert_equal(Keyhash_Count(list), 3, NULL);
+
+    /* look at the data */
+    data = Keyhash_Data(list, 2);
+    zassert_not_null(data, NULL);
+    zassert_equal(strcmp(data, data2), 0, NULL);
+    data = Keyhash_Data(list, 1);
+    zassert_not_null(data, NULL);
+    zassert_equal(strcmp(data, data1), 0, NULL);
+    data = Keyhash_Data(list, 3);
+    zassert_not_null(data, NULL);
+    zassert_equal(strcmp(data, data3), 0, NULL);
+    data = Keyhash_Data(list, 4);
+    zassert_equal(data, NULL, NULL);
+    zassert_equal(Keyhash_Index(list, 4), -1, NULL);
+
+    /* work the data */
+    data = Keyhash_Data_Delete(list, 1);
+    zassert_not_null(data, NULL);
+    zassert_equal(strcmp(data, data1), 0, NULL);
+    data = Keyhash_Data_Delete(list, 1);
+    zassert_equal(data, NULL, NULL);
+    zassert_equal(Keyhash_Count(list), 2, NULL);
+    /* the last node moved into the hole */
+    zassert_equal(Keyhash_Index(list, 3), 0, NULL);
+    data = Keyhash_Data(list, 2);
+    zassert_not_null(data, NULL);
+    zassert_equal(strcmp(data, data2), 0, NULL);
+    data = Keyhash_Data(list, 3);
+    zassert_not_null(data, NULL);
+    zassert_equal(strcmp(data, data3), 0, NULL);
+
+    /* cleanup */
+    while (Keyhash_Count(list)) {
+        data = Keyhash_Data_Delete_By_Index(list, 0);
+        zassert_not_null(data, NULL);
+    }
+    data = Keyhash_Data_Delete_By_Index(list, 0);
+    zassert_equal(data, NULL, NULL);
+
+    Keyhash_Delete(list);
+
+    return;
+}
+
+static void testKeyHashDataMatch(void)
+{
+    OS_Keyhash list;
+    KEY key;
+    char *data1 = "Joshua";
+    char *data2 = "Anna";
+    char *data3 = "Mary";
+    char *data;
+
+    list = Keyhash_Create();
+    zassert_not_null(list, NULL);
+
+    /* all the data collides on the same key */
+    key = 42;
+    zassert_equal(Keyhash_Data_Add(list, key, data1), 0, NULL);
+    zassert_equal(Keyhash_Data_Add(list, key, data2), 1, NULL);
+    zassert_equal(Keyhash_Data_Add(list, key, data3), 2, NULL);
+
+    data = Keyhash_Data_Match(list, key, testKeyHashMatch, "Anna");
+    zassert_equal(data, data2, NULL);
+    data = Keyhash_Data_Match(list, key, testKeyHashMatch, "Mary");
+    zassert_equal(data, data3, NULL);
+    data = Keyhash_Data_Match(list, key, testKeyHashMatch, "Nobody");
+    zassert_equal(data, NULL, NULL);
+    data = Keyhash_Data_Match(list, key + 1, testKeyHashMatch, "Anna");
+    zassert_equal(data, NULL, NULL);
+
+    data = Keyhash_Data_Delete_Match(list, key, testKeyHashMatch, "Anna");
+    zassert_equal(data, data2, NULL);
+    zassert_equal(Keyhash_Count(list), 2, NULL);
+    data = Keyhash_Data_Match(list, key, testKeyHashMatch, "Anna");
+    zassert_equal(data, NULL, NULL);
+    data = Keyhash_Data_Match(list, key, testKeyHashMatch, "Joshua");
+    zassert_equal(data, data1, NULL);
+    data = Keyhash_Data_Match(list, key, testKeyHashMatch, "Mary");
+    zassert_equal(data, data3, NULL);
+
+    Keyhash_Delete(list);
+
+    return;
+}
+
+static void testKeyHashHash(void)
+{
+    KEY hash1;
+    KEY hash2;
+
+    hash1 = Keyhash_Hash(KEYHASH_SEED, "Joshua", 6);
+    hash2 = Keyhash_Hash(KEYHASH_SEED, "Joshua", 6);
+    zassert_equal(hash1, hash2, NULL);
+    /* parts of a composite key accumulate */
+    hash2 = Keyhash_Hash(KEYHASH_SEED, "Jos", 3);
+    hash2 = Keyhash_Hash(hash2, "hua", 3);
+    zassert_equal(hash1, hash2, NULL);
+    hash2 = Keyhash_Hash(KEYHASH_SEED, "Anna", 4);
+    zassert_not_equal(hash1, hash2, NULL);
+    hash2 = Keyhash_Hash(KEYHASH_SEED, NULL, 4);
+    zassert_equal(hash2, KEYHASH_SEED, NULL);
+}
+
+/* test access of a lot of entries */
+static void testKeyHashLarge(void)
+{
+    int data1 = 42;
+    int *data;
+    OS_Keyhash list;
+    KEY key;
+    int index;
+    const unsigned num_keys = 1024 * 16;
+
+    list = Keyhash_Create();
+    if (!list)
+        return;
+
+    for (key = 0; key < num_keys; key++) {
+        index = Keyhash_Data_Add(list, key, &data1);
+        zassert_equal(index, (int)key, NULL);
+    }
+    for (key = 0; key < num_keys; key++) {
+        data = Keyhash_Data(list, key);
+        zassert_equal(*data, data1, NULL);
+    }
+    for (index = 0; index < (int)num_keys; index++) {
+        data = Keyhash_Data_Index(list, index);
+        zassert_equal(*data, data1, NULL);
+    }
+    /* delete the even keys, the odd keys must remain */
+    for (key = 0; key < num_keys; key += 2) {
+        data = Keyhash_Data_Delete(list, key);
+        zassert_not_null(data, NULL);
+    }
+    zassert_equal(Keyhash_Count(list), (int)(num_keys / 2), NULL);
+    for (key = 0; key < num_keys; key++) {
+        data = Keyhash_Data(list, key);
+        if (key % 2) {
+            zassert_not_null(data, NULL);
+        } else {
+            zassert_equal(data, NULL, NULL);
+        }
+    }
+    /* shrink to nothing */
+    for (key = 1; key < num_keys; key += 2) {
+        data = Keyhash_Data_Delete(list, key);
+        zassert_not_null(data, NULL);
+    }
+    zassert_equal(Keyhash_Count(list), 0, NULL);
+    Keyhash_Delete(list);
+
+    return;
+}
+/**
+ * @}
+ */
+
+
+void test_main(void)
+{
+    ztest_test_suite(keyhash_tests,
+     ztest_unit_test(testKeyHashDataKey),
+     ztest_unit_test(testKeyHashDataMatch),
+     ztest_unit_test(testKeyHashHash),
+     ztest_unit_test(testKeyHashLarge)
+     );
+
+    ztest_run_test_suite(keyhash_tests);
+}
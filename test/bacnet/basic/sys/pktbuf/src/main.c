@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2020 Legrand North America, LLC.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief test the descriptor of a received packet
+ */
+
+#include <ztest.h>
+#include <bacnet/basic/sys/pktbuf.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+static unsigned Lock_Count;
+static unsigned Unlock_Count;
+
+static void testLock(void)
+{
+    Lock_Count++;
+}
+
+static void testUnlock(void)
+{
+    Unlock_Count++;
+}
+
+/**
+ * @brief Unit Test for the headers of a packet, in place in its buffer
+ */
+static void testPacketOffsets(void)
+{
+    BACNET_PACKET packet;
+    uint8_t buffer[32] = { 0 };
+
+    pktbuf_init(&packet, buffer, sizeof(buffer));
+    zassert_false(pktbuf_busy(&packet), NULL);
+    zassert_false(pktbuf_receive(&packet, sizeof(buffer) + 1), NULL);
+    zassert_true(pktbuf_receive(&packet, 20), NULL);
+    zassert_equal(packet.length, 20, NULL);
+    zassert_equal(packet.bvlc_offset, 0, NULL);
+    zassert_equal(pktbuf_npdu(&packet), &buffer[0], NULL);
+    packet.npdu_offset = 4;
+    packet.apdu_offset = 6;
+    zassert_equal(pktbuf_npdu(&packet), &buffer[4], NULL);
+    zassert_equal(pktbuf_npdu_len(&packet), 16, NULL);
+    zassert_equal(pktbuf_apdu(&packet), &buffer[6], NULL);
+    zassert_equal(pktbuf_apdu_len(&packet), 14, NULL);
+    packet.apdu_offset = 20;
+    zassert_equal(pktbuf_apdu_len(&packet), 0, NULL);
+    pktbuf_release(&packet);
+    zassert_false(pktbuf_busy(&packet), NULL);
+}
+
+/**
+ * @brief Unit Test for the users of a packet
+ */
+static void testPacketUsers(void)
+{
+    BACNET_PACKET packet;
+    uint8_t buffer[32] = { 0 };
+
+    pktbuf_init(&packet, buffer, sizeof(buffer));
+    /* a free packet cannot be retained */
+    zassert_false(pktbuf_retain(&packet), NULL);
+    zassert_false(pktbuf_retain(NULL), NULL);
+    zassert_true(pktbuf_receive(&packet, 8), NULL);
+    zassert_true(pktbuf_busy(&packet), NULL);
+    /* a packet in use cannot be received into */
+    zassert_false(pktbuf_receive(&packet, 8), NULL);
+    /* deferred by a handler, and released by the datalink */
+    zassert_true(pktbuf_retain(&packet), NULL);
+    pktbuf_release(&packet);
+    zassert_true(pktbuf_busy(&packet), NULL);
+    zassert_equal(packet.length, 8, NULL);
+    /* and released by the handler */
+    pktbuf_release(&packet);
+    zassert_false(pktbuf_busy(&packet), NULL);
+    pktbuf_release(&packet);
+    pktbuf_release(NULL);
+    zassert_false(pktbuf_busy(&packet), NULL);
+    zassert_true(pktbuf_receive(&packet, 4), NULL);
+    pktbuf_release(&packet);
+}
+
+/**
+ * @brief Unit Test for the lock functions of the users
+ */
+static void testPacketLock(void)
+{
+    BACNET_PACKET packet;
+    uint8_t buffer[32] = { 0 };
+
+    pktbuf_init(&packet, buffer, sizeof(buffer));
+    pktbuf_set_lock_functions(testLock, testUnlock);
+    Lock_Count = 0;
+    Unlock_Count = 0;
+    zassert_true(pktbuf_receive(&packet, 8), NULL);
+    zassert_true(pktbuf_retain(&packet), NULL);
+    pktbuf_release(&packet);
+    pktbuf_release(&packet);
+    zassert_equal(Lock_Count, 4, NULL);
+    zassert_equal(Unlock_Count, 4, NULL);
+    pktbuf_set_lock_functions(NULL, NULL);
+    zassert_true(pktbuf_receive(&packet, 8), NULL);
+    pktbuf_release(&packet);
+    zassert_equal(Lock_Count, 4, NULL);
+}
+/**
+ * @}
+ */
+
+void test_main(void)
+{
+    ztest_test_suite(pktbuf_tests,
+     ztest_unit_test(testPacketOffsets),
+     ztest_unit_test(testPacketUsers),
+     ztest_unit_test(testPacketLock)
+     );
+
+    ztest_run_test_suite(pktbuf_tests);
+}
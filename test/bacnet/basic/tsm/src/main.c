@@ -0,0 +1,657 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief test BACnet Transaction State Machine APIs
+ */
+
+#include <string.h>
+#include <ztest.h>
+#include <bacnet/bacaddr.h>
+#include <bacnet/apdu.h>
+#include <bacnet/bits.h>
+#include <bacnet/bacdcode.h>
+#include <bacnet/basic/services.h>
+#include <bacnet/basic/service/h_apdu.h>
+#include <bacnet/basic/tsm/tsm.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+extern unsigned Test_Send_PDU_Count;
+extern uint8_t Test_Send_PDU[MAX_PDU];
+extern unsigned Test_Send_PDU_Len;
+
+static uint8_t Timeout_Invoke_ID;
+static unsigned Timeout_Count;
+
+static void testTimeoutHandler(uint8_t invoke_id)
+{
+    Timeout_Invoke_ID = invoke_id;
+    Timeout_Count++;
+    /* the handler may free the transaction while the timer runs */
+    tsm_free_invoke_id(invoke_id);
+}
+
+static void testTransaction(uint8_t invoke_id)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t apdu[8] = { 0 };
+
+    apdu[0] = invoke_id;
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    tsm_set_confirmed_unsegmented_transaction(
+        invoke_id, &dest, &npdu_data, apdu, sizeof(apdu));
+}
+
+/**
+ * @brief Test the invoke ID table
+ */
+static void testTSMInvokeID(void)
+{
+    uint8_t invoke_id[255] = { 0 };
+    unsigned i;
+
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    tsm_invokeID_set(0);
+    /* the shared space has 255 invoke IDs */
+    for (i = 0; i < 255; i++) {
+        invoke_id[i] = tsm_next_free_invokeID();
+        zassert_not_equal(invoke_id[i], 0, NULL);
+        zassert_false(tsm_invoke_id_free(invoke_id[i]), NULL);
+    }
+    zassert_equal(
+        tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS - 255, NULL);
+    zassert_equal(tsm_next_free_invokeID(), 0, NULL);
+    /* free one in the middle, and its ID is the only one left */
+    tsm_free_invoke_id(invoke_id[42]);
+    zassert_true(tsm_invoke_id_free(invoke_id[42]), NULL);
+    zassert_true(tsm_transaction_available(), NULL);
+    zassert_equal(tsm_next_free_invokeID(), invoke_id[42], NULL);
+    for (i = 0; i < 255; i++) {
+        tsm_free_invoke_id(invoke_id[i]);
+        zassert_true(tsm_invoke_id_free(invoke_id[i]), NULL);
+    }
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+}
+
+/**
+ * @brief Test the transaction retries and timeouts
+ */
+static void testTSMTimer(void)
+{
+    uint8_t invoke_id, other_id;
+    unsigned i;
+
+    apdu_timeout_set(3000);
+    apdu_retries_set(2);
+    tsm_set_timeout_handler(testTimeoutHandler);
+    Timeout_Count = 0;
+    Test_Send_PDU_Count = 0;
+    invoke_id = tsm_next_free_invokeID();
+    zassert_not_equal(invoke_id, 0, NULL);
+    testTransaction(invoke_id);
+    tsm_timer_milliseconds(10);
+    /* a transaction that is answered does not time out */
+    other_id = tsm_next_free_invokeID();
+    testTransaction(other_id);
+    tsm_free_invoke_id(other_id);
+    /* not yet */
+    for (i = 0; i < 298; i++) {
+        tsm_timer_milliseconds(10);
+    }
+    zassert_equal(Test_Send_PDU_Count, 0, NULL);
+    zassert_false(tsm_invoke_id_failed(invoke_id), NULL);
+    /* first retry */
+    tsm_timer_milliseconds(10);
+    zassert_equal(Test_Send_PDU_Count, 1, NULL);
+    /* second retry, after a long pause */
+    tsm_timer_milliseconds(10000);
+    zassert_equal(Test_Send_PDU_Count, 2, NULL);
+    zassert_equal(Timeout_Count, 0, NULL);
+    /* timeout */
+    tsm_timer_milliseconds(2999);
+    zassert_equal(Timeout_Count, 0, NULL);
+    tsm_timer_milliseconds(1);
+    zassert_equal(Timeout_Count, 1, NULL);
+    zassert_equal(Timeout_Invoke_ID, invoke_id, NULL);
+    zassert_equal(Test_Send_PDU_Count, 2, NULL);
+    zassert_true(tsm_invoke_id_free(invoke_id), NULL);
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    tsm_timer_milliseconds(10000);
+    zassert_equal(Timeout_Count, 1, NULL);
+    tsm_set_timeout_handler(NULL);
+}
+
+/**
+ * @brief Test a failed transaction stays until it is freed
+ */
+static void testTSMFailed(void)
+{
+    uint8_t invoke_id;
+
+    apdu_timeout_set(100);
+    apdu_retries_set(0);
+    invoke_id = tsm_next_free_invokeID();
+    testTransaction(invoke_id);
+    zassert_false(tsm_invoke_id_failed(invoke_id), NULL);
+    tsm_timer_milliseconds(100);
+    zassert_true(tsm_invoke_id_failed(invoke_id), NULL);
+    zassert_false(tsm_invoke_id_free(invoke_id), NULL);
+    tsm_free_invoke_id(invoke_id);
+    zassert_true(tsm_invoke_id_free(invoke_id), NULL);
+}
+
+/**
+ * @brief Test the transmit buffers that a transaction keeps
+ */
+static void testTSMPDUPool(void)
+{
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t apdu[MAX_PDU] = { 0 };
+    uint16_t apdu_len = 0;
+    uint8_t *pdu[MAX_PDU_BUFFERS] = { 0 };
+    uint8_t invoke_id;
+    unsigned count;
+    unsigned i;
+
+    count = tsm_pdu_free_count();
+    zassert_equal(count, MAX_PDU_BUFFERS, NULL);
+    pdu[0] = tsm_pdu_acquire();
+    zassert_not_null(pdu[0], NULL);
+    zassert_equal(tsm_pdu_free_count(), count - 1, NULL);
+    /* only the buffers of the pool are retained */
+    zassert_false(tsm_pdu_retain(apdu), NULL);
+    zassert_false(tsm_pdu_retain(&pdu[0][1]), NULL);
+    /* the transaction keeps the buffer after the sender releases it */
+    apdu_timeout_set(3000);
+    apdu_retries_set(1);
+    Test_Send_PDU_Count = 0;
+    invoke_id = tsm_next_free_invokeID();
+    memset(pdu[0], 0x55, 8);
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    tsm_set_confirmed_unsegmented_transaction(
+        invoke_id, &dest, &npdu_data, pdu[0], 8);
+    tsm_pdu_release(pdu[0]);
+    zassert_equal(tsm_pdu_free_count(), count - 1, NULL);
+    memset(pdu[0], 0xAA, 8);
+    zassert_true(tsm_get_transaction_pdu(
+                     invoke_id, &dest, &npdu_data, apdu, &apdu_len),
+        NULL);
+    zassert_equal(apdu_len, 8, NULL);
+    zassert_equal(apdu[7], 0xAA, NULL);
+    tsm_timer_milliseconds(3000);
+    zassert_equal(Test_Send_PDU_Count, 1, NULL);
+    zassert_equal(Test_Send_PDU_Len, 8, NULL);
+    zassert_equal(Test_Send_PDU[0], 0xAA, NULL);
+    tsm_free_invoke_id(invoke_id);
+    zassert_equal(tsm_pdu_free_count(), count, NULL);
+    /* any other buffer is copied into one of the pool */
+    invoke_id = tsm_next_free_invokeID();
+    testTransaction(invoke_id);
+    zassert_equal(tsm_pdu_free_count(), count - 1, NULL);
+    tsm_free_invoke_id(invoke_id);
+    zassert_equal(tsm_pdu_free_count(), count, NULL);
+    /* all of them can be in use */
+    for (i = 0; i < MAX_PDU_BUFFERS; i++) {
+        pdu[i] = tsm_pdu_acquire();
+        zassert_not_null(pdu[i], NULL);
+    }
+    zassert_is_null(tsm_pdu_acquire(), NULL);
+    for (i = 0; i < MAX_PDU_BUFFERS; i++) {
+        tsm_pdu_release(pdu[i]);
+    }
+    zassert_equal(tsm_pdu_free_count(), count, NULL);
+}
+
+static BACNET_ADDRESS Timeout_Peer;
+
+static void testTimeoutPeerHandler(BACNET_ADDRESS *dest, uint8_t invoke_id)
+{
+    bacnet_address_copy(&Timeout_Peer, dest);
+    Timeout_Invoke_ID = invoke_id;
+    Timeout_Count++;
+}
+
+static void testPeerAddress(BACNET_ADDRESS *dest, uint8_t id)
+{
+    memset(dest, 0, sizeof(*dest));
+    dest->mac_len = 6;
+    dest->mac[0] = 192;
+    dest->mac[1] = 168;
+    dest->mac[3] = id;
+    dest->mac[4] = 0xBA;
+    dest->mac[5] = 0xC0;
+}
+
+/**
+ * @brief Test the per-peer invoke ID spaces
+ */
+static void testTSMPeer(void)
+{
+    BACNET_ADDRESS peer_a, peer_b;
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t apdu[8] = { 0 };
+    uint8_t apdu_copy[MAX_PDU] = { 0 };
+    uint16_t apdu_len = 0;
+    uint8_t id_a = 0, id_b = 0, id_shared = 0;
+    unsigned i;
+
+    testPeerAddress(&peer_a, 1);
+    testPeerAddress(&peer_b, 2);
+    apdu_timeout_set(100);
+    apdu_retries_set(0);
+    tsm_set_timeout_peer_handler(testTimeoutPeerHandler);
+    Timeout_Count = 0;
+    zassert_equal(tsm_next_free_invokeID_peer(NULL), 0, NULL);
+    /* the same invoke ID can be outstanding to different peers */
+    tsm_invokeID_set(7);
+    id_a = tsm_next_free_invokeID_peer(&peer_a);
+    tsm_invokeID_set(7);
+    id_b = tsm_next_free_invokeID_peer(&peer_b);
+    zassert_equal(id_a, 7, NULL);
+    zassert_equal(id_b, 7, NULL);
+    zassert_false(tsm_invoke_id_free_peer(&peer_a, 7), NULL);
+    zassert_false(tsm_invoke_id_free_peer(&peer_b, 7), NULL);
+    /* ...but not in the shared space */
+    zassert_true(tsm_invoke_id_free(7), NULL);
+    tsm_invokeID_set(7);
+    id_shared = tsm_next_free_invokeID();
+    zassert_equal(id_shared, 8, NULL);
+    /* and a peer does not get an invoke ID of the shared space */
+    tsm_invokeID_set(8);
+    zassert_equal(tsm_next_free_invokeID_peer(&peer_a), 9, NULL);
+    tsm_free_invoke_id_peer(&peer_a, 9);
+    /* a reply from one peer frees only its own transaction */
+    tsm_free_invoke_id_peer(&peer_a, id_a);
+    zassert_true(tsm_invoke_id_free_peer(&peer_a, id_a), NULL);
+    zassert_false(tsm_invoke_id_free_peer(&peer_b, id_b), NULL);
+    /* the shared space is found through a peer, too */
+    zassert_false(tsm_invoke_id_free_peer(&peer_a, id_shared), NULL);
+    tsm_free_invoke_id_peer(&peer_a, id_shared);
+    zassert_true(tsm_invoke_id_free(id_shared), NULL);
+    /* a peer timeout is reported with its address */
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    tsm_set_confirmed_unsegmented_transaction(
+        id_b, &peer_b, &npdu_data, apdu, sizeof(apdu));
+    /* what was sent is found through the peer that replies */
+    zassert_true(tsm_get_transaction_pdu_peer(
+        &peer_b, id_b, &npdu_data, apdu_copy, &apdu_len), NULL);
+    zassert_equal(apdu_len, sizeof(apdu), NULL);
+    zassert_false(tsm_get_transaction_pdu_peer(
+        &peer_a, id_b, &npdu_data, apdu_copy, &apdu_len), NULL);
+    tsm_timer_milliseconds(100);
+    zassert_equal(Timeout_Count, 1, NULL);
+    zassert_equal(Timeout_Invoke_ID, id_b, NULL);
+    zassert_true(bacnet_address_same(&Timeout_Peer, &peer_b), NULL);
+    zassert_true(tsm_invoke_id_failed_peer(&peer_b, id_b), NULL);
+    tsm_free_invoke_id_peer(&peer_b, id_b);
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    /* every peer has 255 invoke IDs */
+    for (i = 0; i < 255; i++) {
+        zassert_not_equal(tsm_next_free_invokeID_peer(&peer_a), 0, NULL);
+    }
+    zassert_equal(tsm_next_free_invokeID_peer(&peer_a), 0, NULL);
+    zassert_not_equal(tsm_next_free_invokeID_peer(&peer_b), 0, NULL);
+    zassert_equal(tsm_next_free_invokeID(), 0, NULL);
+    for (i = 1; i < 256; i++) {
+        tsm_free_invoke_id_peer(&peer_a, (uint8_t)i);
+        tsm_free_invoke_id_peer(&peer_b, (uint8_t)i);
+    }
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    tsm_set_timeout_peer_handler(NULL);
+}
+
+/* the APDU of a ComplexACK follows the NPDU of a local destination */
+#define TEST_APDU_OFFSET 2
+
+static uint16_t testComplexACK(uint8_t *apdu, uint8_t invoke_id, uint16_t len)
+{
+    uint16_t i;
+
+    apdu[0] = PDU_TYPE_COMPLEX_ACK;
+    apdu[1] = invoke_id;
+    apdu[2] = SERVICE_CONFIRMED_READ_PROP_MULTIPLE;
+    for (i = 0; i < len; i++) {
+        apdu[3 + i] = (uint8_t)i;
+    }
+
+    return 3 + len;
+}
+
+/**
+ * @brief Test the segmented responses
+ */
+static void testTSMSegmentedResponse(void)
+{
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_ADDRESS client;
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t apdu[3 + 2000] = { 0 };
+    uint8_t *buffer;
+    uint16_t apdu_max = 0;
+    uint16_t apdu_len;
+    uint8_t *segment = &Test_Send_PDU[TEST_APDU_OFFSET];
+    unsigned i;
+
+    apdu_timeout_set(100);
+    apdu_retries_set(1);
+    testPeerAddress(&client, 3);
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    service_data.segmented_response_accepted = true;
+    service_data.max_segs = 0;
+    service_data.max_resp = 480;
+    service_data.invoke_id = 9;
+    buffer = tsm_segmented_response_buffer(&service_data, &apdu_max);
+    zassert_not_null(buffer, NULL);
+    zassert_true(apdu_max > 480, NULL);
+    /* a small response is sent unsegmented */
+    Test_Send_PDU_Count = 0;
+    apdu_len = testComplexACK(apdu, 9, 100);
+    zassert_true(tsm_segmented_response_send(
+        &client, &npdu_data, &service_data, apdu, apdu_len), NULL);
+    zassert_equal(Test_Send_PDU_Count, 1, NULL);
+    zassert_equal(segment[0], PDU_TYPE_COMPLEX_ACK, NULL);
+    zassert_equal(
+        Test_Send_PDU_Len, (unsigned)(TEST_APDU_OFFSET + apdu_len), NULL);
+    /* a large one in 5 segments of 475 octets */
+    Test_Send_PDU_Count = 0;
+    apdu_len = testComplexACK(apdu, 9, 2000);
+    zassert_true(tsm_segmented_response_send(
+        &client, &npdu_data, &service_data, apdu, apdu_len), NULL);
+    zassert_equal(Test_Send_PDU_Count, 1, NULL);
+    zassert_equal(segment[0], PDU_TYPE_COMPLEX_ACK | BIT(3) | BIT(2), NULL);
+    zassert_equal(segment[1], 9, NULL);
+    zassert_equal(segment[2], 0, NULL);
+    zassert_equal(segment[4], SERVICE_CONFIRMED_READ_PROP_MULTIPLE, NULL);
+    zassert_equal(Test_Send_PDU_Len, TEST_APDU_OFFSET + 480, NULL);
+    /* the client asks for a window of 2 */
+    tsm_segment_ack_received(&client, 9, 0, 2);
+    zassert_equal(Test_Send_PDU_Count, 3, NULL);
+    zassert_equal(segment[2], 2, NULL);
+    zassert_equal(segment[5], (uint8_t)(2 * 475), NULL);
+    /* a duplicate ACK, and an ACK of someone else, are ignored */
+    tsm_segment_ack_received(&client, 9, 0, 2);
+    tsm_segment_ack_received(&client, 10, 2, 2);
+    zassert_equal(Test_Send_PDU_Count, 3, NULL);
+    /* the window is sent again after the segment timeout */
+    tsm_timer_milliseconds(100);
+    zassert_equal(Test_Send_PDU_Count, 5, NULL);
+    /* the last window */
+    tsm_segment_ack_received(&client, 9, 2, 4);
+    zassert_equal(Test_Send_PDU_Count, 7, NULL);
+    zassert_equal(segment[0], PDU_TYPE_COMPLEX_ACK | BIT(3), NULL);
+    zassert_equal(segment[2], 4, NULL);
+    zassert_equal(Test_Send_PDU_Len, TEST_APDU_OFFSET + 5 + 100, NULL);
+    /* the final ACK ends the response */
+    tsm_segment_ack_received(&client, 9, 4, 4);
+    tsm_timer_milliseconds(1000);
+    zassert_equal(Test_Send_PDU_Count, 7, NULL);
+    /* gives up after the retries */
+    zassert_true(tsm_segmented_response_send(
+        &client, &npdu_data, &service_data, apdu, apdu_len), NULL);
+    tsm_timer_milliseconds(100);
+    tsm_timer_milliseconds(100);
+    zassert_equal(Test_Send_PDU_Count, 9, NULL);
+    tsm_segment_ack_received(&client, 9, 0, 2);
+    zassert_equal(Test_Send_PDU_Count, 9, NULL);
+    /* too many segments for the client */
+    service_data.max_segs = 4;
+    zassert_false(tsm_segmented_response_send(
+        &client, &npdu_data, &service_data, apdu, apdu_len), NULL);
+    service_data.max_segs = 0;
+    /* or no segments at all */
+    service_data.segmented_response_accepted = false;
+    zassert_is_null(
+        tsm_segmented_response_buffer(&service_data, &apdu_max), NULL);
+    zassert_false(tsm_segmented_response_send(
+        &client, &npdu_data, &service_data, apdu, apdu_len), NULL);
+    service_data.segmented_response_accepted = true;
+    /* the client can abort */
+    for (i = 0; i < MAX_TSM_SEGMENTED_RESPONSES; i++) {
+        apdu[1] = (uint8_t)(20 + i);
+        zassert_true(tsm_segmented_response_send(
+            &client, &npdu_data, &service_data, apdu, apdu_len), NULL);
+    }
+    zassert_is_null(
+        tsm_segmented_response_buffer(&service_data, &apdu_max), NULL);
+    zassert_false(tsm_segmented_response_send(
+        &client, &npdu_data, &service_data, apdu, apdu_len), NULL);
+    for (i = 0; i < MAX_TSM_SEGMENTED_RESPONSES; i++) {
+        tsm_segmented_response_abort(&client, (uint8_t)(20 + i));
+    }
+    zassert_not_null(
+        tsm_segmented_response_buffer(&service_data, &apdu_max), NULL);
+    Test_Send_PDU_Count = 0;
+    tsm_segment_ack_received(&client, 20, 0, 2);
+    zassert_equal(Test_Send_PDU_Count, 0, NULL);
+}
+
+/**
+ * @brief Test a ReadPropertyMultiple reply larger than MAX_APDU, which
+ * the handler encodes for the segmented response of the TSM
+ */
+static void testTSMSegmentedRPM(void)
+{
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_ADDRESS client;
+    uint8_t request[32] = { 0 };
+    uint8_t *segment = &Test_Send_PDU[TEST_APDU_OFFSET];
+    uint8_t invoke_id = 40;
+    unsigned segments = 0;
+    unsigned reply_len = 0;
+    int len = 0;
+
+    apdu_timeout_set(100);
+    testPeerAddress(&client, 7);
+    len = encode_context_object_id(&request[0], 0, OBJECT_DEVICE, 1234);
+    len += encode_opening_tag(&request[len], 1);
+    len += encode_context_enumerated(&request[len], 0, PROP_ALL);
+    len += encode_closing_tag(&request[len], 1);
+    service_data.segmented_response_accepted = true;
+    service_data.max_segs = 0;
+    service_data.max_resp = 480;
+    service_data.invoke_id = invoke_id;
+    Test_Send_PDU_Count = 0;
+    handler_read_property_multiple(request, (uint16_t)len, &client,
+        &service_data);
+    /* the first segment, not an abort */
+    zassert_equal(Test_Send_PDU_Count, 1, NULL);
+    zassert_equal(segment[0], PDU_TYPE_COMPLEX_ACK | BIT(3) | BIT(2), NULL);
+    zassert_equal(segment[1], invoke_id, NULL);
+    zassert_equal(segment[2], 0, NULL);
+    zassert_equal(segment[4], SERVICE_CONFIRMED_READ_PROP_MULTIPLE, NULL);
+    /* each following segment is sent on its SegmentACK */
+    while (segment[0] & BIT(2)) {
+        segments++;
+        tsm_segment_ack_received(&client, invoke_id, segment[2], 1);
+        zassert_equal(Test_Send_PDU_Count, segments + 1, NULL);
+        zassert_equal(segment[2], segments, NULL);
+    }
+    zassert_equal(segment[0], PDU_TYPE_COMPLEX_ACK | BIT(3), NULL);
+    reply_len = 3 + (segments * (480 - 5)) +
+        (Test_Send_PDU_Len - TEST_APDU_OFFSET - 5);
+    zassert_true(reply_len > MAX_APDU, NULL);
+    tsm_segment_ack_received(&client, invoke_id, segment[2], 1);
+    zassert_equal(Test_Send_PDU_Count, segments + 1, NULL);
+}
+
+static uint8_t Test_Service_ACK[2000];
+static uint16_t Test_Service_ACK_Len;
+static unsigned Test_Service_ACK_Count;
+
+static void testComplexACKHandler(uint8_t *service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS *src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA *service_data)
+{
+    (void)src;
+    (void)service_data;
+    Test_Service_ACK_Count++;
+    if (service_len <= sizeof(Test_Service_ACK)) {
+        memcpy(Test_Service_ACK, service_request, service_len);
+        Test_Service_ACK_Len = service_len;
+    }
+}
+
+static uint16_t testSegment(uint8_t *apdu,
+    uint8_t invoke_id,
+    uint8_t sequence_number,
+    bool more_follows,
+    uint16_t len)
+{
+    uint16_t i;
+
+    apdu[0] = PDU_TYPE_COMPLEX_ACK | BIT(3);
+    if (more_follows) {
+        apdu[0] |= BIT(2);
+    }
+    apdu[1] = invoke_id;
+    apdu[2] = sequence_number;
+    /* proposed window size */
+    apdu[3] = 4;
+    apdu[4] = SERVICE_CONFIRMED_READ_PROP_MULTIPLE;
+    for (i = 0; i < len; i++) {
+        apdu[5 + i] = (uint8_t)(sequence_number + i);
+    }
+
+    return 5 + len;
+}
+
+static uint8_t testSegmentedRequest(BACNET_ADDRESS *server)
+{
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t apdu[8] = { 0 };
+    uint8_t invoke_id;
+
+    invoke_id = tsm_next_free_invokeID_peer(server);
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    tsm_set_confirmed_unsegmented_transaction(
+        invoke_id, server, &npdu_data, apdu, sizeof(apdu));
+
+    return invoke_id;
+}
+
+/**
+ * @brief Test the reassembly of segmented responses to our requests
+ */
+static void testTSMSegmentedConfirmation(void)
+{
+    BACNET_ADDRESS server;
+    uint8_t apdu[5 + 100] = { 0 };
+    uint8_t *segment_ack = &Test_Send_PDU[TEST_APDU_OFFSET];
+    uint8_t invoke_id[MAX_TSM_SEGMENTED_CONFIRMATIONS + 1];
+    uint16_t apdu_len;
+    unsigned i, j;
+
+    apdu_timeout_set(100);
+    apdu_retries_set(0);
+    testPeerAddress(&server, 4);
+    apdu_set_confirmed_ack_handler(
+        SERVICE_CONFIRMED_READ_PROP_MULTIPLE, testComplexACKHandler);
+    Test_Service_ACK_Count = 0;
+    Test_Send_PDU_Count = 0;
+    /* a segment is ignored without a request */
+    apdu_len = testSegment(apdu, 30, 0, true, 100);
+    apdu_handler(&server, apdu, apdu_len);
+    zassert_equal(Test_Send_PDU_Count, 0, NULL);
+    tsm_invokeID_set(30);
+    invoke_id[0] = testSegmentedRequest(&server);
+    zassert_equal(invoke_id[0], 30, NULL);
+    /* the first segment is acknowledged with the window size */
+    apdu_handler(&server, apdu, apdu_len);
+    zassert_equal(Test_Send_PDU_Count, 1, NULL);
+    zassert_equal(segment_ack[0], PDU_TYPE_SEGMENT_ACK, NULL);
+    zassert_equal(segment_ack[1], 30, NULL);
+    zassert_equal(segment_ack[2], 0, NULL);
+    zassert_equal(segment_ack[3], 4, NULL);
+    zassert_false(tsm_invoke_id_free_peer(&server, 30), NULL);
+    /* and the request is not sent again */
+    tsm_timer_milliseconds(100);
+    zassert_false(tsm_invoke_id_failed_peer(&server, 30), NULL);
+    zassert_equal(Test_Send_PDU_Count, 1, NULL);
+    /* the last segment of the window is acknowledged */
+    for (i = 1; i <= 4; i++) {
+        apdu_len = testSegment(apdu, 30, (uint8_t)i, true, 100);
+        apdu_handler(&server, apdu, apdu_len);
+    }
+    zassert_equal(Test_Send_PDU_Count, 2, NULL);
+    zassert_equal(segment_ack[2], 4, NULL);
+    /* a segment out of order is acknowledged negatively */
+    apdu_len = testSegment(apdu, 30, 6, true, 100);
+    apdu_handler(&server, apdu, apdu_len);
+    zassert_equal(Test_Send_PDU_Count, 3, NULL);
+    zassert_equal(segment_ack[0], PDU_TYPE_SEGMENT_ACK | BIT(1), NULL);
+    zassert_equal(segment_ack[2], 4, NULL);
+    zassert_equal(Test_Service_ACK_Count, 0, NULL);
+    /* the handler gets the complete response */
+    apdu_len = testSegment(apdu, 30, 5, false, 50);
+    apdu_handler(&server, apdu, apdu_len);
+    zassert_equal(Test_Send_PDU_Count, 4, NULL);
+    zassert_equal(segment_ack[0], PDU_TYPE_SEGMENT_ACK, NULL);
+    zassert_equal(segment_ack[2], 5, NULL);
+    zassert_equal(Test_Service_ACK_Count, 1, NULL);
+    zassert_equal(Test_Service_ACK_Len, 5 * 100 + 50, NULL);
+    for (i = 0; i <= 5; i++) {
+        for (j = 0; j < 50; j++) {
+            zassert_equal(Test_Service_ACK[i * 100 + j], (uint8_t)(i + j),
+                NULL);
+        }
+    }
+    zassert_true(tsm_invoke_id_free_peer(&server, 30), NULL);
+    /* the request fails when the server stops sending segments */
+    invoke_id[0] = testSegmentedRequest(&server);
+    apdu_len = testSegment(apdu, invoke_id[0], 0, true, 100);
+    apdu_handler(&server, apdu, apdu_len);
+    tsm_timer_milliseconds(300);
+    zassert_false(tsm_invoke_id_failed_peer(&server, invoke_id[0]), NULL);
+    tsm_timer_milliseconds(100);
+    zassert_true(tsm_invoke_id_failed_peer(&server, invoke_id[0]), NULL);
+    tsm_free_invoke_id_peer(&server, invoke_id[0]);
+    /* a response is aborted when all reassemblies are busy */
+    for (i = 0; i <= MAX_TSM_SEGMENTED_CONFIRMATIONS; i++) {
+        invoke_id[i] = testSegmentedRequest(&server);
+        apdu_len = testSegment(apdu, invoke_id[i], 0, true, 100);
+        apdu_handler(&server, apdu, apdu_len);
+    }
+    zassert_equal(segment_ack[0], PDU_TYPE_ABORT, NULL);
+    zassert_equal(segment_ack[1], invoke_id[i - 1], NULL);
+    zassert_equal(segment_ack[2], ABORT_REASON_BUFFER_OVERFLOW, NULL);
+    zassert_true(tsm_invoke_id_failed_peer(&server, invoke_id[i - 1]), NULL);
+    /* freeing a request gives back its reassembly */
+    for (i = 0; i <= MAX_TSM_SEGMENTED_CONFIRMATIONS; i++) {
+        tsm_free_invoke_id_peer(&server, invoke_id[i]);
+    }
+    invoke_id[0] = testSegmentedRequest(&server);
+    apdu_len = testSegment(apdu, invoke_id[0], 0, true, 100);
+    apdu_handler(&server, apdu, apdu_len);
+    zassert_equal(segment_ack[0], PDU_TYPE_SEGMENT_ACK, NULL);
+    tsm_free_invoke_id_peer(&server, invoke_id[0]);
+    zassert_equal(tsm_transaction_idle_count(), MAX_TSM_TRANSACTIONS, NULL);
+    apdu_set_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE, NULL);
+}
+/**
+ * @}
+ */
+
+
+void test_main(void)
+{
+    ztest_test_suite(tsm_tests,
+     ztest_unit_test(testTSMInvokeID),
+     ztest_unit_test(testTSMTimer),
+     ztest_unit_test(testTSMFailed),
+     ztest_unit_test(testTSMPDUPool),
+     ztest_unit_test(testTSMPeer),
+     ztest_unit_test(testTSMSegmentedResponse),
+     ztest_unit_test(testTSMSegmentedRPM),
+     ztest_unit_test(testTSMSegmentedConfirmation)
+     );
+
+    ztest_run_test_suite(tsm_tests);
+}
@@ -0,0 +1,86 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief stubs for the TSM unit test
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "bacnet/bacdef.h"
+#include "bacnet/bacdcode.h"
+#include "bacnet/rp.h"
+#include "bacnet/proplist.h"
+#include "bacnet/datalink/bip.h"
+
+/* number of PDUs sent, to count the retries */
+unsigned Test_Send_PDU_Count;
+/* the last PDU sent */
+uint8_t Test_Send_PDU[MAX_PDU];
+unsigned Test_Send_PDU_Len;
+
+int bip_send_pdu(BACNET_ADDRESS *dest,
+    BACNET_NPDU_DATA *npdu_data,
+    uint8_t *pdu,
+    unsigned pdu_len)
+{
+    (void)dest;
+    (void)npdu_data;
+    Test_Send_PDU_Count++;
+    if (pdu_len > sizeof(Test_Send_PDU)) {
+        pdu_len = sizeof(Test_Send_PDU);
+    }
+    memcpy(Test_Send_PDU, pdu, pdu_len);
+    Test_Send_PDU_Len = pdu_len;
+
+    return (int)pdu_len;
+}
+
+void bip_get_my_address(BACNET_ADDRESS *my_address)
+{
+    memset(my_address, 0, sizeof(*my_address));
+}
+
+/* the properties of the object read by the RPM test */
+static const int Test_Properties[] = { PROP_OBJECT_IDENTIFIER,
+    PROP_OBJECT_NAME, PROP_OBJECT_TYPE, PROP_DESCRIPTION, PROP_LOCATION,
+    PROP_PROFILE_NAME, PROP_MODEL_NAME, PROP_VENDOR_NAME,
+    PROP_FIRMWARE_REVISION, PROP_APPLICATION_SOFTWARE_VERSION, -1 };
+/* size of the value of each property */
+#define TEST_PROPERTY_VALUE_LEN 300
+
+uint32_t Device_Object_Instance_Number(void)
+{
+    return 1234;
+}
+
+void Device_Objects_Property_List(BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    struct special_property_list_t *pPropertyList)
+{
+    (void)object_type;
+    (void)object_instance;
+    pPropertyList->Required.pList = Test_Properties;
+    pPropertyList->Required.count = property_list_count(Test_Properties);
+    pPropertyList->Optional.pList = NULL;
+    pPropertyList->Optional.count = 0;
+    pPropertyList->Proprietary.pList = NULL;
+    pPropertyList->Proprietary.count = 0;
+}
+
+int Device_Read_Property(BACNET_READ_PROPERTY_DATA *rpdata)
+{
+    int len;
+
+    if (rpdata->application_data_len < (TEST_PROPERTY_VALUE_LEN + 5)) {
+        return BACNET_STATUS_ABORT;
+    }
+    len = encode_tag(&rpdata->application_data[0],
+        BACNET_APPLICATION_TAG_OCTET_STRING, false, TEST_PROPERTY_VALUE_LEN);
+    memset(&rpdata->application_data[len], rpdata->object_property,
+        TEST_PROPERTY_VALUE_LEN);
+
+    return len + TEST_PROPERTY_VALUE_LEN;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020 Legrand North America, LLC.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief benchmark the one pass header parser of BACnet/IPv4 packets
+ * against the BVLC, NPDU and APDU decoders. It prints the number of
+ * packets per second that each one parses on one core. It is not run
+ * by ctest, since its result depends on the machine.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <bacnet/bacint.h>
+#include <bacnet/npdu.h>
+#include <bacnet/basic/service/h_apdu.h>
+#include <bacnet/datalink/bvlc.h>
+
+int main(void)
+{
+    uint8_t npdu[] = { 0x01, 0x04, 0x02, 0x05, 0x07, 0x0C, 0x0C, 0x02,
+        0x00, 0x00, 0x01, 0x19, 0x4B };
+    uint8_t mtu[64] = { 0 };
+    BACNET_PACKET packet = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    uint8_t message_type = 0;
+    uint16_t message_length = 0;
+    uint16_t npdu_len = 0;
+    uint8_t service_choice = 0;
+    uint8_t *service_request = NULL;
+    uint16_t service_request_len = 0;
+    unsigned long count = 1000000UL;
+    unsigned long i = 0;
+    unsigned long parsed = 0;
+    int header_len = 0;
+    int apdu_offset = 0;
+    clock_t start = 0;
+    double decode_seconds = 0.0;
+    double fast_seconds = 0.0;
+    int len = 0;
+
+    len = bvlc_encode_original_unicast(mtu, sizeof(mtu), npdu, sizeof(npdu));
+    packet.buffer = mtu;
+    packet.buffer_size = sizeof(mtu);
+    packet.length = (uint16_t)len;
+    start = clock();
+    for (i = 0; i < count; i++) {
+        header_len = bvlc_decode_header(
+            mtu, packet.length, &message_type, &message_length);
+        if ((header_len == 4) &&
+            (message_type == BVLC_ORIGINAL_UNICAST_NPDU) &&
+            bvlc_decode_original_unicast(&mtu[header_len],
+                packet.length - header_len, NULL, 0, &npdu_len)) {
+            apdu_offset = bacnet_npdu_decode(
+                &mtu[header_len], npdu_len, &dest, &src, &npdu_data);
+            if ((apdu_offset > 0) &&
+                ((mtu[header_len + apdu_offset] & 0xF0) ==
+                    PDU_TYPE_CONFIRMED_SERVICE_REQUEST) &&
+                apdu_decode_confirmed_service_request(
+                    &mtu[header_len + apdu_offset], npdu_len - apdu_offset,
+                    &service_data, &service_choice, &service_request,
+                    &service_request_len)) {
+                parsed++;
+            }
+        }
+    }
+    decode_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if ((parsed != count) || (service_choice != 0x0C)) {
+        printf("decoders: parse failed\n");
+        return 1;
+    }
+    parsed = 0;
+    start = clock();
+    for (i = 0; i < count; i++) {
+        if (bvlc_decode_packet_header(&packet)) {
+            parsed++;
+        }
+    }
+    fast_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if ((parsed != count) || (packet.header.service_choice != 0x0C)) {
+        printf("fast path: parse failed\n");
+        return 1;
+    }
+    if ((decode_seconds > 0.0) && (fast_seconds > 0.0)) {
+        printf("decoders: %.0f packets per second per core\n",
+            count / decode_seconds);
+        printf("fast path: %.0f packets per second per core\n",
+            count / fast_seconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 Legrand North America, LLC.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* @file
+ * @brief test the one pass header parser of BACnet/IPv4 packets
+ */
+
+#include <ztest.h>
+#include <bacnet/bacint.h>
+#include <bacnet/datalink/bvlc.h>
+
+/**
+ * @addtogroup bacnet_tests
+ * @{
+ */
+
+/**
+ * @brief Test the fast-path header parser of a unicast confirmed request
+ */
+static void testBVLC_Packet_Header(void)
+{
+    /* NPDU expecting a reply, and a ReadProperty confirmed request */
+    uint8_t npdu[] = { 0x01, 0x04, 0x02, 0x05, 0x07, 0x0C, 0x0C, 0x02,
+        0x00, 0x00, 0x01, 0x19, 0x4B };
+    uint8_t mtu[64] = { 0 };
+    BACNET_PACKET packet = { 0 };
+    int len = 0;
+    int offset = 3;
+
+    len = bvlc_encode_original_unicast(
+        &mtu[offset], sizeof(mtu) - offset, npdu, sizeof(npdu));
+    zassert_equal(len, 4 + sizeof(npdu), NULL);
+    packet.buffer = mtu;
+    packet.buffer_size = sizeof(mtu);
+    packet.length = offset + len;
+    packet.bvlc_offset = offset;
+    zassert_true(bvlc_decode_packet_header(&packet), NULL);
+    zassert_true(packet.header.valid, NULL);
+    zassert_equal(packet.npdu_offset, offset + 4, NULL);
+    zassert_equal(packet.apdu_offset, offset + 6, NULL);
+    zassert_equal(packet.header.npdu_control, 0x04, NULL);
+    zassert_equal(packet.header.pdu_type, 0x02, NULL);
+    zassert_equal(packet.header.max_segs_max_apdu, 0x05, NULL);
+    zassert_equal(packet.header.invoke_id, 0x07, NULL);
+    zassert_equal(packet.header.service_choice, 0x0C, NULL);
+    zassert_equal(packet.header.service_offset, offset + 10, NULL);
+    /* a request without service data */
+    packet.length = offset + BVLC_PACKET_HEADER_MIN;
+    encode_unsigned16(&mtu[offset + 2], BVLC_PACKET_HEADER_MIN);
+    zassert_true(bvlc_decode_packet_header(&packet), NULL);
+    zassert_equal(packet.header.service_offset, packet.length, NULL);
+    /* too short for the headers */
+    packet.length = offset + BVLC_PACKET_HEADER_MIN - 1;
+    encode_unsigned16(&mtu[offset + 2], BVLC_PACKET_HEADER_MIN - 1);
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    zassert_false(packet.header.valid, NULL);
+    /* BVLC length does not match the packet */
+    packet.length = offset + len;
+    encode_unsigned16(&mtu[offset + 2], len - 1);
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    encode_unsigned16(&mtu[offset + 2], len);
+    zassert_true(bvlc_decode_packet_header(&packet), NULL);
+    /* not an Original-Unicast-NPDU */
+    mtu[offset + 1] = BVLC_ORIGINAL_BROADCAST_NPDU;
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    mtu[offset + 1] = BVLC_ORIGINAL_UNICAST_NPDU;
+    /* NPDU of another version, or with routing, or a network message */
+    mtu[offset + 4] = 0x02;
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    mtu[offset + 4] = BACNET_PROTOCOL_VERSION;
+    mtu[offset + 5] = 0x24;
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    mtu[offset + 5] = 0x0C;
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    mtu[offset + 5] = 0x80;
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    mtu[offset + 5] = 0x04;
+    /* APDU that is unconfirmed, or segmented */
+    mtu[offset + 6] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    mtu[offset + 6] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST | 0x08;
+    zassert_false(bvlc_decode_packet_header(&packet), NULL);
+    mtu[offset + 6] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST | 0x02;
+    zassert_true(bvlc_decode_packet_header(&packet), NULL);
+    /* no packet */
+    zassert_false(bvlc_decode_packet_header(NULL), NULL);
+}
+
+/**
+ * @}
+ */
+
+
+void test_main(void)
+{
+    ztest_test_suite(bvlc_packet_tests,
+     ztest_unit_test(testBVLC_Packet_Header)
+     );
+
+    ztest_run_test_suite(bvlc_packet_tests);
+}